@@ -36,6 +36,7 @@ extern void __arch_install_irq(uint8_t, void(*)());
 extern void __arch_subscribe_irq(uint8_t);
 extern void __arch_unsubscribe_irq(uint8_t);
 extern void __arch_preempt_forever(void(*)());
+extern uint8_t __arch_timer_irq() noexcept;
 inline void __arch_hw_barrier() noexcept;
 inline void __sw_barrier() noexcept;
 extern uint64_t __arch_system_time() noexcept;
@@ -0,0 +1,116 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef FS_DENTRY_CACHE_HPP
+#define FS_DENTRY_CACHE_HPP
+
+#include <fs/dirent.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs {
+
+/**
+ * @brief      Bounded cache of path lookups, shared by all file systems
+ *
+ * @details    Entries are keyed by (device, base directory, path), where
+ *             the base is the block of the directory the path is relative
+ *             to (0 for the root). Negative entries remember paths that
+ *             don't exist, and are returned as invalid Dirents.
+ *
+ *             The least recently used entry is evicted when the cache is
+ *             full. Lookups don't allocate.
+ *
+ * @note       Like the rest of fs, not thread safe.
+ */
+class Dentry_cache {
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 512;
+
+  explicit Dentry_cache(size_t capacity = DEFAULT_CAPACITY);
+
+  /** The cache used by the file systems */
+  static Dentry_cache& get();
+
+  /**
+   * @brief      Find a cached entry
+   *
+   * @return     nullptr on a miss. The entry is valid until the next
+   *             insert or invalidation.
+   */
+  const Dirent* find(int device, uint64_t base, std::string_view path) noexcept;
+
+  /** Remember the entry at path */
+  const Dirent& insert(int device, uint64_t base, std::string_view path, const Dirent&);
+
+  /** Remember that there is nothing at path */
+  const Dirent& insert_negative(int device, uint64_t base, std::string_view path);
+
+  /** Forget everything on a device, eg. when it's (re)mounted */
+  void invalidate(int device);
+
+  void clear();
+
+  size_t size() const noexcept
+  { return count_; }
+
+  size_t capacity() const noexcept
+  { return nodes_.size(); }
+
+  uint64_t hits() const noexcept
+  { return hits_; }
+
+  uint64_t misses() const noexcept
+  { return misses_; }
+
+private:
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  struct Node {
+    uint64_t    hash   = 0;
+    int         device = -1;
+    uint64_t    base   = 0;
+    std::string path;
+    Dirent      ent {nullptr};
+    uint32_t    prev   = NIL;
+    uint32_t    next   = NIL;
+    bool        used   = false;
+  };
+
+  static uint64_t hash(int device, uint64_t base, std::string_view path) noexcept;
+
+  Node& store(int device, uint64_t base, std::string_view path);
+  void remove(uint32_t idx);
+  void unlink(uint32_t idx) noexcept;
+  void push_front(uint32_t idx) noexcept;
+
+  std::vector<Node> nodes_;
+  // hash -> node
+  std::unordered_map<uint64_t, uint32_t> index_;
+  // most and least recently used
+  uint32_t head_  = NIL;
+  uint32_t tail_  = NIL;
+  uint32_t free_  = NIL;
+  size_t   count_ = 0;
+  uint64_t hits_  = 0;
+  uint64_t misses_ = 0;
+};
+
+} //< namespace fs
+
+#endif //< FS_DENTRY_CACHE_HPP
@@ -25,7 +25,7 @@
 #include <functional>
 #include <cstdint>
 #include <memory>
-#include <map>
+#include <vector>
 
 namespace fs
 {
@@ -53,7 +53,7 @@ namespace fs
     // return information about a filesystem entity
     void   stat(Path_ptr, on_stat_func, const Dirent* const start) const override;
     Dirent stat(Path ent, const Dirent* const start) const override;
-    // async cached stat
+    // async stat, cached by its path string
     void cstat(const std::string&, on_stat_func) override;
 
     // returns the name of the filesystem
@@ -77,7 +77,7 @@ namespace fs
 
     // constructor
     FAT(hw::Block_device& dev);
-    virtual ~FAT() = default;
+    virtual ~FAT();
 
   private:
     // FAT types
@@ -124,6 +124,11 @@ namespace fs
     error_t traverse(Path path, dirvector&, const Dirent* const = nullptr) const;
     error_t int_ls(uint32_t sector, dirvector&) const;
 
+    // dentry cache key for path, "/a/b", with the end of each name in @ends
+    static std::string cache_key(const Path& path, std::vector<size_t>* ends = nullptr);
+    // sync lookup through the dentry cache, filling in every name on the way
+    Dirent resolve(const Path& path, const Dirent* const start) const;
+
     // device we can read and write sectors to
     hw::Block_device& device;
 
@@ -147,9 +152,6 @@ namespace fs
     uint32_t root_cluster;  // index of root cluster
     uint32_t data_index;    // index of first data sector (relative to partition)
     uint32_t data_sectors;  // number of data sectors
-
-    // simplistic cache for stat results
-    std::map<std::string, Dirent> stat_cache;
   };
 
 } // fs
@@ -20,6 +20,7 @@
 
 #include "common.hpp"
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace fs {
@@ -68,6 +69,13 @@ namespace fs {
     /** Cached async stat */
     virtual void cstat(const std::string& pathstr, on_stat_func) = 0;
 
+    /**
+     * Look up an absolute path through the dentry cache - sync
+     * Doesn't allocate when the path is cached. The result is invalid
+     * when there's nothing at path, and stays valid until the next lookup.
+     */
+    const Dirent& resolve(std::string_view path) const;
+
     /** Returns the name of this filesystem */
     virtual std::string name() const = 0;
 
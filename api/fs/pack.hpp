@@ -0,0 +1,175 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef FS_PACK_HPP
+#define FS_PACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace fs {
+
+/**
+ * @brief      A read-only packed image of files, built at build time
+ *             (see os_add_pack and tools/memdisk/mkpack.py) and served
+ *             straight from the memory it is linked into.
+ *
+ * @details    The image starts with a header, followed by a hashed path
+ *             index, one 64-byte entry per file, the paths, and the file
+ *             contents, each starting on a page boundary. A file can also
+ *             have pre-compressed variants (gzip, brotli).
+ *
+ *             Finding a file is a hash lookup, and its contents are a
+ *             pointer into the image: nothing is copied or allocated.
+ *
+ *             All integers are little-endian.
+ */
+class Pack {
+public:
+  struct Error : public std::runtime_error {
+    using runtime_error::runtime_error;
+  };
+
+  enum Encoding : uint8_t {
+    IDENTITY = 0,
+    GZIP     = 1,
+    BROTLI   = 2,
+    NUM_ENCODINGS
+  };
+
+  static constexpr uint64_t MAGIC   = 0x314b434150534f49ULL; // "IOSPACK1"
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t   ALIGN   = 4096;
+
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t file_count;
+    // a power of two
+    uint32_t bucket_count;
+    uint32_t reserved;
+    uint64_t buckets_offset;
+    uint64_t entries_offset;
+    uint64_t paths_offset;
+    uint64_t image_size;
+    uint64_t padding;
+  };
+  static_assert(sizeof(Header) == 64, "Header is part of the image format");
+
+  struct Entry {
+    uint64_t hash;
+    uint32_t path_offset;
+    uint32_t path_length;
+    struct {
+      uint64_t offset;
+      uint64_t size;
+    } variant[NUM_ENCODINGS];
+  };
+  static_assert(sizeof(Entry) == 64, "Entry is part of the image format");
+
+  /** A file in the image */
+  class File {
+  public:
+    std::string_view path() const noexcept
+    { return {base_ + entry_->path_offset, entry_->path_length}; }
+
+    /** Contents, or an empty view when there is no such variant */
+    std::string_view data(Encoding enc = IDENTITY) const noexcept
+    {
+      const auto& v = entry_->variant[enc];
+      return {base_ + v.offset, static_cast<size_t>(v.size)};
+    }
+
+    size_t size(Encoding enc = IDENTITY) const noexcept
+    { return entry_->variant[enc].size; }
+
+    bool has(Encoding enc) const noexcept
+    { return enc == IDENTITY or entry_->variant[enc].size != 0; }
+
+  private:
+    File(const char* base, const Entry* entry) noexcept
+      : base_{base}, entry_{entry} {}
+    const char*  base_;
+    const Entry* entry_;
+    friend class Pack;
+  };
+
+  /**
+   * @brief      Open the image at [image, image + size)
+   *
+   * @throws     Pack::Error if the image is malformed
+   */
+  Pack(const void* image, size_t size);
+
+  /** The image linked into the binary with os_add_pack */
+  static const Pack& embedded();
+
+  /** Find a file by its path, eg. "/index.html" */
+  std::optional<File> find(std::string_view path) const noexcept
+  {
+    const auto* entry = find_entry(path);
+    if (entry == nullptr) return std::nullopt;
+    return File{base_, entry};
+  }
+
+  /** Contents of a file, or an empty view */
+  std::string_view read(std::string_view path, Encoding enc = IDENTITY) const noexcept
+  {
+    const auto* entry = find_entry(path);
+    return (entry) ? File{base_, entry}.data(enc) : std::string_view{};
+  }
+
+  bool contains(std::string_view path) const noexcept
+  { return find_entry(path) != nullptr; }
+
+  size_t size() const noexcept
+  { return header().file_count; }
+
+  /** Call func(const File&) for every file */
+  template <typename Func>
+  void for_each(Func func) const
+  {
+    for (size_t i = 0; i < size(); i++)
+      func(File{base_, &entries()[i]});
+  }
+
+  /** 64-bit FNV-1a, as used by the index */
+  static uint64_t hash(std::string_view path) noexcept;
+
+private:
+  const char* base_;
+  size_t      size_;
+
+  const Header& header() const noexcept
+  { return *reinterpret_cast<const Header*>(base_); }
+
+  const uint32_t* buckets() const noexcept
+  { return reinterpret_cast<const uint32_t*>(base_ + header().buckets_offset); }
+
+  const Entry* entries() const noexcept
+  { return reinterpret_cast<const Entry*>(base_ + header().entries_offset); }
+
+  const Entry* find_entry(std::string_view path) const noexcept;
+  void validate() const;
+};
+
+} //< namespace fs
+
+#endif //< FS_PACK_HPP
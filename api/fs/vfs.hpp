@@ -20,6 +20,7 @@
 
 #include <fs/disk.hpp>
 #include <fs/filesystem.hpp>
+#include <fs/dentry_cache.hpp>
 #include <fs/path.hpp>
 #include <algorithm>
 #include <map>
@@ -323,6 +324,8 @@ namespace fs {
     static void mount(Path path, T& obj, std::string desc) {
       INFO("VFS", "Mounting %s on %s", type_name(typeid(obj)).c_str(), path.to_string().c_str());;
       mutable_root().mount<create_path, T>(path, obj, desc);
+      // mounts are rare, so just start over
+      Dentry_cache::get().clear();
     }
 
     /** Mount a path local to a disk, on a VFS path - async **/
@@ -408,6 +411,7 @@ namespace fs {
 
     static fs::Disk_ptr& insert_disk(hw::Block_device& blk) {
       Disk_ptr ptr = std::make_shared<Disk>(blk);
+      Dentry_cache::get().invalidate(blk.id());
       auto& res = (disk_map().emplace(blk.id(), ptr)).first->second;
       return res;
     }
@@ -124,6 +124,15 @@ namespace hw {
 
     virtual void add_vlan([[maybe_unused]] const int id){}
 
+    /**
+     * Reserve the index of a NIC that is constructed later, possibly on
+     * another CPU, so that indices follow the order the NICs were found in
+     */
+    static int reserve_index() noexcept;
+
+    /** The next NIC constructed on this CPU takes the reserved index, -1 for the next free */
+    static void use_index(int idx) noexcept;
+
   protected:
     /**
      *  Constructor
@@ -131,10 +140,8 @@ namespace hw {
      *  Constructed by the actual Nic Driver
      */
     Nic()
-    {
-      static int id_counter = 0;
-      N = id_counter++;
-    }
+      : N{next_index()}
+    {}
 
     std::vector<net::transmit_avail_delg> tqa_events_;
 
@@ -167,6 +174,8 @@ namespace hw {
     }
 
   private:
+    static int next_index() noexcept;
+
     int N;
     uint32_t m_buffer_limit = buffer_limit_default;
     uint32_t m_sendq_limit = sendq_limit_default;
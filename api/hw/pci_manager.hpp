@@ -38,7 +38,19 @@ public:
   using NIC_driver = delegate< std::unique_ptr<hw::Nic> (PCI_Device&, uint16_t) >;
   using Device_vector = std::vector<const hw::PCI_Device*>;
   using Devinfo_vector = std::vector<pcidev_info>;
-  static void register_nic(uint16_t, uint16_t, NIC_driver);
+  /**
+   * Register a NIC driver. When @movable, the driver can be constructed
+   * on any CPU and moved with Nic::move_to_this_cpu() afterwards, which
+   * lets the NICs be initialized in parallel on all CPUs during boot.
+   */
+  static void register_nic(uint16_t, uint16_t, NIC_driver, bool movable = false);
+
+  /**
+   * Whether NICs are initialized in parallel when there is more than one
+   * CPU. On unless built with NO_PARALLEL_NIC_INIT. Takes effect when set
+   * before the devices are initialized, e.g. from a constructor.
+   */
+  static void parallel_nic_init(bool enabled) noexcept;
 
   using BLK_driver = delegate< std::unique_ptr<hw::Block_device> (PCI_Device&) >;
   static void register_blk(uint16_t, uint16_t, BLK_driver);
@@ -22,7 +22,9 @@
 
 #include <os>
 #include <hw/ioport.hpp>
+#include <util/ringbuffer.hpp>
 #include <cstdio>
+#include <memory>
 #include <debug>
 
 namespace hw {
@@ -54,6 +56,7 @@ namespace hw {
 
     char read();
     void write(char c);
+    void write(const char* str, size_t len);
     int received();
     int is_transmit_empty();
 
@@ -73,6 +76,25 @@ namespace hw {
     /** Send the EOT ASCII character. Effectively signal EOF to the receiving terminal. **/
     static void EOT();
 
+    /**
+     * Buffer output and send it from the transmitter empty interrupt,
+     * instead of waiting for the UART after every byte. Output that doesn't
+     * fit in the buffer is dropped and counted. While the kernel is panicking
+     * output is written synchronously.
+     * On port 1 this also applies to the default stdout.
+     */
+    void enable_buffered_output(int capacity = 16384);
+
+    bool is_buffered() const noexcept
+    { return tx_buf_ != nullptr; }
+
+    /** Synchronously write out all buffered output **/
+    void flush();
+
+    /** Number of bytes dropped because the output buffer was full **/
+    uint64_t dropped() const noexcept
+    { return tx_dropped_ ? *tx_dropped_ : 0; }
+
   private:
     void print_handler(const char*, size_t);
 
@@ -83,12 +105,17 @@ namespace hw {
     int port_   {PORTS[0]};
     uint8_t irq_{IRQS[0]};
     std::string buf{};
+    uint8_t ier_ = 0;
+    std::unique_ptr<HeapRingBuffer> tx_buf_;
+    uint64_t* tx_dropped_ = nullptr;
 
     on_data_handler on_data_       = [](char c){ debug("Default on_data: %c \n", c); (void)c; };
     on_string_handler on_readline_ = [](const std::string& s) { (void)s; };
 
     void irq_handler_ ();
     void readline_handler_(char c);
+    void subscribe_irq();
+    void transmit();
   };
 
 }
@@ -0,0 +1,72 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef KERNEL_BOOT_TRACE_HPP
+#define KERNEL_BOOT_TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Boot tracer
+ *
+ * Records the CPU cycle counter at the end of each boot phase, from
+ * kernel_start until Service::ready, into a fixed buffer. Recording
+ * doesn't allocate, so it can be used before libc and the heap exist.
+ *
+ * Each event is named after the phase that just ended, and the phase
+ * took the cycles since the previous event (or begin()).
+ */
+namespace kernel::boot_trace {
+
+  static constexpr size_t MAX_EVENTS = 64;
+  static constexpr size_t MAX_NAME   = 31;
+
+  struct Event {
+    char     name[MAX_NAME+1];
+    // cycle counter at the end of the phase
+    uint64_t cycles;
+  };
+
+  /** Start the trace at @cycles, discarding any earlier events */
+  void begin(uint64_t cycles) noexcept;
+
+  /** Record the end of a phase */
+  void mark(const char* phase) noexcept;
+  void mark(const char* phase, uint64_t cycles) noexcept;
+
+  uint64_t begin_cycles() noexcept;
+
+  /** The recorded events, in order */
+  const Event* events() noexcept;
+  size_t size() noexcept;
+
+  /** Number of events that didn't fit in the buffer */
+  size_t dropped() noexcept;
+
+  /** Cycles spent in event @i's phase */
+  uint64_t duration(size_t i) noexcept;
+
+  /** Publish the phases to Statman, as boot.<phase> in microseconds */
+  void to_statman();
+
+  /** Print the breakdown of the phases to stdout */
+  void print();
+
+} //< kernel::boot_trace
+
+#endif
@@ -123,6 +123,17 @@ namespace CPUID
   bool has_feature(Feature f);
 
   bool kvm_feature(unsigned mask) noexcept;
+
+  /**
+   * TSC frequency reported by the hypervisor timing leaf (0x40000010)
+   * or CPUID leaf 0x15/0x16, or 0 when the CPU doesn't tell
+   */
+  uint64_t tsc_khz() noexcept;
+  /**
+   * Local APIC timer input frequency (before the divider), from the
+   * hypervisor timing leaf or the core crystal, or 0 when unknown
+   */
+  uint64_t apic_timer_khz() noexcept;
 } //< CPUID
 
 
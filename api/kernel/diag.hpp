@@ -2,6 +2,8 @@
 #define KERNEL_DIAG_HOOKS_HPP
 #define RUN_DIAG_HOOKS true
 
+#include <kernel/boot_trace.hpp>
+
 constexpr bool run_diag_hooks = RUN_DIAG_HOOKS;
 
 namespace kernel::diag {
@@ -12,8 +14,10 @@ namespace kernel::diag {
 
   void default_post_init_libc() noexcept;
 
+  // ends a boot phase, see kernel/boot_trace.hpp
   template <auto Func>
-  void hook() {
+  void hook(const char* phase) {
+    boot_trace::mark(phase);
     if constexpr (run_diag_hooks) {
       Func();
     }
@@ -42,6 +42,10 @@ struct Elf
   static uintptr_t
     resolve_name(const std::string& name);
 
+  // sort the symbols by address, making address lookups O(log n)
+  // uses the heap, lookups fall back to a linear scan until called
+  static void build_symbol_index();
+
   // returns the address of the first byte after the ELF header
   // and all static and dynamic sections
   static size_t end_of_file();
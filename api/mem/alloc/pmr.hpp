@@ -93,12 +93,16 @@ namespace os::mem {
     /** Fires on transition from < N bytes to >= N bytes allocatable **/
     void on_avail(std::size_t N, Event e) { avail_thresh = N; avail = e; }
 
+    /** Limit to N bytes instead of a share of the pool (0 for the share) **/
+    void set_capacity(std::size_t N) { cap_ = N; }
+
   private:
     Pool_ptr pool_;
     std::size_t used = 0;
     std::size_t allocs = 0;
     std::size_t deallocs = 0;
     std::size_t avail_thresh = 0;
+    std::size_t cap_ = 0;
     Event non_full{};
     Event avail{};
   };
@@ -0,0 +1,92 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_BOTAN_SESSION_MANAGER_HPP
+#define NET_BOTAN_SESSION_MANAGER_HPP
+
+#include <botan/tls_session_manager.h>
+#include <net/tls/session_cache.hpp>
+
+namespace net
+{
+namespace botan
+{
+/**
+ * Botan session manager on top of the session cache shared by the
+ * TLS servers. Sessions are stored DER-encoded, keyed by session ID.
+ */
+class Session_manager : public Botan::TLS::Session_Manager
+{
+public:
+  static Session_manager& get()
+  {
+    static Session_manager manager;
+    return manager;
+  }
+
+  bool load_from_session_id(const std::vector<uint8_t>& session_id,
+                            Botan::TLS::Session& session) override
+  {
+    auto der = cache().find(key(session_id));
+    if (der.empty()) return false;
+    try {
+      session = Botan::TLS::Session((const uint8_t*) der.data(), der.size());
+      return true;
+    }
+    catch (const std::exception&) {
+      cache().remove(key(session_id));
+      return false;
+    }
+  }
+
+  // only used by clients
+  bool load_from_server_info(const Botan::TLS::Server_Information&,
+                             Botan::TLS::Session&) override
+  { return false; }
+
+  void remove_entry(const std::vector<uint8_t>& session_id) override
+  { cache().remove(key(session_id)); }
+
+  size_t remove_all() override
+  {
+    const size_t n = cache().size();
+    cache().clear();
+    return n;
+  }
+
+  void save(const Botan::TLS::Session& session) override
+  {
+    const auto der = session.DER();
+    cache().store(key(session.session_id()),
+                  {(const char*) der.data(), der.size()});
+  }
+
+  std::chrono::seconds session_lifetime() const override
+  { return cache().lifetime(); }
+
+private:
+  static net::tls::Session_cache& cache()
+  { return net::tls::Session_cache::get(); }
+
+  static std::string_view key(const std::vector<uint8_t>& id)
+  { return {(const char*) id.data(), id.size()}; }
+};
+
+} // botan
+} // net
+
+#endif
@@ -25,6 +25,7 @@
 #include <botan/tls_callbacks.h>
 #include <net/tcp/connection.hpp>
 #include <net/botan/credman.hpp>
+#include <net/botan/session_manager.hpp>
 
 namespace net
 {
@@ -37,8 +38,7 @@ public:
          Botan::RandomNumberGenerator& rng,
          Botan::Credentials_Manager& credman)
   : m_creds{credman},
-    m_session_manager{},
-    m_tls{*this, m_session_manager, m_creds, m_policy, rng},
+    m_tls{*this, Session_manager::get(), m_creds, m_policy, rng},
     m_transport{std::move(remote)}
   {
     assert(m_transport->is_connected());
@@ -217,7 +217,6 @@ private:
 
   Botan::Credentials_Manager&   m_creds;
   Botan::TLS::Strict_Policy     m_policy;
-  Botan::TLS::Session_Manager_Noop m_session_manager;
 
   Botan::TLS::Server m_tls;
   net::Stream_ptr    m_transport = nullptr;
@@ -22,6 +22,7 @@
 #include <net/ip4/ip4.hpp>
 #include <net/udp/socket.hpp>
 #include <util/timer.hpp>
+#include <list>
 #include <map>
 #include <unordered_map>
 #include "query.hpp"
@@ -33,11 +34,21 @@ namespace net
 }
 namespace net::dns {
   /**
-   * @brief      A simple DNS client which is able to resolve hostnames
-   *             and locally cache them.
+   * @brief      A DNS client which is able to resolve hostnames
+   *             and locally cache the answers.
    *
-   * @note       A entry can stay longer than TTL due to flush timer granularity.
-   *             Max_TTL = TTL + FLUSH_INTERVAL (90s default)
+   * @details    Answers are cached by name and record type for the smallest
+   *             TTL of their records (following CNAME chains), bounded by
+   *             the cache TTL. Negative answers (no such name or no records
+   *             of the type) are cached by the SOA minimum (RFC 2308).
+   *             A CNAME without records of the type is not cached.
+   *             Resolves of a name already being resolved wait for the same
+   *             query, popular entries are refreshed shortly before they
+   *             expire, and the least recently used entries are evicted
+   *             when the cache is full.
+   *
+   * @note       A entry can stay longer than TTL due to flush timer granularity,
+   *             but is never served after it has expired.
    */
   class Client
   {
@@ -47,24 +58,51 @@ namespace net::dns {
     using Address         = net::Addr;
     using Hostname        = std::string;
     using timestamp_t     = RTC::timestamp_t;
+
     /**
-     * @brief      A simple cache entry containing the resolved IP address
-     *             and a timestamp when it expires (based on uptime)
+     * @brief      What is cached, a (lowercase) name and a record type
      */
-    struct Cache_entry
+    struct Cache_key
     {
-      Address     address;
-      timestamp_t expires;
+      Hostname    name;
+      Record_type rtype;
+
+      bool operator==(const Cache_key& other) const noexcept
+      { return rtype == other.rtype and name == other.name; }
+    };
 
-      Cache_entry(Address addr, const timestamp_t exp) noexcept
-        : address{std::move(addr)}, expires{exp}
-      {}
+    struct Cache_key_hash
+    {
+      size_t operator()(const Cache_key& key) const noexcept
+      { return std::hash<Hostname>{}(key.name) ^ static_cast<size_t>(key.rtype); }
     };
-    using Cache           = std::unordered_map<Hostname, Cache_entry>;
+
+    /**
+     * @brief      A cache entry containing the answer records (empty if negative),
+     *             the first resolved IP address and a timestamp when it expires
+     *             (based on uptime)
+     */
+    struct Cache_entry
+    {
+      Address             address;
+      timestamp_t         expires;
+      uint32_t            ttl;
+      Response_code       rcode;
+      std::vector<Record> answers;
+      // where it was resolved, to refresh it
+      Address             server;
+      std::list<Cache_key>::iterator lru;
+
+      bool is_negative() const noexcept
+      { return answers.empty(); }
+    };
+    using Cache           = std::unordered_map<Cache_key, Cache_entry, Cache_key_hash>;
 
     static Timer::duration_t DEFAULT_RESOLVE_TIMEOUT; // 5s, client.cpp
-    static Timer::duration_t DEFAULT_FLUSH_INTERVAL; // 60s, client.cpp
-    static std::chrono::seconds DEFAULT_CACHE_TTL; // 60s, client.cpp
+    static Timer::duration_t DEFAULT_FLUSH_INTERVAL; // 30s, client.cpp
+    static std::chrono::seconds DEFAULT_CACHE_TTL; // 3600s, client.cpp
+    static std::chrono::seconds DEFAULT_NEGATIVE_TTL; // 300s, client.cpp
+    static size_t DEFAULT_CACHE_SIZE; // 1024, client.cpp
 
     /**
      * @brief      Construct a DNS client on a given interface (stack),
@@ -75,10 +113,11 @@ namespace net::dns {
     Client(Stack& stack);
 
     /**
-     * @brief      Resolve a hostname for an IP4 address with a timeout duration
+     * @brief      Resolve a hostname for an IP address with a timeout duration
      *             and an option whether to force the request, disabling cache lookup.
-     *             Invokes the resolve handler with the address and a error (if any happend).
-     *             The address can be 0 (INADDR_ANY) which means that
+     *             Asks for AAAA records from an IPv6 server, A records otherwise.
+     *             Invokes the resolve handler with the response and a error (if any happend).
+     *             The response has no address when
      *             1) either the hostname was not found or
      *             2) the request timed out.
      *
@@ -92,7 +131,11 @@ namespace net::dns {
                  Hostname           hostname,
                  Resolve_handler    handler,
                  Timer::duration_t  timeout,
-                 bool               force = false);
+                 bool               force = false)
+    {
+      const auto rtype = dns_server.is_v6() ? Record_type::AAAA : Record_type::A;
+      resolve(dns_server, std::move(hostname), rtype, std::move(handler), timeout, force);
+    }
 
     /**
      * @brief      Resolve a hostname with default timeout.
@@ -105,6 +148,16 @@ namespace net::dns {
       resolve(dns_server, std::move(hostname), std::move(handler), DEFAULT_RESOLVE_TIMEOUT, force);
     }
 
+    /**
+     * @brief      Resolve records of a given type for a hostname.
+     */
+    void resolve(Address            dns_server,
+                 Hostname           hostname,
+                 Record_type        rtype,
+                 Resolve_handler    handler,
+                 Timer::duration_t  timeout,
+                 bool               force = false);
+
     /**
      * @brief      Flush the cache, removing all entries.
      */
@@ -119,7 +172,7 @@ namespace net::dns {
     { return cache_; }
 
     /**
-     * @brief      Returns the time to live value of an entry in the cache.
+     * @brief      Returns the longest time an entry stays in the cache.
      *
      * @return     Time to live in seconds
      */
@@ -127,7 +180,8 @@ namespace net::dns {
     { return cache_ttl_; }
 
     /**
-     * @brief      Sets the time to live for a cache entry
+     * @brief      Sets the longest time to live for a cache entry,
+     *             shorter record TTLs are respected.
      *             A value of zero means caching is disabled.
      *
      * @param[in]  ttl   The ttl in seconds
@@ -135,6 +189,19 @@ namespace net::dns {
     void set_cache_ttl(std::chrono::seconds ttl)
     { cache_ttl_ = ttl; }
 
+    /**
+     * @brief      Sets the longest time to cache a negative answer.
+     *             A value of zero disables negative caching.
+     */
+    void set_negative_ttl(std::chrono::seconds ttl)
+    { negative_ttl_ = ttl; }
+
+    /**
+     * @brief      Sets the maximum number of cache entries
+     */
+    void set_cache_size(size_t entries)
+    { cache_size_ = entries; }
+
     /**
      * @brief      Disables caching
      */
@@ -144,39 +211,52 @@ namespace net::dns {
     /**
      * @brief      Enables caching
      *
-     * @param[in]  ttl   The ttl for a cache entry (optional)
+     * @param[in]  ttl   The longest ttl for a cache entry (optional)
      */
     void enable_cache(std::chrono::seconds ttl = DEFAULT_CACHE_TTL)
     { set_cache_ttl(ttl); }
 
+    uint64_t cache_hits() const noexcept
+    { return cache_hits_; }
+
+    uint64_t cache_misses() const noexcept
+    { return cache_misses_; }
+
+    /** Resolves answered by a query already in flight */
+    uint64_t coalesced() const noexcept
+    { return coalesced_; }
+
     static bool is_FQDN(const std::string& hostname)
     { return hostname.find('.') != std::string::npos; }
 
   private:
     Stack&                stack_;
     Cache                 cache_;
+    // most recently used first
+    std::list<Cache_key>  lru_;
     std::chrono::seconds  cache_ttl_;
+    std::chrono::seconds  negative_ttl_;
+    size_t                cache_size_;
     Timer                 flush_timer_;
+    uint64_t              cache_hits_   = 0;
+    uint64_t              cache_misses_ = 0;
+    uint64_t              coalesced_    = 0;
 
     /**
-     * @brief      Receive a UDP message with a (hopefully) DNS response
-     *             to one of our requests.
+     * @brief      Cache the answer of a response (or the lack of one).
      *
-     * @param[in]  <unnamed>  From whom address
-     * @param[in]  <unnamed>  From whom port
-     * @param[in]  data       The raw data containing the msg
-     * @param[in]  <unnamed>  Size of the data
+     * @param[in]  key       What was asked
+     * @param[in]  server    Where it was asked
+     * @param[in]  res       The response
      */
-    void receive_response(Address, udp::port_t, const char* data, size_t);
+    void add_cache_entry(const Cache_key& key, Address server, const Response& res);
 
     /**
-     * @brief      Adds a cache entry.
-     *
-     * @param[in]  hostname  The hostname
-     * @param[in]  addr      The address
-     * @param[in]  ttl       The ttl
+     * @brief      Create a response from a cache entry, with the remaining ttl
      */
-    void add_cache_entry(const Hostname& hostname, Address addr, std::chrono::seconds ttl);
+    Response_ptr cached_response(const Cache_entry&, timestamp_t now) const;
+
+    void erase(Cache::iterator it);
 
     /**
      * @brief      Flush all expired cache entries.
@@ -184,6 +264,12 @@ namespace net::dns {
      */
     void flush_expired();
 
+    /**
+     * @brief      Send a query, or wait for one already in flight
+     */
+    void query(Cache_key key, Address server, Resolve_handler handler,
+               Timer::duration_t timeout);
+
     /**
      * @brief      Returns a timestamp used when calculating TTL.
      *
@@ -194,7 +280,7 @@ namespace net::dns {
 
     /**
      * @brief      An internal client request. Contains the DNS request itself,
-     *             the callback to be called when resolved (or timedout) and
+     *             the callbacks to be called when resolved (or timedout) and
      *             a timeout timer.
      */
     struct Request
@@ -206,8 +292,10 @@ namespace net::dns {
       Response_ptr    response;
 
       udp::Socket&    socket;
+      Address         server;
 
-      Resolve_handler callback;
+      // everyone waiting for this answer, none for a refresh
+      std::vector<Resolve_handler> callbacks;
       Timer           timer;
 
       Request(Client& cli, udp::Socket& sock, dns::Query q, Resolve_handler cb);
@@ -224,7 +312,7 @@ namespace net::dns {
 
       /**
        * @brief      Finish the request with a no error,
-       *             invoking the resolve handler (callback)
+       *             invoking the resolve handlers (callbacks)
        */
       void finish(const Error& err);
 
@@ -235,6 +323,8 @@ namespace net::dns {
     using Requests = std::unordered_map<dns::id_t, Request>;
     /** Pending requests (not yet resolved) */
     Requests requests_;
+    /** The pending request for each name and type */
+    std::unordered_map<Cache_key, dns::id_t, Cache_key_hash> inflight_;
   };
 }
 
@@ -87,6 +87,10 @@ namespace net::dns {
     A     = 1,
     NS    = 2,
     ALIAS = 5,
+    SOA   = 6,
+    PTR   = 12,
+    MX    = 15,
+    TXT   = 16,
     AAAA  = 28
   };
 
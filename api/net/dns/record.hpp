@@ -29,6 +29,8 @@ namespace net::dns {
     uint32_t    ttl;
     uint16_t    data_len;
     std::string rdata;
+    // SOA only: the minimum field, bounding negative caching (RFC 2308)
+    uint32_t    soa_minimum = 0;
 
     Record() = default;
 
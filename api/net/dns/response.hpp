@@ -30,6 +30,7 @@ namespace net::dns {
       parse(buffer, len);
     }
 
+    Response_code       rcode = Response_code::NO_ERROR;
     std::vector<Record> answers;
     std::vector<Record> auth;
     std::vector<Record> addit;
@@ -40,6 +41,12 @@ namespace net::dns {
 
     bool has_addr() const;
 
+    /** Whether the answers contain a record of the type */
+    bool has_answer(Record_type) const;
+
+    /** Seconds a negative answer may be cached (RFC 2308), 0 without a SOA */
+    uint32_t negative_ttl() const;
+
     int parse(const char* buffer, size_t len);
   };
 
@@ -0,0 +1,161 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_DNS_SERVER_HPP
+#define NET_DNS_SERVER_HPP
+
+#include "zone.hpp"
+#include <net/tcp/common.hpp>
+#include <net/udp/socket.hpp>
+#include <rtc>
+#include <util/timer.hpp>
+#include <memory>
+#include <unordered_map>
+
+namespace net
+{
+  class Inet;
+  namespace tcp { class Listener; }
+}
+namespace net::dns {
+
+  /**
+   * @brief      A DNS server answering from a Zone_table over UDP and TCP,
+   *             optionally forwarding queries for other names upstream.
+   *
+   * @details    UDP queries are received in batches and answered in place
+   *             in the outgoing packet buffers. Queries for names outside
+   *             the zones are refused, or relayed to the forwarder with a
+   *             new ID when one is set.
+   *
+   *             load() swaps in a new table between queries, so a reload
+   *             is atomic: each query sees either the old or the new
+   *             zones. A table can be shared by servers on several stacks.
+   *
+   * @code
+   *   auto& server = *new dns::Server{inet};
+   *   server.load(zones);
+   *   server.listen();
+   * @endcode
+   */
+  class Server {
+  public:
+    using Stack      = Inet;
+    using Table_ptr  = std::shared_ptr<const Zone_table>;
+    using port_t     = uint16_t;
+
+    static Timer::duration_t FORWARD_TIMEOUT; // 5s, server.cpp
+    static constexpr size_t MAX_FORWARDED = 4096;
+    static constexpr size_t MAX_TCP_MESSAGE = 0xFFFF;
+
+    Server(Stack& stack, port_t port = SERVICE_PORT);
+
+    ~Server();
+
+    /** Start answering on the UDP and TCP port */
+    void listen();
+
+    /**
+     * @brief      Compile zones and start answering from them
+     *
+     * @throws     Zone_error if the zones are invalid, the old zones
+     *             are kept
+     */
+    void load(const std::vector<Zone>& zones)
+    { load(std::make_shared<const Zone_table>(zones)); }
+
+    /** Start answering from a compiled table */
+    void load(Table_ptr table)
+    { table_ = std::move(table); }
+
+    const Zone_table* table() const noexcept
+    { return table_.get(); }
+
+    /** Forward queries for names outside the zones to a recursive server */
+    void set_forwarder(net::Addr server, port_t port = SERVICE_PORT);
+
+    port_t port() const noexcept
+    { return port_; }
+
+    uint64_t queries() const noexcept
+    { return queries_; }
+
+    uint64_t refused() const noexcept
+    { return refused_; }
+
+    uint64_t forwarded() const noexcept
+    { return forwarded_; }
+
+    /** Queries not answered, for lack of packet buffers or forwarding slots */
+    uint64_t dropped() const noexcept
+    { return dropped_; }
+
+  private:
+    struct Forwarded
+    {
+      net::Addr client;
+      port_t    port;
+      id_t      id;       // the client's
+      std::weak_ptr<tcp::Connection> conn; // when asked over TCP
+      bool      tcp;
+      RTC::timestamp_t sent;
+    };
+
+    Stack&        stack_;
+    const port_t  port_;
+    Table_ptr     table_;
+    udp::Socket*  socket_   = nullptr;
+    tcp::Listener* listener_ = nullptr;
+
+    udp::Socket*  upstream_ = nullptr;
+    net::Addr     forwarder_;
+    port_t        forwarder_port_ = 0;
+    std::unordered_map<id_t, Forwarded> pending_;
+    Timer         forward_timer_;
+    // the response to a TCP query
+    std::vector<uint8_t> tcp_buf_;
+
+    uint64_t queries_   = 0;
+    uint64_t refused_   = 0;
+    uint64_t forwarded_ = 0;
+    uint64_t dropped_   = 0;
+
+    void receive(const udp::Datagram* datagrams, size_t count);
+
+    void on_connect(tcp::Connection_ptr conn);
+    void receive_tcp(std::weak_ptr<tcp::Connection> conn, std::vector<uint8_t>& msgs,
+                     const uint8_t* data, size_t len);
+
+    /**
+     * @brief      Write the response to a query
+     *
+     * @return     The response length, 0 if there is none (yet)
+     */
+    size_t respond(const uint8_t* query, size_t len, uint8_t* out, size_t max,
+                   net::Addr client, port_t port, std::weak_ptr<tcp::Connection> conn);
+
+    bool forward(const uint8_t* query, size_t len, net::Addr client, port_t port,
+                 std::weak_ptr<tcp::Connection> conn);
+    void receive_upstream(net::Addr, port_t, const char* data, size_t len);
+    void expire_forwarded();
+
+    static void write_tcp(tcp::Connection& conn, const uint8_t* msg, size_t len);
+  };
+
+}
+
+#endif
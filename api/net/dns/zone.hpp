@@ -0,0 +1,204 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_DNS_ZONE_HPP
+#define NET_DNS_ZONE_HPP
+
+#include "dns.hpp"
+#include <net/ip4/addr.hpp>
+#include <net/ip6/addr.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace net::dns {
+
+  class Zone_error : public std::runtime_error {
+    using runtime_error::runtime_error;
+  };
+
+  /**
+   * @brief      The records of a zone, to be compiled into a Zone_table.
+   *
+   * @details    Names are relative to the origin unless they end with a dot,
+   *             "@" (or an empty name) is the origin itself. A TTL of 0 means
+   *             the zone default.
+   *
+   * @code
+   *   Zone zone{"example.com"};
+   *   zone.soa("ns1.example.com.", "hostmaster.example.com.", 2018010101)
+   *       .add_ns("@", "ns1")
+   *       .add("ns1", ip4::Addr{10,0,0,1})
+   *       .add("www", ip4::Addr{10,0,0,2})
+   *       .add_cname("ftp", "www");
+   * @endcode
+   */
+  class Zone {
+  public:
+    /**
+     * @brief      A record, with its rdata split in raw bytes and
+     *             domain names (which are compressed when compiled):
+     *             rdata = prefix + names... + suffix
+     */
+    struct Entry {
+      std::string name; // absolute, lowercase, without the trailing dot
+      Record_type rtype;
+      uint32_t    ttl;
+      std::string prefix;
+      std::vector<std::string> names;
+      std::string suffix;
+    };
+
+    explicit Zone(std::string origin, uint32_t ttl = 3600);
+
+    /** The start of authority, required */
+    Zone& soa(const std::string& mname, const std::string& rname,
+              uint32_t serial,
+              uint32_t refresh = 7200,
+              uint32_t retry   = 3600,
+              uint32_t expire  = 1209600,
+              uint32_t minimum = 300);
+
+    Zone& add(const std::string& name, ip4::Addr addr, uint32_t ttl = 0);
+    Zone& add(const std::string& name, ip6::Addr addr, uint32_t ttl = 0);
+    Zone& add_ns(const std::string& name, const std::string& target, uint32_t ttl = 0);
+    Zone& add_cname(const std::string& name, const std::string& target, uint32_t ttl = 0);
+    Zone& add_ptr(const std::string& name, const std::string& target, uint32_t ttl = 0);
+    Zone& add_mx(const std::string& name, uint16_t preference,
+                 const std::string& exchange, uint32_t ttl = 0);
+    Zone& add_txt(const std::string& name, const std::string& text, uint32_t ttl = 0);
+
+    const std::string& origin() const noexcept
+    { return origin_; }
+
+    uint32_t default_ttl() const noexcept
+    { return ttl_; }
+
+    const std::vector<Entry>& entries() const noexcept
+    { return entries_; }
+
+    /** The SOA entry, nullptr if not set */
+    const Entry* soa() const noexcept;
+
+  private:
+    std::string origin_;
+    uint32_t    ttl_;
+    std::vector<Entry> entries_;
+
+    std::string absolute(const std::string& name) const;
+    Entry& add_entry(const std::string& name, Record_type rtype, uint32_t ttl);
+  };
+
+  /**
+   * @brief      The compiled, read-only form of a set of zones.
+   *
+   * @details    Names are stored in a trie of labels, with identical labels
+   *             shared. The children of a node are contiguous and sorted,
+   *             and found by binary search. Every name and record type has
+   *             its complete response precomputed in wire format, so
+   *             answering a query is a lookup, a copy and patching in the
+   *             query ID and question. Negative answers (NXDOMAIN/NODATA)
+   *             carry the zone SOA (RFC 2308).
+   *
+   *             Compile a new table and swap it in to reload zones,
+   *             a table never changes once built.
+   */
+  class Zone_table {
+  public:
+    /** Largest response without EDNS (RFC 1035) */
+    static constexpr size_t MAX_UDP_SIZE = 512;
+
+    /**
+     * @brief      Compile zones
+     *
+     * @throws     Zone_error if a zone has no SOA, two zones have the same
+     *             origin, a name is outside its zone or invalid, or a name
+     *             has a CNAME and other records.
+     */
+    explicit Zone_table(const std::vector<Zone>& zones);
+
+    /**
+     * @brief      Write the response to a query
+     *
+     * @param[in]  query  The query message
+     * @param[in]  len    The query length
+     * @param      out    Where to write the response
+     * @param[in]  max    The largest response, it is truncated (TC) if larger
+     *
+     * @return     The response length, or 0 if the name is not in any zone
+     *             (for the caller to refuse or forward)
+     */
+    size_t respond(const uint8_t* query, size_t len, uint8_t* out, size_t max) const;
+
+    /**
+     * @brief      Write an empty response with an error code, echoing the
+     *             question if it can be parsed
+     *
+     * @return     The response length, 0 if the query has no header
+     */
+    static size_t error_response(const uint8_t* query, size_t len, Response_code rcode,
+                                 uint8_t* out, size_t max);
+
+    /** Whether a message is a query (has a header and QR is clear) */
+    static bool is_query(const uint8_t* msg, size_t len) noexcept
+    { return len >= sizeof(Header) and (msg[2] & 0x80) == 0; }
+
+    size_t zones() const noexcept
+    { return zones_.size(); }
+
+    size_t nodes() const noexcept
+    { return nodes_.size(); }
+
+    /** Bytes used by the compiled table */
+    size_t memory_usage() const noexcept;
+
+  private:
+    struct Node {
+      uint32_t label;     // offset of the length prefixed label in labels_
+      uint32_t children;  // index of the first child
+      uint32_t nchildren;
+      int32_t  zone;      // index of the zone with this apex, -1 if none
+      uint32_t answers;   // index of the first answer
+      uint16_t nanswers;
+    };
+    struct Answer {
+      uint16_t rtype;
+      uint32_t offset;    // of the response in wire_
+      uint32_t len;
+    };
+    struct Zone_info {
+      uint32_t    apex_len; // wire length of the origin
+      std::string soa;      // SOA record after its owner name
+    };
+
+    std::vector<Node>      nodes_;
+    std::vector<Answer>    answers_;
+    std::vector<Zone_info> zones_;
+    std::string            labels_;
+    std::string            wire_;
+
+    struct Build_node;
+    void flatten(Build_node& root);
+
+    int find_child(const Node& node, const uint8_t* label, uint8_t len) const noexcept;
+    size_t negative(const uint8_t* query, size_t qlen, const Zone_info& zone,
+                    Response_code rcode, uint8_t* out, size_t max) const;
+  };
+
+}
+
+#endif
@@ -49,6 +49,15 @@ namespace net {
       return "eth" + std::to_string(ethernet_idx);
     }
 
+    /**
+     * Reserve the name index of a link constructed later, possibly on
+     * another CPU, so that names follow the order the NICs were found in
+     */
+    static int reserve_index() noexcept;
+
+    /** The next link constructed on this CPU takes the reserved index, -1 for the next free */
+    static void use_index(int idx) noexcept;
+
     /** Bottom upstream input, "Bottom up". Handle raw ethernet buffer. */
     void receive(Packet_ptr);
 
@@ -115,6 +124,8 @@ namespace net {
     { return trailer_packets_dropped_; }
 
   protected:
+    static int next_index() noexcept;
+
     const addr& mac_;
     int   ethernet_idx;
 
@@ -0,0 +1,399 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_FILTER_CLASSIFIER_HPP
+#define NET_FILTER_CLASSIFIER_HPP
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <expects>
+#include "netfilter.hpp"
+#include "ip4/addr.hpp"
+#include "ip6/addr.hpp"
+
+namespace net {
+
+/**
+ * @brief      A compiled packet classifier for filter chains.
+ *
+ * @details    Holds an ordered list of match rules (src/dst prefix,
+ *             protocol, src/dst port, conntrack state) and the verdict
+ *             for each. The first matching rule decides, like a chain
+ *             of compare-and-branch filters would.
+ *
+ *             Rules are compiled into a tuple space: rules with the same
+ *             shape (prefix lengths, and which fields are matched) share
+ *             one hash table on the masked fields, so a packet is
+ *             classified with one lookup per distinct shape instead of
+ *             one test per rule. Tables are visited in order of their
+ *             first rule, and the search stops once no table can hold a
+ *             rule earlier than the best match found so far.
+ *             Rules with port ranges (other than a single port or any)
+ *             are tested one by one.
+ *
+ *             Port matches only apply to TCP and UDP packets.
+ *
+ *             Use filter() to get a Packetfilter for a Filter_chain.
+ *
+ * @tparam     IPV   IP Version (IP4 or IP6)
+ */
+template <typename IPV>
+class Filter_classifier {
+public:
+  using Addr          = typename IPV::addr;
+  using IP_packet     = typename IPV::IP_packet;
+  using IP_packet_ptr = typename IPV::IP_packet_ptr;
+
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr uint8_t  addr_bits = sizeof(Addr) * 8;
+
+  struct Prefix {
+    Addr    addr {};
+    uint8_t length = 0; // 0 matches any address
+  };
+
+  struct Port_range {
+    uint16_t min = 0;
+    uint16_t max = 0xFFFF;
+
+    bool any() const noexcept
+    { return min == 0 and max == 0xFFFF; }
+
+    bool exact() const noexcept
+    { return min == max; }
+
+    bool contains(const uint16_t port) const noexcept
+    { return port >= min and port <= max; }
+  };
+
+  struct Rule {
+    Prefix                          src;
+    Prefix                          dst;
+    std::optional<Protocol>         proto;
+    Port_range                      sport;
+    Port_range                      dport;
+    std::optional<Conntrack::State> ct_state;
+    Filter_verdict_type             verdict = Filter_verdict_type::ACCEPT;
+  };
+
+  /**
+   * @brief      Construct an empty classifier
+   *
+   * @param[in]  default_verdict  Verdict when no rule matches
+   */
+  explicit Filter_classifier(Filter_verdict_type default_verdict = Filter_verdict_type::ACCEPT)
+    : default_verdict_{default_verdict}
+  {}
+
+  /**
+   * @brief      Append a rule. Takes effect at the next compile().
+   *
+   * @return     The rule's id (its position)
+   */
+  size_t add(Rule rule)
+  {
+    Expects(rule.src.length <= addr_bits and rule.dst.length <= addr_bits);
+    Expects(rule.sport.min <= rule.sport.max and rule.dport.min <= rule.dport.max);
+    rule.src.addr = mask(rule.src.addr, rule.src.length);
+    rule.dst.addr = mask(rule.dst.addr, rule.dst.length);
+    rules_.push_back(std::move(rule));
+    hits_.push_back(0);
+    compiled_ = false;
+    return rules_.size() - 1;
+  }
+
+  void clear()
+  {
+    rules_.clear();
+    hits_.clear();
+    tuples_.clear();
+    linear_.clear();
+    misses_ = 0;
+    compiled_ = false;
+  }
+
+  /**
+   * @brief      Build the lookup tables from the rules. Done automatically
+   *             on the first packet after the rules changed.
+   */
+  void compile()
+  {
+    tuples_.clear();
+    linear_.clear();
+
+    for (uint32_t id = 0; id < rules_.size(); id++)
+    {
+      const auto& rule = rules_[id];
+      if (not (rule.sport.any() or rule.sport.exact())
+       or not (rule.dport.any() or rule.dport.exact()))
+      {
+        linear_.push_back(id);
+        continue;
+      }
+
+      const Shape shape {
+        rule.src.length, rule.dst.length, rule.proto.has_value(),
+        not rule.sport.any(), not rule.dport.any(), rule.ct_state.has_value()
+      };
+      auto it = std::find_if(tuples_.begin(), tuples_.end(),
+        [&shape] (const Tuple& t) { return t.shape == shape; });
+      if (it == tuples_.end())
+      {
+        tuples_.push_back(Tuple{shape, id, {}});
+        it = std::prev(tuples_.end());
+      }
+      // an earlier rule with the same key shadows this one
+      it->table.emplace(key_of(rule), id);
+    }
+
+    std::sort(tuples_.begin(), tuples_.end(),
+      [] (const Tuple& a, const Tuple& b) { return a.first_rule < b.first_rule; });
+    compiled_ = true;
+  }
+
+  /**
+   * @brief      Find the first rule matching a packet, counting the hit.
+   *
+   * @return     The rule id, or NONE if no rule matched
+   */
+  uint32_t classify(const IP_packet& packet, Conntrack::Entry_ptr ct)
+  {
+    if (UNLIKELY(not compiled_))
+      compile();
+
+    const auto fields = fields_of(packet, ct);
+    uint32_t best = NONE;
+
+    for (const auto& tuple : tuples_)
+    {
+      if (tuple.first_rule >= best)
+        break;
+      const auto& shape = tuple.shape;
+      if ((shape.sport or shape.dport) and not fields.has_ports)
+        continue;
+      if (shape.ct and ct == nullptr)
+        continue;
+
+      const Key key {
+        mask(fields.src, shape.src_len), mask(fields.dst, shape.dst_len),
+        shape.sport ? fields.sport : uint16_t(0),
+        shape.dport ? fields.dport : uint16_t(0),
+        shape.proto ? fields.proto : uint8_t(0),
+        shape.ct    ? fields.ct    : uint8_t(0)
+      };
+      auto it = tuple.table.find(key);
+      if (it != tuple.table.end())
+        best = std::min(best, it->second);
+    }
+
+    for (const auto id : linear_)
+    {
+      if (id >= best)
+        break;
+      if (matches(rules_[id], fields, ct != nullptr)) {
+        best = id;
+        break;
+      }
+    }
+
+    if (best != NONE) hits_[best]++;
+    else misses_++;
+    return best;
+  }
+
+  /**
+   * @brief      Classify and give the verdict, as a packet filter
+   */
+  Filter_verdict<IPV> operator()(IP_packet_ptr pckt, Inet&, Conntrack::Entry_ptr ct)
+  {
+    const auto id = classify(*pckt, ct);
+    const auto verdict = (id != NONE) ? rules_[id].verdict : default_verdict_;
+    return {std::move(pckt), verdict};
+  }
+
+  /**
+   * @brief      A packet filter running this classifier, to be added to
+   *             a Filter_chain. The classifier must outlive the chain.
+   */
+  Packetfilter<IPV> filter()
+  { return {this, &Filter_classifier::operator()}; }
+
+  const Rule& rule(const size_t id) const
+  { return rules_.at(id); }
+
+  size_t size() const noexcept
+  { return rules_.size(); }
+
+  /** Number of packets matched by a rule */
+  uint64_t hits(const size_t id) const
+  { return hits_.at(id); }
+
+  /** Number of packets not matching any rule */
+  uint64_t misses() const noexcept
+  { return misses_; }
+
+  /** Number of hash tables a packet is looked up in (at most) */
+  size_t tuples() const noexcept
+  { return tuples_.size(); }
+
+  Filter_verdict_type default_verdict() const noexcept
+  { return default_verdict_; }
+
+  void set_default_verdict(Filter_verdict_type verdict) noexcept
+  { default_verdict_ = verdict; }
+
+private:
+  struct Shape {
+    uint8_t src_len;
+    uint8_t dst_len;
+    bool    proto;
+    bool    sport;
+    bool    dport;
+    bool    ct;
+
+    bool operator==(const Shape& o) const noexcept
+    {
+      return src_len == o.src_len and dst_len == o.dst_len and proto == o.proto
+         and sport == o.sport and dport == o.dport and ct == o.ct;
+    }
+  };
+
+  struct Key {
+    Addr     src;
+    Addr     dst;
+    uint16_t sport;
+    uint16_t dport;
+    uint8_t  proto;
+    uint8_t  ct;
+
+    bool operator==(const Key& o) const noexcept
+    {
+      return src == o.src and dst == o.dst and sport == o.sport
+         and dport == o.dport and proto == o.proto and ct == o.ct;
+    }
+  };
+
+  struct Key_hash {
+    size_t operator()(const Key& key) const noexcept
+    {
+      uint64_t h = std::hash<Addr>{}(key.src) * 0x9e3779b97f4a7c15ULL;
+      h ^= std::hash<Addr>{}(key.dst) + (h << 6) + (h >> 2);
+      h ^= (uint64_t(key.sport) << 32 | uint64_t(key.dport) << 16
+            | uint64_t(key.proto) << 8 | key.ct) * 0xbf58476d1ce4e5b9ULL;
+      return h ^ (h >> 31);
+    }
+  };
+
+  struct Tuple {
+    Shape    shape;
+    uint32_t first_rule;
+    std::unordered_map<Key, uint32_t, Key_hash> table;
+  };
+
+  struct Fields {
+    Addr     src;
+    Addr     dst;
+    uint16_t sport = 0;
+    uint16_t dport = 0;
+    uint8_t  proto;
+    uint8_t  ct    = 0;
+    bool     has_ports = false;
+  };
+
+  std::vector<Rule>     rules_;
+  std::vector<uint64_t> hits_;
+  std::vector<Tuple>    tuples_;
+  std::vector<uint32_t> linear_; // rules with port ranges, in order
+  uint64_t              misses_   = 0;
+  bool                  compiled_ = false;
+  Filter_verdict_type   default_verdict_;
+
+  static ip4::Addr mask(const ip4::Addr& addr, const uint8_t len) noexcept
+  {
+    if (len == 0) return ip4::Addr{0};
+    return ip4::Addr{addr.whole & htonl(0xFFFFFFFF << (32 - len))};
+  }
+
+  static ip6::Addr mask(ip6::Addr addr, uint8_t len) noexcept
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      const uint8_t bits = std::min<uint8_t>(len, 32);
+      addr.i32[i] &= (bits == 0) ? 0 : htonl(0xFFFFFFFF << (32 - bits));
+      len -= bits;
+    }
+    return addr;
+  }
+
+  static Key key_of(const Rule& rule) noexcept
+  {
+    return Key {
+      rule.src.addr, rule.dst.addr,
+      rule.sport.min == rule.sport.max ? rule.sport.min : uint16_t(0),
+      rule.dport.min == rule.dport.max ? rule.dport.min : uint16_t(0),
+      rule.proto ? static_cast<uint8_t>(*rule.proto) : uint8_t(0),
+      rule.ct_state ? static_cast<uint8_t>(*rule.ct_state) : uint8_t(0)
+    };
+  }
+
+  static Fields fields_of(const IP_packet& packet, Conntrack::Entry_ptr ct) noexcept
+  {
+    Fields f;
+    f.src   = packet.ip_src();
+    f.dst   = packet.ip_dst();
+    const auto proto = packet.ip_protocol();
+    f.proto = static_cast<uint8_t>(proto);
+    if (ct != nullptr)
+      f.ct = static_cast<uint8_t>(ct->state);
+
+    if (proto == Protocol::TCP or proto == Protocol::UDP)
+    {
+      const auto data = packet.ip_data();
+      if (data.size() >= 4)
+      {
+        // source and destination port lead both headers
+        f.sport = (data[0] << 8) | data[1];
+        f.dport = (data[2] << 8) | data[3];
+        f.has_ports = true;
+      }
+    }
+    return f;
+  }
+
+  static bool matches(const Rule& rule, const Fields& f, const bool have_ct) noexcept
+  {
+    if (mask(f.src, rule.src.length) != rule.src.addr) return false;
+    if (mask(f.dst, rule.dst.length) != rule.dst.addr) return false;
+    if (rule.proto and static_cast<uint8_t>(*rule.proto) != f.proto) return false;
+    if (rule.ct_state and (not have_ct or static_cast<uint8_t>(*rule.ct_state) != f.ct))
+      return false;
+    if (not rule.sport.any() or not rule.dport.any())
+    {
+      if (not f.has_ports) return false;
+      if (not rule.sport.contains(f.sport) or not rule.dport.contains(f.dport))
+        return false;
+    }
+    return true;
+  }
+
+}; // < class Filter_classifier
+
+} // < namespace net
+
+#endif // < NET_FILTER_CLASSIFIER_HPP
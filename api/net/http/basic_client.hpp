@@ -24,8 +24,11 @@
 
 #include <net/tcp/tcp.hpp>
 #include <net/inet>
+#include <statman>
+#include <deque>
 #include <vector>
 #include <map>
+#include <optional>
 
 namespace http {
 
@@ -63,6 +66,22 @@ namespace http {
 
     };
 
+    /* Connection pool options (only in effect with keep-alive enabled) */
+    struct Pool_options {
+      // max connections to a single host, further requests are queued
+      size_t                max_conns_per_host{8};
+      // max idle connections kept open to a single host
+      size_t                max_idle_per_host{4};
+      // idle connections are closed after this long
+      std::chrono::seconds  idle_timeout{30};
+      // max requests in flight on a single connection (HTTP/1.1 pipelining),
+      // only idempotent requests are pipelined. 1 disables pipelining
+      size_t                pipeline_depth{1};
+
+      Pool_options() noexcept {}
+
+    };
+
   private:
     using ResolveCallback = net::Inet::resolve_func;
 
@@ -191,21 +210,82 @@ namespace http {
     std::string origin() const
     { return tcp_.stack().ip_addr().to_string(); }
 
-    virtual ~Basic_client() = default;
+    /**
+     * @brief      Whether requests ask for the connection to be kept alive,
+     *             allowing connections to be pooled and reused.
+     */
+    bool keep_alive() const noexcept
+    { return keep_alive_; }
+
+    /**
+     * @brief      Set whether requests should ask for keep-alive.
+     *             Disabled by default.
+     *
+     * @param[in]  keep_alive  Whether to keep connections alive
+     */
+    void keep_alive(const bool keep_alive) noexcept
+    { keep_alive_ = keep_alive; }
+
+    const Pool_options& pool_options() const noexcept
+    { return pool_opts_; }
+
+    /**
+     * @brief      Configure the connection pool.
+     *
+     * @param[in]  opts  The pool options
+     */
+    void set_pool_options(Pool_options opts);
+
+    /**
+     * @brief      Returns the number of open connections to the given host
+     */
+    size_t connection_count(const Host host) const;
+
+    /**
+     * @brief      Returns the number of requests waiting for a connection
+     *             to the given host
+     */
+    size_t queued_count(const Host host) const;
+
+    virtual ~Basic_client();
 
   protected:
+    using Stream_ptr = Connection::Stream_ptr;
+
     TCP&              tcp_;
     Connection_mapset conns_;
 
     explicit Basic_client(TCP& tcp, Request_handler on_send, const bool https_supported);
 
-    virtual Client_connection& get_secure_connection(const Host host);
+    virtual Stream_ptr connect_secure(const Host host);
 
   private:
     friend class Client_connection;
+
+    /* A request waiting for a connection to its host */
+    struct Pending {
+      Request_ptr       req;
+      Response_handler  cb;
+      Options           options;
+      bool              secure;
+      // times the request out while it's waiting, the wait counts
+      Timers::id_t      timer;
+      uint64_t          queued_at; // nanoseconds
+    };
+    using Pending_queue = std::deque<Pending>;
+
     Request_handler   on_send_;
     bool              keep_alive_ = false;
     const bool        supports_https;
+    Pool_options      pool_opts_;
+    std::map<Host, Pending_queue> waiting_;
+    Timers::id_t      idle_timer_{Timers::UNUSED_ID};
+
+    Stat&             stat_pool_hits_;
+    Stat&             stat_pool_misses_;
+    Stat&             stat_pool_queued_;
+    Stat&             stat_pipelined_;
+    Stat&             stat_idle_closed_;
 
     void resolve(const std::string& host, ResolveCallback);
 
@@ -221,7 +301,35 @@ namespace http {
     /** Add data and content length */
     void add_data(Request&, const std::string& data);
 
-    Client_connection& get_connection(const Host host);
+    /**
+     * @brief      Find a connection for a request to the given host.
+     *             Prefers a healthy idle connection, then a new connection,
+     *             then pipelining onto a busy one.
+     *
+     * @return     A connection, or nullptr if the host is at capacity
+     */
+    Client_connection* get_connection(const Host host, const bool secure, const bool pipeline);
+
+    bool healthy(const Client_connection&) const;
+
+    /** Called by a connection when it has no outstanding requests */
+    void release(Client_connection&);
+
+    /** Queue a request until a connection to its host is available */
+    void enqueue(Request_ptr, const Host, Response_handler, const bool secure, Options);
+
+    /**
+     * @brief      Take the next request waiting for a host
+     *
+     * @return     The request, with the time it has left as timeout,
+     *             or nullopt if none are waiting
+     */
+    std::optional<Pending> dequeue(const Host host);
+
+    /** A queued request timed out before it got a connection */
+    void expire_waiting(Timers::id_t);
+
+    void close_idle(int32_t);
 
     void close(Client_connection&);
 
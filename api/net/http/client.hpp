@@ -30,7 +30,7 @@ namespace http {
   private:
     SSL_CTX* ssl_context;
 
-    virtual Client_connection& get_secure_connection(const Host host) override;
+    virtual Stream_ptr connect_secure(const Host host) override;
 
   }; // < class Client
 
@@ -25,6 +25,8 @@
 #include "error.hpp"
 
 #include <util/timer.hpp>
+#include <rtc>
+#include <deque>
 
 namespace http {
 
@@ -39,14 +41,48 @@ namespace http {
     explicit Client_connection(Basic_client&, Stream_ptr);
 
     bool available() const
-    { return on_response_ == nullptr && keep_alive_; }
+    { return on_response_ == nullptr && pipeline_.empty() && keep_alive_; }
 
     bool occupied() const
     { return !available(); }
 
+    /**
+     * @brief      Number of requests sent (or about to be sent)
+     *             still waiting for a response
+     */
+    size_t in_flight() const noexcept
+    { return (on_response_ != nullptr) + pipeline_.size(); }
+
+    /**
+     * @brief      Whether another request can be pipelined behind
+     *             the one(s) already in flight
+     *
+     * @param[in]  depth  Max number of requests in flight
+     */
+    bool can_pipeline(const size_t depth) const
+    {
+      return on_response_ != nullptr and keep_alive_ and not released()
+        and stream_->is_connected() and in_flight() < depth;
+    }
+
+    auto idle_since() const noexcept
+    { return idle_since_; }
+
+    /**
+     * @brief      Send a request. If a request is already in flight
+     *             the request is pipelined behind it.
+     */
     void send(Request_ptr, Response_handler, int redirects, timeout_duration = timeout_duration::zero());
 
   private:
+    /* A request written on the connection, waiting for its turn */
+    struct Pipelined {
+      Request_ptr       req;
+      Response_handler  on_response;
+      int               redirects;
+      timeout_duration  timeout;
+    };
+
     Basic_client&     client_;
     Request_ptr       req_;
     Response_ptr      res_;
@@ -54,11 +90,22 @@ namespace http {
     Timer             timer_;
     timeout_duration  timeout_dur_;
     int               redirect_;
+    std::deque<Pipelined> pipeline_;
+    std::string       inbuf_;
+    RTC::timestamp_t  idle_since_;
 
     void send_request();
 
+    void write_request(const Request&);
+
     void recv_response(buffer_t buf);
 
+    void process_input();
+
+    void next_request();
+
+    void fail_pipeline(Error err);
+
     void end_response(Error err = Error::NONE);
 
     void timeout_request()
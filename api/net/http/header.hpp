@@ -182,6 +182,32 @@ public:
   ///
   bool set_content_length(const size_t len);
 
+  ///
+  /// Get the amount of bytes needed to serialize the set,
+  /// including the empty line terminating the header block
+  ///
+  /// @return The size of the serialized set
+  ///
+  std::size_t serialized_size() const noexcept;
+
+  ///
+  /// Serialize the set into a buffer holding at least
+  /// {serialized_size()} bytes
+  ///
+  /// The format is as follows:
+  /// field : value "\r\n"
+  /// ...
+  /// "\r\n"
+  ///
+  /// @note Unlike the stream operator, the terminating empty
+  /// line is always written, even when the set is empty
+  ///
+  /// @param out The buffer to serialize into
+  ///
+  /// @return Pointer to one past the last byte written
+  ///
+  char* serialize(char* out) const noexcept;
+
 private:
   ///
   /// Class data members
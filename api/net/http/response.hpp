@@ -141,6 +141,25 @@ public:
    */
   std::string status_line() const noexcept;
 
+  ///
+  /// Get the amount of bytes needed to serialize the status line
+  /// and the header block of this message
+  ///
+  /// @return The size of the serialized head
+  ///
+  std::size_t head_size() const noexcept;
+
+  ///
+  /// Serialize the status line and the header block (including the
+  /// terminating empty line) into a buffer holding at least
+  /// {head_size()} bytes
+  ///
+  /// @param out The buffer to serialize into
+  ///
+  /// @return Pointer to one past the last byte written
+  ///
+  char* serialize_head(char* out) const noexcept;
+
   ///
   /// Reset the response message as if it was now
   /// default constructed
@@ -60,6 +60,20 @@ std::time_t to_time_t(util::csview time_);
 ///
 std::string now();
 
+///
+/// Get the current time in {Internet Standard Format} from
+/// a per-second cache
+///
+/// The string is only formatted again when the second changes,
+/// which makes it suitable for stamping the Date header of
+/// every outgoing response
+///
+/// @return A view of the current time, valid until the next call
+///
+/// @note Returns an empty view if an error occurred
+///
+util::sview cached_now() noexcept;
+
 } //< namespace time
 } //< namespace http
 
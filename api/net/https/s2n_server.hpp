@@ -20,6 +20,7 @@
 #define NET_HTTP_S2N_SERVER_HPP
 
 #include <net/http/server.hpp>
+#include <net/tls/ticket_keys.hpp>
 
 namespace http {
 
@@ -40,8 +41,13 @@ public:
 
 private:
   void* m_config = nullptr;
+  // names of the ticket keys last handed to s2n
+  using Key_name = std::array<uint8_t, net::tls::Ticket_keys::NAME_LEN>;
+  std::array<Key_name, net::tls::Ticket_keys::MAX_KEYS> m_ticket_keys {};
+  size_t m_next_key = 0;
 
   void initialize(const std::string&, const std::string&);
+  void update_ticket_keys();
   void bind(const uint16_t port) override;
   void on_connect(TCP_conn conn) override;
 };
@@ -29,6 +29,7 @@
 #include <net/checksum.hpp>
 
 #include <net/error.hpp>
+#include <kernel/rng.hpp>
 #include <net/ip4/icmp_error.hpp>
 #include <net/iana.hpp>
 
@@ -67,7 +68,7 @@ namespace net {
   }
 
   inline uint16_t new_ephemeral_port() noexcept
-  { return port_ranges::DYNAMIC_START + rand() % (port_ranges::DYNAMIC_END - port_ranges::DYNAMIC_START); }
+  { return port_ranges::DYNAMIC_START + rng_extract_uint32() % (port_ranges::DYNAMIC_END - port_ranges::DYNAMIC_START); }
 
 } //< namespace net
 
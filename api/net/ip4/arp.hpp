@@ -22,6 +22,7 @@
 #include <rtc>
 #include <unordered_map>
 #include <util/timer.hpp>
+#include <net/neighbor_cache.hpp>
 #include "ip4.hpp"
 
 using namespace std::chrono_literals;
@@ -47,6 +48,9 @@ namespace net {
     /** Number of resolution retries **/
     static constexpr int arp_retries = 3;
 
+    /** Default max number of entries in the ARP cache */
+    static constexpr size_t default_cache_capacity = 512;
+
     /** Constructor */
     explicit Arp(Stack&) noexcept;
 
@@ -66,7 +70,10 @@ namespace net {
 
     /** Roll your own arp-resolution system. */
     void set_resolver(Arp_resolver ar)
-    { arp_resolver_ = ar; }
+    {
+      arp_resolver_ = ar;
+      custom_resolver_ = true;
+    }
 
     enum Resolver_name { DEFAULT, HH_MAP };
 
@@ -100,27 +107,50 @@ namespace net {
       flush_interval_ = m;
     }
 
+    /**
+     * Set the max number of cached neighbors. Clears the cache.
+     * When full, the least recently used entry is evicted.
+     */
+    void set_cache_capacity(size_t entries)
+    { cache_.resize(entries); }
+
+    size_t cache_size() const noexcept
+    { return cache_.size(); }
+
   private:
 
     /** ARP cache expires after cache_exp_sec_ seconds */
     static constexpr uint16_t cache_exp_sec_ {60 * 5};
 
+    /**
+     * Entries this close to expiry are refreshed in the background
+     * while still in use, so traffic never stalls on an expired entry
+     */
+    static constexpr uint16_t cache_refresh_sec_ {30};
+
     /** Cache entries are just MAC's and timestamps */
     struct Cache_entry {
-      /** Map needs empty constructor (we have no emplace yet) */
+      /** Table needs empty constructor */
       Cache_entry() noexcept = default;
 
       Cache_entry(MAC::Addr mac) noexcept
       : mac_(mac), timestamp_(RTC::time_since_boot()) {}
 
-      Cache_entry(const Cache_entry& cpy) noexcept
-      : mac_(cpy.mac_), timestamp_(cpy.timestamp_) {}
-
       void update() noexcept { timestamp_ = RTC::time_since_boot(); }
 
       bool expired() const noexcept
       { return RTC::time_since_boot() > timestamp_ + cache_exp_sec_; }
 
+      /** Should be refreshed (and no refresh was sent the last second) */
+      bool needs_refresh(RTC::timestamp_t now) const noexcept
+      {
+        return now + cache_refresh_sec_ > timestamp_ + cache_exp_sec_
+           and now != refreshed_;
+      }
+
+      void refreshing(RTC::timestamp_t now) noexcept
+      { refreshed_ = now; }
+
       MAC::Addr mac() const noexcept
       { return mac_; }
 
@@ -132,7 +162,8 @@ namespace net {
 
     private:
       MAC::Addr mac_;
-      RTC::timestamp_t timestamp_;
+      RTC::timestamp_t timestamp_ = 0;
+      RTC::timestamp_t refreshed_ = 0;
     }; //< struct Cache_entry
 
     struct Queue_entry {
@@ -144,7 +175,7 @@ namespace net {
       {}
     };
 
-    using Cache       = std::unordered_map<ip4::Addr, Cache_entry>;
+    using Cache       = Neighbor_cache<ip4::Addr, Cache_entry>;
     using PacketQueue = std::unordered_map<ip4::Addr, Queue_entry>;
 
 
@@ -153,6 +184,11 @@ namespace net {
     uint32_t& requests_tx_;
     uint32_t& replies_rx_;
     uint32_t& replies_tx_;
+    uint64_t& cache_hits_;
+    uint64_t& cache_misses_;
+    uint64_t& cache_stalls_;
+    uint64_t& cache_evictions_;
+    uint64_t& cache_refreshes_;
 
     std::chrono::minutes flush_interval_ = 5min;
 
@@ -169,13 +205,14 @@ namespace net {
     downstream_link linklayer_out_ = nullptr;
 
     // The ARP cache
-    Cache cache_ {};
+    Cache cache_ {default_cache_capacity};
 
     // RFC-1122 2.3.2.2 Packet queue
     PacketQueue waiting_packets_;
 
     // Settable resolver - defualts to arp_resolve
     Arp_resolver arp_resolver_ = {this, &Arp::arp_resolve};
+    bool custom_resolver_ = false;
 
     /** Respond to arp request */
     void arp_respond(header* hdr_in, ip4::Addr ack_ip);
@@ -183,6 +220,9 @@ namespace net {
     /** Send an arp resolution request */
     void arp_resolve(ip4::Addr next_hop);
 
+    /** Revalidate a cache entry about to expire, without stalling traffic */
+    void refresh(ip4::Addr next_hop, Cache_entry&);
+
     /**
      * Add a packet to waiting queue, to be sent when IP is resolved.
      *
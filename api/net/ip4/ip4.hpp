@@ -22,6 +22,7 @@
 #include "addr.hpp"
 #include "header.hpp"
 #include "packet_ip4.hpp"
+#include "reassembly.hpp"
 #include <net/netfilter.hpp>
 #include <net/port_util.hpp>
 #include <rtc>
@@ -224,9 +225,16 @@ namespace net {
     /**  Drop outgoing packets invalid according to RFC */
     IP_packet_ptr drop_invalid_out(IP_packet_ptr packet);
 
-    /**  Reassemble fragments into a coherent heap-allocated packet **/
+    /**  Reassemble fragments into a coherent packet **/
     IP_packet_ptr reassemble(IP_packet_ptr packet);
 
+    /**
+     * @brief      Set limits for fragment reassembly: max concurrent
+     *             datagrams, memory held in total and per source, and
+     *             timeout. Drops datagrams being reassembled.
+     */
+    void set_reassembly_config(ip4::Reassembly::Config config);
+
     /**
      *  Path MTU Discovery (and Packetization Layered Path MTU Discovery) related methods
      */
@@ -346,6 +354,9 @@ namespace net {
 
     Stack& stack_;
 
+    /** Created on the first fragment received */
+    std::unique_ptr<ip4::Reassembly> reassembly_;
+
     /**
      * @brief      Estimates a Path MTU value based on the Total Length field of an IP header
      *             Implemented in accordance with RFC 1191, section 5
@@ -175,6 +175,13 @@ namespace net {
       ip_header().frag_off_flags |= htons(offs) >> 3;
     }
 
+    /** Set both flags and fragment offset (in 8 byte units) */
+    void set_ip_frag_off_flags(ip4::Flags f, uint16_t offs)
+    {
+      Expects(offs < 0x2000);
+      ip_header().frag_off_flags = htons((static_cast<uint16_t>(f) << 13) | offs);
+    }
+
     /** Set total length header field */
     void set_ip_ttl(uint8_t ttl) noexcept
     { ip_header().ttl = ttl; }
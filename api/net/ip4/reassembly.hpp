@@ -0,0 +1,168 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_IP4_REASSEMBLY_HPP
+#define NET_IP4_REASSEMBLY_HPP
+
+#include <rtc>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <util/timer.hpp>
+#include "packet_ip4.hpp"
+
+namespace net {
+namespace ip4 {
+
+  /**
+   * @brief      IPv4 fragment reassembly (RFC 791, RFC 815)
+   *
+   * @details    Fragments are kept as the packets they arrived in, sorted
+   *             on offset, and only copied into one contiguous datagram
+   *             once every byte has arrived. When the first fragment's
+   *             buffer is large enough, the datagram is assembled in place.
+   *
+   *             Pending datagrams are found through a hash table on
+   *             (src, dst, protocol, id). Buffer memory held by pending
+   *             fragments is capped in total and per source address, and
+   *             datagrams not completed within the timeout are dropped.
+   */
+  class Reassembly {
+  public:
+    using IP_packet_ptr = std::unique_ptr<PacketIP4>;
+
+    struct Config {
+      /** Max number of datagrams being reassembled at once */
+      uint16_t max_datagrams = 64;
+
+      /** Max buffer memory held by pending fragments, in bytes */
+      uint32_t max_memory = 4 * 1024 * 1024;
+
+      /** Max buffer memory held by pending fragments from one source */
+      uint32_t max_memory_per_source = 512 * 1024;
+
+      /** Seconds to wait for missing fragments */
+      uint16_t timeout = 15;
+    };
+
+    /**
+     * @brief      Construct a reassembly table
+     *
+     * @param[in]  stat_prefix  Prefix for the stat names, e.g. "eth0"
+     * @param[in]  config       Table limits
+     */
+    Reassembly(const std::string& stat_prefix, Config config);
+
+    explicit Reassembly(const std::string& stat_prefix);
+
+    /**
+     * @brief      Set new limits. Drops all pending datagrams.
+     */
+    void set_config(Config config);
+
+    const Config& config() const noexcept
+    { return config_; }
+
+    /**
+     * @brief      Process a fragment
+     *
+     * @param[in]  packet  A fragment (MF set or non-zero offset)
+     * @param[in]  now     Current time in seconds
+     *
+     * @return     The complete datagram, or nullptr if still waiting
+     */
+    IP_packet_ptr process(IP_packet_ptr packet, RTC::timestamp_t now);
+
+    /**
+     * @brief      Drop datagrams that timed out
+     *
+     * @param[in]  now   Current time in seconds
+     */
+    void expire(RTC::timestamp_t now);
+
+    /** Number of datagrams being reassembled */
+    size_t pending() const noexcept
+    { return table_.size(); }
+
+    /** Buffer memory held by pending fragments */
+    size_t memory() const noexcept
+    { return memory_; }
+
+  private:
+    struct Key {
+      Addr     src;
+      Addr     dst;
+      uint16_t id;
+      Protocol proto;
+
+      bool operator==(const Key& other) const noexcept
+      {
+        return src == other.src and dst == other.dst
+           and id == other.id and proto == other.proto;
+      }
+    };
+
+    struct Key_hash {
+      size_t operator()(const Key& key) const noexcept
+      {
+        const uint64_t a = (uint64_t(key.src.whole) << 32) | key.dst.whole;
+        const uint64_t b = (uint64_t(key.id) << 8) | uint8_t(key.proto);
+        return std::hash<uint64_t>{}(a ^ (b * 0x9e3779b97f4a7c15ULL));
+      }
+    };
+
+    struct Fragment {
+      uint16_t      offset;  // in bytes
+      uint16_t      length;
+      IP_packet_ptr packet;
+    };
+
+    struct Datagram {
+      RTC::timestamp_t expires;
+      uint32_t total    = 0;  // known when the last fragment arrives
+      uint32_t received = 0;
+      uint32_t memory   = 0;
+      std::vector<Fragment> frags; // sorted on offset
+    };
+
+    using Table = std::unordered_map<Key, Datagram, Key_hash>;
+
+    Config   config_;
+    Table    table_;
+    std::unordered_map<Addr, uint32_t> source_memory_;
+    uint32_t memory_ = 0;
+    Timer    expire_timer_ {{ *this, &Reassembly::on_timeout }};
+
+    /** Stats */
+    uint64_t& reassembled_;
+    uint32_t& timeouts_;
+    uint32_t& dropped_;
+
+    /** Drop a pending datagram, releasing its fragments */
+    void drop(Table::iterator it);
+
+    /** Build the complete datagram from its fragments */
+    IP_packet_ptr assemble(Datagram&);
+
+    void on_timeout();
+
+  }; //< class Reassembly
+
+} //< namespace ip4
+} //< namespace net
+
+#endif //< NET_IP4_REASSEMBLY_HPP
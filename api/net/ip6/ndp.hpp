@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <deque>
 #include <util/timer.hpp>
+#include <net/neighbor_cache.hpp>
 #include "packet_icmp6.hpp"
 #include "packet_ndp.hpp"
 #include "stateful_addr.hpp"
@@ -60,6 +61,9 @@ namespace net {
     static const int        MAX_NEIGHBOR_ADVERTISEMENT = 3;     // transmissions
     static const int        DELAY_FIRST_PROBE_TIME     = 5;     // in seconds
 
+    /** Default max number of entries in the neighbour/destination caches */
+    static constexpr size_t default_cache_capacity = 512;
+
     // Neighbour flag constants
     static const uint32_t NEIGH_UPDATE_OVERRIDE          = 0x00000001;
     static const uint32_t NEIGH_UPDATE_WEAK_OVERRIDE     = 0x00000002;
@@ -155,6 +159,19 @@ namespace net {
       flush_interval_ = m;
     }
 
+    /**
+     * Set the max number of cached neighbours and destinations.
+     * Clears both caches. When full, the least recently used entry is evicted.
+     */
+    void set_cache_capacity(size_t entries)
+    {
+      neighbour_cache_.resize(entries);
+      dest_cache_.resize(entries);
+    }
+
+    size_t neighbour_cache_size() const noexcept
+    { return neighbour_cache_.size(); }
+
     // Delegate output to link layer
     void set_linklayer_out(downstream_link s)
     { linklayer_out_ = s; }
@@ -185,9 +202,15 @@ namespace net {
     /** NDP cache expires after neighbour_cache_exp_sec_ seconds */
     static constexpr uint16_t neighbour_cache_exp_sec_ {60 * 5};
 
+    /**
+     * Entries this close to expiry are refreshed in the background
+     * while still in use, so traffic never stalls on an expired entry
+     */
+    static constexpr uint16_t neighbour_cache_refresh_sec_ {30};
+
     /** Cache entries are just MAC's and timestamps */
     struct Neighbour_Cache_entry {
-      /** Map needs empty constructor (we have no emplace yet) */
+      /** Table needs empty constructor */
       Neighbour_Cache_entry() noexcept = default;
 
       Neighbour_Cache_entry(MAC::Addr mac, NeighbourStates state, uint32_t flags) noexcept
@@ -195,15 +218,25 @@ namespace net {
           set_state(state);
       }
 
-      Neighbour_Cache_entry(const Neighbour_Cache_entry& cpy) noexcept
-      : mac_(cpy.mac_), state_(cpy.state_),
-        timestamp_(cpy.timestamp_), flags_(cpy.flags_) {}
-
       void update() noexcept { timestamp_ = RTC::time_since_boot(); }
 
       bool expired() const noexcept
       { return RTC::time_since_boot() > timestamp_ + neighbour_cache_exp_sec_; }
 
+      /** Has a usable link-layer address */
+      bool resolved() const noexcept
+      { return state_ != NeighbourStates::INCOMPLETE and mac_ != MAC::EMPTY; }
+
+      /** Should be refreshed (and no refresh was sent the last second) */
+      bool needs_refresh(RTC::timestamp_t now) const noexcept
+      {
+        return now + neighbour_cache_refresh_sec_ > timestamp_ + neighbour_cache_exp_sec_
+           and now != refreshed_;
+      }
+
+      void refreshing(RTC::timestamp_t now) noexcept
+      { refreshed_ = now; }
+
       MAC::Addr mac() const noexcept
       { return mac_; }
 
@@ -247,12 +280,15 @@ namespace net {
 
     private:
       MAC::Addr        mac_;
-      NeighbourStates  state_;
-      RTC::timestamp_t timestamp_;
-      uint32_t         flags_;
+      NeighbourStates  state_ = NeighbourStates::INCOMPLETE;
+      RTC::timestamp_t timestamp_ = 0;
+      RTC::timestamp_t refreshed_ = 0;
+      uint32_t         flags_ = 0;
     }; //< struct Neighbour_Cache_entry
 
     struct Destination_Cache_entry {
+      Destination_Cache_entry() noexcept = default;
+
       Destination_Cache_entry(ip6::Addr next_hop)
         : next_hop_{next_hop} {}
 
@@ -277,8 +313,8 @@ namespace net {
       int tries_remaining = MAX_MULTICAST_SOLICIT;
     };
 
-    using Cache       = std::unordered_map<ip6::Addr, Neighbour_Cache_entry>;
-    using DestCache   = std::unordered_map<ip6::Addr, Destination_Cache_entry>;
+    using Cache       = Neighbor_cache<ip6::Addr, Neighbour_Cache_entry>;
+    using DestCache   = Neighbor_cache<ip6::Addr, Destination_Cache_entry>;
     using PacketQueue = std::unordered_map<ip6::Addr, Queue_entry>;
     using PrefixList  = std::deque<ip6::Stateful_addr>;
     using RouterList  = std::deque<ndp::Router_entry>;
@@ -288,6 +324,11 @@ namespace net {
     uint32_t& requests_tx_;
     uint32_t& replies_rx_;
     uint32_t& replies_tx_;
+    uint64_t& cache_hits_;
+    uint64_t& cache_misses_;
+    uint64_t& cache_stalls_;
+    uint64_t& cache_evictions_;
+    uint64_t& cache_refreshes_;
 
     std::chrono::minutes flush_interval_ = 5min;
 
@@ -319,8 +360,8 @@ namespace net {
     downstream_link linklayer_out_ = nullptr;
 
     // The caches
-    Cache     neighbour_cache_ {};
-    DestCache dest_cache_ {};
+    Cache     neighbour_cache_ {default_cache_capacity};
+    DestCache dest_cache_ {default_cache_capacity};
 
     // Packet queue
     PacketQueue waiting_packets_;
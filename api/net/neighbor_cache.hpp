@@ -0,0 +1,308 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_NEIGHBOR_CACHE_HPP
+#define NET_NEIGHBOR_CACHE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <expects>
+
+namespace net {
+
+  /**
+   * @brief      Fixed capacity neighbor table (ARP/NDP caches).
+   *
+   * @details    Open addressing with linear probing and backward shift
+   *             deletion, so lookups never walk over tombstones. All
+   *             entries are linked in LRU order; inserting into a full
+   *             table evicts the least recently used entry.
+   *             Memory is allocated once, on construction (or resize).
+   *
+   * @tparam     Addr   The protocol address (key), must have std::hash
+   * @tparam     Entry  The cached entry, must be default constructible
+   */
+  template <typename Addr, typename Entry>
+  class Neighbor_cache {
+  public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    explicit Neighbor_cache(const size_t capacity)
+    { resize(capacity); }
+
+    /**
+     * @brief      Drop all entries and set a new capacity.
+     *
+     * @param[in]  capacity  Max number of entries
+     */
+    void resize(const size_t capacity)
+    {
+      Expects(capacity > 0 and capacity < (NONE / 2));
+      // keep the load factor at or below 1/2 to keep probe chains short
+      size_t slots = 1;
+      while (slots < capacity * 2) slots <<= 1;
+
+      capacity_ = capacity;
+      mask_     = slots - 1;
+      slots_.assign(slots, Slot{});
+      head_ = tail_ = NONE;
+      size_ = 0;
+    }
+
+    /**
+     * @brief      Find an entry without affecting LRU order.
+     *
+     * @return     Pointer to the entry, nullptr if absent
+     */
+    Entry* find(const Addr& addr) noexcept
+    {
+      const auto idx = index_of(addr);
+      return (idx != NONE) ? &slots_[idx].entry : nullptr;
+    }
+
+    const Entry* find(const Addr& addr) const noexcept
+    { return const_cast<Neighbor_cache*>(this)->find(addr); }
+
+    /**
+     * @brief      Find an entry and mark it as the most recently used.
+     *
+     * @return     Pointer to the entry, nullptr if absent
+     */
+    Entry* lookup(const Addr& addr) noexcept
+    {
+      const auto idx = index_of(addr);
+      if (idx == NONE)
+        return nullptr;
+      touch(idx);
+      return &slots_[idx].entry;
+    }
+
+    /**
+     * @brief      Insert or replace an entry, making it the most recently
+     *             used. Evicts the least recently used entry if full.
+     *
+     * @return     Reference to the stored entry
+     */
+    Entry& insert(const Addr& addr, Entry entry)
+    {
+      if (auto idx = index_of(addr); idx != NONE)
+      {
+        slots_[idx].entry = std::move(entry);
+        touch(idx);
+        return slots_[idx].entry;
+      }
+
+      if (size_ == capacity_)
+      {
+        ++evictions_;
+        erase_slot(tail_);
+      }
+
+      auto idx = home(addr);
+      while (slots_[idx].used)
+        idx = (idx + 1) & mask_;
+
+      auto& slot = slots_[idx];
+      slot.used  = true;
+      slot.addr  = addr;
+      slot.entry = std::move(entry);
+      link_front(idx);
+      ++size_;
+      return slot.entry;
+    }
+
+    /**
+     * @brief      Remove an entry.
+     *
+     * @return     true if the entry was present
+     */
+    bool erase(const Addr& addr)
+    {
+      const auto idx = index_of(addr);
+      if (idx == NONE)
+        return false;
+      erase_slot(idx);
+      return true;
+    }
+
+    /**
+     * @brief      Remove all entries matching a predicate.
+     *
+     * @param[in]  pred  bool(const Addr&, const Entry&)
+     *
+     * @return     The number of removed entries
+     */
+    template <typename Pred>
+    size_t erase_if(Pred pred)
+    {
+      size_t removed = 0;
+      // walking the LRU list is safe while shifting slots, since the
+      // successor is looked up by address after each removal
+      for (auto idx = head_; idx != NONE;)
+      {
+        const auto next = slots_[idx].next;
+        if (pred(slots_[idx].addr, slots_[idx].entry))
+        {
+          const bool have_next = next != NONE;
+          const Addr next_addr = have_next ? slots_[next].addr : Addr{};
+          erase_slot(idx);
+          ++removed;
+          idx = have_next ? index_of(next_addr) : NONE;
+        }
+        else
+          idx = next;
+      }
+      return removed;
+    }
+
+    /**
+     * @brief      Visit all entries, most recently used first.
+     *
+     * @param[in]  fn    void(const Addr&, Entry&)
+     */
+    template <typename Fn>
+    void for_each(Fn fn)
+    {
+      for (auto idx = head_; idx != NONE; idx = slots_[idx].next)
+        fn(slots_[idx].addr, slots_[idx].entry);
+    }
+
+    void clear()
+    {
+      for (auto& slot : slots_)
+        slot = Slot{};
+      head_ = tail_ = NONE;
+      size_ = 0;
+    }
+
+    size_t size() const noexcept
+    { return size_; }
+
+    bool empty() const noexcept
+    { return size_ == 0; }
+
+    size_t capacity() const noexcept
+    { return capacity_; }
+
+    /** Number of entries evicted to make room for new ones */
+    uint64_t evictions() const noexcept
+    { return evictions_; }
+
+  private:
+    struct Slot {
+      Addr     addr {};
+      Entry    entry {};
+      uint32_t prev = NONE;
+      uint32_t next = NONE;
+      bool     used = false;
+    };
+
+    std::vector<Slot> slots_;
+    size_t   capacity_  = 0;
+    size_t   mask_      = 0;
+    size_t   size_      = 0;
+    uint32_t head_      = NONE; // most recently used
+    uint32_t tail_      = NONE; // least recently used
+    uint64_t evictions_ = 0;
+
+    uint32_t home(const Addr& addr) const noexcept
+    {
+      // std::hash is often the identity, mix the bits (splitmix64 finalizer)
+      uint64_t h = std::hash<Addr>{}(addr);
+      h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+      h ^= (h >> 31);
+      return static_cast<uint32_t>(h & mask_);
+    }
+
+    uint32_t index_of(const Addr& addr) const noexcept
+    {
+      for (auto idx = home(addr); slots_[idx].used; idx = (idx + 1) & mask_)
+      {
+        if (slots_[idx].addr == addr)
+          return idx;
+      }
+      return NONE;
+    }
+
+    void link_front(const uint32_t idx) noexcept
+    {
+      auto& slot = slots_[idx];
+      slot.prev = NONE;
+      slot.next = head_;
+      if (head_ != NONE)
+        slots_[head_].prev = idx;
+      head_ = idx;
+      if (tail_ == NONE)
+        tail_ = idx;
+    }
+
+    void unlink(const uint32_t idx) noexcept
+    {
+      auto& slot = slots_[idx];
+      if (slot.prev != NONE) slots_[slot.prev].next = slot.next;
+      else head_ = slot.next;
+      if (slot.next != NONE) slots_[slot.next].prev = slot.prev;
+      else tail_ = slot.prev;
+    }
+
+    void touch(const uint32_t idx) noexcept
+    {
+      if (head_ == idx)
+        return;
+      unlink(idx);
+      link_front(idx);
+    }
+
+    /** Move a used slot, keeping the LRU links pointing at it */
+    void move_slot(const uint32_t from, const uint32_t to) noexcept
+    {
+      slots_[to] = std::move(slots_[from]);
+      auto& slot = slots_[to];
+      if (slot.prev != NONE) slots_[slot.prev].next = to;
+      else head_ = to;
+      if (slot.next != NONE) slots_[slot.next].prev = to;
+      else tail_ = to;
+      slots_[from] = Slot{};
+    }
+
+    void erase_slot(uint32_t idx)
+    {
+      unlink(idx);
+      slots_[idx] = Slot{};
+      --size_;
+
+      // backward shift: pull following entries of the probe chain into
+      // the hole if that brings them closer to their home slot
+      for (auto next = (idx + 1) & mask_; slots_[next].used; next = (next + 1) & mask_)
+      {
+        const auto h = home(slots_[next].addr);
+        // can the entry at 'next' move to 'idx'? (cyclic distance check)
+        if (((next - h) & mask_) >= ((next - idx) & mask_))
+        {
+          move_slot(next, idx);
+          idx = next;
+        }
+      }
+    }
+
+  }; // < class Neighbor_cache
+
+} // < namespace net
+
+#endif // < NET_NEIGHBOR_CACHE_HPP
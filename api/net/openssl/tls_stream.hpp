@@ -13,11 +13,24 @@
 
 namespace openssl
 {
+  /**
+   * TLS on top of a transport stream. Ciphertext is decrypted straight
+   * out of the buffers received from the transport, and records are
+   * encrypted into buffers that are handed over to the transport's
+   * write queue. Writes made from within the stream's callbacks are
+   * coalesced into full records, and sent when the callback returns.
+   */
   struct TLS_stream : public net::StreamBuffer
   {
     using Stream_ptr = net::Stream_ptr;
 
+    // max plaintext in one TLS record
+    static constexpr size_t RECORD_SIZE = 16384;
+    // record header, IV, MAC and padding
+    static constexpr size_t RECORD_OVERHEAD = 512;
+
     TLS_stream(SSL_CTX* ctx, Stream_ptr, bool outgoing = false);
+    // takes over an SSL session using memory BIOs
     TLS_stream(Stream_ptr, SSL* ctx, BIO*, BIO*);
     virtual ~TLS_stream();
 
@@ -64,15 +77,24 @@ namespace openssl
     void handle_write_congestion() override;
 
   private:
+    void install_bio();
     void handle_data();
-    int  decrypt(const void *data,int size);
+    int  decrypt();
     int  send_decrypted();
     bool tls_read(buffer_t);
+    int  encrypt(const void* data, size_t len);
+    int  flush_pending();
+    void leave_busy();
     int  tls_perform_stream_write();
     int  tls_perform_handshake();
     bool handshake_completed() const noexcept;
     void close_callback_once();
 
+    static BIO_METHOD* bio_method();
+    static int  bio_read(BIO*, char* out, int len);
+    static int  bio_write(BIO*, const char* in, int len);
+    static long bio_ctrl(BIO*, int cmd, long num, void* ptr);
+
     enum status_t {
       STATUS_OK,
       STATUS_WANT_IO,
@@ -81,8 +103,14 @@ namespace openssl
     status_t status(int n) const noexcept;
     Stream_ptr m_transport = nullptr;
     SSL*   m_ssl    = nullptr;
-    BIO*   m_bio_rd = nullptr;
-    BIO*   m_bio_wr = nullptr;
+    BIO*   m_bio    = nullptr;
+    // ciphertext being decrypted, read in place by the BIO
+    buffer_t m_rd_buffer = nullptr;
+    size_t   m_rd_offset = 0;
+    // encrypted records, not yet handed to the transport
+    buffer_t m_wr_buffer = nullptr;
+    // small writes coalesced into one record
+    buffer_t m_pending   = nullptr;
     int8_t m_busy = 0;
     bool   m_deferred_close = false;
   };
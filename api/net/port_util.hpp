@@ -20,7 +20,10 @@
 #define NET_PORT_UTIL_HPP
 
 #include "inet_common.hpp"
+#include <kernel/rng.hpp>
 #include <util/fixed_bitmap.hpp>
+#include <util/siphash.hpp>
+#include <array>
 
 namespace net {
 
@@ -36,6 +39,11 @@ struct Port_error : public std::runtime_error {
  */
 class Port_util {
 public:
+  /** Size of the table spreading ports per destination (RFC 6056) */
+  static constexpr int TABLE_SIZE = 256;
+  /** Ports tried from the hashed position before scanning for a free one */
+  static constexpr int MAX_PROBES = 8;
+
   /**
    * @brief      Construct a port util with a new generated ephemeral port
    *             and a empty port list.
@@ -44,13 +52,15 @@ public:
     : ports(),
       eph_view{ // set the ephemeral view to be between 49152-65535
         ports.data() + port_ranges::DYNAMIC_START / 8,
-        static_cast<MemBitmap::index_t> (size() / sizeof(MemBitmap::word))
+        static_cast<MemBitmap::index_t> (size() / MemBitmap::CHUNK_SIZE)
       },
       ephemeral_(net::new_ephemeral_port()),
-      eph_count(0)
+      eph_count(0),
+      table_{}
   {
     // all ports are free
     ports.set_all();
+    rng_extract(&key_, sizeof(key_));
   }
 
   static constexpr int size() {
@@ -69,6 +79,41 @@ public:
     return ephemeral_;
   }
 
+  /**
+   * @brief      Gets an ephemeral port for talking to a remote socket
+   *             (RFC 6056, algorithm 4). The port sequence starts at a
+   *             secret hash of the destination and is advanced per
+   *             destination, so ports are hard to guess and reconnects
+   *             to one destination don't collide in TIME-WAIT.
+   *             Throws if there are no free ephemeral ports.
+   *
+   * @param[in]  remote  The remote socket
+   *
+   * @return     A free ephemeral port.
+   */
+  uint16_t get_next_ephemeral(const Socket& remote)
+  {
+    if(UNLIKELY( not has_free_ephemeral() ))
+      throw Port_error{"All ephemeral ports are taken"};
+
+    uint8_t dest[18];
+    memcpy(dest, &remote.address().v6(), 16);
+    const uint16_t port = remote.port();
+    memcpy(dest + 16, &port, 2);
+    const uint64_t hash = siphash(key_, dest, sizeof(dest));
+
+    const uint16_t offset = hash & 0xFFFF;
+    auto& next = table_[(hash >> 32) % TABLE_SIZE];
+    for(int i = 0; i < MAX_PROBES; i++)
+    {
+      const uint16_t candidate = port_ranges::DYNAMIC_START + uint16_t(offset + next++) % size();
+      if(not is_bound(candidate))
+        return candidate;
+    }
+    // heavily used, take the next free one
+    return find_free(port_ranges::DYNAMIC_START + uint16_t(offset + next) % size());
+  }
+
   /**
    * @brief      Bind a port, making it reserved.
    *
@@ -118,6 +163,29 @@ private:
   MemBitmap           eph_view;
   uint16_t            ephemeral_;
   uint16_t            eph_count;
+  Siphash_key         key_;
+  std::array<uint16_t, TABLE_SIZE> table_;
+
+  /**
+   * @brief      Find the first free ephemeral port from a port,
+   *             scanning a word of ports at a time and wrapping around.
+   */
+  uint16_t find_free(const uint16_t from) const
+  {
+    constexpr int chunks = size() / MemBitmap::CHUNK_SIZE;
+    const int idx = from - port_ranges::DYNAMIC_START;
+    int chunk = idx / MemBitmap::CHUNK_SIZE;
+    // skip the ports before in the first word
+    auto word = eph_view.get_chunk(chunk) & (MemBitmap::WORD_MAX << (idx % MemBitmap::CHUNK_SIZE));
+    for(int n = 0; n <= chunks; n++)
+    {
+      if(word != 0)
+        return port_ranges::DYNAMIC_START + chunk * MemBitmap::CHUNK_SIZE + __builtin_ctz(word);
+      chunk = (chunk + 1) % chunks;
+      word = eph_view.get_chunk(chunk);
+    }
+    throw Port_error{"All ephemeral ports are taken"};
+  }
 
   /**
    * @brief      Increment the ephemeral port by one.
@@ -135,11 +203,7 @@ private:
       ephemeral_ = port_ranges::DYNAMIC_START;
 
     if(UNLIKELY( is_bound(ephemeral_) ))
-    {
-      auto i = eph_view.first_set();
-      Ensures(i != -1 && "Did not found a free ephemeral even tho has_free_ephemeral() == true...");
-      ephemeral_ = port_ranges::DYNAMIC_START + i;
-    }
+      ephemeral_ = find_free(ephemeral_);
 
     Expects(not is_bound(ephemeral_) && "Generated ephemeral port is already bound. Please fix me!");
   }
@@ -56,6 +56,12 @@ namespace net {
     static constexpr size_t default_min_bufsize   {4_KiB};
     static constexpr size_t default_max_bufsize   {256_KiB};
     static constexpr size_t default_total_bufsize {64_MiB};
+    // receive buffer autotuning, from the initial toward the max
+    static constexpr size_t default_rcvbuf        {64_KiB};
+    static constexpr size_t default_max_rcvbuf    {2_MiB};
+    // idle connections give back memory when the pool is this full (%)
+    static constexpr size_t default_rcvbuf_pressure {75};
+    static const std::chrono::seconds       default_rcvbuf_idle {1};
 
     using Address = net::Addr;
 
@@ -21,11 +21,14 @@
 
 #include "common.hpp"
 #include "packet_view.hpp"
+#include "payload.hpp"
+#include "rcvbuf_tuner.hpp"
 #include "read_request.hpp"
 #include "rttm.hpp"
 #include "tcp_errors.hpp"
 #include "write_queue.hpp"
 #include "sack.hpp"
+#include "scoreboard.hpp"
 
 #include <net/socket.hpp>
 #include <delegate>
@@ -122,6 +125,23 @@ public:
    */
   inline size_t   next_size();
 
+  /** Called with the received data, in the packets it arrived in when possible. */
+  using ChainCallback           = delegate<void(Payload_chain)>;
+  /**
+   * @brief      Event when incoming data is received, without copying it.
+   *             In order segments are handed over as Payloads pointing into
+   *             the packets they arrived in. Only data that had to be
+   *             reassembled (out of order) is copied, into a read buffer.
+   *             The callback is called when either 1) PSH is seen, or 2)
+   *             a receive buffer worth of data is pending.
+   *
+   * @param[in]  recv_bufsz  The size of the receive buffer
+   * @param[in]  callback    The callback
+   *
+   * @return     This connection
+   */
+  inline Connection&            on_read_chain(size_t recv_bufsz, ChainCallback callback);
+
   /** Called with the connection itself and the reason wrapped in a Disconnect struct. */
   using DisconnectCallback      = delegate<void(Connection_ptr self, Disconnect)>;
   /**
@@ -299,6 +319,23 @@ public:
   size_t readq_size() const
   { return (read_request) ? read_request->size() : 0; }
 
+  /**
+   * @brief      The receive buffer the window is sized to, grown toward
+   *             the bandwidth-delay product of the flow (0 if not tuned)
+   *
+   * @return     The receive buffer size in bytes
+   */
+  size_t rcvbuf() const noexcept
+  { return rcvbuf_; }
+
+  /**
+   * @brief      Size the receive buffer, allowing the connection to use
+   *             more (or less) than its share of the TCP memory pool
+   *
+   * @param[in]  size  The size in bytes
+   */
+  void set_rcvbuf(size_t size);
+
   /**
    * @brief Total number of bytes in send queue
    *
@@ -575,8 +612,8 @@ public:
     TCB(const uint16_t mss, const uint32_t recvwin);
     TCB(const uint16_t mss);
 
-    void init() {
-      ISS = Connection::generate_iss();
+    void init(const seq_t iss) {
+      ISS = iss;
       recover = ISS; // [RFC 6582]
     }
 
@@ -660,6 +697,14 @@ private:
 
   /** The given read request */
   std::unique_ptr<Read_request> read_request;
+  /** Receive buffer autotuning, dynamic right-sizing */
+  size_t   rcvbuf_ = 0;
+  Rcvbuf_tuner rcvbuf_tuner_;
+
+  /** Received data not yet handed to on_read_chain */
+  ChainCallback on_read_chain_;
+  Payload_chain rx_chain_;
+  size_t        rx_chain_bytes_ = 0;
   os::mem::Pmr_pool::Resource_ptr bufalloc{nullptr};
 
   /** Queue for write requests to process */
@@ -701,6 +746,18 @@ private:
   bool sack_perm = false;
   size_t bytes_sacked_ = 0;
 
+  /** Sender side SACK scoreboard, created when the first data is sent */
+  std::unique_ptr<Scoreboard> scoreboard_;
+  /** RACK reordering timeout / tail loss probe timer [RFC 8985] */
+  Timer rack_timer_;
+  // rack_timer_ is running the reordering timeout (not a probe timeout)
+  bool rack_reo_armed_ = false;
+  // tail loss probe sent and not yet acknowledged
+  bool tlp_pending_ = false;
+  seq_t tlp_end_seq_ = 0;
+  // SACK loss recovery after a retransmission timeout
+  bool rto_recovery_ = false;
+
   /** Congestion control */
   // is fast recovery state
   bool fast_recovery_ = false;
@@ -750,6 +807,15 @@ private:
    */
   void _on_data(DataCallback cb);
 
+  /** Add an in order segment to the chain, without copying it */
+  void recv_chain(const Packet_view& in, size_t length);
+
+  /** Add data from the read buffer to the chain */
+  void recv_chain_buffer(buffer_t buf);
+
+  /** Hand the pending chain to the user */
+  void deliver_chain();
+
 
   // Retrieve the associated shared_ptr for a connection, if it exists
   // Throws out_of_range if it doesn't
@@ -873,7 +939,7 @@ private:
   /*
     Generate a new ISS.
   */
-  static seq_t generate_iss();
+  seq_t generate_iss() const;
 
   /*
     SND.UNA + SND.WND - SND.NXT
@@ -881,6 +947,13 @@ private:
   */
   uint32_t usable_window() const noexcept
   {
+    // during SACK recovery the data in flight is estimated by pipe [RFC 6675]
+    if(UNLIKELY(scoreboard_ != nullptr and in_loss_recovery()))
+    {
+      const int64_t cw = (int64_t)cb.cwnd - (int64_t)scoreboard_->pipe();
+      const int64_t rw = (int64_t)cb.SND.WND - (int64_t)flight_size();
+      return (uint32_t) std::max(static_cast<int64_t>(0), std::min(cw, rw));
+    }
     const int64_t x = (int64_t)send_window() - (int64_t)flight_size();
     return (uint32_t) std::max(static_cast<int64_t>(0), x);
   }
@@ -932,6 +1005,21 @@ private:
 
   void recv_out_of_order(const Packet_view& in);
 
+  /**
+   * @brief      Once every RTT, grow the receive buffer to twice what was
+   *             received in that RTT, if it's more than in the last.
+   */
+  void rcvbuf_adjust();
+
+  /**
+   * @brief      Shrink the receive buffer of an idle connection, and give
+   *             back the memory of its empty read buffers.
+   *
+   * @param[in]  now   The current time in ms, see TCP::now_ms
+   * @param[in]  idle  How long without data makes a connection idle, in ms
+   */
+  void rcvbuf_reclaim(uint32_t now, uint32_t idle);
+
   /**
    * @brief      Acknowledge incoming data. This is done by:
    *             - Trying to send data if possible (can send)
@@ -1093,6 +1181,54 @@ private:
   bool reno_full_ack(seq_t ACK)
   { return static_cast<int32_t>(ACK - cb.recover) > 1; }
 
+  // SACK loss recovery [RFC 6675] and RACK-TLP [RFC 8985] //
+
+  bool in_loss_recovery() const noexcept
+  { return fast_recovery_ or rto_recovery_; }
+
+  /** Millisecond clock used by the scoreboard */
+  static uint32_t sack_clock() noexcept;
+
+  /**
+   * @brief      Handle an ACK (new or duplicate) when the scoreboard is in use.
+   *             Replaces the New Reno on_dup_ack/fast_recovery handling.
+   *
+   * @param[in]  in    Incoming TCP segment
+   * @param[in]  dup   If the ACK is a duplicate ACK
+   */
+  void sack_ack(const Packet_view& in, const bool dup);
+
+  void sack_enter_recovery();
+
+  /**
+   * @brief      Retransmit lost segments, then new data, while pipe
+   *             is below cwnd [RFC 6675] 5 (C)
+   */
+  void sack_send();
+
+  /**
+   * @brief      Retransmit the range [start, end) from the write queue
+   *
+   * @return     False if nothing could be sent
+   */
+  bool sack_retransmit(const seq_t start, const seq_t end);
+
+  /**
+   * @brief      Arm the RACK timer, either for a reordering timeout or
+   *             for a tail loss probe.
+   *
+   * @param[in]  reo_timeout  Reordering timeout in ms, 0 if none
+   */
+  void rack_arm(const uint32_t reo_timeout);
+
+  void rack_timeout();
+
+  /** Probe timeout [RFC 8985] 7.2 */
+  std::chrono::milliseconds probe_timeout() const;
+
+  /** Send a tail loss probe [RFC 8985] 7.3 */
+  void tail_loss_probe();
+
 
 
   /// --- STATE HANDLING --- ///
@@ -0,0 +1,148 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TCP_CONNECTION_TABLE_HPP
+#define NET_TCP_CONNECTION_TABLE_HPP
+
+#include "common.hpp"
+#include <net/socket.hpp>
+#include <vector>
+
+namespace net {
+namespace tcp {
+
+/**
+ * @brief      A flat hash table of connections, keyed by (local, remote).
+ *
+ * @details    Buckets are one cache line each, holding 8 one-byte tags and
+ *             the slots of the entries they point to. A lookup hashes the
+ *             tuple once, and usually compares tuples only in the home
+ *             bucket, where the tag of the hash matches.
+ *
+ *             Buckets count how many entries probed past them when they
+ *             were full, so erased slots are free again immediately and
+ *             lookups stop at the first bucket nothing overflowed from.
+ *
+ *             The hash is keyed with a random secret, so remote peers
+ *             can't choose tuples that collide.
+ */
+class Connection_table {
+public:
+  using Tuple = std::pair<Socket, Socket>;
+
+  static constexpr size_t BUCKET_SLOTS = 8;
+
+  Connection_table(size_t capacity = 64);
+
+  /**
+   * @brief      Hash of a tuple, to be passed to find/insert/erase.
+   *             The same tuple always hashes the same in one table.
+   */
+  uint64_t hash(const Tuple& tuple) const noexcept
+  { return hash(tuple.first, tuple.second); }
+
+  uint64_t hash(const Socket& local, const Socket& remote) const noexcept;
+
+  /**
+   * @brief      Find the connection for a tuple
+   *
+   * @return     A pointer to the connection, valid until the next insert,
+   *             or nullptr
+   */
+  const Connection_ptr* find(const Tuple& tuple, uint64_t hash) const noexcept;
+
+  const Connection_ptr* find(const Tuple& tuple) const noexcept
+  { return find(tuple, hash(tuple)); }
+
+  /**
+   * @brief      Insert a connection
+   *
+   * @return     False if there already is a connection for the tuple
+   */
+  bool insert(const Tuple& tuple, uint64_t hash, Connection_ptr conn);
+
+  bool insert(const Tuple& tuple, Connection_ptr conn)
+  { return insert(tuple, hash(tuple), std::move(conn)); }
+
+  /**
+   * @brief      Erase the connection for a tuple
+   *
+   * @return     True if there was one
+   */
+  bool erase(const Tuple& tuple, uint64_t hash) noexcept;
+
+  bool erase(const Tuple& tuple) noexcept
+  { return erase(tuple, hash(tuple)); }
+
+  size_t size() const noexcept
+  { return size_; }
+
+  bool empty() const noexcept
+  { return size_ == 0; }
+
+  /** Number of connections the table holds before it grows */
+  size_t capacity() const noexcept
+  { return buckets_.size() * BUCKET_SLOTS * 7 / 8; }
+
+  /**
+   * @brief      Call func(tuple, conn) for every connection.
+   *             The table must not be changed while iterating.
+   */
+  template <typename Func>
+  void for_each(Func func) const
+  {
+    for(const auto& entry : entries_)
+      if(entry.conn != nullptr)
+        func(entry.tuple, entry.conn);
+  }
+
+private:
+  struct Entry {
+    Tuple          tuple;
+    uint64_t       hash;
+    Connection_ptr conn;
+  };
+
+  struct alignas(64) Bucket {
+    uint8_t  tags[BUCKET_SLOTS] {};
+    // number of entries that probed past this bucket
+    uint8_t  overflow = 0;
+    uint32_t slots[BUCKET_SLOTS];
+  };
+  static_assert(sizeof(Bucket) == 64, "A bucket should be one cache line");
+
+  std::vector<Bucket>   buckets_;
+  std::vector<Entry>    entries_;
+  std::vector<uint32_t> free_;
+  size_t   size_ = 0;
+  uint64_t key_[3];
+
+  // 0 is an empty slot
+  static uint8_t tag(uint64_t hash) noexcept
+  { return (hash >> 56) | 0x80; }
+
+  size_t mask() const noexcept
+  { return buckets_.size() - 1; }
+
+  void place(uint32_t slot, uint64_t hash) noexcept;
+  void grow();
+};
+
+} // < namespace tcp
+} // < namespace net
+
+#endif // < NET_TCP_CONNECTION_TABLE_HPP
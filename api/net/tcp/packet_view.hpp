@@ -183,6 +183,11 @@ public:
   void set_ts_option(const Option::opt_ts* opt)
   { this->ts_opt = opt; }
 
+  /**
+   * @brief      Find the SACK option [RFC 2018], if present
+   */
+  inline const Option::opt_sack* parse_sack_option() const noexcept;
+
   // Data //
 
   uint8_t* tcp_data()
@@ -363,6 +368,32 @@ inline const Option::opt_ts* Packet_v<Ptr_type>::parse_ts_option() const noexcep
   return nullptr;
 }
 
+template <typename Ptr_type>
+inline const Option::opt_sack* Packet_v<Ptr_type>::parse_sack_option() const noexcept
+{
+  auto* opt = this->tcp_options();
+  while(opt < (uint8_t*)this->tcp_data())
+  {
+    auto* option = (Option*)opt;
+    if (option->kind == Option::END) break;
+    if (option->kind == Option::NOP) {
+      opt++;
+      continue;
+    }
+    // zero-length options cause infinite loops (and are invalid)
+    if (option->length < 2) break;
+    // option must fit within the header
+    if (opt + option->length > (uint8_t*)this->tcp_data()) break;
+
+    if (option->kind == Option::SACK)
+      return reinterpret_cast<const Option::opt_sack*>(option);
+
+    opt += option->length;
+  }
+
+  return nullptr;
+}
+
 template <typename Ptr_type>
 inline size_t Packet_v<Ptr_type>::fill(const uint8_t* buffer, size_t length)
 {
@@ -0,0 +1,81 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TCP_PAYLOAD_HPP
+#define NET_TCP_PAYLOAD_HPP
+
+#include "common.hpp" // buffer_t
+#include <vector>
+
+namespace net {
+namespace tcp {
+
+/**
+ * @brief      A read-only piece of received data, which keeps the memory
+ *             it points into alive: either the packet it arrived in, or
+ *             a buffer it was reassembled in.
+ *
+ * @note       Payloads backed by packets hold on to the NIC's receive
+ *             buffers, so they should be released (or copied) promptly.
+ */
+class Payload {
+public:
+  using Owner = std::shared_ptr<const void>;
+
+  Payload(Owner owner, const uint8_t* data, size_t len) noexcept
+    : owner_{std::move(owner)}, data_{data}, len_{len}
+  {}
+
+  /** Data copied into a buffer */
+  explicit Payload(buffer_t buf) noexcept
+    : owner_{buf}, data_{buf->data()}, len_{buf->size()}
+  {}
+
+  const uint8_t* data() const noexcept
+  { return data_; }
+
+  size_t size() const noexcept
+  { return len_; }
+
+  const uint8_t* begin() const noexcept
+  { return data_; }
+
+  const uint8_t* end() const noexcept
+  { return data_ + len_; }
+
+private:
+  Owner          owner_;
+  const uint8_t* data_;
+  size_t         len_;
+};
+
+/** Consecutive pieces of the stream, in order */
+using Payload_chain = std::vector<Payload>;
+
+/** Total number of bytes in a chain */
+inline size_t chain_size(const Payload_chain& chain) noexcept
+{
+  size_t len = 0;
+  for(const auto& p : chain)
+    len += p.size();
+  return len;
+}
+
+} // < namespace tcp
+} // < namespace net
+
+#endif // < NET_TCP_PAYLOAD_HPP
@@ -0,0 +1,72 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TCP_RCVBUF_TUNER_HPP
+#define NET_TCP_RCVBUF_TUNER_HPP
+
+#include "common.hpp"
+
+namespace net {
+namespace tcp {
+
+/**
+ * Receive buffer autotuning (dynamic right-sizing). Once every RTT it
+ * compares what was received in that RTT with the RTT before; if the
+ * sender keeps sending more, it is limited by our window.
+ * All times are in milliseconds.
+ */
+struct Rcvbuf_tuner {
+
+  /**
+   * @brief      Account for received data
+   *
+   * @param[in]  now      The current time
+   * @param[in]  rcv_nxt  RCV.NXT after the data
+   * @param[in]  rcv_wnd  The window currently advertised
+   * @param[in]  srtt     The sender side RTT, 0 when there's none
+   *
+   * @return     Twice what was received in the last RTT, when that grew;
+   *             otherwise 0
+   */
+  uint32_t on_data(uint32_t now, seq_t rcv_nxt, uint32_t rcv_wnd, uint32_t srtt);
+
+  /** Whether nothing was received for @timeout */
+  bool idle(uint32_t now, uint32_t timeout) const noexcept
+  { return now - last_rcv >= timeout; }
+
+  /** Start measuring over, when data flows again */
+  void restart() noexcept
+  { space = {}; }
+
+  // data received during the last measured RTT
+  struct {
+    uint32_t time  = 0;
+    seq_t    seq   = 0;
+    uint32_t bytes = 0;
+  } space;
+  // receiver side RTT estimate, for when we don't send data
+  uint32_t rcv_rtt      = 0;
+  uint32_t rcv_rtt_time = 0;
+  seq_t    rcv_rtt_seq  = 0;
+  uint32_t last_rcv     = 0;
+
+}; // < struct Rcvbuf_tuner
+
+} // < namespace tcp
+} // < namespace net
+
+#endif // < NET_TCP_RCVBUF_TUNER_HPP
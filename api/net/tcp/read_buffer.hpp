@@ -159,6 +159,16 @@ public:
    */
   void reset(const seq_t start, const size_t capacity);
 
+  /**
+   * @brief      Give back the memory reserved by an empty buffer.
+   *             It's allocated again when data is inserted.
+   */
+  void shrink()
+  {
+    if(buf->empty() and buf.use_count() == 1)
+      buf->shrink_to_fit();
+  }
+
   /**
    * @brief      Sets the starting sequence number.
    *             Should not be messed with.
@@ -50,6 +50,13 @@ public:
 
   void reset(const seq_t seq);
 
+  /** Give back the memory reserved by empty buffers */
+  void shrink()
+  {
+    for(auto& buf : buffers)
+      buf->shrink();
+  }
+
   size_t next_size();
   buffer_t read_next();
 
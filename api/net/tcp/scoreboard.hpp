@@ -0,0 +1,193 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TCP_SCOREBOARD_HPP
+#define NET_TCP_SCOREBOARD_HPP
+
+#include <deque>
+#include "common.hpp"
+#include "sack.hpp"
+
+namespace net {
+namespace tcp {
+
+/**
+ * @brief      Sender side scoreboard for SACK based loss recovery
+ *             [RFC 6675] with RACK time based loss detection [RFC 8985].
+ *
+ * @details    Keeps one record per transmitted data segment, in sequence
+ *             order, with the time it was (re)transmitted and whether it
+ *             has been SACKed, marked lost or retransmitted.
+ *
+ *             pipe() follows the RFC 6675 definition: outstanding bytes,
+ *             minus SACKed and lost bytes, plus retransmitted bytes still
+ *             in flight.
+ *
+ *             Timestamps are in milliseconds.
+ */
+class Scoreboard {
+public:
+  /** Number of segments SACKed above a hole before reordering is ruled out */
+  static constexpr uint32_t dup_thresh = 3;
+
+  struct Segment {
+    seq_t    start;
+    seq_t    end;
+    uint32_t xmit_ts;
+    bool     sacked        = false;
+    bool     lost          = false;
+    bool     retransmitted = false;
+
+    uint32_t size() const noexcept
+    { return end - start; }
+  };
+
+  /**
+   * @brief      Record a transmitted data segment.
+   *             Segments starting below the highest sent sequence number
+   *             are treated as retransmissions.
+   */
+  void on_send(seq_t start, seq_t end, uint32_t now);
+
+  /**
+   * @brief      Record the retransmission of the segment starting at start
+   */
+  void on_retransmit(seq_t start, uint32_t now);
+
+  /**
+   * @brief      Process an incoming (cumulative and selective) acknowledgement
+   *
+   * @param[in]  una     The cumulative ACK (new SND.UNA)
+   * @param[in]  blocks  SACK blocks in host byte order
+   * @param[in]  count   Number of SACK blocks
+   * @param[in]  now     Current time
+   *
+   * @return     Number of bytes newly SACKed
+   */
+  uint32_t on_ack(seq_t una, const sack::Block* blocks, size_t count, uint32_t now);
+
+  /**
+   * @brief      RACK loss detection [RFC 8985] 6.2 step 5. Marks segments
+   *             sent before the most recently delivered one as lost once
+   *             they are older than the RACK RTT plus the reordering window.
+   *
+   * @param[in]  now          Current time
+   * @param[in]  in_recovery  Whether the sender is in loss recovery
+   *
+   * @return     Milliseconds until a segment may be deemed lost (the
+   *             reordering timeout), 0 if none are pending.
+   */
+  uint32_t detect_loss(uint32_t now, bool in_recovery);
+
+  /**
+   * @brief      Mark every unSACKed segment lost, after a retransmission
+   *             timeout [RFC 6675] 5.1 / [RFC 8985] 6.3
+   */
+  void mark_all_lost();
+
+  /**
+   * @brief      The first segment marked lost and not yet retransmitted
+   *             ([RFC 6675] NextSeg rule 1)
+   *
+   * @return     Pointer to the segment, nullptr if none
+   */
+  const Segment* next_lost() const noexcept;
+
+  /**
+   * @brief      The highest unSACKed segment, used for tail loss probes
+   */
+  const Segment* last_unsacked() const noexcept;
+
+  /** Estimated bytes in flight [RFC 6675] */
+  uint32_t pipe() const noexcept
+  { return outstanding_ - sacked_ - lost_ + retrans_; }
+
+  uint32_t outstanding() const noexcept
+  { return outstanding_; }
+
+  uint32_t sacked_bytes() const noexcept
+  { return sacked_; }
+
+  bool has_lost() const noexcept
+  { return lost_ > retrans_lost_; }
+
+  /** Minimum RTT seen, 0 if no samples */
+  uint32_t min_rtt() const noexcept
+  { return rack_valid_ ? min_rtt_ : 0; }
+
+  /** RTT of the most recently delivered segment */
+  uint32_t rack_rtt() const noexcept
+  { return rack_rtt_; }
+
+  /** If segments have been delivered out of order */
+  bool reordering_seen() const noexcept
+  { return reordering_seen_; }
+
+  bool empty() const noexcept
+  { return segments_.empty(); }
+
+  size_t size() const noexcept
+  { return segments_.size(); }
+
+  void clear();
+
+private:
+  std::deque<Segment> segments_;
+
+  uint32_t outstanding_  = 0;
+  uint32_t sacked_       = 0;
+  uint32_t lost_         = 0;  // lost, including those retransmitted
+  uint32_t retrans_      = 0;  // retransmitted and not yet delivered
+  uint32_t retrans_lost_ = 0;  // lost and retransmitted
+  uint32_t sacked_segs_  = 0;
+
+  /** RACK state [RFC 8985] 5.2 */
+  uint32_t rack_xmit_ts_ = 0;
+  seq_t    rack_end_seq_ = 0;
+  uint32_t rack_rtt_     = 0;
+  uint32_t min_rtt_      = UINT32_MAX;
+  seq_t    rack_fack_    = 0;  // highest delivered sequence number
+  bool     rack_valid_   = false;
+  bool     fack_valid_   = false;
+  bool     reordering_seen_ = false;
+
+  /** RACK update [RFC 8985] 6.2 steps 1-3, for a newly delivered segment */
+  void deliver(const Segment& seg, uint32_t now);
+
+  void set_lost(Segment& seg);
+
+  /** Add (or subtract) a segment's bytes to the sacked/lost/retrans counters */
+  void count(const Segment& seg, bool add) noexcept;
+
+  uint32_t reo_wnd(bool in_recovery) const noexcept;
+
+  static bool seq_lt(seq_t a, seq_t b) noexcept
+  { return static_cast<int32_t>(a - b) < 0; }
+
+  static bool seq_leq(seq_t a, seq_t b) noexcept
+  { return static_cast<int32_t>(a - b) <= 0; }
+
+  /** Was a sent after b (RACK_sent_after) */
+  static bool sent_after(uint32_t t1, seq_t seq1, uint32_t t2, seq_t seq2) noexcept
+  { return t1 > t2 or (t1 == t2 and seq_lt(seq2, seq1)); }
+
+}; // < class Scoreboard
+
+} // < namespace tcp
+} // < namespace net
+
+#endif // < NET_TCP_SCOREBOARD_HPP
@@ -144,7 +144,10 @@ namespace net::tcp
      * @brief      Resets all callbacks.
      */
     void reset_callbacks() override
-    { m_tcp->reset_callbacks(); }
+    {
+      m_on_close = nullptr;
+      m_tcp->reset_callbacks();
+    }
 
     /**
      * @brief      Returns the streams local socket.
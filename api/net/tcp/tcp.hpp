@@ -21,16 +21,19 @@
 
 #include "common.hpp"
 #include "connection.hpp"
+#include "connection_table.hpp"
 #include "headers.hpp"
 #include "listener.hpp"
 #include "packet_view.hpp"
 #include "packet.hpp" // remove me, temp for NaCl
 
-#include <map>  // connections, listeners
+#include <map>  // listeners
+#include <unordered_map>  // listener ports
 #include <deque>  // writeq
 #include <net/socket.hpp>
 #include <net/ip4/ip4.hpp>
 #include <util/bitops.hpp>
+#include <util/siphash.hpp>
 #include <mem/alloc/pmr.hpp>
 
 namespace net {
@@ -59,7 +62,7 @@ namespace net {
 
   private:
     using Listeners       = std::map<Socket, std::shared_ptr<tcp::Listener>>;
-    using Connections     = std::unordered_map<tcp::Connection::Tuple, tcp::Connection_ptr>;
+    using Connections     = tcp::Connection_table;
 
   public:
     /////// TCP Stuff - Relevant to the protocol /////
@@ -417,6 +420,36 @@ namespace net {
     auto max_bufsize() const
     { return max_bufsize_; }
 
+    /**
+     * @brief      Sets the receive buffer of new connections. It is grown
+     *             toward the bandwidth-delay product of each connection,
+     *             up to max, and shrunk again when the connection goes
+     *             idle while memory is short. 0 disables the tuning, and
+     *             connections share the memory pool evenly.
+     *
+     * @param[in]  initial  The initial receive buffer size
+     * @param[in]  max      The maximum receive buffer size
+     */
+    void set_rcvbuf(const size_t initial, const size_t max)
+    {
+      Expects(initial <= max);
+      rcvbuf_     = initial;
+      max_rcvbuf_ = max;
+    }
+
+    size_t rcvbuf() const noexcept
+    { return rcvbuf_; }
+
+    size_t max_rcvbuf() const noexcept
+    { return max_rcvbuf_; }
+
+    /**
+     * @brief      Whether the memory pool is so full that receive buffers
+     *             should not grow, and idle ones should shrink.
+     */
+    bool memory_pressure()
+    { return mempool_.allocated() * 100 >= total_bufsize_ * tcp::default_rcvbuf_pressure; }
+
     /**
      * @brief      The Maximum Segment Size to be used for this instance.
      *             [RFC 793] [RFC 879] [RFC 6691]
@@ -504,18 +537,18 @@ namespace net {
     **/
     tcp::Connection_ptr retrieve_shared(tcp::Connection* self)
     {
-      auto i = connections_.find(self->tuple());
-      if (i != connections_.end())
+      auto* i = connections_.find(self->tuple());
+      if (i != nullptr)
       {
-        //printf("Found connection: %p\n", i->second.get());
-        return i->second;
+        //printf("Found connection: %p\n", i->get());
+        return *i;
       }
 
-      auto j = find_listener(self->local());
-      if (j != listeners_.end())
+      auto* j = find_listener(self->local());
+      if (j != nullptr)
       {
         //printf("Found listener\n");
-        auto& q = j->second->syn_queue_;
+        auto& q = j->syn_queue_;
         for (auto& conn : q) {
           if (conn.get() == self) {
             //printf("Found connection: %p\n", conn.get());
@@ -534,18 +567,54 @@ namespace net {
       return this->cpu_id;
     }
 
+    /**
+     * @brief      Share a port with a TCP instance on another CPU, like
+     *             SO_REUSEPORT. Segments to the port are spread over the
+     *             group by the hash of their connection tuple, so every
+     *             segment of a connection reaches the same instance.
+     *             Add this instance too for it to take its share.
+     *
+     * @details    The group is set up on the instance the network
+     *             delivers to. Each instance in it must listen on the port
+     *             itself, and outlive the group. Segments for another
+     *             instance are handed to its CPU before they are checksummed
+     *             or counted here.
+     *
+     * @param[in]  port      The port
+     * @param[in]  instance  The instance to add to the port's group
+     */
+    void reuse_port(const tcp::port_t port, TCP& instance);
+
   private:
     IPStack&      inet_;
     Listeners     listeners_;
     Connections   connections_;
 
+    /** The listeners bound on each port, with their (possibly any) address */
+    using Port_listeners = std::vector<std::pair<Socket, tcp::Listener*>>;
+    std::unordered_map<tcp::port_t, Port_listeners> listener_ports_;
+    /** Instances sharing a port, see reuse_port() */
+    std::unordered_map<tcp::port_t, std::vector<TCP*>> reuse_ports_;
+
+    /** The receiver of the last segment, segments often come in trains */
+    tcp::Connection* last_conn_ = nullptr;
+    /** The owner of the packet being received, see hold_rx_packet() */
+    std::shared_ptr<net::Packet_ptr> rx_held_;
+
     size_t total_bufsize_;
     os::mem::Pmr_pool mempool_;
 
     size_t min_bufsize_;
     size_t max_bufsize_;
 
+    size_t rcvbuf_;
+    size_t max_rcvbuf_;
+    /** Shrinks idle connections when memory is short */
+    Timer  rcvbuf_timer_;
+
     Port_utils& ports_;
+    /** Secret for the ISS hash */
+    Siphash_key iss_key_;
 
     downstream  network_layer_out4_;
     downstream  network_layer_out6_;
@@ -615,11 +684,16 @@ namespace net {
     void send_reset(const tcp::Packet_view& incoming);
 
     /**
-     * @brief      Generate a unique initial sequence number (ISS).
+     * @brief      Generate an initial sequence number (ISS) for a connection,
+     *             a 4us clock plus a keyed hash of the connection id
+     *             [RFC 6528]
+     *
+     * @param[in]  local   The local socket
+     * @param[in]  remote  The remote socket
      *
      * @return     A sequence number (SEQ)
      */
-    static tcp::seq_t generate_iss();
+    tcp::seq_t generate_iss(const Socket& local, const Socket& remote) const;
 
     /**
      * @brief      Gets an incremental timestamp value.
@@ -628,6 +702,14 @@ namespace net {
      */
     uint32_t get_ts_value() const;
 
+    /**
+     * @brief      A millisecond clock, for receive buffer tuning.
+     *             Wraps around, compare differences only.
+     *
+     * @return     The current time in ms
+     */
+    uint32_t now_ms() const;
+
     /**
      * @brief      The IP4 object bound to the IPStack
      *
@@ -674,6 +756,18 @@ namespace net {
      */
     Socket bind(const tcp::Address& addr);
 
+    /**
+     * @brief      Bind to an address with an ephemeral port picked
+     *             for talking to a remote socket [RFC 6056]
+     *             Throws if there are no more free ephemeral ports.
+     *
+     * @param[in]  addr    The address
+     * @param[in]  remote  The remote socket
+     *
+     * @return     The socket that got bound.
+     */
+    Socket bind(const tcp::Address& addr, const Socket& remote);
+
     /**
      * @brief      Determines if the source address is valid.
      *
@@ -689,19 +783,58 @@ namespace net {
      *
      * @param[in]  socket  The socket the listener is bound to
      *
-     * @return     A listener iterator
+     * @return     The listener, or nullptr
      */
-    Listeners::iterator find_listener(const Socket& socket);
+    tcp::Listener* find_listener(const Socket& socket) const;
+
+    /** Add a listener to listeners_ and listener_ports_ */
+    bool add_listener(const Socket& socket, std::shared_ptr<tcp::Listener> listener);
+
+    /** Remove a listener from listeners_ and listener_ports_ */
+    void remove_listener(const Socket& socket);
 
     /**
-     * @brief      Try to find the listener bound to socket.
-     *             If none is found directly, try any address (0).
+     * @brief      Hand a segment to the instance of the port's group
+     *             its connection belongs to.
      *
-     * @param[in]  socket  The socket the listener is bound to
+     * @return     True if it was handed to another instance
+     */
+    bool reuse_port_dispatch(tcp::Packet_view& packet);
+
+    /**
+     * @brief      Give the receive buffer of a new connection its initial
+     *             size, and start watching the memory pool.
+     */
+    void init_rcvbuf(tcp::Connection& conn);
+
+    /** Shrink the receive buffers of idle connections, if memory is short */
+    void rcvbuf_reclaim();
+
+    /** Receive a segment handed over from another instance */
+    void receive_dispatched(net::Packet_ptr ptr, const Protocol ipv);
+
+    /**
+     * @brief      Keep the packet being received after it's handled.
+     *             Used by connections handing out views of the payload.
      *
-     * @return     A listener const iterator
+     * @return     The owner of the packet, filled in by receive()
      */
-    Listeners::const_iterator cfind_listener(const Socket& socket) const;
+    std::shared_ptr<const void> hold_rx_packet()
+    {
+      if (rx_held_ == nullptr)
+        rx_held_ = std::make_shared<net::Packet_ptr>();
+      return rx_held_;
+    }
+
+    /** Hand the packet over to its holders, if there are any left */
+    void release_held(tcp::Packet_view& packet)
+    {
+      if (LIKELY(rx_held_ == nullptr))
+        return;
+      if (rx_held_.use_count() > 1)
+        *rx_held_ = packet.release();
+      rx_held_ = nullptr;
+    }
 
     /**
      * @brief      Adds a connection.
@@ -733,6 +866,8 @@ namespace net {
     void close_connection(const tcp::Connection* conn)
     {
       unbind(conn->local());
+      if (last_conn_ == conn)
+        last_conn_ = nullptr;
       connections_.erase(conn->tuple());
     }
 
@@ -111,6 +111,13 @@ public:
   auto nxt_rem() const
   { return q.at(current_)->size() - offset_; }
 
+  /*
+    Unacknowledged data at offset bytes from SND.UNA, as a pointer
+    and the number of contiguous bytes from there (used to retransmit
+    arbitrary ranges). Returns {nullptr, 0} if out of range.
+  */
+  std::pair<const uint8_t*, size_t> data_at(uint32_t offset) const;
+
   auto bytes_total() const {
     uint32_t n = 0;
     for(auto& it : q)
@@ -0,0 +1,102 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TLS_SESSION_CACHE_HPP
+#define NET_TLS_SESSION_CACHE_HPP
+
+#include <rtc>
+#include <chrono>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace net::tls {
+
+/**
+ * @brief      Server-side TLS session cache, shared by the TLS servers
+ *
+ * @details    Maps session IDs to sessions serialized by the TLS library,
+ *             so returning clients can resume with an abbreviated
+ *             handshake. Bounded: the least recently used session is
+ *             evicted when the cache is full, and sessions expire after
+ *             the lifetime.
+ */
+class Session_cache {
+public:
+  using timestamp_t = RTC::timestamp_t;
+
+  static constexpr size_t MAX_ID_LEN = 32;
+  static constexpr size_t DEFAULT_CAPACITY = 1024;
+  static constexpr std::chrono::seconds DEFAULT_LIFETIME {std::chrono::minutes(5)};
+
+  explicit Session_cache(size_t capacity = DEFAULT_CAPACITY,
+                         std::chrono::seconds lifetime = DEFAULT_LIFETIME);
+
+  /** The cache shared by the TLS servers */
+  static Session_cache& get();
+
+  /** Store a serialized session. IDs longer than MAX_ID_LEN are ignored */
+  void store(std::string_view id, std::string_view session,
+             timestamp_t now = RTC::now());
+
+  /**
+   * @brief      Find a serialized session
+   *
+   * @return     An empty view when there's no such session or it has
+   *             expired. Valid until the next store or remove.
+   */
+  std::string_view find(std::string_view id, timestamp_t now = RTC::now());
+
+  void remove(std::string_view id);
+  void clear();
+
+  size_t size() const noexcept
+  { return lru_.size(); }
+
+  size_t capacity() const noexcept
+  { return capacity_; }
+
+  std::chrono::seconds lifetime() const noexcept
+  { return lifetime_; }
+
+  uint64_t hits() const noexcept
+  { return hits_; }
+
+  uint64_t misses() const noexcept
+  { return misses_; }
+
+private:
+  struct Entry {
+    std::string id;
+    std::string session;
+    timestamp_t expires;
+  };
+  using Lru = std::list<Entry>;
+
+  // most recently used first
+  Lru lru_;
+  std::unordered_map<std::string_view, Lru::iterator> index_;
+  const size_t capacity_;
+  const std::chrono::seconds lifetime_;
+  uint64_t hits_   = 0;
+  uint64_t misses_ = 0;
+};
+
+} //< namespace net::tls
+
+#endif //< NET_TLS_SESSION_CACHE_HPP
@@ -0,0 +1,110 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef NET_TLS_TICKET_KEYS_HPP
+#define NET_TLS_TICKET_KEYS_HPP
+
+#include <rtc>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace net::tls {
+
+/**
+ * @brief      Rotating keys for encrypting TLS session tickets
+ *
+ * @details    New tickets are encrypted with the current key, which is
+ *             replaced by a fresh random key once it's older than the
+ *             lifetime. Tickets from the previous keys are still accepted
+ *             until the key is 2 lifetimes old, so clients resume across
+ *             a rotation.
+ *
+ *             The keys can be carried over a LiveUpdate with
+ *             liu::Storage::add_ticket_keys, so tickets handed out before
+ *             the update stay valid.
+ */
+class Ticket_keys {
+public:
+  using timestamp_t = RTC::timestamp_t;
+
+  static constexpr size_t NAME_LEN = 16;
+  static constexpr size_t KEY_LEN  = 32;
+  static constexpr size_t MAX_KEYS = 4;
+  static constexpr std::chrono::seconds DEFAULT_LIFETIME {std::chrono::hours(12)};
+
+  struct Key {
+    uint8_t     name[NAME_LEN];
+    uint8_t     aes_key[KEY_LEN];
+    uint8_t     hmac_key[KEY_LEN];
+    timestamp_t created;
+  };
+
+  explicit Ticket_keys(std::chrono::seconds lifetime = DEFAULT_LIFETIME) noexcept
+    : lifetime_{lifetime} {}
+
+  ~Ticket_keys();
+
+  /** The keys shared by the TLS servers */
+  static Ticket_keys& get();
+
+  /** The key to encrypt new tickets with, rotated when it's too old */
+  const Key& current(timestamp_t now = RTC::now());
+
+  /** The key named @name, if tickets with it are still accepted */
+  const Key* find(const uint8_t* name, timestamp_t now = RTC::now()) const noexcept;
+
+  /** Calls @fn with each key that is still accepted, newest first */
+  template <typename Fn>
+  void for_each(Fn fn, timestamp_t now = RTC::now()) const
+  {
+    for (size_t i = 0; i < count_; i++)
+      if (not expired(keys_[i], now)) fn(keys_[i]);
+  }
+
+  /** Start using a new random key */
+  void rotate(timestamp_t now = RTC::now());
+
+  /** Number of keys that are still accepted */
+  size_t size() const noexcept
+  { return count_; }
+
+  std::chrono::seconds lifetime() const noexcept
+  { return lifetime_; }
+
+  /** Serialization, for LiveUpdate */
+  size_t serialized_size() const noexcept;
+  size_t serialize_to(void* addr, size_t size) const;
+  /** Replaces the keys. @throws std::runtime_error on bad input */
+  void   deserialize_from(const void* addr, size_t size);
+
+private:
+  static timestamp_t age(const Key& key, timestamp_t now) noexcept
+  { return (now > key.created) ? now - key.created : 0; }
+
+  bool expired(const Key& key, timestamp_t now) const noexcept
+  { return age(key, now) >= 2 * (timestamp_t) lifetime_.count(); }
+
+  // newest first
+  std::array<Key, MAX_KEYS> keys_;
+  size_t count_ = 0;
+  std::chrono::seconds lifetime_;
+};
+
+} //< namespace net::tls
+
+#endif //< NET_TLS_TICKET_KEYS_HPP
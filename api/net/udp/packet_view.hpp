@@ -113,6 +113,17 @@ public:
 
   inline size_t fill(const uint8_t* buffer, size_t length);
 
+  /** Room for payload in the packet buffer */
+  uint16_t udp_data_capacity() const noexcept
+  { return ip_capacity() - udp_header_length(); }
+
+  /** Set the payload length, after writing it directly to udp_data() */
+  void set_data_length(uint16_t length)
+  {
+    Expects(length <= udp_data_capacity());
+    set_length(length);
+  }
+
   // Packet_view specific operations //
 
   Ptr_type release()
@@ -26,18 +26,29 @@
 #include <net/socket.hpp>
 
 #include <string>
+#include <vector>
 
 namespace net {
   class UDP;
 }
 namespace net::udp
 {
+  /** A datagram to send, or a received one (valid during the callback) */
+  struct Datagram
+  {
+    addr_t         addr;
+    port_t         port;
+    const uint8_t* data;
+    size_t         length;
+  };
+
   class Socket
   {
   public:
     using multicast_group_addr = ip4::Addr;
 
     using recvfrom_handler  = delegate<void(addr_t, port_t, const char*, size_t)>;
+    using batch_handler     = delegate<void(const Datagram*, size_t)>;
 
     // constructors
     Socket(UDP&, net::Socket socket);
@@ -51,11 +62,42 @@ namespace net::udp
     void on_read(recvfrom_handler callback)
     { on_read_handler = callback; }
 
+    /**
+     * @brief      Receive datagrams in batches instead of one callback each.
+     *             Datagrams arriving in one burst are delivered together from
+     *             an event, or as soon as @max_batch are waiting.
+     *             Replaces on_read.
+     */
+    void on_read_batch(batch_handler callback, size_t max_batch = 32);
+
     void sendto(addr_t destIP, port_t port,
                 const void* buffer, size_t length,
                 sendto_handler cb = nullptr,
                 error_handler ecb = nullptr);
 
+    /**
+     * @brief      Send several single packet datagrams with one call, after
+     *             the send queue has been flushed.
+     *
+     * @return     The number of datagrams sent, fewer than @count when the
+     *             transmit queue is full
+     */
+    size_t sendmmsg(const Datagram* datagrams, size_t count);
+
+    /**
+     * @brief      Create a datagram to be filled in place: write the payload to
+     *             udp_data(), at most payload_capacity() bytes, set its length
+     *             with set_data_length() and hand it to send()
+     *
+     * @return     The datagram, or nullptr when out of packet buffers
+     */
+    Packet_view_ptr create_datagram(addr_t dest_ip, port_t port);
+
+    void send(Packet_view_ptr datagram, error_handler ecb = nullptr);
+
+    /** The largest payload of a datagram made by create_datagram */
+    size_t payload_capacity() const;
+
     void bcast(addr_t srcIP, port_t port,
                const void* buffer, size_t length,
                sendto_handler cb = nullptr,
@@ -78,11 +120,19 @@ namespace net::udp
 
   private:
     void internal_read(const Packet_view&);
+    void queue_read(Packet_view_ptr);
+    void deliver_batch();
+
+    bool is_batched() const noexcept
+    { return on_batch_handler != nullptr; }
 
     UDP&    udp_;
     net::Socket  socket_;
     recvfrom_handler on_read_handler =
       [] (addr_t, port_t, const char*, size_t) {};
+    batch_handler on_batch_handler = nullptr;
+    std::vector<Packet_view_ptr> rxq_;
+    size_t max_batch_ = 0;
 
     const bool is_ipv6_;
     bool reuse_addr;
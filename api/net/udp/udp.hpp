@@ -52,7 +52,7 @@ namespace net {
     using Stack         = Inet;
     using Port_utils    = std::map<Addr, Port_util>;
 
-    using Sockets       = std::map<net::Socket, udp::Socket>;
+    using Sockets       = std::unordered_map<net::Socket, udp::Socket>;
 
     using sendto_handler = udp::sendto_handler;
     using error_handler  = udp::error_handler;
@@ -174,6 +174,12 @@ namespace net {
 
     // the async send queue
     std::deque<WriteBuffer> sendq;
+    // datagrams from udp::Socket::send waiting for the transmit queue
+    std::deque<udp::Packet_view_ptr> packetq_;
+
+    // sockets with received datagrams waiting for batch delivery
+    std::vector<net::Socket> batch_pending_;
+    int batch_event_ = -1;
 
     Sockets::iterator find(const Socket& socket)
     {
@@ -214,6 +220,17 @@ namespace net {
 
     udp::Packet_view_ptr create_packet(const net::Socket& src, const net::Socket& dst);
 
+    // send a single packet datagram right away, if the transmit queue allows
+    bool send_now(const net::Socket& src, const net::Socket& dst,
+                  const uint8_t* data, size_t length,
+                  sendto_handler cb, error_handler ecb);
+    void send_packet(udp::Packet_view_ptr, error_handler ecb);
+    size_t send_batch(const net::Socket& src, const udp::Datagram*, size_t count);
+    void add_error_callback(const net::Socket& dst, error_handler ecb);
+
+    void schedule_batch(const net::Socket& socket);
+    void deliver_batches();
+
     friend class udp::Socket;
 
   }; //< class UDP
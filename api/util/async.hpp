@@ -27,6 +27,10 @@ class Async
 {
 public:
   static const size_t PAYLOAD_SIZE = 64000;
+  // number of chunks read ahead of the writer
+  static const size_t PIPELINE_DEPTH = 4;
+  // bytes allowed in the stream's write queue before writes are held back
+  static const size_t MAX_QUEUED = 2 * PAYLOAD_SIZE;
 
   using Stream  = net::Stream;
   using Disk    = fs::Disk_ptr;
@@ -36,19 +40,39 @@ public:
   typedef delegate<void(fs::error_t, bool)> on_after_func;
   typedef delegate<void(fs::buffer_t, next_func)> on_write_func;
 
+  /**
+   * @brief      Stream a file from disk to a stream
+   *
+   * @details    Keeps up to depth chunks read from disk ahead of the
+   *             stream, and writes them in order for as long as the
+   *             stream's write queue holds less than max_queued bytes.
+   *             Disk reads and network transmission overlap.
+   *
+   *             Totals are published to Statman as async.upload.*
+   */
   static void upload_file(
       Disk,
       const Dirent&,
       Stream*,
       on_after_func,
-      size_t = PAYLOAD_SIZE);
+      size_t chunk_size = PAYLOAD_SIZE,
+      size_t depth      = PIPELINE_DEPTH,
+      size_t max_queued = MAX_QUEUED);
 
+  /**
+   * @brief      Read a file from disk chunk by chunk
+   *
+   * @details    The write callback is called for one chunk at a time, in
+   *             order, and the next chunk is handed over once it calls
+   *             next(true). The chunks after it are read in the meantime.
+   */
   static void disk_transfer(
       Disk,
       const Dirent&,
       on_write_func,
       on_after_func,
-      size_t = PAYLOAD_SIZE);
+      size_t chunk_size = PAYLOAD_SIZE,
+      size_t depth      = 2);
 
 };
 
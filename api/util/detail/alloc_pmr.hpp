@@ -90,6 +90,7 @@ namespace os::mem::detail {
 
     void return_resource(Resource* raw) {
       Expects(used_resources_ > 0);
+      raw->set_capacity(0);
       auto res_ptr = resource_from_raw(raw);
       used_resources_--;
       free_resources_.emplace_back(std::move(res_ptr));
@@ -240,6 +241,9 @@ namespace os::mem {
   //
   Pmr_resource::Pmr_resource(Pool_ptr p) : pool_{p} {}
   std::size_t Pmr_resource::capacity() {
+    // a set capacity may overcommit the pool, it's bounded by what's left
+    if (cap_ != 0)
+      return std::min(cap_, used + pool_->allocatable());
     return pool_->resource_capacity();
   }
   std::size_t Pmr_resource::allocatable() {
@@ -0,0 +1,177 @@
+// -*- C++ -*-
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2017 Oslo and Akershus University College of Applied Sciences
+// and Alfred Bratterud
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef UTIL_PATH_ROUTER_HPP
+#define UTIL_PATH_ROUTER_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "path_to_regex.hpp"
+
+namespace path2regex {
+
+  /**
+   *  Matches request paths against a set of Express-style routes
+   *  (the same syntax as path_to_regex) without running std::regex
+   *  for the common cases.
+   *
+   *  Routes are compiled into a tree over path segments:
+   *    /users/:id          static segment + segment parameter
+   *    /users/:id(\d+)     typed (integer) parameter
+   *    /users/:id?         optional trailing parameter
+   *    /files/:path(.*)    wildcard capturing the rest of the path
+   *                        (also unnamed, as a '*' segment)
+   *
+   *  Routes using anything else (custom patterns, partial segments like
+   *  /:file.:ext, repeated parameters) fall back to a regex built by
+   *  path_to_regex.
+   *
+   *  When several routes match, static segments take precedence over
+   *  parameters, and parameters over wildcards. Fallback routes are
+   *  honoured in the order they were added relative to the route found
+   *  in the tree.
+   *
+   *  Parameter values are views into the matched path and names are views
+   *  into the Router, so both must outlive the Match.
+   */
+  class Router {
+  public:
+    using Route_id = uint32_t;
+    static constexpr Route_id NO_ROUTE   = UINT32_MAX;
+    static constexpr size_t   MAX_PARAMS = 8;
+
+    struct Param {
+      std::string_view name;
+      std::string_view value;
+    };
+
+    struct Match {
+      Route_id route {NO_ROUTE};
+      std::array<Param, MAX_PARAMS> params {};
+      size_t count {0};
+
+      explicit operator bool() const noexcept
+      { return route != NO_ROUTE; }
+
+      /** Get the value of the named parameter, empty view if absent */
+      std::string_view get(std::string_view name) const noexcept;
+
+      /** Get the named parameter as an unsigned integer */
+      std::optional<uint64_t> get_uint(std::string_view name) const noexcept;
+
+      const Param* begin() const noexcept { return params.data(); }
+      const Param* end() const noexcept   { return params.data() + count; }
+    };
+
+    /**
+     *  Same options as path_to_regex ("sensitive", "strict" and "end"),
+     *  applied to every route
+     */
+    explicit Router(const Options& options = Options{});
+
+    /**
+     *  Add a route
+     *
+     *  @return The id of the route, returned with a successful match.
+     *          Ids are handed out sequentially starting from 0
+     */
+    Route_id add(const std::string& path);
+
+    /**
+     *  Match a path (without query string) against the routes
+     *
+     *  @return A Match, which evaluates to false if no route matched
+     */
+    Match match(std::string_view path) const;
+
+    /** Number of routes added */
+    size_t size() const noexcept
+    { return routes_; }
+
+    /** Number of routes that could not be compiled and use a regex */
+    size_t fallbacks() const noexcept
+    { return fallbacks_.size(); }
+
+  private:
+    enum class Edge_type : uint8_t {
+      SEGMENT,  // [^/]+
+      INTEGER,  // \d+
+      WILDCARD  // .*
+    };
+
+    struct Param_edge {
+      Edge_type type;
+      uint32_t  child;
+    };
+
+    struct Node {
+      // sorted on label (lower case unless sensitive)
+      std::vector<std::pair<std::string, uint32_t>> statics;
+      std::vector<Param_edge> params;
+      Route_id route {NO_ROUTE};
+    };
+
+    struct Route_info {
+      std::vector<std::string> names;
+    };
+
+    struct Fallback {
+      Route_id    route;
+      std::regex  regex;
+      Keys        keys;
+    };
+
+    struct Segment {
+      enum Kind { STATIC, PARAM } kind;
+      std::string text;      // static label or parameter name
+      Edge_type   type;
+      bool        optional;
+    };
+
+    Options options_;
+    bool strict_;
+    bool sensitive_;
+    bool end_;
+    Route_id routes_ {0};
+    std::vector<Node> nodes_;
+    std::vector<Route_info> info_;
+    std::vector<Fallback> fallbacks_;
+
+    static bool compile(const Tokens&, std::vector<Segment>&);
+
+    uint32_t static_child(uint32_t node, const std::string& label);
+
+    uint32_t param_child(uint32_t node, Edge_type type);
+
+    void set_route(uint32_t node, Route_id id);
+
+    bool match_node(uint32_t node, std::string_view path, size_t len,
+                    size_t pos, Match& m) const;
+
+    bool finish(uint32_t node, Match& m) const;
+
+    bool match_fallback(const Fallback&, std::string_view path, Match& m) const;
+  }; //< class Router
+
+} //< namespace path2regex
+
+#endif //< UTIL_PATH_ROUTER_HPP
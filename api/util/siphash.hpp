@@ -0,0 +1,85 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef UTIL_SIPHASH_HPP
+#define UTIL_SIPHASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * A 128-bit secret key for siphash
+ */
+struct Siphash_key {
+  uint64_t k0;
+  uint64_t k1;
+};
+
+/**
+ * @brief      SipHash-2-4, a fast keyed hash (PRF) for short inputs.
+ *             Outputs are unpredictable without the key, which makes it
+ *             suitable for sequence numbers, port selection and hash tables
+ *             facing untrusted input.
+ *
+ * @param[in]  key   The secret key
+ * @param[in]  data  The data
+ * @param[in]  len   The length of the data
+ *
+ * @return     64-bit hash
+ */
+inline uint64_t siphash(const Siphash_key& key, const void* data, size_t len) noexcept
+{
+  auto rotl = [] (uint64_t x, int b) { return (x << b) | (x >> (64 - b)); };
+
+  uint64_t v0 = key.k0 ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = key.k1 ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = key.k0 ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = key.k1 ^ 0x7465646279746573ULL;
+
+  auto round = [&] () {
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+  };
+
+  const auto* in = static_cast<const uint8_t*>(data);
+  const auto* end = in + (len & ~size_t(7));
+  for(; in != end; in += 8)
+  {
+    uint64_t m;
+    memcpy(&m, in, 8); // little endian
+    v3 ^= m;
+    round(); round();
+    v0 ^= m;
+  }
+
+  uint64_t b = uint64_t(len) << 56;
+  for(size_t i = 0; i < (len & 7); i++)
+    b |= uint64_t(in[i]) << (8 * i);
+
+  v3 ^= b;
+  round(); round();
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  round(); round(); round(); round();
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#endif
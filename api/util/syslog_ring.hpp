@@ -0,0 +1,107 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#ifndef UTIL_SYSLOG_RING_HPP
+#define UTIL_SYSLOG_RING_HPP
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <delegate>
+
+/**
+ * @brief      A ring of unformatted log records, for deferred syslog.
+ *
+ * @details    record() stores the format string pointer and the binary
+ *             arguments (strings are copied, truncated to max_string),
+ *             which is much cheaper than formatting. drain() formats the
+ *             records later, outside the hot path.
+ *
+ *             One producer and one consumer may use the ring concurrently
+ *             without locking. Records that don't fit are dropped and
+ *             counted.
+ *
+ *             The format string must outlive the record (string literals).
+ */
+class Syslog_ring {
+public:
+  using Sink = delegate<void(int priority, const char* msg, size_t len)>;
+
+  static constexpr size_t default_capacity = 16384;
+  static constexpr size_t max_string = 255;
+  static constexpr size_t max_message = 2048;
+
+  explicit Syslog_ring(size_t capacity = default_capacity);
+
+  /**
+   * @brief      Store a log record
+   *
+   * @param[in]  priority     Syslog priority
+   * @param[in]  fmt          printf format, with %m as in syslog(3)
+   * @param[in]  args         The arguments
+   * @param[in]  saved_errno  errno to use for %m
+   *
+   * @return     False if the record was dropped
+   */
+  bool record(int priority, const char* fmt, va_list args, int saved_errno);
+
+  /**
+   * @brief      Format and hand all stored records to a sink, oldest first
+   *
+   * @return     The number of records drained
+   */
+  size_t drain(Sink sink);
+
+  /**
+   * @brief      Format a stored argument list. Exposed for testing.
+   *
+   * @return     The formatted length, not counting the terminator
+   */
+  static size_t format(char* buf, size_t len, const char* fmt,
+                       const uint8_t* args, const uint8_t* end, int saved_errno);
+
+  /** Number of records dropped since the ring was full */
+  uint64_t dropped() const noexcept
+  { return dropped_.load(std::memory_order_relaxed); }
+
+  bool empty() const noexcept
+  { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+  size_t capacity() const noexcept
+  { return capacity_; }
+
+private:
+  struct Header {
+    uint32_t    size;     // record size, including the header
+    int16_t     priority; // -1 marks padding to the end of the ring
+    uint16_t    reserved;
+    int32_t     saved_errno;
+    const char* fmt;
+  };
+
+  std::unique_ptr<uint8_t[]> data_;
+  const size_t capacity_;
+  // free running positions, written by the producer and consumer
+  std::atomic<size_t> head_ {0};
+  std::atomic<size_t> tail_ {0};
+  std::atomic<uint64_t> dropped_ {0};
+
+}; // < class Syslog_ring
+
+#endif
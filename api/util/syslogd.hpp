@@ -20,7 +20,6 @@
 
 #include <cstdio>
 #include <string>
-#include <regex>
 #include <stdarg.h>
 
 #include <syslog.h> // POSIX symbolic constants
@@ -52,6 +51,28 @@ public:
 
   static void openlog(const char* ident, int logopt, int facility);
 
+  /**
+   * @brief      Defer formatting and sending of messages. syslog() then only
+   *             stores the format and arguments in a per-CPU ring, which is
+   *             flushed from an event on the same CPU.
+   *             The format strings must outlive the call (string literals).
+   */
+  static void set_deferred(bool enabled) noexcept
+  { deferred_ = enabled; }
+
+  static bool is_deferred() noexcept
+  { return deferred_; }
+
+  /**
+   * @brief      Format and send all deferred messages logged on this CPU
+   */
+  static void flush();
+
+  /**
+   * @brief      Number of deferred messages dropped because a ring was full
+   */
+  static uint64_t dropped();
+
   static void closelog();
 
   static bool valid_priority(int priority) noexcept {
@@ -69,6 +90,9 @@ public:
 
 private:
   static std::unique_ptr<Syslog_facility> fac_;
+  static bool deferred_;
+
+  static void send(int priority, const char* msg, size_t len);
 
 }; // < Syslog
 
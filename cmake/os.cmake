@@ -358,6 +358,23 @@ function(os_build_memdisk TARGET FOLD)
   os_add_memdisk(${TARGET} "${CMAKE_CURRENT_BINARY_DIR}/memdisk.fat")
 endfunction()
 
+# build a read-only packed image from folder (see api/fs/pack.hpp)
+# extra arguments are passed on to mkpack.py, eg. --gzip
+function(os_add_pack TARGET FOLD)
+  get_filename_component(REL_PATH "${FOLD}" REALPATH BASE_DIR "${CMAKE_CURRENT_SOURCE_DIR}")
+  file(GLOB_RECURSE PACK_FILES CONFIGURE_DEPENDS "${REL_PATH}/*")
+  add_custom_command(
+    OUTPUT  ${TARGET}_pack.o
+    COMMAND ${PYTHON3_EXECUTABLE} ${INCLUDEOS_PACKAGE}/tools/memdisk/mkpack.py ${ARGN} -o ${TARGET}.pack --asm ${TARGET}_pack.asm ${REL_PATH}
+    COMMAND nasm -f ${CMAKE_ASM_NASM_OBJECT_FORMAT} ${TARGET}_pack.asm -o ${TARGET}_pack.o
+    COMMENT "Creating pack image"
+    DEPENDS ${PACK_FILES}
+  )
+  add_library(${TARGET}_pack STATIC ${TARGET}_pack.o)
+  set_target_properties(${TARGET}_pack PROPERTIES LINKER_LANGUAGE CXX)
+  os_link_libraries(${TARGET} --whole-archive ${TARGET}_pack --no-whole-archive)
+endfunction()
+
 # call build_memdisk only if MEMDISK is not defined from command line
 function(os_diskbuilder TARGET FOLD)
   os_build_memdisk(${TARGET} ${FOLD})
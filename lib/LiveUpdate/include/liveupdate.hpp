@@ -29,6 +29,7 @@
 #include <vector>
 struct storage_entry;
 struct storage_header;
+namespace net::tls { class Ticket_keys; }
 
 namespace liu
 {
@@ -147,6 +148,8 @@ struct Storage
   inline void add_vector(uid, const std::vector<T>& vector);
   // store a TCP connection
   void add_connection(uid, Connection_ptr);
+  // store TLS session ticket keys, so tickets stay valid across the update
+  void add_ticket_keys(uid, const net::tls::Ticket_keys&);
   // store a Stream, but not its underlying transport
   // NOTE: UID is taken and used to determine its underlying type
   void add_stream(net::Stream&);
@@ -194,6 +197,8 @@ struct Restore
   // 2. select whether or not its an outgoing or incoming connection
   // 3. provide the underlying transport stream, for example a TCP stream
   net::Stream_ptr as_tls_stream(void* ctx, bool outgoing, net::Stream_ptr tr);
+  // replaces the keys with the stored ones
+  void            as_ticket_keys(net::tls::Ticket_keys&) const;
 
   template <typename S>
   inline const S& as_type() const;
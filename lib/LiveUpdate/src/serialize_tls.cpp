@@ -0,0 +1,45 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tls/ticket_keys.hpp>
+#include "liveupdate.hpp"
+#include "storage.hpp"
+#include <cstring>
+
+namespace liu
+{
+  using net::tls::Ticket_keys;
+  // header + keys, see Ticket_keys::serialize_to()
+  static constexpr size_t MAX_SERIALIZED_KEYS = 64 + Ticket_keys::MAX_KEYS * sizeof(Ticket_keys::Key);
+
+  void Storage::add_ticket_keys(uid id, const Ticket_keys& keys)
+  {
+    char buffer[MAX_SERIALIZED_KEYS];
+    const size_t len = keys.serialize_to(buffer, sizeof(buffer));
+    hdr.add_buffer(id, buffer, len);
+    // don't leave key material on the stack
+    volatile char* p = buffer;
+    for (size_t i = 0; i < len; i++) p[i] = 0;
+  }
+
+  void Restore::as_ticket_keys(Ticket_keys& keys) const
+  {
+    if (ent->type != TYPE_BUFFER) {
+      throw std::runtime_error("LiveUpdate: Restore::as_ticket_keys() encountered incorrect type " + std::to_string(ent->type));
+    }
+    keys.deserialize_from(ent->data(), ent->len);
+  }
+}
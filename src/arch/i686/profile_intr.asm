@@ -23,9 +23,10 @@ extern profiler_stack_sampler
 parasite_interrupt_handler:
   cli
   pusha
-  push DWORD [esp + 32]
+  push ebp
+  push DWORD [esp + 36]
   call profiler_stack_sampler
-  pop eax
+  add esp, 8
   call DWORD [current_intr_handler]
   popa
   sti
@@ -1,6 +1,8 @@
 #include "virtiocon.hpp"
 #include <kernel/events.hpp>
 #include <hw/pci.hpp>
+#include <kernel.hpp>
+#include <statman>
 #include <cassert>
 #include <cstring>
 #include <info>
@@ -27,7 +29,8 @@
 
 static int index_counter = 0;
 VirtioCon::VirtioCon(hw::PCI_Device& d)
-: Virtio(d), m_index(index_counter)
+: Virtio(d), m_index(index_counter),
+  tx_dropped_{Statman::get().create(Stat::UINT64, device_name() + ".tx_dropped").get_uint64()}
 {
   index_counter++;
   INFO("VirtioCon", "Driver initializing");
@@ -147,18 +150,55 @@ void VirtioCon::msix_xmit_handler()
   while (tx.new_incoming())
   {
     auto res = tx.dequeue();
-    free(res.data());
+    delete[] res.data();
   }
+  tx_busy_ = tx.num_free() < tx.size();
+  send_buffered();
   tx.enable_interrupts();
 }
 
 void VirtioCon::write(const void* data, size_t len)
 {
+  // completions are not handled while panicking, send directly
+  if (UNLIKELY(kernel::is_panicking())) {
+    send_buffered();
+    send(data, len);
+    return;
+  }
+  const int written = tx_buf_.write(data, len);
+  if (UNLIKELY((size_t) written < len))
+    tx_dropped_ += len - written;
+
+  if (not tx_busy_)
+    send_buffered();
+}
+
+void VirtioCon::send_buffered()
+{
+  const int len = tx_buf_.size();
+  if (len == 0 or tx.num_free() == 0) return;
+
+  uint8_t* heapdata = new uint8_t[len];
+  tx_buf_.read((char*) heapdata, len);
+  enqueue(heapdata, len);
+}
+
+void VirtioCon::send(const void* data, size_t len)
+{
+  if (UNLIKELY(tx.num_free() == 0)) {
+    tx_dropped_ += len;
+    return;
+  }
   uint8_t* heapdata = new uint8_t[len];
   memcpy(heapdata, data, len);
+  enqueue(heapdata, len);
+}
 
+void VirtioCon::enqueue(uint8_t* heapdata, size_t len)
+{
   const Token token {{ heapdata, len }, Token::OUT };
   std::array<Token, 1> tokens { token };
   tx.enqueue(tokens);
   tx.kick();
+  tx_busy_ = true;
 }
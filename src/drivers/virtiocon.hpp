@@ -21,6 +21,7 @@
 
 #include <delegate>
 #include <hw/pci_device.hpp>
+#include <util/ringbuffer.hpp>
 #include <virtio/virtio.hpp>
 
 /**
@@ -59,8 +60,17 @@ public:
     return config.cols;
   }
 
+  /**
+   * Queue output for the console. Writes made while a transmission is in
+   * flight are coalesced and sent together when it completes. Output that
+   * doesn't fit in the buffer is dropped and counted.
+   */
   void write (const void* data, size_t len);
 
+  /** Number of bytes dropped because the output buffer was full */
+  uint64_t dropped() const noexcept
+  { return tx_dropped_; }
+
   /** Constructor. @param pcidev an initialized PCI device. */
   VirtioCon(hw::PCI_Device& pcidev);
 
@@ -92,6 +102,9 @@ private:
   void event_handler();
   void msix_recv_handler();
   void msix_xmit_handler();
+  void send(const void* data, size_t len);
+  void send_buffered();
+  void enqueue(uint8_t* heapdata, size_t len);
 
   Virtio::Queue rx;     // 0
   Virtio::Queue tx;     // 1
@@ -101,6 +114,11 @@ private:
   // configuration as read from paravirtual PCI device
   console_config config;
   const int m_index = 0;
+
+  // output waiting for the transmission in flight
+  HeapRingBuffer tx_buf_ {16384};
+  bool tx_busy_ = false;
+  uint64_t& tx_dropped_;
 };
 
 #endif
@@ -50,8 +50,19 @@ struct alignas(SMP_ALIGN) smp_deferred_kick
 {
   std::vector<VirtioNet*> devs;
   uint8_t irq;
+  bool    subscribed = false;
 };
 static std::array<smp_deferred_kick, SMP_MAX_CORES> deferred_devs;
+
+// once per CPU, as devices may be constructed on any CPU
+void VirtioNet::subscribe_deferred_kick()
+{
+  auto& deferred = PER_CPU(deferred_devs);
+  if (deferred.subscribed == false) {
+    deferred.subscribed = true;
+    deferred.irq = Events::get().subscribe(handle_deferred_devices);
+  }
+}
 #endif
 
 using namespace net;
@@ -200,12 +211,7 @@ VirtioNet::VirtioNet(hw::PCI_Device& d, const uint16_t /*mtu*/)
   }
 
 #ifndef NO_DEFERRED_KICK
-  static bool init_deferred = false;
-  if (!init_deferred) {
-    init_deferred = true;
-    auto defirq = Events::get().subscribe(handle_deferred_devices);
-    PER_CPU(deferred_devs).irq = defirq;
-  }
+  subscribe_deferred_kick();
 #endif
 
   CHECK(this->link_up(), "Link up");
@@ -457,13 +463,19 @@ void VirtioNet::move_to_this_cpu()
   this->Virtio::move_to_this_cpu();
   // reset the IRQ handlers on this CPU
   auto& irqs = this->Virtio::get_irqs();
-  Events::get().subscribe(irqs[0], {this, &VirtioNet::msix_recv_handler});
-  Events::get().subscribe(irqs[1], {this, &VirtioNet::msix_xmit_handler});
-  Events::get().subscribe(irqs[2], {this, &VirtioNet::msix_conf_handler});
+  if (has_msix())
+  {
+    Events::get().subscribe(irqs[0], {this, &VirtioNet::msix_recv_handler});
+    Events::get().subscribe(irqs[1], {this, &VirtioNet::msix_xmit_handler});
+    Events::get().subscribe(irqs[2], {this, &VirtioNet::msix_conf_handler});
+  }
+  else
+  {
+    Events::get().subscribe(irqs[0], {this, &VirtioNet::legacy_handler});
+  }
 #ifndef NO_DEFERRED_KICK
   // update deferred kick IRQ
-  auto defirq = Events::get().subscribe(handle_deferred_devices);
-  PER_CPU(deferred_devs).irq = defirq;
+  subscribe_deferred_kick();
 #endif
 }
 
@@ -472,5 +484,6 @@ void VirtioNet::move_to_this_cpu()
 /** Register VirtioNet's driver factory at the PCI_manager */
 __attribute__((constructor))
 void autoreg_virtionet() {
-  hw::PCI_manager::register_nic(PCI::VENDOR_VIRTIO, 0x1000, &VirtioNet::new_instance);
+  // can move between CPUs, so it may be initialized on an AP during boot
+  hw::PCI_manager::register_nic(PCI::VENDOR_VIRTIO, 0x1000, &VirtioNet::new_instance, true);
 }
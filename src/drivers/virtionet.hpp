@@ -232,6 +232,7 @@ private:
   void begin_deferred_kick();
   bool deferred_kick = false;
   static void handle_deferred_devices();
+  static void subscribe_deferred_kick();
 
   net::BufferStore bufstore_;
 
@@ -0,0 +1,163 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fs/dentry_cache.hpp>
+#include <expects>
+
+namespace fs {
+
+  Dentry_cache::Dentry_cache(size_t capacity)
+    : nodes_(capacity)
+  {
+    Expects(capacity > 0 and capacity < NIL);
+    index_.reserve(capacity);
+    // every node starts out on the free list
+    for (uint32_t i = 0; i < capacity; i++)
+      nodes_[i].next = (i + 1 < capacity) ? i + 1 : NIL;
+    free_ = 0;
+  }
+
+  Dentry_cache& Dentry_cache::get()
+  {
+    // never destroyed, file systems invalidate their entries
+    // when they go away, which may be during static destruction
+    static auto* cache = new Dentry_cache;
+    return *cache;
+  }
+
+  uint64_t Dentry_cache::hash(int device, uint64_t base, std::string_view path) noexcept
+  {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h] (uint8_t b) {
+      h ^= b;
+      h *= 0x100000001b3ULL;
+    };
+    for (size_t i = 0; i < sizeof(device); i++) mix(device >> (i * 8));
+    for (size_t i = 0; i < sizeof(base); i++)   mix(base >> (i * 8));
+    for (const char c : path) mix(c);
+    return h;
+  }
+
+  const Dirent* Dentry_cache::find(int device, uint64_t base, std::string_view path) noexcept
+  {
+    auto it = index_.find(hash(device, base, path));
+    if (it != index_.end())
+    {
+      auto& node = nodes_[it->second];
+      if (node.device == device and node.base == base and node.path == path)
+      {
+        hits_++;
+        if (head_ != it->second) {
+          unlink(it->second);
+          push_front(it->second);
+        }
+        return &node.ent;
+      }
+    }
+    misses_++;
+    return nullptr;
+  }
+
+  const Dirent& Dentry_cache::insert(int device, uint64_t base, std::string_view path, const Dirent& ent)
+  {
+    auto& node = store(device, base, path);
+    node.ent = ent;
+    return node.ent;
+  }
+
+  const Dirent& Dentry_cache::insert_negative(int device, uint64_t base, std::string_view path)
+  {
+    auto& node = store(device, base, path);
+    node.ent = Dirent(nullptr, INVALID_ENTITY);
+    return node.ent;
+  }
+
+  Dentry_cache::Node& Dentry_cache::store(int device, uint64_t base, std::string_view path)
+  {
+    const uint64_t h = hash(device, base, path);
+    // replaces the same path, or another path with the same hash
+    auto it = index_.find(h);
+    if (it != index_.end())
+      remove(it->second);
+    // evict the least recently used
+    if (free_ == NIL)
+      remove(tail_);
+
+    const uint32_t idx = free_;
+    auto& node = nodes_[idx];
+    free_ = node.next;
+
+    node.hash   = h;
+    node.device = device;
+    node.base   = base;
+    node.path.assign(path.data(), path.size());
+    node.used   = true;
+    push_front(idx);
+    index_.emplace(h, idx);
+    count_++;
+    return node;
+  }
+
+  void Dentry_cache::remove(uint32_t idx)
+  {
+    auto& node = nodes_[idx];
+    Expects(node.used);
+    index_.erase(node.hash);
+    unlink(idx);
+    node.used = false;
+    // drop the Dirent's name, keep the path's storage for reuse
+    node.ent  = Dirent(nullptr);
+    node.next = free_;
+    free_ = idx;
+    count_--;
+  }
+
+  void Dentry_cache::invalidate(int device)
+  {
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+      if (nodes_[i].used and nodes_[i].device == device)
+        remove(i);
+    }
+  }
+
+  void Dentry_cache::clear()
+  {
+    while (head_ != NIL)
+      remove(head_);
+  }
+
+  void Dentry_cache::unlink(uint32_t idx) noexcept
+  {
+    auto& node = nodes_[idx];
+    if (node.prev != NIL) nodes_[node.prev].next = node.next;
+    else head_ = node.next;
+    if (node.next != NIL) nodes_[node.next].prev = node.prev;
+    else tail_ = node.prev;
+    node.prev = node.next = NIL;
+  }
+
+  void Dentry_cache::push_front(uint32_t idx) noexcept
+  {
+    auto& node = nodes_[idx];
+    node.prev = NIL;
+    node.next = head_;
+    if (head_ != NIL) nodes_[head_].prev = idx;
+    head_ = idx;
+    if (tail_ == NIL) tail_ = idx;
+  }
+
+} //< namespace fs
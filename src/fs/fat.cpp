@@ -19,6 +19,8 @@
 #include <fs/fat_internal.hpp>
 
 #include <fs/mbr.hpp>
+#include <fs/dentry_cache.hpp>
+#include <fs/path.hpp>
 #include <cassert>
 #include <cstring>
 #include <locale>
@@ -43,6 +45,24 @@ namespace fs
     //
   }
 
+  FAT::~FAT()
+  {
+    // cached entries point to us
+    Dentry_cache::get().invalidate(device_id());
+  }
+
+  std::string FAT::cache_key(const Path& path, std::vector<size_t>* ends)
+  {
+    if (path.empty()) return "/";
+    std::string key;
+    for (const auto& name : path) {
+      key += '/';
+      key += name;
+      if (ends) ends->push_back(key.size());
+    }
+    return key;
+  }
+
   void FAT::init(const void* base_sector) {
 
     // assume its the master boot record for now
@@ -165,6 +185,8 @@ namespace fs
 
         // initialize FAT16 or FAT32 filesystem
         init(mbr);
+        // anything cached for this device is from an earlier mount
+        Dentry_cache::get().invalidate(device_id());
 
         // determine which FAT version is initialized
         switch (this->fat_type) {
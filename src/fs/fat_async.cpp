@@ -19,6 +19,7 @@
 
 #include <cassert>
 #include <fs/path.hpp>
+#include <fs/dentry_cache.hpp>
 #include <cstring>
 #include <memory>
 
@@ -232,14 +233,51 @@ namespace fs
     }
 
     FS_PRINT("stat: %s\n", path->back().c_str());
+    auto& cache = Dentry_cache::get();
+    const int dev = device_id();
+    const uint64_t base = start ? start->block() : 0;
+
+    std::vector<size_t> ends;
+    ends.reserve(path->size());
+    auto key = cache_key(*path, &ends);
+    const std::string_view keyv {key};
+
     // extract file we are looking for
     std::string filename = path->back();
+
+    if (const auto* ent = cache.find(dev, base, keyv)) {
+      // func may evict it
+      if (ent->is_valid())
+        func(no_error, Dirent{*ent});
+      else
+        func({ error_t::E_NOENT, filename }, Dirent(this, INVALID_ENTITY, filename));
+      return;
+    }
+
+    // start from the nearest cached parent directory
+    Dirent parent = start ? *start : Dirent(this, DIR, "/", 0);
+    size_t skip = 0;
+    for (size_t i = path->size() - 1; i > 0; i--)
+    {
+      const auto* ent = cache.find(dev, base, keyv.substr(0, ends[i-1]));
+      if (ent == nullptr) continue;
+      if (not ent->is_dir()) {
+        error_t err = ent->is_valid() ? error_t{ error_t::E_NOTDIR, ent->name() }
+                                      : error_t{ error_t::E_NOENT, filename };
+        func(err, Dirent(this, INVALID_ENTITY, filename));
+        return;
+      }
+      parent = *ent;
+      skip   = i;
+      break;
+    }
+    for (size_t i = 0; i < skip; i++) path->pop_front();
     path->pop_back();
 
     traverse(
       path,
       cluster_func::make_packed(
-      [this, filename, func] (error_t error, Dirvec_ptr dirents)
+      [this, filename, func, dev, base, key = std::move(key)] (error_t error, Dirvec_ptr dirents)
       {
         if (UNLIKELY(error)) {
           // no path, no file!
@@ -250,6 +288,7 @@ namespace fs
         // find the matching filename in directory
         for (auto& e : *dirents) {
           if (UNLIKELY(e.name() == filename)) {
+            Dentry_cache::get().insert(dev, base, key, e);
             // return this dir entry
             func(no_error, e);
             return;
@@ -257,30 +296,23 @@ namespace fs
         }
 
         // not found
+        Dentry_cache::get().insert_negative(dev, base, key);
         func({ error_t::E_NOENT, filename }, Dirent(this, INVALID_ENTITY, filename));
       }),
-      start
+      &parent
     );
   }
 
   void FAT::cstat(const std::string& strpath, on_stat_func func)
   {
-    // cache lookup
-    auto it = stat_cache.find(strpath);
-    if (it != stat_cache.end()) {
+    // lookup without parsing the path, when it's already in canonical form
+    const auto* ent = Dentry_cache::get().find(device_id(), 0, strpath);
+    if (ent != nullptr and ent->is_valid()) {
       FS_PRINT("used cached stat for %s\n", strpath.c_str());
-      func(no_error, it->second);
+      func(no_error, Dirent{*ent});
       return;
     }
 
-    File_system::stat(
-      strpath,
-      fs::on_stat_func::make_packed(
-      [this, strpath, func] (error_t error, const Dirent& ent)
-      {
-        stat_cache.emplace(strpath, ent);
-        func(error, ent);
-      })
-    );
+    File_system::stat(strpath, func);
   }
 }
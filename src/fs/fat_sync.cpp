@@ -18,6 +18,8 @@
 #include <fs/fat.hpp>
 
 #include <fs/path.hpp>
+#include <fs/dentry_cache.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <memory>
@@ -153,24 +155,64 @@ namespace fs
     }
 
     FS_PRINT("stat_sync: %s\n", path.back().c_str());
-    // extract file we are looking for
-    const std::string filename = path.back();
-    path.pop_back();
+    return resolve(path, start);
+  }
 
-    // result directory entries are put into @dirents
-    dirvector dirents;
+  Dirent FAT::resolve(const Path& path, const Dirent* const start) const
+  {
+    auto& cache = Dentry_cache::get();
+    const int dev = device_id();
+    const uint64_t base = start ? start->block() : 0;
+
+    std::vector<size_t> ends;
+    ends.reserve(path.size());
+    const auto key = cache_key(path, &ends);
+    const std::string_view keyv {key};
+
+    if (const auto* ent = cache.find(dev, base, keyv)) {
+      if (ent->is_valid()) return *ent;
+      return Dirent(this, INVALID_ENTITY);
+    }
 
-    auto err = traverse(path, dirents, start);
-    if (UNLIKELY(err))
-      return Dirent(this, INVALID_ENTITY); // for now
+    // continue from the nearest cached parent directory
+    Dirent dir = start ? *start : Dirent(this, DIR, "/", 0);
+    size_t next = 0;
+    for (size_t i = path.size() - 1; i > 0; i--)
+    {
+      const auto* ent = cache.find(dev, base, keyv.substr(0, ends[i-1]));
+      if (ent == nullptr) continue;
+      if (not ent->is_dir())
+        return Dirent(this, INVALID_ENTITY);
+      dir  = *ent;
+      next = i;
+      break;
+    }
 
-    // find the matching filename in directory
-    for (auto& e : dirents)
-    if (UNLIKELY(e.name() == filename)) {
-      // return this directory entry
-      return e;
+    // read one directory per remaining name, caching each of them
+    dirvector dirents;
+    for (size_t i = next; i < path.size(); i++)
+    {
+      dirents.clear();
+      auto err = int_ls(this->cl_to_sector(dir.block()), dirents);
+      if (UNLIKELY(err))
+        return Dirent(this, INVALID_ENTITY); // for now
+
+      const auto& name = path[i];
+      const auto prefix = keyv.substr(0, ends[i]);
+      auto it = std::find_if(dirents.begin(), dirents.end(),
+          [&name] (const Dirent& e) { return e.name() == name; });
+
+      if (it == dirents.end()) {
+        FS_PRINT("stat_sync: NO MATCH for %s\n", name.c_str());
+        cache.insert_negative(dev, base, prefix);
+        return Dirent(this, INVALID_ENTITY);
+      }
+      cache.insert(dev, base, prefix, *it);
+      // only follow directories
+      if (i + 1 < path.size() and not it->is_dir())
+        return Dirent(this, INVALID_ENTITY);
+      dir = *it;
     }
-    // entry not found
-    return Dirent(this, INVALID_ENTITY);
+    return dir;
   }
 }
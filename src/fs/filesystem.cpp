@@ -17,6 +17,7 @@
 
 #include <array>
 #include <fs/dirent.hpp>
+#include <fs/dentry_cache.hpp>
 
 namespace fs
 {
@@ -66,6 +67,19 @@ namespace fs
       return read(ent, 0, ent.size());
   }
 
+  const Dirent& File_system::resolve(std::string_view path) const
+  {
+    auto& cache = Dentry_cache::get();
+    if (const auto* ent = cache.find(device_id(), 0, path))
+      return *ent;
+
+    // the file system caches the canonical path, remember this one too
+    const auto ent = stat(std::string(path));
+    if (not ent.is_valid())
+      return cache.insert_negative(device_id(), 0, path);
+    return cache.insert(device_id(), 0, path, ent);
+  }
+
   static error_t print_subtree(Dirvec_ptr entries, int depth)
   {
     int indent = depth * 3;
@@ -0,0 +1,136 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fs/pack.hpp>
+#include <info>
+#include <likely>
+#include <cstring>
+
+extern char _PACK_START_;
+extern char _PACK_END_;
+
+namespace fs {
+
+  // an image without files, for when there is nothing linked in
+  alignas(Pack::Header) static const Pack::Header empty_header {
+    Pack::MAGIC, Pack::VERSION, 0, 0, 0, 0, 0, 0, sizeof(Pack::Header), 0
+  };
+
+  Pack::Pack(const void* image, size_t size)
+    : base_{static_cast<const char*>(image)}, size_{size}
+  {
+    if (size_ == 0) {
+      base_ = reinterpret_cast<const char*>(&empty_header);
+      size_ = sizeof(empty_header);
+    }
+    validate();
+  }
+
+  const Pack& Pack::embedded()
+  {
+    static Pack pack = [] {
+      Pack p {&_PACK_START_, size_t(&_PACK_END_ - &_PACK_START_)};
+      INFO("Pack", "Embedded image with %zu files at %p", p.size(), &_PACK_START_);
+      return p;
+    }();
+    return pack;
+  }
+
+  uint64_t Pack::hash(std::string_view path) noexcept
+  {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char c : path) {
+      h ^= static_cast<uint8_t>(c);
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  const Pack::Entry* Pack::find_entry(std::string_view path) const noexcept
+  {
+    const auto& hdr = header();
+    if (UNLIKELY(hdr.bucket_count == 0)) return nullptr;
+
+    const uint64_t h = hash(path);
+    const uint32_t mask = hdr.bucket_count - 1;
+    const auto* index = buckets();
+    // linear probing, 0 is an empty bucket
+    for (uint32_t i = h & mask; index[i] != 0; i = (i + 1) & mask)
+    {
+      const auto& entry = entries()[index[i] - 1];
+      if (entry.hash == h && entry.path_length == path.size()
+          && std::memcmp(base_ + entry.path_offset, path.data(), path.size()) == 0)
+        return &entry;
+    }
+    return nullptr;
+  }
+
+  void Pack::validate() const
+  {
+    if (size_ < sizeof(Header))
+      throw Error("Pack image is too small");
+    if (reinterpret_cast<uintptr_t>(base_) % alignof(Header) != 0)
+      throw Error("Pack image is misaligned");
+
+    const auto& hdr = header();
+    if (hdr.magic != MAGIC)
+      throw Error("Not a pack image");
+    if (hdr.version != VERSION)
+      throw Error("Unsupported pack image version");
+    if (hdr.image_size > size_)
+      throw Error("Pack image is truncated");
+
+    auto within = [this] (uint64_t offset, uint64_t len) {
+      return offset <= size_ && len <= size_ - offset;
+    };
+    // without files there is no index, find_entry() checks bucket_count
+    if (hdr.file_count == 0) {
+      if (hdr.bucket_count != 0)
+        throw Error("Invalid pack index size");
+      return;
+    }
+    if ((hdr.bucket_count & (hdr.bucket_count - 1)) != 0
+        || hdr.bucket_count <= hdr.file_count)
+      throw Error("Invalid pack index size");
+    if (!within(hdr.buckets_offset, uint64_t(hdr.bucket_count) * sizeof(uint32_t))
+        || !within(hdr.entries_offset, uint64_t(hdr.file_count) * sizeof(Entry))
+        || hdr.buckets_offset % alignof(uint32_t) != 0
+        || hdr.entries_offset % alignof(Entry) != 0)
+      throw Error("Pack index is out of bounds");
+
+    uint32_t empty = 0;
+    for (uint32_t i = 0; i < hdr.bucket_count; i++) {
+      if (buckets()[i] > hdr.file_count)
+        throw Error("Pack index refers to a missing file");
+      if (buckets()[i] == 0)
+        empty++;
+    }
+    // probing for a missing name stops at an empty bucket
+    if (empty == 0)
+      throw Error("Pack index has no empty bucket");
+    for (uint32_t i = 0; i < hdr.file_count; i++)
+    {
+      const auto& entry = entries()[i];
+      if (!within(entry.path_offset, entry.path_length))
+        throw Error("Pack path is out of bounds");
+      for (const auto& v : entry.variant) {
+        if (!within(v.offset, v.size))
+          throw Error("Pack file is out of bounds");
+      }
+    }
+  }
+
+} //< namespace fs
@@ -16,9 +16,33 @@
 // limitations under the License.
 
 #include <hw/nic.hpp>
+#include <atomic>
 
 namespace hw
 {
+  static std::atomic<int> id_counter {0};
+  // NICs may be constructed on several CPUs at once
+  static thread_local int reserved_id = -1;
+
+  int Nic::reserve_index() noexcept
+  {
+    return id_counter++;
+  }
+
+  void Nic::use_index(const int idx) noexcept
+  {
+    reserved_id = idx;
+  }
+
+  int Nic::next_index() noexcept
+  {
+    if (reserved_id < 0)
+      return id_counter++;
+    const int idx = reserved_id;
+    reserved_id = -1;
+    return idx;
+  }
+
   __attribute__((weak))
   uint16_t Nic::MTU_detection_override(int idx, const uint16_t default_MTU)
   {
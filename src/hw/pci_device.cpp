@@ -20,9 +20,15 @@
 #include <hw/pci.hpp>
 #include <hw/pci_device.hpp>
 #include <hw/msi.hpp>
+#include <smp_utils>
+#include <mutex>
 
 namespace hw {
 
+  // the address and data ports are shared by all CPUs,
+  // which may initialize devices concurrently during boot
+  static Spinlock config_lock;
+
   static constexpr std::array<const char*,3> bridge_subclasses {
     "Host",
     "ISA",
@@ -105,6 +111,7 @@ namespace hw {
     req.addr = pci_addr;
     req.reg  = reg;
 
+    std::lock_guard<Spinlock> guard(config_lock);
     outpd(PCI::CONFIG_ADDR, 0x80000000 | req.data);
     return inpd(PCI::CONFIG_DATA);
   }
@@ -115,6 +122,7 @@ namespace hw {
     req.addr = pci_addr_;
     req.reg  = reg;
 
+    std::lock_guard<Spinlock> guard(config_lock);
     outpd(PCI::CONFIG_ADDR, 0x80000000 | req.data);
     outpd(PCI::CONFIG_DATA, value);
   }
@@ -126,6 +134,7 @@ namespace hw {
     req.addr = pci_addr_;
     req.reg  = reg;
 
+    std::lock_guard<Spinlock> guard(config_lock);
     outpd(PCI::CONFIG_ADDR, 0x80000000 | req.data);
     return inpd(PCI::CONFIG_DATA);
   }
@@ -137,6 +146,7 @@ namespace hw {
     req.addr = pci_addr_;
     req.reg  = reg;
 
+    std::lock_guard<Spinlock> guard(config_lock);
     outpd(PCI::CONFIG_ADDR, 0x80000000 | req.data);
     uint16_t data = inpw(PCI::CONFIG_DATA + (reg & 2));
     return data;
@@ -147,6 +157,7 @@ namespace hw {
     req.addr = pci_addr_;
     req.reg  = reg;
 
+    std::lock_guard<Spinlock> guard(config_lock);
     outpd(PCI::CONFIG_ADDR, 0x80000000 | req.data);
     outpw(PCI::CONFIG_DATA + (reg & 2), value);
   }
@@ -15,13 +15,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
 #include <delegate>
+#include <exception>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include <hw/pci_manager.hpp>
 #include <hal/machine.hpp>
+#include <kernel/boot_trace.hpp>
+#include <net/ethernet/ethernet.hpp>
+#include <smp>
 
 namespace hw {
 
@@ -34,34 +42,175 @@ static std::vector<pcidev_info> devinfos_;
 static std::vector<hw::PCI_Device> devices_;
 static std::vector<Driver_entry<PCI_manager::NIC_driver>> nic_fact;
 static std::vector<Driver_entry<PCI_manager::BLK_driver>> blk_fact;
+// NIC drivers whose instances can move to another CPU once constructed
+static std::vector<uint32_t> nic_movable;
+
+template <typename Factory>
+static const Factory* find_driver(const hw::PCI_Device& dev,
+                                  const fixed_factory_t<Factory>& factory)
+{
+  for (const auto& fact : factory) {
+    if (fact.first == dev.vendor_product())
+      return &fact.second;
+  }
+  return nullptr;
+}
 
 template <typename Factory, typename Class>
 static inline bool register_device(hw::PCI_Device& dev,
                                    fixed_factory_t<Factory>& factory) {
   INFO2("|--[ %s ]", dev.to_string().c_str());
-  for (const auto& fact : factory) {
-    if (fact.first == dev.vendor_product())
+  if (const auto* fact = find_driver(dev, factory))
+  {
+    INFO2("|");
+    auto driver = [&]
     {
-      INFO2("|");
-      auto driver = [&]
+      if constexpr(std::is_same<Class, hw::Nic>::value)
       {
-        if constexpr(std::is_same<Class, hw::Nic>::value)
-        {
-          const ssize_t idx = os::machine().count<hw::Nic>();
-          return fact.second(dev, hw::Nic::MTU_detection_override(idx, 1500));
-        }
-        else {
-          return fact.second(dev);
-        }
-      }();
-      os::machine().add<Class>(std::move(driver));
-      return true;
-    }
+        const ssize_t idx = os::machine().count<hw::Nic>();
+        return (*fact)(dev, hw::Nic::MTU_detection_override(idx, 1500));
+      }
+      else {
+        return (*fact)(dev);
+      }
+    }();
+    os::machine().add<Class>(std::move(driver));
+    // time spent in each driver factory
+    char phase[kernel::boot_trace::MAX_NAME+1];
+    snprintf(phase, sizeof(phase), "driver %04x:%04x",
+             dev.vendor_id(), dev.product_id());
+    kernel::boot_trace::mark(phase);
+    return true;
   }
   INFO2("|  +-x Driver not found ");
   return false;
 }
 
+#ifdef NO_PARALLEL_NIC_INIT
+static bool parallel_nics = false;
+#else
+static bool parallel_nics = true;
+#endif
+
+struct Nic_job {
+  hw::PCI_Device* dev;
+  const PCI_manager::NIC_driver* factory;
+  uint16_t mtu;
+  int      cpu;
+  // reserved in bus order, as the drivers finish in any order
+  int      nic_idx;
+  int      link_idx;
+  std::unique_ptr<hw::Nic> nic;
+  std::exception_ptr error;
+};
+
+// shared with the tasks, which may outlive init_nics_parallel on the APs
+struct Nic_jobs {
+  std::vector<Nic_job> jobs;
+  std::atomic<size_t> built {0};
+  std::atomic<bool>   moved {false};
+  std::atomic<size_t> left  {0};
+};
+
+static void build_nic(Nic_job& job)
+{
+  hw::Nic::use_index(job.nic_idx);
+  net::Ethernet::use_index(job.link_idx);
+  try {
+    job.nic = (*job.factory)(*job.dev, job.mtu);
+  }
+  catch (...) {
+    job.error = std::current_exception();
+  }
+  // unused if the driver failed early
+  hw::Nic::use_index(-1);
+  net::Ethernet::use_index(-1);
+}
+
+/**
+ * Construct NIC drivers on all CPUs at once. Drivers that can't move
+ * between CPUs are constructed on this one. The NICs are added to the
+ * machine in bus order afterwards, and their names reserved in bus order
+ * beforehand, so neither depends on which finished first.
+ *
+ * The APs wait until their NICs have moved to this CPU, so they never
+ * handle interrupts for a device while it is being moved. A driver
+ * failing is rethrown here once the APs are done.
+ */
+static void init_nics_parallel(const std::vector<hw::PCI_Device*>& devs)
+{
+  auto state = std::make_shared<Nic_jobs>();
+  auto& jobs = state->jobs;
+  jobs.reserve(devs.size());
+
+  const int this_cpu = SMP::cpu_id();
+  const int cpus = SMP::cpu_count();
+  int next = 0;
+  for (auto* dev : devs)
+  {
+    INFO2("|--[ %s ]", dev->to_string().c_str());
+    const auto* fact = find_driver(*dev, nic_fact);
+    if (fact == nullptr) {
+      INFO2("|  +-x Driver not found ");
+      continue;
+    }
+    const ssize_t idx = os::machine().count<hw::Nic>() + jobs.size();
+    int cpu = this_cpu;
+    if (std::find(nic_movable.begin(), nic_movable.end(),
+                  dev->vendor_product()) != nic_movable.end())
+      cpu = SMP::active_cpus(next++ % cpus);
+    jobs.push_back({dev, fact, hw::Nic::MTU_detection_override(idx, 1500), cpu,
+                    hw::Nic::reserve_index(), net::Ethernet::reserve_index(),
+                    nullptr, nullptr});
+  }
+
+  size_t remote = 0;
+  for (size_t i = 0; i < jobs.size(); i++)
+  {
+    if (jobs[i].cpu == this_cpu) continue;
+    remote++;
+    SMP::add_task(
+      [state, i] {
+        build_nic(state->jobs[i]);
+        state->built++;
+        while (state->moved.load(std::memory_order_acquire) == false)
+          os::Arch::cpu_relax();
+        state->left++;
+      }, jobs[i].cpu);
+  }
+  if (remote)
+    SMP::signal();
+
+  // do our share meanwhile
+  for (auto& job : jobs)
+  {
+    if (job.cpu != this_cpu) continue;
+    build_nic(job);
+    state->built++;
+  }
+  while (state->built.load(std::memory_order_acquire) < jobs.size())
+    os::Arch::cpu_relax();
+
+  std::exception_ptr error = nullptr;
+  for (auto& job : jobs)
+  {
+    if (job.error) {
+      if (error == nullptr) error = job.error;
+      continue;
+    }
+    if (job.cpu != this_cpu)
+      job.nic->move_to_this_cpu();
+    os::machine().add<hw::Nic>(std::move(job.nic));
+  }
+  state->moved.store(true, std::memory_order_release);
+  while (state->left.load(std::memory_order_acquire) < remote)
+    os::Arch::cpu_relax();
+  kernel::boot_trace::mark("nics (parallel)");
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
 PCI_manager::Device_vector PCI_manager::devices () {
   Device_vector device_vec;
   for (const auto& dev : devices_)
@@ -113,12 +262,18 @@ void PCI_manager::scan_bus(const int bus)
 void PCI_manager::init_devices(const uint8_t classcode)
 {
   INFO2("|- Initializing %s", PCI::classcode_str(classcode));
+  std::vector<hw::PCI_Device*> nics;
   for(const auto& [pci_addr, id, devclass] : devinfos_)
   {
     if(devclass.classcode != classcode)
       continue;
 
     auto& stored_dev = devices_.emplace_back(pci_addr, id, devclass.reg);
+    // with more CPUs, NICs can be initialized concurrently
+    if (classcode == PCI::NIC && parallel_nics && SMP::cpu_count() > 1) {
+      nics.push_back(&stored_dev);
+      continue;
+    }
     // translate classcode to device and register
     switch (devclass.classcode)
     {
@@ -135,6 +290,8 @@ void PCI_manager::init_devices(const uint8_t classcode)
         break;
     }
   }
+  if (not nics.empty())
+    init_nics_parallel(nics);
   INFO2("o");
 }
 
@@ -147,15 +304,24 @@ void PCI_manager::init()
    * Starting with the first bus
   **/
   scan_bus(0);
+  // drivers keep references to their devices
+  devices_.reserve(devinfos_.size());
 }
 
 inline uint32_t driver_id(uint16_t vendor, uint16_t prod) {
   return (uint32_t) prod << 16 | vendor;
 }
 
-void PCI_manager::register_nic(uint16_t vendor, uint16_t prod, NIC_driver factory)
+void PCI_manager::register_nic(uint16_t vendor, uint16_t prod, NIC_driver factory,
+                               bool movable)
 {
   nic_fact.emplace_back(driver_id(vendor, prod), factory);
+  if (movable)
+    nic_movable.push_back(driver_id(vendor, prod));
+}
+void PCI_manager::parallel_nic_init(const bool enabled) noexcept
+{
+  parallel_nics = enabled;
 }
 void PCI_manager::register_blk(uint16_t vendor, uint16_t prod, BLK_driver factory)
 {
@@ -17,9 +17,17 @@
 
 #include <hw/serial.hpp>
 #include <kernel/events.hpp>
+#include <statman>
+#include <kernel.hpp>
 
 using namespace hw;
 
+// Used by the default stdout (__serial_print) when port 1 is buffered
+extern "C" void (*__serial_print_buffered)(const char*, size_t);
+void (*__serial_print_buffered)(const char*, size_t) = nullptr;
+
+static constexpr int UART_FIFO_SIZE = 16;
+
 // Storage for port numbers
 constexpr uint16_t Serial::PORTS[];
 constexpr uint8_t  Serial::IRQS[];
@@ -46,16 +54,37 @@ Serial::Serial(int port) :
 }
 
 void Serial::print_handler(const char* str, size_t len) {
-  for(size_t i = 0; i < len; ++i)
-      this->write(str[i]);
+  this->write(str, len);
+}
+
+void Serial::subscribe_irq() {
+  Events::get().subscribe(irq_, {this, &Serial::irq_handler_});
+  __arch_enable_legacy_irq(irq_);
 }
 
 void Serial::on_data(on_data_handler del) {
   enable_interrupt();
   on_data_ = del;
   INFO("Serial", "Subscribing to data on IRQ %i",irq_);
-  Events::get().subscribe(irq_, {this, &Serial::irq_handler_});
-  __arch_enable_legacy_irq(irq_);
+  subscribe_irq();
+}
+
+void Serial::enable_buffered_output(int capacity) {
+  if (tx_buf_ != nullptr) return;
+  tx_buf_ = std::make_unique<HeapRingBuffer>(capacity);
+  int index = 1;
+  while (index < 4 and PORTS[index-1] != port_) index++;
+  tx_dropped_ = &Statman::get().get_or_create(Stat::UINT64,
+      "serial" + std::to_string(index) + ".tx_dropped").get_uint64();
+
+  if (port_ == PORTS[0])
+    __serial_print_buffered = [] (const char* str, size_t len) {
+      Serial::port<1>().write(str, len);
+    };
+  // interrupt when the transmitter holding register is empty
+  ier_ |= 0x02;
+  outb(port_ + 1, ier_);
+  subscribe_irq();
 }
 
 void Serial::on_readline(on_string_handler del, char delim) {
@@ -66,11 +95,13 @@ void Serial::on_readline(on_string_handler del, char delim) {
 }
 
 void Serial::enable_interrupt() {
-  outb(port_ + 1, 0x01);
+  ier_ |= 0x01;
+  outb(port_ + 1, ier_);
 }
 
 void Serial::disable_interrupt() {
-  outb(port_ + 1, 0x00);
+  ier_ &= ~0x01;
+  outb(port_ + 1, ier_);
 }
 
 char Serial::read() {
@@ -82,6 +113,36 @@ void Serial::write(char c) {
   hw::outb(port_, c);
 }
 
+void Serial::write(const char* str, size_t len) {
+  if (tx_buf_ == nullptr or kernel::is_panicking()) {
+    flush();
+    for (size_t i = 0; i < len; ++i)
+      write(str[i]);
+    return;
+  }
+  const int written = tx_buf_->write(str, len);
+  if (UNLIKELY((size_t) written < len))
+    *tx_dropped_ += len - written;
+  transmit();
+}
+
+void Serial::transmit() {
+  // an empty holding register means the FIFO is empty too
+  if (tx_buf_->empty() or is_transmit_empty() == 0) return;
+  char chunk[UART_FIFO_SIZE];
+  const int len = tx_buf_->read(chunk, sizeof(chunk));
+  for (int i = 0; i < len; i++)
+    hw::outb(port_, chunk[i]);
+}
+
+void Serial::flush() {
+  if (tx_buf_ == nullptr) return;
+  char chunk[UART_FIFO_SIZE];
+  while (int len = tx_buf_->read(chunk, sizeof(chunk)))
+    for (int i = 0; i < len; i++)
+      write(chunk[i]);
+}
+
 int Serial::received() {
   return hw::inb(port_ + 5) & 1;
 }
@@ -91,10 +152,14 @@ int Serial::is_transmit_empty() {
 }
 
 void Serial::irq_handler_ () {
+  // reading the identification register acknowledges a transmit interrupt
+  (void) hw::inb(port_ + 2);
 
   while (received())
     on_data_(read());
 
+  if (tx_buf_ != nullptr)
+    transmit();
 }
 
 void Serial::readline_handler_ (char c) {
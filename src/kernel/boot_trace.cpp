@@ -0,0 +1,121 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <kernel/boot_trace.hpp>
+#include <arch.hpp>
+#include <os.hpp>
+#include <statman>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+
+namespace kernel::boot_trace {
+
+  // in .bss, so only usable after _init_bss
+  static Event    trace[MAX_EVENTS];
+  static size_t   count   = 0;
+  static size_t   lost    = 0;
+  static uint64_t started = 0;
+
+  void begin(uint64_t cycles) noexcept
+  {
+    started = cycles;
+    count   = 0;
+    lost    = 0;
+  }
+
+  void mark(const char* phase) noexcept
+  {
+    mark(phase, os::Arch::cpu_cycles());
+  }
+
+  void mark(const char* phase, uint64_t cycles) noexcept
+  {
+    if (count == MAX_EVENTS) {
+      lost++;
+      return;
+    }
+    auto& ev = trace[count++];
+    // no libc yet, early on
+    size_t i = 0;
+    for (; i < MAX_NAME && phase[i] != '\0'; i++)
+      ev.name[i] = phase[i];
+    ev.name[i] = '\0';
+    ev.cycles  = cycles;
+  }
+
+  uint64_t begin_cycles() noexcept
+  { return started; }
+
+  const Event* events() noexcept
+  { return trace; }
+
+  size_t size() noexcept
+  { return count; }
+
+  size_t dropped() noexcept
+  { return lost; }
+
+  uint64_t duration(size_t i) noexcept
+  {
+    const uint64_t prev = (i == 0) ? started : trace[i-1].cycles;
+    return trace[i].cycles - prev;
+  }
+
+  static uint64_t to_micros(uint64_t cycles)
+  {
+    const double khz = os::cpu_freq().count();
+    if (khz <= 0.0) return 0;
+    return cycles * 1000.0 / khz;
+  }
+
+  void to_statman()
+  {
+    // the same phase may appear more than once, eg. drivers.
+    // assigned, not added, so exporting again doesn't count twice
+    std::map<std::string, uint64_t> phases;
+    for (size_t i = 0; i < count; i++)
+      phases[std::string("boot.") + trace[i].name] += duration(i);
+
+    auto& statman = Statman::get();
+    for (const auto& [name, cycles] : phases)
+      statman.get_or_create(Stat::UINT64, name).get_uint64() = to_micros(cycles);
+    if (count > 0) {
+      statman.get_or_create(Stat::UINT64, "boot.total").get_uint64()
+          = to_micros(trace[count-1].cycles - started);
+    }
+  }
+
+  void print()
+  {
+    printf("%-32s | %14s | %10s\n", "Boot phase", "Cycles", "Micros");
+    printf("%.*s\n", 62, "--------------------------------------------------------------------------------");
+    for (size_t i = 0; i < count; i++)
+    {
+      const auto cycles = duration(i);
+      printf("%-32s | %14" PRIu64 " | %10" PRIu64 "\n",
+             trace[i].name, cycles, to_micros(cycles));
+    }
+    printf("%.*s\n", 62, "--------------------------------------------------------------------------------");
+    if (count > 0) {
+      const auto total = trace[count-1].cycles - started;
+      printf("%-32s | %14" PRIu64 " | %10" PRIu64 "\n", "Total", total, to_micros(total));
+    }
+    if (lost > 0)
+      printf("(%zu events dropped)\n", lost);
+  }
+
+} //< kernel::boot_trace
@@ -329,6 +329,65 @@ static unsigned kvm_function() noexcept
       return res.EAX;
   return 0;
 }
+// VMware-style timing leaf, also provided by KVM and others when
+// the TSC is invariant: EAX is the TSC and EBX the APIC bus in kHz
+#define HYPERVISOR_CPUID_BASE    0x40000000
+#define HYPERVISOR_CPUID_TIMING  0x40000010
+
+static bool is_hypervisor() noexcept
+{
+  return (cpuid(1, 0).ECX & (1u << 31)) != 0;
+}
+
+static cpuid_t hypervisor_timing() noexcept
+{
+  if (is_hypervisor()) {
+    const auto max = cpuid(HYPERVISOR_CPUID_BASE, 0).EAX;
+    if (max >= HYPERVISOR_CPUID_TIMING && max < HYPERVISOR_CPUID_BASE + 0x10000)
+      return cpuid(HYPERVISOR_CPUID_TIMING, 0);
+  }
+  return {};
+}
+
+// core crystal clock in Hz, from leaf 0x15
+static uint64_t crystal_hz(uint32_t* num = nullptr, uint32_t* den = nullptr) noexcept
+{
+  if (cpuid(0, 0).EAX < 0x15) return 0;
+  const auto res = cpuid(0x15, 0);
+  if (num) *num = res.EBX;
+  if (den) *den = res.EAX;
+  return res.ECX;
+}
+
+uint64_t CPUID::tsc_khz() noexcept
+{
+  const auto timing = hypervisor_timing();
+  if (timing.EAX != 0) return timing.EAX;
+
+  uint32_t num = 0, den = 0;
+  const uint64_t crystal = crystal_hz(&num, &den);
+  if (crystal != 0 && num != 0 && den != 0)
+    return crystal * num / den / 1000;
+
+  // processor base frequency in MHz
+  if (cpuid(0, 0).EAX >= 0x16) {
+    const auto base = cpuid(0x16, 0).EAX & 0xFFFF;
+    if (base != 0) return base * 1000ull;
+  }
+  return 0;
+}
+
+uint64_t CPUID::apic_timer_khz() noexcept
+{
+  const auto timing = hypervisor_timing();
+  if (timing.EBX != 0) return timing.EBX;
+  // hypervisors emulate the APIC timer at a rate of their own choice,
+  // which only the timing leaf reports
+  if (is_hypervisor()) return 0;
+  // on bare metal the APIC timer runs off the core crystal
+  return crystal_hz() / 1000;
+}
+
 bool CPUID::kvm_feature(unsigned mask) noexcept
 {
   unsigned func = kvm_function();
@@ -17,6 +17,7 @@
 
 #include <kernel/elf.hpp>
 #include <util/crc32.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -104,6 +105,7 @@ public:
     this->strtab = {strs, strsize};
     this->checksum_syms = csum_syms;
     this->checksum_strs = csum_strs;
+    this->index.clear();
   }
 
   safe_func_offset getsym_safe(ElfAddr addr, char* buffer, size_t length)
@@ -132,8 +134,23 @@ public:
     return {buffer, static_cast<uintptr_t>(addr), 0};
   }
 
+  void build_index()
+  {
+    std::vector<uint32_t> idx;
+    idx.reserve(symtab.entries);
+    for (uint32_t i = 0; i < symtab.entries; i++)
+      if (symtab.base[i].st_value != 0) idx.push_back(i);
+
+    std::sort(idx.begin(), idx.end(),
+      [this] (uint32_t a, uint32_t b) {
+        return symtab.base[a].st_value < symtab.base[b].st_value;
+      });
+    this->index = std::move(idx);
+  }
+
   const ElfSym* getaddr(ElfAddr addr)
   {
+    if (LIKELY(not index.empty())) return getaddr_indexed(addr);
     // find exact match
     for (int i = 0; i < (int) symtab.entries; i++)
     {
@@ -161,6 +178,24 @@ public:
     return guess;
   }
 
+  // same as getaddr, using the symbols sorted by address
+  const ElfSym* getaddr_indexed(ElfAddr addr) const
+  {
+    auto it = std::upper_bound(index.begin(), index.end(), addr,
+      [this] (ElfAddr a, uint32_t i) {
+        return a < symtab.base[i].st_value;
+      });
+    // the closest symbols at or below addr, the first one containing it wins
+    const ElfSym* guess = nullptr;
+    for (int scanned = 0; it != index.begin() and scanned < 16; scanned++)
+    {
+      const auto& sym = symtab.base[*--it];
+      if (addr < sym.st_value + sym.st_size) return &sym;
+      if (guess == nullptr and addr - sym.st_value < 512) guess = &sym;
+    }
+    return guess;
+  }
+
   size_t end_of_file() const {
     auto& hdr = elf_header();
     return hdr.e_ehsize + (hdr.e_phnum * hdr.e_phentsize) + (hdr.e_shnum * hdr.e_shentsize);
@@ -208,6 +243,8 @@ private:
 
   SymTab    symtab;
   StrTab    strtab;
+  // symbol table indices sorted by address, built on request
+  std::vector<uint32_t> index;
   /* NOTE: DON'T INITIALIZE */
   uint32_t  checksum_syms;
   uint32_t  checksum_strs;
@@ -227,6 +264,11 @@ const char* Elf::get_strtab() {
   return get_parser().get_strtab();
 }
 
+void Elf::build_symbol_index()
+{
+  get_parser().build_index();
+}
+
 uintptr_t Elf::resolve_addr(uintptr_t addr)
 {
   auto* sym = get_parser().getaddr(addr);
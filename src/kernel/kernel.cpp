@@ -17,6 +17,7 @@
 
 #include <os.hpp>
 #include <kernel.hpp>
+#include <kernel/boot_trace.hpp>
 #include <kernel/cpuid.hpp>
 #include <kernel/diag.hpp>
 #include <kernel/rng.hpp>
@@ -110,6 +111,7 @@ void kernel::post_start()
   MYINFO("Initializing RNG");
   PROFILE("RNG init");
   RNG::get().init();
+  kernel::boot_trace::mark("rng");
 
   // Seed rand with 32 bits from RNG
   srand(rng_extract_uint32());
@@ -126,6 +128,7 @@ void kernel::post_start()
     INFO2("* Initializing %s", plugin.name);
     plugin.func();
   }
+  kernel::boot_trace::mark("plugins");
 
   MYINFO("Running service constructors");
   FILLINE('-');
@@ -136,6 +139,7 @@ void kernel::post_start()
     // Run service constructors
   kernel::run_ctors(&__service_ctors_start, &__service_ctors_end);
 #endif
+  kernel::boot_trace::mark("service ctors");
 
   PROFILE("Service::start");
   // begin service start
@@ -169,7 +173,7 @@ void kernel::post_start()
 
   // service program start
   Service::start();
-  kernel::diag::hook<kernel::diag::post_service>();
+  kernel::diag::hook<kernel::diag::post_service>("Service::start");
 }
 
 void os::add_stdout(os::print_func func)
@@ -206,9 +210,18 @@ void os::print(const char* str, const size_t len)
     static bool apply_ts = true;
     if (apply_ts)
     {
-      std::string ts = "[" + isotime::now() + "] ";
+      // the prefix only changes once per second, so format it only then
+      static time_t ts_time = -1;
+      static char   ts_buf[48];
+      static int    ts_len = 0;
+      const time_t now = time(0);
+      if (now != ts_time) {
+        ts_time = now;
+        ts_len = snprintf(ts_buf, sizeof(ts_buf), "[%s] ",
+                          isotime::to_datetime_string(now).c_str());
+      }
       for (const auto& callback : os_print_handlers) {
-        callback(ts.c_str(), ts.size());
+        callback(ts_buf, ts_len);
       }
       apply_ts = false;
     }
@@ -20,18 +20,23 @@
 #include <kernel.hpp>
 #include <kernel/cpuid.hpp>
 #include <kernel/elf.hpp>
+#include <kernel/timers.hpp>
 #include <os.hpp>
+#include <smp>
 #include <util/fixed_vector.hpp>
 #include <util/pretty.hpp>
 #include <unordered_map>
+#include <atomic>
 #include <cassert>
 #include <algorithm>
 
 #define BUFFER_COUNT    1024
+#define STACK_DEPTH     32
+#define STACK_RING      256
 
 extern "C" {
   void parasite_interrupt_handler();
-  void profiler_stack_sampler(void*);
+  void profiler_stack_sampler(void*, void*);
   static void gather_stack_sampling();
 }
 extern char _irq_cb_return_location;
@@ -89,18 +94,189 @@ static Sampler& get() {
   return sampler;
 }
 
+struct Stack_trace
+{
+  uint32_t  depth;
+  uintptr_t frames[STACK_DEPTH]; // interrupted address, then return addresses
+};
+
+struct Stack_hash
+{
+  size_t operator() (const std::vector<uintptr_t>& stack) const noexcept
+  {
+    size_t hash = stack.size();
+    for (auto addr : stack)
+      hash ^= addr + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    return hash;
+  }
+};
+
+// continuous sampling state of one CPU
+struct alignas(SMP_ALIGN) Cpu_sampler
+{
+  // written from the timer interrupt, read from the event loop
+  Stack_trace* ring = nullptr;
+  std::atomic<uint32_t> head {0};
+  std::atomic<uint32_t> tail {0};
+  uint64_t total   = 0;
+  uint64_t asleep  = 0;
+  uint64_t dropped = 0;
+  // sampled call stacks (function addresses, leaf first)
+  std::unordered_map<std::vector<uintptr_t>, func_sample, Stack_hash> stacks;
+  // held while the stacks are aggregated or read
+  Spinlock lock;
+};
+static SMP::Array<Cpu_sampler> cpu_samplers;
+static std::chrono::milliseconds sampling_period;
+static bool discard_stacks = false;
+
+// follow the frame pointer chain from the interrupted frame
+static uint32_t walk_stack(uintptr_t* frames, void* ip, void* fp)
+{
+  uint32_t depth = 0;
+  frames[depth++] = (uintptr_t) ip;
+
+  auto* frame = (const uintptr_t*) fp;
+  while (depth < STACK_DEPTH)
+  {
+    // frames must be aligned, and move up the stack a little at a time
+    if ((uintptr_t) frame < 0x1000 or ((uintptr_t) frame & (sizeof(uintptr_t)-1)))
+        break;
+    const uintptr_t ra = frame[1];
+    if (ra < 0x1000) break;
+    frames[depth++] = ra;
+
+    auto* next = (const uintptr_t*) frame[0];
+    if (next <= frame or (uintptr_t) next - (uintptr_t) frame > 0x100000)
+        break;
+    frame = next;
+  }
+  return depth;
+}
+
+static void sample_stack(Cpu_sampler& cpu, void* ip, void* fp)
+{
+  cpu.total++;
+  if (ip == &_irq_cb_return_location) {
+    cpu.asleep++;
+    return;
+  }
+  if (UNLIKELY(discard_stacks)) return;
+
+  const uint32_t head = cpu.head.load(std::memory_order_relaxed);
+  if (UNLIKELY(head - cpu.tail.load(std::memory_order_acquire) >= STACK_RING)) {
+    cpu.dropped++;
+    return;
+  }
+  auto& trace = cpu.ring[head % STACK_RING];
+  trace.depth = walk_stack(trace.frames, ip, fp);
+  cpu.head.store(head + 1, std::memory_order_release);
+}
+
+static void gather_cpu_samples(Timers::id_t)
+{
+  auto& cpu = PER_CPU(cpu_samplers);
+  std::lock_guard<Spinlock> guard(cpu.lock);
+
+  std::vector<uintptr_t> stack;
+  uint32_t tail = cpu.tail.load(std::memory_order_relaxed);
+  const uint32_t head = cpu.head.load(std::memory_order_acquire);
+  for (; tail != head; tail++)
+  {
+    const auto& trace = cpu.ring[tail % STACK_RING];
+    stack.clear();
+    for (uint32_t i = 0; i < trace.depth; i++) {
+      // a return address can be past the end of a noreturn caller
+      const uintptr_t addr = (i == 0) ? trace.frames[i] : trace.frames[i] - 1;
+      stack.push_back(Elf::resolve_addr(addr));
+    }
+    cpu.stacks[stack]++;
+  }
+  cpu.tail.store(tail, std::memory_order_release);
+}
+
+// platforms without a timer interrupt of their own use the legacy timer
+__attribute__((weak))
+uint8_t __arch_timer_irq() noexcept
+{
+  return 0;
+}
+
+static void start_cpu_sampling()
+{
+  auto& cpu = PER_CPU(cpu_samplers);
+  if (cpu.ring != nullptr) return;
+  cpu.ring = new Stack_trace[STACK_RING];
+  // samples are taken whenever the timer interrupt fires, so keep
+  // it firing, and gather the samples on every period
+  Timers::periodic(sampling_period, gather_cpu_samples);
+  __arch_install_irq(__arch_timer_irq(), parasite_interrupt_handler);
+}
+
 void StackSampler::begin()
 {
+  Elf::build_symbol_index();
   // start taking samples using PIT interrupts
   get().begin();
 }
+
+void StackSampler::begin_continuous(std::chrono::milliseconds period)
+{
+  sampling_period = period;
+  Elf::build_symbol_index();
+  start_cpu_sampling();
+  for (int cpu : SMP::active_cpus())
+  {
+    if (cpu != SMP::cpu_id())
+        SMP::add_task(start_cpu_sampling, cpu);
+  }
+  if (SMP::cpu_count() > 1) SMP::signal();
+}
+
+void StackSampler::write_folded(output_func output)
+{
+  char symbol[1024];
+  std::string line;
+  for (auto& cpu : cpu_samplers)
+  {
+    if (cpu.ring == nullptr) continue;
+    std::lock_guard<Spinlock> guard(cpu.lock);
+    for (const auto& entry : cpu.stacks)
+    {
+      line.clear();
+      // root first
+      const auto& stack = entry.first;
+      for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+      {
+        if (it != stack.rbegin()) line += ';';
+        line += Elf::safe_resolve_symbol((void*) *it, symbol, sizeof(symbol)).name;
+      }
+      line += ' ';
+      line += std::to_string(entry.second);
+      line += '\n';
+      output(line.data(), line.size());
+    }
+  }
+}
+
+uint64_t StackSampler::samples_dropped() noexcept
+{
+  uint64_t dropped = 0;
+  for (auto& cpu : cpu_samplers) dropped += cpu.dropped;
+  return dropped;
+}
 void StackSampler::set_mode(mode_t md)
 {
   get().mode = md;
 }
 
-void profiler_stack_sampler(void* sample)
+void profiler_stack_sampler(void* sample, void* frame)
 {
+  auto& cpu = PER_CPU(cpu_samplers);
+  if (cpu.ring != nullptr) {
+    sample_stack(cpu, sample, frame);
+    return;
+  }
   auto& system = get();
   if (UNLIKELY(sample == nullptr)) return;
   // gather sample statistics
@@ -143,16 +319,29 @@ void gather_stack_sampling()
 }
 
 uint64_t StackSampler::samples_total() noexcept {
-  return get().total;
+  uint64_t total = get().total;
+  for (auto& cpu : cpu_samplers) total += cpu.total;
+  return total;
 }
 uint64_t StackSampler::samples_asleep() noexcept {
-  return get().asleep;
+  uint64_t asleep = get().asleep;
+  for (auto& cpu : cpu_samplers) asleep += cpu.asleep;
+  return asleep;
 }
 
 std::vector<Sample> StackSampler::results(int N)
 {
   using sample_pair = std::pair<uintptr_t, func_sample>;
-  std::vector<sample_pair> vec(get().dict.begin(), get().dict.end());
+  auto dict = get().dict;
+  // include the leaf functions of the continuously sampled stacks
+  for (auto& cpu : cpu_samplers)
+  {
+    if (cpu.ring == nullptr) continue;
+    std::lock_guard<Spinlock> guard(cpu.lock);
+    for (const auto& entry : cpu.stacks)
+        dict[entry.first.front()] += entry.second;
+  }
+  std::vector<sample_pair> vec(dict.begin(), dict.end());
 
   // sort by count
   std::sort(vec.begin(), vec.end(),
@@ -202,6 +391,7 @@ void StackSampler::print(const int N)
 void StackSampler::set_mask(bool mask)
 {
   get().discard = mask;
+  discard_stacks = mask;
 }
 
 std::string HeapDiag::to_string() {
@@ -1,6 +1,7 @@
 #include <kernel/timers.hpp>
 
 #include <os.hpp>
+#include <kernel/boot_trace.hpp>
 #include <kernel/events.hpp>
 #include <kernel/rtc.hpp>
 #include <service>
@@ -134,6 +135,8 @@ void Timers::ready()
   }
   if (SMP::cpu_id() == 0)
   {
+    // includes waiting for the timer calibration
+    kernel::boot_trace::mark("timers");
     // call Service::ready(), because timer system is ready!
     Service::ready();
   }
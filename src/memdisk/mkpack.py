@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+
+# Build a read-only packed image of a folder, see api/fs/pack.hpp
+#
+# Every file becomes /<path relative to the folder>. A file "x.gz" or "x.br"
+# next to "x" is stored as a pre-compressed variant of "x" rather than as a
+# file of its own. With --gzip (or --brotli, when the brotli module is
+# installed) missing variants are generated when they are smaller.
+
+from __future__ import print_function
+import argparse
+import gzip
+import os
+import struct
+import sys
+
+MAGIC   = 0x314b434150534f49  # "IOSPACK1"
+VERSION = 1
+ALIGN   = 4096
+HEADER  = struct.Struct("<QIIIIQQQQQ")
+ENTRY   = struct.Struct("<QII" + "QQ" * 3)
+IDENTITY, GZIP, BROTLI = range(3)
+SUFFIXES = {".gz": GZIP, ".br": BROTLI}
+
+def fnv1a(data):
+  h = 0xcbf29ce484222325
+  for b in bytearray(data):
+    h ^= b
+    h = (h * 0x100000001b3) & 0xffffffffffffffff
+  return h
+
+def align(n, a):
+  return (n + a - 1) & ~(a - 1)
+
+def collect(folder):
+  files = {}
+  for root, dirs, names in os.walk(folder):
+    dirs.sort()
+    for name in sorted(names):
+      full = os.path.join(root, name)
+      path = "/" + os.path.relpath(full, folder).replace(os.sep, "/")
+      files[path] = full
+  # attach pre-compressed variants to their originals
+  packed = {}
+  for path in sorted(files):
+    base, ext = os.path.splitext(path)
+    if ext in SUFFIXES and base in files:
+      continue
+    variants = [open(files[path], "rb").read(), b"", b""]
+    for suffix, enc in SUFFIXES.items():
+      if path + suffix in files:
+        variants[enc] = open(files[path + suffix], "rb").read()
+    packed[path] = variants
+  return packed
+
+def compress(packed, use_gzip, use_brotli):
+  brotli = None
+  if use_brotli:
+    try:
+      import brotli
+    except ImportError:
+      print("mkpack: brotli module not found, skipping brotli variants", file=sys.stderr)
+  for variants in packed.values():
+    data = variants[IDENTITY]
+    if use_gzip and not variants[GZIP]:
+      z = gzip.compress(data, 9, mtime=0) if sys.version_info >= (3, 8) else gzip.compress(data, 9)
+      if len(z) < len(data):
+        variants[GZIP] = z
+    if brotli and not variants[BROTLI]:
+      z = brotli.compress(data)
+      if len(z) < len(data):
+        variants[BROTLI] = z
+
+def build(packed):
+  paths = sorted(packed)
+  count = len(paths)
+  buckets = 1
+  # at most 50% load, and always an empty bucket
+  while buckets < count * 2 or buckets <= count:
+    buckets *= 2
+  if count == 0:
+    buckets = 0
+
+  buckets_offset = HEADER.size
+  entries_offset = align(buckets_offset + buckets * 4, 64)
+  paths_offset   = entries_offset + count * ENTRY.size
+  path_bytes = b""
+  path_offsets = []
+  for path in paths:
+    path_offsets.append(paths_offset + len(path_bytes))
+    path_bytes += path.encode("utf-8")
+
+  # contents, each on its own page
+  offset = align(paths_offset + len(path_bytes), ALIGN)
+  contents = []
+  locations = []
+  for path in paths:
+    loc = []
+    for data in packed[path]:
+      if data:
+        loc.append((offset, len(data)))
+        contents.append((offset, data))
+        offset = align(offset + len(data), ALIGN)
+      else:
+        loc.append((0, 0))
+    locations.append(loc)
+  size = offset
+
+  index = [0] * buckets
+  hashes = []
+  for i, path in enumerate(paths):
+    h = fnv1a(path.encode("utf-8"))
+    hashes.append(h)
+    b = h & (buckets - 1)
+    while index[b] != 0:
+      b = (b + 1) & (buckets - 1)
+    index[b] = i + 1
+
+  image = bytearray(size)
+  HEADER.pack_into(image, 0, MAGIC, VERSION, count, buckets, 0,
+                   buckets_offset, entries_offset, paths_offset, size, 0)
+  struct.pack_into("<%dI" % buckets, image, buckets_offset, *index)
+  for i, path in enumerate(paths):
+    fields = [hashes[i], path_offsets[i], len(path.encode("utf-8"))]
+    for off, length in locations[i]:
+      fields += [off, length]
+    ENTRY.pack_into(image, entries_offset + i * ENTRY.size, *fields)
+  image[paths_offset:paths_offset + len(path_bytes)] = path_bytes
+  for off, data in contents:
+    image[off:off + len(data)] = data
+  return bytes(image)
+
+def main():
+  parser = argparse.ArgumentParser(description='Create a packed read-only image')
+  parser.add_argument('folder', metavar='FOLDER', help='a folder with files')
+  parser.add_argument('-o', '--output', default="image.pack", help='the output image')
+  parser.add_argument('--gzip', action='store_true', help='add gzip variants')
+  parser.add_argument('--brotli', action='store_true', help='add brotli variants')
+  parser.add_argument('--asm', default=None, help='also write an assembly file including the image')
+  args = parser.parse_args()
+
+  packed = collect(args.folder)
+  compress(packed, args.gzip, args.brotli)
+  image = build(packed)
+  with open(args.output, "wb") as f:
+    f.write(image)
+  print("Packed %d files into %s (%d bytes)" % (len(packed), args.output, len(image)))
+  if args.asm:
+    with open(args.asm, "w") as f:
+      # align within the section, where the image is placed
+      f.write("USE32\nsection .packdata\nALIGN 4096\n")
+      f.write('   incbin "' + os.path.abspath(args.output) + '"\n')
+
+if __name__ == "__main__":
+  main()
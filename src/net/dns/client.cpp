@@ -17,6 +17,8 @@
 
 #include <net/dns/client.hpp>
 #include <net/inet>
+#include <algorithm>
+#include <cctype>
 
 namespace net::dns
 {
@@ -27,17 +29,22 @@ namespace net::dns
   Timer::duration_t Client::DEFAULT_RESOLVE_TIMEOUT{std::chrono::seconds(5)};
 #endif
   Timer::duration_t Client::DEFAULT_FLUSH_INTERVAL{std::chrono::seconds(30)};
-  std::chrono::seconds Client::DEFAULT_CACHE_TTL{std::chrono::seconds(60)};
+  std::chrono::seconds Client::DEFAULT_CACHE_TTL{std::chrono::seconds(3600)};
+  std::chrono::seconds Client::DEFAULT_NEGATIVE_TTL{std::chrono::seconds(300)};
+  size_t Client::DEFAULT_CACHE_SIZE{1024};
 
   Client::Client(Stack& stack)
     : stack_{stack},
       cache_ttl_{DEFAULT_CACHE_TTL},
+      negative_ttl_{DEFAULT_NEGATIVE_TTL},
+      cache_size_{DEFAULT_CACHE_SIZE},
       flush_timer_{{this, &Client::flush_expired}}
   {
   }
 
   void Client::resolve(Address dns_server,
                        Hostname hostname,
+                       Record_type rtype,
                        Resolve_handler func,
                        Timer::duration_t timeout, bool force)
   {
@@ -46,52 +53,109 @@ namespace net::dns
     {
       hostname.append(".").append(stack_.domain_name());
     }
+    // names are case insensitive
+    std::transform(hostname.begin(), hostname.end(), hostname.begin(),
+      [](unsigned char c) { return std::tolower(c); });
+
+    Cache_key key{std::move(hostname), rtype};
+
     if(not force)
     {
-      auto it = cache_.find(hostname);
+      auto it = cache_.find(key);
       if(it != cache_.end())
       {
-        Error err;
-        func(nullptr, err); // fix
-        return;
+        auto& entry = it->second;
+        const auto now = timestamp();
+        if(entry.expires > now)
+        {
+          cache_hits_++;
+          lru_.splice(lru_.begin(), lru_, entry.lru);
+          // refresh popular entries before they expire
+          // so they never miss
+          if((entry.expires - now) * 10 < entry.ttl
+            and inflight_.find(key) == inflight_.end())
+          {
+            query(key, entry.server, nullptr, DEFAULT_RESOLVE_TIMEOUT);
+          }
+          func(cached_response(entry, now), {});
+          return;
+        }
       }
     }
+    cache_misses_++;
+    query(std::move(key), dns_server, std::move(func), timeout);
+  }
+
+  void Client::query(Cache_key key, Address dns_server,
+                     Resolve_handler func, Timer::duration_t timeout)
+  {
+    // the name is already being resolved, wait for the answer
+    auto pending = inflight_.find(key);
+    if(pending != inflight_.end())
+    {
+      auto req = requests_.find(pending->second);
+      Expects(req != requests_.end());
+      if(func)
+      {
+        req->second.callbacks.push_back(std::move(func));
+        coalesced_++;
+      }
+      return;
+    }
+
     // Make sure we actually can bind to a socket
     auto& socket = (dns_server.is_v6()) ? stack_.udp().bind6() : stack_.udp().bind();
 
     // Create our query
-    Query query{std::move(hostname), (dns_server.is_v6() ? Record_type::AAAA : Record_type::A)};
+    Query query{key.name, key.rtype};
 #ifdef LIBFUZZER_ENABLED
     g_last_xid = query.id;
 #endif
+    const auto id = query.id;
 
     // store the request for later match
     auto emp = requests_.emplace(std::piecewise_construct,
-      std::forward_as_tuple(query.id),
+      std::forward_as_tuple(id),
       std::forward_as_tuple(*this, socket, std::move(query), std::move(func)));
 
     Ensures(emp.second && "Unable to insert");
+    inflight_.emplace(std::move(key), id);
+
     auto& req = emp.first->second;
     req.resolve(dns_server, timeout);
   }
 
+  Response_ptr Client::cached_response(const Cache_entry& entry, timestamp_t now) const
+  {
+    auto res = std::make_unique<Response>();
+    res->rcode   = entry.rcode;
+    res->answers = entry.answers;
+    // tell the remaining time to live
+    const auto left = static_cast<uint32_t>(entry.expires - now);
+    for(auto& rec : res->answers)
+      rec.ttl = std::min(rec.ttl, left);
+    return res;
+  }
+
   Client::Request::Request(Client& cli, udp::Socket& sock,
                               dns::Query q, Resolve_handler cb)
     : client{cli},
       query{std::move(q)},
       response{nullptr},
       socket{sock},
-      callback{std::move(cb)},
       timer({this, &Request::timeout})
   {
+    if(cb)
+      callbacks.push_back(std::move(cb));
     socket.on_read({this, &Client::Request::parse_response});
   }
 
-  void Client::Request::resolve(net::Addr server, Timer::duration_t timeout)
+  void Client::Request::resolve(net::Addr dns_server, Timer::duration_t timeout)
   {
     std::array<char, 256> buf;
     size_t len = query.write(buf.data());
 
+    this->server = dns_server;
     socket.sendto(server, dns::SERVICE_PORT, buf.data(), len, nullptr,
       {this, &Client::Request::handle_error});
 
@@ -109,17 +173,11 @@ namespace net::dns
     if(query.id == ntohs(reply.id))
     {
       auto res = std::make_unique<dns::Response>();
-      // TODO: Validate
-      res->parse(data, len);
+      if(UNLIKELY(res->parse(data, len) < 0))
+        return;
 
       this->response = std::move(res);
 
-      // TODO: Cache
-      /*if(client.cache_ttl_ > std::chrono::seconds::zero())
-      {
-        add_cache_entry(...);
-      }*/
-
       finish({});
     }
     else
@@ -131,7 +189,25 @@ namespace net::dns
 
   void Client::Request::finish(const Error& err)
   {
-    callback(std::move(response), err);
+    timer.stop();
+
+    const Cache_key key{query.hostname, query.rtype};
+    if(not err and response != nullptr)
+      client.add_cache_entry(key, server, *response);
+
+    auto pending = client.inflight_.find(key);
+    if(pending != client.inflight_.end() and pending->second == query.id)
+      client.inflight_.erase(pending);
+
+    // everyone waiting gets their own copy, the last one the original
+    auto cbs = std::move(callbacks);
+    for(size_t i = 0; i < cbs.size(); i++)
+    {
+      if(i + 1 < cbs.size())
+        cbs[i](response ? std::make_unique<dns::Response>(*response) : nullptr, err);
+      else
+        cbs[i](std::move(response), err);
+    }
 
     auto erased = client.requests_.erase(query.id);
     Ensures(erased == 1);
@@ -156,25 +232,84 @@ namespace net::dns
   void Client::flush_cache()
   {
     cache_.clear();
+    lru_.clear();
 
     flush_timer_.stop();
   }
 
-  void Client::add_cache_entry(const Hostname& hostname, Address addr, std::chrono::seconds ttl)
+  void Client::add_cache_entry(const Cache_key& key, Address server, const Response& res)
   {
-    // cache the address
-    cache_.emplace(std::piecewise_construct,
-      std::forward_as_tuple(hostname),
-      std::forward_as_tuple(addr, timestamp() + ttl.count()));
+    if(cache_ttl_ == std::chrono::seconds::zero() or cache_size_ == 0)
+      return;
 
-    debug("<DNSClient> Cache entry added: [%s] %s (%lld)\n",
-      hostname.c_str(), addr.to_string().c_str(), ttl.count());
+    uint32_t ttl = cache_ttl_.count();
+    std::vector<Record> answers;
+    Address addr;
+
+    // no such name, or no records of the type (RFC 2308)
+    if(res.rcode == Response_code::NAME_ERROR or
+      (res.rcode == Response_code::NO_ERROR and res.answers.empty()))
+    {
+      ttl = std::min<uint32_t>({ttl, res.negative_ttl(),
+                                static_cast<uint32_t>(negative_ttl_.count())});
+    }
+    else if(res.rcode == Response_code::NO_ERROR and res.has_answer(key.rtype))
+    {
+      // the answer lives as long as the shortest record, CNAMEs included
+      for(auto& rec : res.answers)
+        ttl = std::min(ttl, rec.ttl);
+      answers = res.answers;
+      addr = res.get_first_addr();
+    }
+    else
+    {
+      // server failures etc. are not cached, and neither is a CNAME
+      // the server didn't follow: the name exists, but the answer
+      // is only known to the server of the alias target
+      return;
+    }
+
+    if(ttl == 0)
+      return;
+
+    const auto expires = timestamp() + ttl;
+    auto it = cache_.find(key);
+    if(it != cache_.end())
+    {
+      auto& entry = it->second;
+      entry.address = addr;
+      entry.expires = expires;
+      entry.ttl     = ttl;
+      entry.rcode   = res.rcode;
+      entry.answers = std::move(answers);
+      entry.server  = server;
+      lru_.splice(lru_.begin(), lru_, entry.lru);
+    }
+    else
+    {
+      lru_.push_front(key);
+      cache_.emplace(key, Cache_entry{addr, expires, ttl, res.rcode,
+                                      std::move(answers), server, lru_.begin()});
+
+      // evict the least recently used
+      while(cache_.size() > cache_size_)
+        erase(cache_.find(lru_.back()));
+    }
+
+    debug("<DNSClient> Cache entry added: [%s] %s (%u)\n",
+      key.name.c_str(), addr.to_string().c_str(), ttl);
 
     // start the timer if not already active
     if(not flush_timer_.is_running())
       flush_timer_.start(DEFAULT_FLUSH_INTERVAL);
   }
 
+  void Client::erase(Cache::iterator it)
+  {
+    lru_.erase(it->second.lru);
+    cache_.erase(it);
+  }
+
   void Client::flush_expired()
   {
     const auto now = timestamp();
@@ -183,7 +318,10 @@ namespace net::dns
       if(it->second.expires > now)
         it++;
       else
+      {
+        lru_.erase(it->second.lru);
         it = cache_.erase(it);
+      }
     }
 
     if(not cache_.empty())
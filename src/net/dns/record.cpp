@@ -45,20 +45,32 @@ namespace net::dns {
     reader += sizeof(rr_data);
     count += sizeof(rr_data);
 
+    if (reader + data_len > buffer + len)
+      throw std::runtime_error("Resource data out of bounds");
+
     switch(this->rtype)
     {
       case Record_type::A:    // IPv4
       case Record_type::AAAA: // IPv6
       {
         this->rdata.assign(reader, this->data_len);
-        count += data_len;
+        break;
+      }
+      case Record_type::SOA:
+      {
+        // mname, rname, then serial, refresh, retry, expire and minimum
+        if (data_len >= 5 * sizeof(uint32_t))
+          this->soa_minimum = ntohl(*(const uint32_t*) (reader + data_len - sizeof(uint32_t)));
+        parse_name(reader, buffer, len, this->rdata);
         break;
       }
       default:
       {
-        count += parse_name(reader, buffer, len, this->rdata);
+        parse_name(reader, buffer, len, this->rdata);
       }
     }
+    // the record always ends after its data, whatever was decoded
+    count += data_len;
 
     return count;
   }
@@ -79,6 +91,7 @@ namespace net::dns {
 
     unsigned namelen = 0;
     bool jumped = false;
+    int  jumps  = 0;
 
     int count = 1;
     const auto* ureader = (unsigned char*) reader;
@@ -88,10 +101,10 @@ namespace net::dns {
       if (*ureader >= 192)
       {
         // read 16-bit offset, mask out the 2 top bits
-        uint16_t offset = (*ureader >> 8) | *(ureader+1);
+        uint16_t offset = (*ureader << 8) | *(ureader+1);
         offset &= 0x3fff; // remove 2 top bits
 
-        if(UNLIKELY(offset > tot_len))
+        if(UNLIKELY(offset >= tot_len or ++jumps > 16))
           return 0;
 
         ureader = (unsigned char*) &buffer[offset];
@@ -99,10 +112,11 @@ namespace net::dns {
       }
       else
       {
-        output[namelen++] = *ureader++;
+        output.push_back(*ureader++);
+        namelen++;
 
-        // maximum label size
-        if(UNLIKELY(namelen > 63)) break;
+        // maximum name size
+        if(UNLIKELY(namelen > 255 or (const char*) ureader >= buffer + tot_len)) break;
       }
 
       // if we havent jumped to another location then we can count up
@@ -121,7 +135,7 @@ namespace net::dns {
     {
       const uint8_t len = output[i];
 
-      for(unsigned j = 0; j < len; j++)
+      for(unsigned j = 0; j < len and i + 1 < output.size(); j++)
       {
         output[i] = output[i+1];
         i++;
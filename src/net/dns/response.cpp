@@ -58,19 +58,40 @@ namespace net::dns {
     return false;
   }
 
+  bool Response::has_answer(Record_type rtype) const
+  {
+    for(auto& rec : answers)
+    {
+      if(rec.rtype == rtype)
+        return true;
+    }
+    return false;
+  }
+
+  uint32_t Response::negative_ttl() const
+  {
+    for(auto& rec : auth)
+    {
+      if(rec.rtype == Record_type::SOA)
+        return std::min(rec.ttl, rec.soa_minimum);
+    }
+    return 0;
+  }
+
   // TODO: Verify
   int Response::parse(const char* buffer, size_t len)
   {
     Expects(len >= sizeof(Header));
 
     const auto& hdr = *(const Header*) buffer;
+    this->rcode = static_cast<Response_code>(hdr.rcode);
 
     // move ahead of the dns header and the query field
     const char* reader = (char*)buffer + sizeof(Header);
     // Iterate past the question string we sent ...
-    while (*reader) reader++;
+    while (reader < buffer + len and *reader) reader++;
     // .. and past the question data
-    reader += sizeof(Question);
+    reader += 1 + sizeof(Question);
 
     if(UNLIKELY(reader > (buffer + len)))
       return -1;
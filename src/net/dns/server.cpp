@@ -0,0 +1,230 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/dns/server.hpp>
+#include <net/inet>
+#include <kernel/rng.hpp>
+#include <cstring>
+
+namespace net::dns {
+
+  Timer::duration_t Server::FORWARD_TIMEOUT{std::chrono::seconds(5)};
+
+  Server::Server(Stack& stack, port_t port)
+    : stack_{stack},
+      port_{port},
+      forward_timer_{{this, &Server::expire_forwarded}}
+  {
+  }
+
+  Server::~Server()
+  {
+    if(socket_)
+      socket_->close();
+    if(upstream_)
+      upstream_->close();
+    if(listener_)
+      listener_->close();
+  }
+
+  void Server::listen()
+  {
+    Expects(socket_ == nullptr && "Already listening");
+    socket_ = &stack_.udp().bind(port_);
+    socket_->on_read_batch({this, &Server::receive});
+    listener_ = &stack_.tcp().listen(port_, {this, &Server::on_connect});
+  }
+
+  void Server::set_forwarder(net::Addr server, port_t port)
+  {
+    if(upstream_ == nullptr)
+    {
+      upstream_ = server.is_v6() ? &stack_.udp().bind6() : &stack_.udp().bind();
+      upstream_->on_read({this, &Server::receive_upstream});
+    }
+    forwarder_      = server;
+    forwarder_port_ = port;
+  }
+
+  void Server::receive(const udp::Datagram* datagrams, size_t count)
+  {
+    const size_t max = std::min(socket_->payload_capacity(), Zone_table::MAX_UDP_SIZE);
+    for(size_t i = 0; i < count; i++)
+    {
+      const auto& dgram = datagrams[i];
+      if(UNLIKELY(not Zone_table::is_query(dgram.data, dgram.length)))
+        continue;
+
+      // answer directly in the outgoing packet
+      auto pkt = socket_->create_datagram(dgram.addr, dgram.port);
+      if(UNLIKELY(pkt == nullptr)) {
+        queries_++;
+        dropped_++;
+        continue;
+      }
+      const auto len = respond(dgram.data, dgram.length, pkt->udp_data(), max,
+                               dgram.addr, dgram.port, {});
+      if(len == 0)
+        continue;
+      pkt->set_data_length(len);
+      socket_->send(std::move(pkt));
+    }
+  }
+
+  size_t Server::respond(const uint8_t* query, size_t len, uint8_t* out, size_t max,
+                         net::Addr client, port_t port, std::weak_ptr<tcp::Connection> conn)
+  {
+    queries_++;
+    const auto* table = table_.get();
+    const auto res = (table != nullptr) ? table->respond(query, len, out, max) : 0;
+    if(LIKELY(res > 0))
+      return res;
+
+    if(forwarder_port_ != 0)
+    {
+      if(forward(query, len, client, port, std::move(conn)))
+        return 0;
+      return Zone_table::error_response(query, len, Response_code::SERVER_FAIL, out, max);
+    }
+    refused_++;
+    return Zone_table::error_response(query, len, Response_code::OP_REFUSED, out, max);
+  }
+
+  bool Server::forward(const uint8_t* query, size_t len, net::Addr client, port_t port,
+                       std::weak_ptr<tcp::Connection> conn)
+  {
+    if(UNLIKELY(pending_.size() >= MAX_FORWARDED))
+    {
+      dropped_++;
+      return false;
+    }
+    // a random ID, to make spoofed answers harder (RFC 5452)
+    id_t id;
+    do {
+      id = rng_extract_uint32();
+    } while(pending_.find(id) != pending_.end());
+
+    const id_t client_id = (query[0] << 8) | query[1];
+    const bool tcp = not conn.expired();
+    pending_.emplace(id, Forwarded{client, port, client_id, std::move(conn), tcp,
+                                   RTC::time_since_boot()});
+
+    std::vector<uint8_t> msg(query, query + len);
+    msg[0] = id >> 8;
+    msg[1] = id & 0xFF;
+    upstream_->sendto(forwarder_, forwarder_port_, msg.data(), msg.size());
+    forwarded_++;
+
+    if(not forward_timer_.is_running())
+      forward_timer_.start(FORWARD_TIMEOUT);
+    return true;
+  }
+
+  void Server::receive_upstream(net::Addr addr, port_t port, const char* data, size_t len)
+  {
+    if(UNLIKELY(len < sizeof(Header) or addr != forwarder_ or port != forwarder_port_))
+      return;
+
+    const id_t id = ((uint8_t) data[0] << 8) | (uint8_t) data[1];
+    auto it = pending_.find(id);
+    if(it == pending_.end())
+      return;
+    const auto fwd = std::move(it->second);
+    pending_.erase(it);
+
+    std::vector<uint8_t> msg(data, data + len);
+    msg[0] = fwd.id >> 8;
+    msg[1] = fwd.id & 0xFF;
+
+    if(not fwd.tcp)
+    {
+      socket_->sendto(fwd.client, fwd.port, msg.data(), msg.size());
+    }
+    else if(auto conn = fwd.conn.lock())
+    {
+      if(conn->is_writable())
+        write_tcp(*conn, msg.data(), msg.size());
+    }
+  }
+
+  void Server::expire_forwarded()
+  {
+    const auto timeout = static_cast<RTC::timestamp_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(FORWARD_TIMEOUT).count());
+    const auto now = RTC::time_since_boot();
+    for(auto it = pending_.begin(); it != pending_.end();)
+    {
+      // the client will retry
+      if(now - it->second.sent >= timeout)
+        it = pending_.erase(it);
+      else
+        it++;
+    }
+    if(not pending_.empty())
+      forward_timer_.start(FORWARD_TIMEOUT);
+  }
+
+  void Server::on_connect(tcp::Connection_ptr conn)
+  {
+    // messages are prefixed by their length (RFC 1035 4.2.2),
+    // and may span several reads
+    auto msgs = std::make_shared<std::vector<uint8_t>>();
+    std::weak_ptr<tcp::Connection> weak = conn;
+    conn->on_read(MAX_TCP_MESSAGE,
+    [this, weak, msgs] (tcp::buffer_t buf)
+    {
+      receive_tcp(weak, *msgs, buf->data(), buf->size());
+    });
+  }
+
+  void Server::receive_tcp(std::weak_ptr<tcp::Connection> weak, std::vector<uint8_t>& msgs,
+                           const uint8_t* data, size_t len)
+  {
+    auto conn = weak.lock();
+    if(conn == nullptr)
+      return;
+    msgs.insert(msgs.end(), data, data + len);
+
+    tcp_buf_.resize(MAX_TCP_MESSAGE);
+    size_t pos = 0;
+    while(msgs.size() - pos >= 2)
+    {
+      const size_t msglen = (msgs[pos] << 8) | msgs[pos + 1];
+      if(msgs.size() - pos - 2 < msglen)
+        break;
+      const auto* query = msgs.data() + pos + 2;
+      pos += 2 + msglen;
+      if(not Zone_table::is_query(query, msglen))
+        continue;
+
+      const auto res = respond(query, msglen, tcp_buf_.data(), tcp_buf_.size(),
+                               conn->remote().address(), conn->remote().port(), weak);
+      if(res > 0)
+        write_tcp(*conn, tcp_buf_.data(), res);
+    }
+    msgs.erase(msgs.begin(), msgs.begin() + pos);
+  }
+
+  void Server::write_tcp(tcp::Connection& conn, const uint8_t* msg, size_t len)
+  {
+    auto buf = tcp::construct_buffer(2 + len);
+    (*buf)[0] = len >> 8;
+    (*buf)[1] = len & 0xFF;
+    std::memcpy(buf->data() + 2, msg, len);
+    conn.write(std::move(buf));
+  }
+
+}
@@ -0,0 +1,563 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/dns/zone.hpp>
+#include <likely>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace net::dns {
+
+  static constexpr uint16_t TYPE_ANY = 255;
+  static constexpr uint8_t  FLAGS_RESPONSE = 0x84; // QR | AA
+  static constexpr uint8_t  FLAG_TC = 0x02;
+  static constexpr uint8_t  FLAG_RD = 0x01;
+
+  static void put16(std::string& out, uint16_t val)
+  {
+    out.push_back(val >> 8);
+    out.push_back(val & 0xFF);
+  }
+
+  static void put32(std::string& out, uint32_t val)
+  {
+    put16(out, val >> 16);
+    put16(out, val & 0xFFFF);
+  }
+
+  static inline void write16(uint8_t* out, uint16_t val) noexcept
+  {
+    out[0] = val >> 8;
+    out[1] = val & 0xFF;
+  }
+
+  static inline uint16_t read16(const uint8_t* in) noexcept
+  { return (in[0] << 8) | in[1]; }
+
+  static std::string lowercase(std::string name)
+  {
+    std::transform(name.begin(), name.end(), name.begin(),
+      [](unsigned char c) { return (c >= 'A' and c <= 'Z') ? c + 32 : c; });
+    return name;
+  }
+
+  // convert www.example.com to 3www7example3com0
+  static std::string to_wire(const std::string& name)
+  {
+    std::string wire;
+    size_t start = 0;
+    while(start < name.size())
+    {
+      auto end = name.find('.', start);
+      if(end == std::string::npos)
+        end = name.size();
+      const auto len = end - start;
+      if(len == 0 or len > 63)
+        throw Zone_error{"Invalid label in name: " + name};
+      wire.push_back(len);
+      wire.append(name, start, len);
+      start = end + 1;
+    }
+    wire.push_back('\0');
+    if(wire.size() > 255)
+      throw Zone_error{"Name too long: " + name};
+    return wire;
+  }
+
+  // write a name, pointing into the question name where possible
+  static void write_name(std::string& out, const std::string& wire, const std::string& qname)
+  {
+    for(size_t p = 0; wire[p] != 0; p += 1 + wire[p])
+    {
+      const size_t suffix = wire.size() - p;
+      if(suffix > qname.size())
+        continue;
+      // the suffix must start at a label in the question name
+      size_t q = 0;
+      while(q < qname.size() - suffix)
+        q += 1 + qname[q];
+      if(q == qname.size() - suffix and qname.compare(q, suffix, wire, p, suffix) == 0)
+      {
+        out.append(wire, 0, p);
+        put16(out, 0xC000 | (sizeof(Header) + q));
+        return;
+      }
+    }
+    out.append(wire);
+  }
+
+  Zone::Zone(std::string origin, uint32_t ttl)
+    : origin_{lowercase(std::move(origin))}, ttl_{ttl}
+  {
+    if(not origin_.empty() and origin_.back() == '.')
+      origin_.pop_back();
+  }
+
+  std::string Zone::absolute(const std::string& name) const
+  {
+    if(name.empty() or name == "@")
+      return origin_;
+    if(name.back() == '.')
+      return lowercase(name.substr(0, name.size()-1));
+    if(origin_.empty())
+      return lowercase(name);
+    return lowercase(name + "." + origin_);
+  }
+
+  Zone::Entry& Zone::add_entry(const std::string& name, Record_type rtype, uint32_t ttl)
+  {
+    auto& entry = entries_.emplace_back();
+    entry.name  = absolute(name);
+    entry.rtype = rtype;
+    entry.ttl   = (ttl != 0) ? ttl : ttl_;
+    return entry;
+  }
+
+  Zone& Zone::soa(const std::string& mname, const std::string& rname,
+                  uint32_t serial, uint32_t refresh, uint32_t retry,
+                  uint32_t expire, uint32_t minimum)
+  {
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+      [](const auto& e) { return e.rtype == Record_type::SOA; }), entries_.end());
+
+    auto& entry = add_entry("@", Record_type::SOA, 0);
+    entry.names = {absolute(mname), absolute(rname)};
+    for(auto val : {serial, refresh, retry, expire, minimum})
+      put32(entry.suffix, val);
+    return *this;
+  }
+
+  const Zone::Entry* Zone::soa() const noexcept
+  {
+    for(auto& entry : entries_)
+      if(entry.rtype == Record_type::SOA)
+        return &entry;
+    return nullptr;
+  }
+
+  Zone& Zone::add(const std::string& name, ip4::Addr addr, uint32_t ttl)
+  {
+    add_entry(name, Record_type::A, ttl).prefix.assign((const char*) &addr, 4);
+    return *this;
+  }
+
+  Zone& Zone::add(const std::string& name, ip6::Addr addr, uint32_t ttl)
+  {
+    add_entry(name, Record_type::AAAA, ttl).prefix.assign((const char*) &addr, 16);
+    return *this;
+  }
+
+  Zone& Zone::add_ns(const std::string& name, const std::string& target, uint32_t ttl)
+  {
+    add_entry(name, Record_type::NS, ttl).names = {absolute(target)};
+    return *this;
+  }
+
+  Zone& Zone::add_cname(const std::string& name, const std::string& target, uint32_t ttl)
+  {
+    add_entry(name, Record_type::ALIAS, ttl).names = {absolute(target)};
+    return *this;
+  }
+
+  Zone& Zone::add_ptr(const std::string& name, const std::string& target, uint32_t ttl)
+  {
+    add_entry(name, Record_type::PTR, ttl).names = {absolute(target)};
+    return *this;
+  }
+
+  Zone& Zone::add_mx(const std::string& name, uint16_t preference,
+                     const std::string& exchange, uint32_t ttl)
+  {
+    auto& entry = add_entry(name, Record_type::MX, ttl);
+    put16(entry.prefix, preference);
+    entry.names = {absolute(exchange)};
+    return *this;
+  }
+
+  Zone& Zone::add_txt(const std::string& name, const std::string& text, uint32_t ttl)
+  {
+    auto& entry = add_entry(name, Record_type::TXT, ttl);
+    // split into character strings of at most 255 bytes
+    size_t pos = 0;
+    do {
+      const auto len = std::min<size_t>(255, text.size() - pos);
+      entry.prefix.push_back(len);
+      entry.prefix.append(text, pos, len);
+      pos += len;
+    } while(pos < text.size());
+    return *this;
+  }
+
+  struct Zone_table::Build_node
+  {
+    std::map<std::string, std::unique_ptr<Build_node>> children;
+    std::vector<const Zone::Entry*> entries;
+    std::string wire;
+    int zone = -1;
+
+    Build_node& insert(const std::string& name)
+    {
+      if(name.empty())
+        return *this;
+      const auto dot = name.rfind('.');
+      const auto label = (dot == std::string::npos) ? name : name.substr(dot + 1);
+      if(label.empty())
+        throw Zone_error{"Empty label in name: " + name};
+      auto& child = children[label];
+      if(child == nullptr)
+      {
+        child = std::make_unique<Build_node>();
+        child->wire = to_wire(label);
+        child->wire.pop_back();
+        child->wire.append(wire);
+        if(child->wire.size() > 255)
+          throw Zone_error{"Name too long: " + name};
+      }
+      return (dot == std::string::npos) ? *child : child->insert(name.substr(0, dot));
+    }
+  };
+
+  static bool in_zone(const std::string& name, const std::string& origin)
+  {
+    if(origin.empty() or name == origin)
+      return true;
+    return name.size() > origin.size()
+      and name.compare(name.size() - origin.size(), origin.size(), origin) == 0
+      and name[name.size() - origin.size() - 1] == '.';
+  }
+
+  Zone_table::Zone_table(const std::vector<Zone>& zones)
+  {
+    Build_node root;
+    root.wire = std::string(1, '\0');
+
+    for(size_t i = 0; i < zones.size(); i++)
+    {
+      const auto& zone = zones[i];
+      const auto* soa = zone.soa();
+      if(soa == nullptr)
+        throw Zone_error{"Zone has no SOA: " + zone.origin()};
+
+      auto& apex = root.insert(zone.origin());
+      if(apex.zone >= 0)
+        throw Zone_error{"Duplicate zone: " + zone.origin()};
+      apex.zone = i;
+
+      // the SOA for negative answers, its TTL bounds negative caching
+      Zone_info info;
+      info.apex_len = apex.wire.size();
+      const uint32_t minimum = read16((const uint8_t*) soa->suffix.data() + 16) << 16
+                             | read16((const uint8_t*) soa->suffix.data() + 18);
+      put16(info.soa, static_cast<uint16_t>(Record_type::SOA));
+      put16(info.soa, DNS_CLASS_INET);
+      put32(info.soa, std::min(soa->ttl, minimum));
+      std::string rdata;
+      for(auto& name : soa->names)
+        rdata.append(to_wire(name));
+      rdata.append(soa->suffix);
+      put16(info.soa, rdata.size());
+      info.soa.append(rdata);
+      zones_.push_back(std::move(info));
+
+      for(auto& entry : zone.entries())
+      {
+        if(not in_zone(entry.name, zone.origin()))
+          throw Zone_error{entry.name + " is not in zone " + zone.origin()};
+        root.insert(entry.name).entries.push_back(&entry);
+      }
+    }
+
+    flatten(root);
+  }
+
+  static std::string make_response(const std::string& qname, Record_type rtype,
+                                   const std::vector<const Zone::Entry*>& entries)
+  {
+    std::string res;
+    put16(res, 0); // id, patched in
+    res.push_back(FLAGS_RESPONSE);
+    res.push_back(0);
+    put16(res, 1);
+    put16(res, entries.size());
+    put16(res, 0);
+    put16(res, 0);
+    // the question, patched in
+    res.append(qname);
+    put16(res, static_cast<uint16_t>(rtype));
+    put16(res, DNS_CLASS_INET);
+
+    for(auto* entry : entries)
+    {
+      // the owner is the question name
+      put16(res, 0xC000 | sizeof(Header));
+      put16(res, static_cast<uint16_t>(rtype));
+      put16(res, DNS_CLASS_INET);
+      put32(res, entry->ttl);
+      const auto rdlen = res.size();
+      put16(res, 0);
+      res.append(entry->prefix);
+      for(auto& name : entry->names)
+        write_name(res, to_wire(name), qname);
+      res.append(entry->suffix);
+      const auto len = res.size() - rdlen - 2;
+      res[rdlen]     = len >> 8;
+      res[rdlen + 1] = len & 0xFF;
+    }
+    if(res.size() > 0xFFFF)
+      throw Zone_error{"Too many records"};
+    return res;
+  }
+
+  void Zone_table::flatten(Build_node& root)
+  {
+    std::unordered_map<std::string, uint32_t> label_offsets;
+    auto add_label = [&] (const std::string& label) -> uint32_t {
+      auto it = label_offsets.find(label);
+      if(it != label_offsets.end())
+        return it->second;
+      const uint32_t offset = labels_.size();
+      labels_.push_back(label.size());
+      labels_.append(label);
+      label_offsets.emplace(label, offset);
+      return offset;
+    };
+
+    auto add_node = [&] (const std::string& label, Build_node& bnode) {
+      Node node {add_label(label), 0, 0, bnode.zone, (uint32_t) answers_.size(), 0};
+
+      // group the records by type, in the order they were added
+      std::vector<Record_type> types;
+      for(auto* entry : bnode.entries)
+        if(std::find(types.begin(), types.end(), entry->rtype) == types.end())
+          types.push_back(entry->rtype);
+
+      if(std::find(types.begin(), types.end(), Record_type::ALIAS) != types.end()
+        and (types.size() > 1 or bnode.entries.size() > 1))
+        throw Zone_error{"CNAME and other records for the same name"};
+
+      for(auto type : types)
+      {
+        std::vector<const Zone::Entry*> entries;
+        for(auto* entry : bnode.entries)
+          if(entry->rtype == type)
+            entries.push_back(entry);
+        const auto res = make_response(bnode.wire, type, entries);
+        answers_.push_back({static_cast<uint16_t>(type), (uint32_t) wire_.size(), (uint32_t) res.size()});
+        wire_.append(res);
+      }
+      node.nanswers = types.size();
+      nodes_.push_back(node);
+    };
+
+    // breadth first, making the children of each node contiguous
+    std::vector<Build_node*> queue {&root};
+    add_node("", root);
+    for(size_t i = 0; i < queue.size(); i++)
+    {
+      auto& bnode = *queue[i];
+      nodes_[i].children  = nodes_.size();
+      nodes_[i].nchildren = bnode.children.size();
+      // std::map keeps the children sorted
+      for(auto& child : bnode.children)
+      {
+        add_node(child.first, *child.second);
+        queue.push_back(child.second.get());
+      }
+    }
+    nodes_.shrink_to_fit();
+    answers_.shrink_to_fit();
+    labels_.shrink_to_fit();
+    wire_.shrink_to_fit();
+  }
+
+  int Zone_table::find_child(const Node& node, const uint8_t* label, uint8_t len) const noexcept
+  {
+    uint32_t lo = node.children;
+    uint32_t hi = node.children + node.nchildren;
+    while(lo < hi)
+    {
+      const auto mid = lo + (hi - lo) / 2;
+      const auto* other = (const uint8_t*) labels_.data() + nodes_[mid].label;
+      int cmp = memcmp(other + 1, label, std::min(other[0], len));
+      if(cmp == 0)
+        cmp = (int) other[0] - (int) len;
+      if(cmp == 0)
+        return mid;
+      if(cmp < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return -1;
+  }
+
+  // header and question of a response without records
+  static size_t write_empty(const uint8_t* query, size_t qend, uint8_t flags,
+                            Response_code rcode, uint8_t* out)
+  {
+    out[0] = query[0];
+    out[1] = query[1];
+    out[2] = flags | (query[2] & FLAG_RD);
+    out[3] = static_cast<uint8_t>(rcode);
+    write16(out + 4, qend > sizeof(Header) ? 1 : 0);
+    memset(out + 6, 0, 6);
+    memcpy(out + sizeof(Header), query + sizeof(Header), qend - sizeof(Header));
+    return qend;
+  }
+
+  // the end of the question, 0 if malformed. Writes the lowercase name.
+  static size_t parse_question(const uint8_t* query, size_t len, uint8_t* name,
+                               uint8_t* labels, int& count)
+  {
+    size_t pos = sizeof(Header);
+    size_t nlen = 0;
+    count = 0;
+    while(true)
+    {
+      if(pos >= len)
+        return 0;
+      const uint8_t l = query[pos];
+      if(l == 0)
+        break;
+      // no compression in the question
+      if(l > 63 or pos + 1 + l > len or nlen + 1 + l >= 255)
+        return 0;
+      labels[count++] = nlen;
+      name[nlen++] = l;
+      for(int i = 1; i <= l; i++)
+      {
+        const uint8_t c = query[pos + i];
+        name[nlen++] = (c >= 'A' and c <= 'Z') ? c + 32 : c;
+      }
+      pos += 1 + l;
+    }
+    name[nlen] = 0;
+    pos += 1 + sizeof(Question);
+    return (pos <= len) ? pos : 0;
+  }
+
+  size_t Zone_table::error_response(const uint8_t* query, size_t len, Response_code rcode,
+                                    uint8_t* out, size_t max)
+  {
+    if(len < sizeof(Header) or max < sizeof(Header))
+      return 0;
+    uint8_t name[256];
+    uint8_t labels[128];
+    int count;
+    size_t qend = (read16(query + 4) == 1) ? parse_question(query, len, name, labels, count) : 0;
+    if(qend == 0 or qend > max)
+      qend = sizeof(Header);
+    return write_empty(query, qend, 0x80 | (query[2] & 0x78), rcode, out);
+  }
+
+  size_t Zone_table::negative(const uint8_t* query, size_t qend, const Zone_info& zone,
+                              Response_code rcode, uint8_t* out, size_t max) const
+  {
+    const size_t len = qend + 2 + zone.soa.size();
+    if(UNLIKELY(len > max))
+      return write_empty(query, qend, FLAGS_RESPONSE | FLAG_TC, Response_code::NO_ERROR, out);
+
+    write_empty(query, qend, FLAGS_RESPONSE, rcode, out);
+    write16(out + 8, 1);
+    // the zone apex is a suffix of the question name
+    const size_t qname_len = qend - sizeof(Header) - sizeof(Question);
+    write16(out + qend, 0xC000 | (sizeof(Header) + qname_len - zone.apex_len));
+    memcpy(out + qend + 2, zone.soa.data(), zone.soa.size());
+    return len;
+  }
+
+  size_t Zone_table::respond(const uint8_t* query, size_t len, uint8_t* out, size_t max) const
+  {
+    if(UNLIKELY(len < sizeof(Header) or max < Zone_table::MAX_UDP_SIZE))
+      return 0;
+
+    const uint8_t opcode = (query[2] >> 3) & 0xF;
+    if(UNLIKELY(opcode != 0))
+      return error_response(query, len, Response_code::NOT_IMPL, out, max);
+
+    uint8_t name[256];
+    uint8_t labels[128];
+    int count;
+    const size_t qend = (read16(query + 4) == 1) ? parse_question(query, len, name, labels, count) : 0;
+    if(UNLIKELY(qend == 0))
+      return error_response(query, len, Response_code::FORMAT_ERROR, out, max);
+
+    const uint16_t qtype  = read16(query + qend - 4);
+    const uint16_t qclass = read16(query + qend - 2);
+    if(UNLIKELY(qclass != DNS_CLASS_INET))
+      return error_response(query, len, Response_code::OP_REFUSED, out, max);
+
+    // walk the trie from the top label, remembering the closest zone
+    uint32_t idx = 0;
+    int zone = nodes_[0].zone;
+    bool found = true;
+    for(int i = count - 1; i >= 0; i--)
+    {
+      const int child = find_child(nodes_[idx], &name[labels[i] + 1], name[labels[i]]);
+      if(child < 0) {
+        found = false;
+        break;
+      }
+      idx = child;
+      if(nodes_[idx].zone >= 0)
+        zone = nodes_[idx].zone;
+    }
+
+    if(zone < 0)
+      return 0;
+    if(not found)
+      return negative(query, qend, zones_[zone], Response_code::NAME_ERROR, out, max);
+
+    const auto& node = nodes_[idx];
+    const Answer* answer = nullptr;
+    for(uint32_t i = node.answers; i < node.answers + node.nanswers; i++)
+    {
+      const auto& a = answers_[i];
+      if(a.rtype == qtype or a.rtype == static_cast<uint16_t>(Record_type::ALIAS)
+        or qtype == TYPE_ANY)
+      {
+        answer = &a;
+        if(a.rtype == qtype) break;
+      }
+    }
+    if(answer == nullptr)
+      return negative(query, qend, zones_[zone], Response_code::NO_ERROR, out, max);
+
+    if(UNLIKELY(answer->len > max))
+      return write_empty(query, qend, FLAGS_RESPONSE | FLAG_TC, Response_code::NO_ERROR, out);
+
+    // the precomputed response, with the id, flags and question of the query
+    memcpy(out, wire_.data() + answer->offset, answer->len);
+    out[0] = query[0];
+    out[1] = query[1];
+    out[2] |= query[2] & FLAG_RD;
+    memcpy(out + sizeof(Header), query + sizeof(Header), qend - sizeof(Header));
+    return answer->len;
+  }
+
+  size_t Zone_table::memory_usage() const noexcept
+  {
+    return sizeof(*this)
+      + nodes_.capacity() * sizeof(Node)
+      + answers_.capacity() * sizeof(Answer)
+      + labels_.capacity() + wire_.capacity()
+      + zones_.capacity() * sizeof(Zone_info);
+  }
+
+}
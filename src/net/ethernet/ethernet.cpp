@@ -26,6 +26,7 @@
 #include <net/util.hpp>
 #include <net/ethernet/ethernet.hpp>
 #include <statman>
+#include <atomic>
 
 #ifdef ntohs
 #undef ntohs
@@ -39,13 +40,34 @@ namespace net {
   static void ignore_ip(net::Packet_ptr, const bool) noexcept {
     debug("<Ethernet upstream_ip> Ignoring data (no real upstream)\n");
   }
-  static int eth_name_idx = 0;
+  static std::atomic<int> eth_name_idx {0};
+  // links may be constructed on several CPUs at once
+  static thread_local int reserved_idx = -1;
+
+  int Ethernet::reserve_index() noexcept
+  {
+    return eth_name_idx++;
+  }
+
+  void Ethernet::use_index(const int idx) noexcept
+  {
+    reserved_idx = idx;
+  }
+
+  int Ethernet::next_index() noexcept
+  {
+    if (reserved_idx < 0)
+      return eth_name_idx++;
+    const int idx = reserved_idx;
+    reserved_idx = -1;
+    return idx;
+  }
 
   Ethernet::Ethernet(
         downstream physical_downstream,
         const addr& mac) noexcept
   : mac_(mac),
-    ethernet_idx(eth_name_idx++),
+    ethernet_idx(next_index()),
     packets_rx_{Statman::get().create(Stat::UINT64,
                 link_name() + ".ethernet.packets_rx").get_uint64()},
     packets_tx_{Statman::get().create(Stat::UINT64,
@@ -16,6 +16,8 @@
 // limitations under the License.
 
 #include <net/http/basic_client.hpp>
+#include <rtc>
+#include <algorithm>
 
 namespace http {
 
@@ -30,10 +32,55 @@ namespace http {
   Basic_client::Basic_client(TCP& tcp, Request_handler on_send, const bool https_supported)
     : tcp_(tcp),
       on_send_{std::move(on_send)},
-      supports_https(https_supported)
+      supports_https(https_supported),
+      stat_pool_hits_{Statman::get().get_or_create(Stat::UINT64, tcp.stack().ifname() + ".http_client.pool_hits")},
+      stat_pool_misses_{Statman::get().get_or_create(Stat::UINT64, tcp.stack().ifname() + ".http_client.pool_misses")},
+      stat_pool_queued_{Statman::get().get_or_create(Stat::UINT64, tcp.stack().ifname() + ".http_client.pool_queued")},
+      stat_pipelined_{Statman::get().get_or_create(Stat::UINT64, tcp.stack().ifname() + ".http_client.pipelined")},
+      stat_idle_closed_{Statman::get().get_or_create(Stat::UINT64, tcp.stack().ifname() + ".http_client.idle_closed")}
   {
   }
 
+  Basic_client::~Basic_client()
+  {
+    if(idle_timer_ != Timers::UNUSED_ID)
+      Timers::stop(idle_timer_);
+
+    for(auto& [host, queue] : waiting_)
+    {
+      for(auto& pending : queue)
+      {
+        if(pending.timer != Timers::UNUSED_ID)
+          Timers::stop(pending.timer);
+      }
+    }
+  }
+
+  void Basic_client::set_pool_options(Pool_options opts)
+  {
+    Expects(opts.max_conns_per_host > 0);
+    Expects(opts.pipeline_depth > 0);
+    pool_opts_ = std::move(opts);
+
+    if(idle_timer_ != Timers::UNUSED_ID)
+    {
+      Timers::stop(idle_timer_);
+      idle_timer_ = Timers::UNUSED_ID;
+    }
+  }
+
+  size_t Basic_client::connection_count(const Host host) const
+  {
+    auto it = conns_.find(host);
+    return (it != conns_.end()) ? it->second.size() : 0;
+  }
+
+  size_t Basic_client::queued_count(const Host host) const
+  {
+    auto it = waiting_.find(host);
+    return (it != waiting_.end()) ? it->second.size() : 0;
+  }
+
   Request_ptr Basic_client::create_request(Method method) const
   {
     auto req = std::make_unique<Request>();
@@ -51,8 +98,6 @@ namespace http {
   {
     Expects(cb != nullptr);
     using namespace std;
-    auto& conn = (not secure) ?
-      get_connection(host) : get_secure_connection(host);
 
     auto&& header = req->header();
 
@@ -69,7 +114,20 @@ namespace http {
     if(on_send_)
       on_send_(*req, options, host);
 
-    conn.send(std::move(req), std::move(cb), options.follow_redirect, options.timeout);
+    // only idempotent requests are pipelined (RFC 7230 6.3.2)
+    const auto method = req->method();
+    const bool pipeline = (method == GET or method == HEAD);
+
+    auto* conn = get_connection(host, secure, pipeline);
+
+    // all connections to the host are busy, wait for one to be released
+    if(conn == nullptr)
+    {
+      enqueue(std::move(req), host, std::move(cb), secure, std::move(options));
+      return;
+    }
+
+    conn->send(std::move(req), std::move(cb), options.follow_redirect, options.timeout);
   }
 
   void Basic_client::send(Request_ptr req, URI url, Response_handler cb, Options options)
@@ -339,26 +397,126 @@ namespace http {
     stack.resolve(host, cb);
   }
 
-  Client_connection& Basic_client::get_connection(const Host host)
+  Client_connection* Basic_client::get_connection(const Host host, const bool secure, const bool pipeline)
   {
     // return/create a set for the given host
     auto& cset = conns_[host];
 
-    // iterate all the connection and return the first free one
+    // reuse the first free connection that is still healthy
     for(auto& conn : cset)
     {
-      if(!conn->occupied())
-        return *conn;
+      if(conn->available() and healthy(*conn))
+      {
+        ++stat_pool_hits_;
+        return conn.get();
+      }
+    }
+
+    // open a new connection if the host is not at capacity
+    if(not keep_alive_ or cset.size() < pool_opts_.max_conns_per_host)
+    {
+      ++stat_pool_misses_;
+      auto stream = (not secure) ?
+        std::make_unique<net::tcp::Stream>(tcp_.connect(host)) : connect_secure(host);
+
+      cset.push_back(std::make_unique<Client_connection>(*this, std::move(stream)));
+      return cset.back().get();
+    }
+
+    // pipeline behind the connection with the fewest requests in flight
+    if(pipeline and pool_opts_.pipeline_depth > 1)
+    {
+      Client_connection* best = nullptr;
+      for(auto& conn : cset)
+      {
+        if(conn->can_pipeline(pool_opts_.pipeline_depth)
+          and (best == nullptr or conn->in_flight() < best->in_flight()))
+          best = conn.get();
+      }
+      if(best != nullptr)
+      {
+        ++stat_pipelined_;
+        return best;
+      }
     }
 
-    // no non-occupied connections, emplace a new one
-    cset.push_back(std::make_unique<Client_connection>(
-      *this, std::make_unique<net::tcp::Stream>(tcp_.connect(host)))
-    );
-    return *cset.back();
+    return nullptr;
+  }
+
+  bool Basic_client::healthy(const Client_connection& conn) const
+  {
+    if(conn.released())
+      return false;
+
+    const auto& stream = conn.stream();
+    // still connecting is fine, as long as its not being torn down
+    if(stream->is_closing() or stream->is_closed())
+      return false;
+
+    return RTC::now() < conn.idle_since() + pool_opts_.idle_timeout.count();
   }
 
-  Client_connection& Basic_client::get_secure_connection(const Host)
+  void Basic_client::release(Client_connection& conn)
+  {
+    const auto host = conn.peer();
+
+    // hand the connection to the next request waiting for this host
+    if(auto pending = dequeue(host))
+    {
+      ++stat_pool_hits_;
+      conn.send(std::move(pending->req), std::move(pending->cb),
+                pending->options.follow_redirect, pending->options.timeout);
+      return;
+    }
+
+    // keep a bounded amount of idle connections per host
+    const auto& cset = conns_[host];
+    const auto idle = std::count_if(cset.begin(), cset.end(),
+      [](const auto& c) { return c->available(); });
+
+    if(static_cast<size_t>(idle) > pool_opts_.max_idle_per_host)
+    {
+      ++stat_idle_closed_;
+      conn.keep_alive(false);
+      conn.shutdown();
+      return;
+    }
+
+    // make sure idle connections eventually get closed
+    if(idle_timer_ == Timers::UNUSED_ID)
+    {
+      const auto interval = std::chrono::duration_cast<Timers::duration_t>(
+        std::max(pool_opts_.idle_timeout / 2, std::chrono::seconds(1)));
+      idle_timer_ = Timers::periodic(interval, interval, {this, &Basic_client::close_idle});
+    }
+  }
+
+  void Basic_client::close_idle(int32_t)
+  {
+    bool any_open = false;
+    for(auto& [host, cset] : conns_)
+    {
+      for(auto& conn : cset)
+      {
+        if(conn->available() and not healthy(*conn))
+        {
+          ++stat_idle_closed_;
+          conn->keep_alive(false);
+          conn->shutdown();
+        }
+        else
+          any_open = true;
+      }
+    }
+    // nothing left to watch
+    if(not any_open)
+    {
+      Timers::stop(idle_timer_);
+      idle_timer_ = Timers::UNUSED_ID;
+    }
+  }
+
+  Basic_client::Stream_ptr Basic_client::connect_secure(const Host)
   {
     throw Client_error{"Secured connections not supported (use the HTTPS Client)."};
   }
@@ -366,13 +524,79 @@ namespace http {
   void Basic_client::close(Client_connection& c)
   {
     debug("<http::Basic_client> Closing %u:%s %p\n", c.local_port(), c.peer().to_string().c_str(), &c);
-    auto& cset = conns_.at(c.peer());
+    const auto host = c.peer();
+    auto& cset = conns_.at(host);
 
     cset.erase(std::remove_if(cset.begin(), cset.end(),
     [port = c.local_port()] (const std::unique_ptr<Client_connection>& conn)->bool
     {
       return conn->local_port() == port;
-    }));
+    }), cset.end());
+
+    // a slot opened up, let the next waiting request connect
+    if(auto pending = dequeue(host))
+    {
+      auto* conn = get_connection(host, pending->secure, false);
+      Ensures(conn != nullptr);
+      conn->send(std::move(pending->req), std::move(pending->cb),
+                 pending->options.follow_redirect, pending->options.timeout);
+    }
+  }
+
+  void Basic_client::enqueue(Request_ptr req, const Host host, Response_handler cb,
+                             const bool secure, Options options)
+  {
+    ++stat_pool_queued_;
+    // the timeout runs from when the request was made,
+    // not from when it gets a connection
+    auto timer = Timers::UNUSED_ID;
+    if(options.timeout > timeout_duration::zero())
+      timer = Timers::oneshot(options.timeout, {this, &Basic_client::expire_waiting});
+
+    waiting_[host].push_back({std::move(req), std::move(cb), std::move(options),
+                              secure, timer, RTC::nanos_now()});
+  }
+
+  std::optional<Basic_client::Pending> Basic_client::dequeue(const Host host)
+  {
+    auto it = waiting_.find(host);
+    if(it == waiting_.end())
+      return std::nullopt;
+
+    auto pending = std::move(it->second.front());
+    it->second.pop_front();
+    if(it->second.empty())
+      waiting_.erase(it);
+
+    if(pending.timer != Timers::UNUSED_ID)
+    {
+      Timers::stop(pending.timer);
+      const auto waited = std::chrono::duration_cast<timeout_duration>(
+        std::chrono::nanoseconds(RTC::nanos_now() - pending.queued_at));
+      pending.options.timeout = std::max(pending.options.timeout - waited,
+                                         timeout_duration{1});
+    }
+    return pending;
+  }
+
+  void Basic_client::expire_waiting(Timers::id_t id)
+  {
+    for(auto it = waiting_.begin(); it != waiting_.end(); ++it)
+    {
+      auto& queue = it->second;
+      auto p = std::find_if(queue.begin(), queue.end(),
+        [id] (const Pending& pending) { return pending.timer == id; });
+      if(p == queue.end())
+        continue;
+
+      auto cb = std::move(p->cb);
+      queue.erase(p);
+      if(queue.empty())
+        waiting_.erase(it);
+
+      cb({Error::TIMEOUT}, nullptr, Connection::empty());
+      return;
+    }
   }
 
 }
@@ -28,7 +28,8 @@ namespace http {
       on_response_{nullptr},
       timer_({this, &Client_connection::timeout_request}),
       timeout_dur_{timeout_duration::zero()},
-      redirect_{client.default_follow_redirect}
+      redirect_{client.default_follow_redirect},
+      idle_since_{RTC::now()}
   {
     // setup close event
     stream_->on_close({this, &Client_connection::close});
@@ -36,10 +37,21 @@ namespace http {
 
   void Client_connection::send(Request_ptr req, Response_handler on_res, int redirects, timeout_duration timeout)
   {
+    Expects(on_res != nullptr);
+
+    // a request is already in flight, pipeline this one behind it.
+    // responses arrive in the same order as the requests are written
+    if(on_response_ != nullptr)
+    {
+      Expects(keep_alive_ and stream_->is_connected());
+      write_request(*req);
+      pipeline_.push_back({std::move(req), std::move(on_res), redirects, timeout});
+      return;
+    }
+
     Expects(available());
     req_ = std::move(req);
     on_response_ = std::move(on_res);
-    Expects(on_response_ != nullptr);
     timeout_dur_ = timeout;
     redirect_ = redirects;
 
@@ -61,11 +73,16 @@ namespace http {
 
   void Client_connection::send_request()
   {
-    keep_alive_ = (req_->header().value(header::Connection) != "close");
-
     stream_->on_read(0 , {this, &Client_connection::recv_response});
 
-    stream_->write(req_->to_string());
+    write_request(*req_);
+  }
+
+  void Client_connection::write_request(const Request& req)
+  {
+    keep_alive_ = (req.header().value(header::Connection) != "close");
+
+    stream_->write(req.to_string());
   }
 
   void Client_connection::recv_response(buffer_t buf)
@@ -75,91 +92,90 @@ namespace http {
       return;
     }
 
-    const std::string data{(char*) buf->data(), buf->size()};
-
     // restart timer since we got data
     if(timer_.is_running())
       timer_.restart(timeout_dur_);
 
-    // create response if not exist
-    if(res_ == nullptr)
-    {
-      try {
-        res_ = make_response(data); // this also parses
-      }
-      catch(...)
-      {
-        end_response({Error::INVALID});
-        return;
-      }
-    }
-    // if there already is a response
-    else
+    inbuf_.append(reinterpret_cast<const char*>(buf->data()), buf->size());
+
+    process_input();
+  }
+
+  void Client_connection::process_input()
+  {
+    // with keep-alive (and pipelining) a single buffer may hold the end
+    // of one response and the start of the next, so only consume what
+    // belongs to the response currently being received
+    while(on_response_ != nullptr and not inbuf_.empty())
     {
-      // this is the case when Status line is received, but not yet headers.
-      if(not res_->headers_complete() && req_->method() != HEAD)
+      if(res_ == nullptr)
       {
-        *res_ << data;
-        res_->parse();
+        // wait until the status line and all the headers are received
+        const auto head_end = inbuf_.find("\r\n\r\n");
+        if(head_end == std::string::npos)
+          return;
+
+        try {
+          res_ = make_response(inbuf_.substr(0, head_end + 4)); // this also parses
+        }
+        catch(...)
+        {
+          end_response({Error::INVALID});
+          return;
+        }
+        inbuf_.erase(0, head_end + 4);
       }
-      // here we assume all headers has already been received (could not be true?)
-      else
+
+      // HTTP/1.1 7.2.2 Length: Any response message which must not include an entity body
+      // (such as the 1xx, 204, and 304 responses and any response to a HEAD request)
+      // is always terminated by the first empty line after the header fields
+      if(const auto code = res_->status_code();
+        is_informational(code) or code == No_Content or code == Not_Modified
+        or req_->method() == HEAD)
       {
-        // add chunks of body data
-        res_->add_chunk(data);
+        end_response();
+        continue;
       }
-    }
 
-    const auto& header = res_->header();
-    // TODO: Temporary, not good enough
-    // if(res_->is_complete())
-    // Assume we want some headers
-    if(!header.is_empty())
-    {
       // Note: Content Length is not required
+      const auto& header = res_->header();
       if(header.has_field(header::Content_Length))
       {
+        size_t conlen = 0;
         try
         {
-          const unsigned conlen = std::stoul(std::string(header.value(header::Content_Length)));
-          const unsigned body_size = res_->body().size();
-          //printf("<http::Connection> [%s] Data: %u ConLen: %u Body:%u\n",
-          //  req_->uri().to_string().to_string().c_str(), data.size(), conlen, body_size);
-          // risk buffering forever if no timeout
-          if(body_size == conlen)
-          {
-            end_response();
-          }
-          else if(body_size > conlen)
-          {
-            end_response({Error::INVALID});
-          }
+          conlen = std::stoul(std::string(header.value(header::Content_Length)));
         }
         catch(...)
-        { end_response({Error::INVALID}); }
+        {
+          end_response({Error::INVALID});
+          return;
+        }
+
+        const size_t take = std::min(conlen - res_->body().size(), inbuf_.size());
+        res_->add_chunk(inbuf_.substr(0, take));
+        inbuf_.erase(0, take);
+
+        // risk buffering forever if no timeout
+        if(res_->body().size() < conlen)
+          return;
+
+        end_response();
       }
-      // HTTP/1.1 7.2.2 Length: Any response message which must not include an entity body
-      // (such as the 1xx, 204, and 304 responses and any response to a HEAD request)
-      // is always terminated by the first empty line after the header fields
-      else if(const auto code = res_->status_code();
-        is_informational(code) or code == No_Content or code == Not_Modified
-        or req_->method() == HEAD)
+      // without a length the body lasts until the connection is closed
+      else
       {
-        end_response();
+        res_->add_chunk(inbuf_);
+        inbuf_.clear();
+        return;
       }
     }
-    else if(req_->method() == HEAD)
-    {
-      end_response();
-    }
   }
 
   void Client_connection::end_response(Error err)
   {
     // If the request has timed out, but the response is received later,
     // just discard (we can't do anything because we have no callback).
-    // This MAY have side effects if the connection is reused and
-    // a delayed response is received
     if (on_response_)
     {
       if(UNLIKELY(not err and can_redirect(res_)))
@@ -168,8 +184,9 @@ namespace http {
 
         if(location.is_valid())
         {
+          res_.reset();
           redirect(location);
-          end(); // hope its good here..
+          next_request();
           return;
         }
 
@@ -181,21 +198,63 @@ namespace http {
       // stop timeout timer
       timer_.stop();
 
+      // after an error the stream can't be trusted to be in sync
+      // with the requests, so don't reuse it
+      if(err)
+        keep_alive_ = false;
+
       callback(err, std::move(res_), *this);
+
+      if(err)
+        fail_pipeline(err);
     }
-    end();
-    /*if(!released())
+    next_request();
+  }
+
+  void Client_connection::next_request()
+  {
+    // the next pipelined request is already written, wait for its response
+    if(on_response_ == nullptr and not pipeline_.empty() and not released())
     {
-      // avoid trying to parse any more responses
-      tcpconn_->on_read(0, nullptr);
+      auto next = std::move(pipeline_.front());
+      pipeline_.pop_front();
+
+      req_          = std::move(next.req);
+      on_response_  = std::move(next.on_response);
+      redirect_     = next.redirects;
+      timeout_dur_  = next.timeout;
 
-      if(!keep_alive_) // user callback may override this
-        shutdown();
+      if(timeout_dur_ > timeout_duration::zero())
+        timer_.restart(timeout_dur_);
+      return;
     }
-    else
+
+    if(on_response_ != nullptr)
+      return;
+
+    // ending a released connection closes it, which destroys it,
+    // so don't touch it afterwards
+    if(released() or not keep_alive_)
     {
-      close();
-    }*/
+      end();
+      return;
+    }
+
+    // hand the connection back to the pool
+    if(available())
+    {
+      idle_since_ = RTC::now();
+      client_.release(*this);
+    }
+  }
+
+  void Client_connection::fail_pipeline(Error err)
+  {
+    auto pipeline = std::move(pipeline_);
+    pipeline_.clear();
+
+    for(auto& pending : pipeline)
+      pending.on_response(err, nullptr, *this);
   }
 
   bool Client_connection::can_redirect(const Response_ptr& res) const
@@ -243,6 +302,7 @@ namespace http {
         callback(Error::CLOSING, std::move(res_), *this);
       }
     }
+    fail_pipeline(Error::CLOSING);
 
     client_.close(*this);
   }
@@ -19,6 +19,25 @@
 
 namespace http {
 
+///
+/// Compare two field names
+///
+/// Most names are added through the constants in header_fields.hpp and
+/// looked up through the same constants, so try an exact match before
+/// falling back to a case-insensitive one (RFC 7230 §3.2)
+///
+static bool field_equals(util::csview lhs, util::csview rhs) noexcept {
+  if (lhs.size() not_eq rhs.size()) return false;
+  if (std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0) return true;
+  //-----------------------------------
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    const char a = lhs[i], b = rhs[i];
+    if (a == b) continue;
+    if ((a | 0x20) not_eq (b | 0x20) or (a | 0x20) < 'a' or (a | 0x20) > 'z') return false;
+  }
+  return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 Header::Header() {
   fields_.reserve(25);
@@ -104,14 +123,37 @@ bool Header::set_content_length(const size_t len) {
   return set_field(header::Content_Length, std::to_string(len));
 }
 
+///////////////////////////////////////////////////////////////////////////////
+std::size_t Header::serialized_size() const noexcept {
+  std::size_t size = 2; //< "\r\n"
+  for (const auto& field : fields_) {
+    size += field.first.size() + 2 + field.second.size() + 2;
+  }
+  return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+char* Header::serialize(char* out) const noexcept {
+  for (const auto& field : fields_) {
+    out = std::copy(field.first.cbegin(), field.first.cend(), out);
+    *out++ = ':';
+    *out++ = ' ';
+    out = std::copy(field.second.cbegin(), field.second.cend(), out);
+    *out++ = '\r';
+    *out++ = '\n';
+  }
+  *out++ = '\r';
+  *out++ = '\n';
+  return out;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 Header::Const_iterator Header::find(util::csview field) const noexcept {
   if (field.empty()) return fields_.cend();
   //-----------------------------------
   return
-    std::find_if(fields_.cbegin(), fields_.cend(), [&field](const auto _) {
-      return std::equal(_.first.cbegin(), _.first.cend(), field.cbegin(), field.cend(),
-        [](const auto a, const auto b) { return std::tolower(a) == std::tolower(b); });
+    std::find_if(fields_.cbegin(), fields_.cend(), [field](const auto& _) {
+      return field_equals(_.first, field);
     });
 }
 
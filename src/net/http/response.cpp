@@ -15,6 +15,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <charconv>
 #include <http_parser.h>
 #include <net/http/response.hpp>
 
@@ -60,6 +61,13 @@ static void riegfjeriugfjreiougf()
 ///
 static size_t parse_response(Response*, const std::string&) noexcept;
 
+///
+/// Format the status line without the trailing CRLF into {buffer}
+///
+/// @return The length of the status line
+///
+static size_t format_status_line(char (&buffer)[96], const Version version, const status_t code) noexcept;
+
 ///////////////////////////////////////////////////////////////////////////////
 Response::Response(const Version version, const status_t status_code) noexcept
   : code_{status_code}
@@ -107,12 +115,24 @@ Response& Response::set_version(const Version version) noexcept {
 
 ///////////////////////////////////////////////////////////////////////////////
 std::string Response::status_line() const noexcept {
-  std::ostringstream status_line;
-  //-----------------------------------
-  status_line << version_ << " " << code_ << " "
-              << code_description(code_);
-  //-----------------------------------
-  return status_line.str();
+  char buffer[96];
+  return {buffer, format_status_line(buffer, version_, code_)};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::size_t Response::head_size() const noexcept {
+  char buffer[96];
+  return format_status_line(buffer, version_, code_) + 2 + header().serialized_size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+char* Response::serialize_head(char* out) const noexcept {
+  char buffer[96];
+  const auto len = format_status_line(buffer, version_, code_);
+  out = std::copy(buffer, buffer + len, out);
+  *out++ = '\r';
+  *out++ = '\n';
+  return header().serialize(out);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -123,13 +143,13 @@ Response& Response::reset() noexcept {
 
 ///////////////////////////////////////////////////////////////////////////////
 std::string Response::to_string() const {
-  std::ostringstream response;
+  const auto body = this->body();
+  std::string response(head_size() + body.size(), '\0');
   //-----------------------------------
-  response << version_ << " " << code_ << " "
-           << code_description(code_)  << "\r\n"
-           << Message::to_string();
+  auto end = serialize_head(response.data());
+  std::copy(body.cbegin(), body.cend(), end);
   //-----------------------------------
-  return response.str();
+  return response;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -145,6 +165,26 @@ static size_t parse_response(Response* res, const std::string& data) noexcept {
   return http_parser_execute(&parser, &settings, data.data(), data.size());
 }
 
+///////////////////////////////////////////////////////////////////////////////
+static size_t format_status_line(char (&buffer)[96], const Version version, const status_t code) noexcept {
+  constexpr util::csview prefix {"HTTP/"};
+  auto* const last = buffer + sizeof(buffer);
+  //-----------------------------------
+  auto* out = std::copy(prefix.cbegin(), prefix.cend(), buffer);
+  out = std::to_chars(out, last, version.major()).ptr;
+  *out++ = '.';
+  out = std::to_chars(out, last, version.minor()).ptr;
+  *out++ = ' ';
+  out = std::to_chars(out, last, static_cast<unsigned>(code)).ptr;
+  *out++ = ' ';
+  //-----------------------------------
+  const auto desc = code_description(code);
+  const auto len  = std::min<size_t>(desc.size(), last - out);
+  out = std::copy(desc.cbegin(), desc.cbegin() + len, out);
+  //-----------------------------------
+  return out - buffer;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 Response& Response::operator<<(const std::string& chunk) {
   response_.append(chunk);
@@ -17,10 +17,48 @@
 
 #include <net/http/response_writer.hpp>
 
-#include <sstream>
+#include <array>
 
 namespace http {
 
+  /**
+   * @brief      A small set of reusable buffers for serialized headers.
+   *             A buffer is handed out again once the TCP write queue
+   *             has released its reference to it.
+   */
+  class Header_arena {
+  public:
+    static constexpr size_t SLOTS = 16;
+    static constexpr size_t SLOT_SIZE = 512;
+
+    Response_writer::buffer_t acquire(const size_t len)
+    {
+      for (auto& buf : slots_)
+      {
+        if (buf == nullptr) {
+          buf = net::tcp::construct_buffer();
+          buf->reserve(std::max(len, SLOT_SIZE));
+        }
+        else if (buf.use_count() > 1) {
+          continue;
+        }
+        buf->resize(len);
+        return buf;
+      }
+      // every slot is still in flight
+      return net::tcp::construct_buffer(len);
+    }
+
+  private:
+    std::array<Response_writer::buffer_t, SLOTS> slots_;
+  };
+
+  static Header_arena& header_arena()
+  {
+    thread_local Header_arena arena;
+    return arena;
+  }
+
   Response_writer::Response_writer(Response_ptr res, Connection& conn)
     : response_(std::move(res)),
       connection_(conn)
@@ -78,10 +116,16 @@ namespace http {
     {
       response_->set_status_code(code);
 
-      std::ostringstream header;
-      header << response_->status_line() << "\r\n" << response_->header();
+      if(not header().has_field(header::Date))
+        header().add_field(header::Date, std::string{time::cached_now()});
 
-      connection_.stream()->write(header.str());
+      // serialize status line + header straight into a (recycled) buffer,
+      // the body is written as its own buffer without being concatenated
+      auto buf = header_arena().acquire(response_->head_size());
+      response_->serialize_head(reinterpret_cast<char*>(buf->data()));
+
+      connection_.stream()->write(std::move(buf));
+      header_sent_ = true;
 
       // disable keep alive if "Connection: close" is present
       if(response_->header().value(http::header::Connection) == "close")
@@ -93,8 +137,12 @@ namespace http {
 
   void Response_writer::write()
   {
-    if(!response_->body().empty())
-      write(std::string(response_->body()));
+    const auto body = response_->body();
+    if(!body.empty())
+    {
+      pre_write(body.size());
+      connection_.stream()->write(body.data(), body.size());
+    }
     else
       write_header(response_->status_code());
   }
@@ -34,7 +34,14 @@ namespace http {
 
   void Server_connection::send(Response_ptr res)
   {
-    stream_->write(res->to_string());
+    // serialize head and body into a single buffer sized up front
+    const auto body = res->body();
+    auto buf = net::Stream::construct_buffer(res->head_size() + body.size());
+
+    auto* end = res->serialize_head(reinterpret_cast<char*>(buf->data()));
+    std::copy(body.cbegin(), body.cend(), end);
+
+    stream_->write(std::move(buf));
   }
 
   void Server_connection::recv_request(buffer_t buf)
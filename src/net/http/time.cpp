@@ -64,5 +64,23 @@ std::string now() {
   return from_time_t(std::time(nullptr));
 }
 
+///////////////////////////////////////////////////////////////////////////////
+util::sview cached_now() noexcept {
+  thread_local std::time_t last {-1};
+  thread_local char   buffer[64];
+  thread_local size_t length {0};
+
+  const auto current = std::time(nullptr);
+
+  if (current not_eq last) {
+    auto tm = std::gmtime(&current);
+    length = tm ? std::strftime(buffer, sizeof(buffer),
+                                "%a, %d %b %Y %H:%M:%S %Z", tm) : 0;
+    last = current;
+  }
+
+  return {buffer, length};
+}
+
 } //< namespace time
 } //< namespace http
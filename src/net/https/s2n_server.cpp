@@ -17,6 +17,10 @@
 
 #include <net/https/s2n_server.hpp>
 #include <net/s2n/stream.hpp>
+#include <info>
+#include <net/tls/session_cache.hpp>
+#include <algorithm>
+#include <cstring>
 using s2n::print_s2n_error;
 
 // allow all clients
@@ -24,6 +28,32 @@ static uint8_t verify_host_passthrough(const char*, size_t, void* /*data*/) {
     return 1;
 }
 
+// server-side session cache, shared with the other TLS servers
+static int cache_store(s2n_connection*, void*, uint64_t /*ttl*/,
+                       const void* key, uint64_t key_size,
+                       const void* value, uint64_t value_size)
+{
+  net::tls::Session_cache::get().store({(const char*) key, key_size},
+                                       {(const char*) value, value_size});
+  return 0;
+}
+static int cache_retrieve(s2n_connection*, void*,
+                          const void* key, uint64_t key_size,
+                          void* value, uint64_t* value_size)
+{
+  auto session = net::tls::Session_cache::get().find({(const char*) key, key_size});
+  if (session.empty() or session.size() > *value_size) return -1;
+  std::memcpy(value, session.data(), session.size());
+  *value_size = session.size();
+  return 0;
+}
+static int cache_delete(s2n_connection*, void*,
+                        const void* key, uint64_t key_size)
+{
+  net::tls::Session_cache::get().remove({(const char*) key, key_size});
+  return 0;
+}
+
 namespace http
 {
   void S2N_server::initialize(
@@ -55,8 +85,56 @@ namespace http
       print_s2n_error("Error setting verify-host callback");
       exit(1);
     }
+
+    // session resumption, by ID and by ticket
+    s2n_config_set_cache_store_callback(config, cache_store, nullptr);
+    s2n_config_set_cache_retrieve_callback(config, cache_retrieve, nullptr);
+    s2n_config_set_cache_delete_callback(config, cache_delete, nullptr);
+    res = s2n_config_set_session_cache_onoff(config, 1);
+    if (res < 0) {
+      print_s2n_error("Error enabling session cache");
+      exit(1);
+    }
+    const auto& keys = net::tls::Ticket_keys::get();
+    const uint64_t lifetime = keys.lifetime().count();
+    s2n_config_set_ticket_encrypt_decrypt_key_lifetime(config, lifetime);
+    s2n_config_set_ticket_decrypt_key_lifetime(config, lifetime);
+    res = s2n_config_set_session_tickets_onoff(config, 1);
+    if (res < 0) {
+      print_s2n_error("Error enabling session tickets");
+      exit(1);
+    }
+    this->update_ticket_keys();
   }
-  
+
+  void S2N_server::update_ticket_keys()
+  {
+    auto& keys = net::tls::Ticket_keys::get();
+    // rotates the key when it's due
+    keys.current();
+    // all the accepted keys, as keys restored after a LiveUpdate
+    // can be older than the current one. s2n retires them as they expire
+    keys.for_each([this] (const auto& key)
+    {
+      Key_name name;
+      std::memcpy(name.data(), key.name, name.size());
+      if (std::find(m_ticket_keys.begin(), m_ticket_keys.end(), name) != m_ticket_keys.end())
+        return;
+
+      uint8_t secret[sizeof(key.aes_key)];
+      std::memcpy(secret, key.aes_key, sizeof(secret));
+      int res = s2n_config_add_ticket_crypto_key((s2n_config*) this->m_config,
+                    key.name, sizeof(key.name), secret, sizeof(secret), key.created);
+      std::memset(secret, 0, sizeof(secret));
+      if (res < 0) {
+        print_s2n_error("Error adding session ticket key");
+        return;
+      }
+      m_ticket_keys[m_next_key] = name;
+      m_next_key = (m_next_key + 1) % m_ticket_keys.size();
+    });
+  }
+
   S2N_server::~S2N_server()
   {
     s2n_config_free((s2n_config*) this->m_config);
@@ -70,6 +148,7 @@ namespace http
 
   void S2N_server::on_connect(TCP_conn conn)
   {
+    this->update_ticket_keys();
     connect(
       std::make_unique<s2n::TLS_stream> (
         (s2n_config*) this->m_config,
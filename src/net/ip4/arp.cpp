@@ -39,6 +39,11 @@ namespace net {
   requests_tx_    {Statman::get().create(Stat::UINT32, inet.ifname() + ".arp.requests_tx").get_uint32()},
   replies_rx_     {Statman::get().create(Stat::UINT32, inet.ifname() + ".arp.replies_rx").get_uint32()},
   replies_tx_     {Statman::get().create(Stat::UINT32, inet.ifname() + ".arp.replies_tx").get_uint32()},
+  cache_hits_     {Statman::get().create(Stat::UINT64, inet.ifname() + ".arp.cache_hits").get_uint64()},
+  cache_misses_   {Statman::get().create(Stat::UINT64, inet.ifname() + ".arp.cache_misses").get_uint64()},
+  cache_stalls_   {Statman::get().create(Stat::UINT64, inet.ifname() + ".arp.cache_stalls").get_uint64()},
+  cache_evictions_{Statman::get().create(Stat::UINT64, inet.ifname() + ".arp.cache_evictions").get_uint64()},
+  cache_refreshes_{Statman::get().create(Stat::UINT64, inet.ifname() + ".arp.cache_refreshes").get_uint64()},
   inet_           {inet},
   mac_            (inet.link_addr())
   {}
@@ -103,24 +108,21 @@ namespace net {
   void Arp::cache(ip4::Addr ip, MAC::Addr mac) {
     PRINT("<Arp> Caching IP %s for %s\n", ip.str().c_str(), mac.str().c_str());
 
-    auto entry = cache_.find(ip);
+    auto* entry = cache_.find(ip);
 
-    if (entry != cache_.end()) {
+    if (entry != nullptr and entry->mac() == mac) {
       PRINT("Cached entry found: %s recorded @ %zu. Updating timestamp\n",
-             entry->second.mac().str().c_str(), entry->second.timestamp());
+             entry->mac().str().c_str(), entry->timestamp());
+      entry->update();
+      return;
+    }
 
-      if (entry->second.mac() != mac) {
-        cache_.erase(entry);
-        cache_.emplace(ip, mac);
-      } else {
-        entry->second.update();
-      }
+    // Insert, or replace an entry with a changed MAC
+    cache_.insert(ip, Cache_entry{mac});
+    cache_evictions_ = cache_.evictions();
 
-    } else {
-      cache_.emplace(ip, mac); // Insert
-      if (UNLIKELY(not flush_timer_.is_running())) {
-        flush_timer_.start(flush_interval_);
-      }
+    if (UNLIKELY(not flush_timer_.is_running())) {
+      flush_timer_.start(flush_interval_);
     }
   }
 
@@ -165,16 +167,29 @@ namespace net {
       extern MAC::Addr linux_tap_device;
       dest_mac = linux_tap_device;
 #else
-      // If we don't have a cached IP, perform address resolution
-      auto cache_entry = cache_.find(next_hop);
-      if (UNLIKELY(cache_entry == cache_.end())) {
+      // If we don't have a valid cached IP, perform address resolution
+      auto* entry = cache_.lookup(next_hop);
+      if (UNLIKELY(entry == nullptr or entry->expired())) {
         PRINT("<ARP> No cache entry for IP %s.  Resolving. \n", next_hop.to_string().c_str());
+        if (entry != nullptr) {
+          // The entry was in use but expired before a refresh was answered
+          cache_stalls_++;
+          cache_.erase(next_hop);
+        }
+        cache_misses_++;
         await_resolution(std::move(pckt), next_hop);
         return;
       }
 
-      // Get MAC from cache
-      dest_mac = cache_[next_hop].mac();
+      cache_hits_++;
+      dest_mac = entry->mac();
+
+      // Revalidate in the background before the entry expires
+      const auto now = RTC::time_since_boot();
+      if (UNLIKELY(entry->needs_refresh(now))) {
+        entry->refreshing(now);
+        refresh(next_hop, *entry);
+      }
 #endif
 
       PRINT("<ARP> Found cache entry for IP %s -> %s \n",
@@ -240,19 +255,35 @@ namespace net {
   }
 
 
+  void Arp::refresh(ip4::Addr next_hop, Cache_entry& entry) {
+    PRINT("<ARP REFRESH> %s\n", next_hop.str().c_str());
+    cache_refreshes_++;
+
+    // A custom resolver knows best how to resolve
+    if (custom_resolver_) {
+      arp_resolver_(next_hop);
+      return;
+    }
+
+    // Unicast to the cached address, as recommended by RFC-1122 2.3.2.1
+    auto req = static_unique_ptr_cast<PacketArp>(inet_.create_packet());
+    req->init(mac_, inet_.ip_addr(), next_hop);
+
+    req->set_dest_mac(entry.mac());
+    req->set_opcode(H_request);
+
+    requests_tx_++;
+
+    linklayer_out_(std::move(req), entry.mac(), Ethertype::ARP);
+  }
+
+
   void Arp::flush_expired()
   {
     PRINT("<ARP> Flushing expired entries\n");
-    std::vector<ip4::Addr> expired;
-    for (auto ent : cache_) {
-      if (ent.second.expired()) {
-        expired.push_back(ent.first);
-      }
-    }
-
-    for (auto ip : expired) {
-      cache_.erase(ip);
-    }
+    cache_.erase_if([] (const ip4::Addr&, const Cache_entry& entry) {
+      return entry.expired();
+    });
 
     if (not cache_.empty()) {
       flush_timer_.start(flush_interval_);
@@ -1,6 +1,18 @@
-#include <net/ip4/ip4.hpp>
-#include <cassert>
-#include <rtc>
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
 
 //#define REASSEMBLY_DEBUG 1
 #ifdef REASSEMBLY_DEBUG
@@ -9,14 +21,17 @@
 #define PRINT(fmt, ...) /* fmt */
 #endif
 
+#include <net/inet>
+#include <net/ip4/ip4.hpp>
+#include <net/ip4/reassembly.hpp>
+#include <algorithm>
+#include <cstring>
+#include <statman>
 
 namespace net
 {
-  static const int REASSEMBLY_ENTRIES = 64;
-  static const int TIMEOUT = 15;
-  //static const int TTL_MAX = 163;
   static const int IP_ALIGN = 2;
-  static const int MAX_DATAGRAM = 65515;
+  static const int MAX_DATAGRAM = 65535;
 
   inline net::Packet_ptr create_packet(uint16_t length)
   {
@@ -28,212 +43,264 @@ namespace net
     return net::Packet_ptr(ptr);
   }
 
-  struct Entry
+  IP4::IP_packet_ptr IP4::reassemble(IP4::IP_packet_ptr packet)
   {
-    ip4::Addr src = IP4::ADDR_ANY;
-    Protocol proto;
-    uint16_t frag_id;
-    DSCP     dscp;
-    uint32_t received;
-    uint32_t total_length;
-    RTC::timestamp_t last_seen;
-    IP4::IP_packet_ptr buffer = nullptr;
-
-    Entry() = default;
-    inline Entry(RTC::timestamp_t, IP4::IP_packet&);
-
-    bool is_dead(RTC::timestamp_t now) const noexcept {
-      return src == IP4::ADDR_ANY || now - last_seen >= TIMEOUT;
-    }
-    bool matches(RTC::timestamp_t now, IP4::IP_packet& packet) const noexcept {
-      return is_dead(now) == false
-          && this->src == packet.ip_src()
-          && this->proto == packet.ip_protocol()
-          && this->frag_id == packet.ip_id();
-    }
-    void disable() { this->src = IP4::ADDR_ANY; }
+    assert(packet != nullptr);
+    if (UNLIKELY(reassembly_ == nullptr))
+      reassembly_ = std::make_unique<ip4::Reassembly>(stack_.ifname());
+    return reassembly_->process(std::move(packet), RTC::time_since_boot());
+  }
 
-    IP4::IP_packet_ptr assemble_from(IP4::IP_packet&);
+  void IP4::set_reassembly_config(ip4::Reassembly::Config config)
+  {
+    if (reassembly_ == nullptr)
+      reassembly_ = std::make_unique<ip4::Reassembly>(stack_.ifname(), config);
+    else
+      reassembly_->set_config(config);
+  }
 
-    auto release() {
-      this->src = IP4::ADDR_ANY;
-      return std::move(buffer);
-    }
-  };
-  IP4::IP_packet_ptr Entry::assemble_from(IP4::IP_packet& packet)
+namespace ip4
+{
+  Reassembly::Reassembly(const std::string& stat_prefix)
+    : Reassembly(stat_prefix, Config{})
+  {}
+
+  Reassembly::Reassembly(const std::string& stat_prefix, Config config)
+    : config_{config},
+      reassembled_{Statman::get().get_or_create(Stat::UINT64, stat_prefix + ".ip4.reassembled").get_uint64()},
+      timeouts_{Statman::get().get_or_create(Stat::UINT32, stat_prefix + ".ip4.reassembly_timeouts").get_uint32()},
+      dropped_{Statman::get().get_or_create(Stat::UINT32, stat_prefix + ".ip4.reassembly_dropped").get_uint32()}
   {
-    const int fragoff = packet.ip_frag_offs() * 8;
-    assert(fragoff >= 0);
-    // we don't allow non-initial fragments to start with
-    if (fragoff != 0 && this->buffer == nullptr) {
-      PRINT("-> Non-initial fragment in new buffer, dropping entry\n");
-      this->disable();
-      return nullptr;
+    Expects(config_.max_datagrams > 0 and config_.timeout > 0);
+    table_.reserve(config_.max_datagrams);
+  }
+
+  void Reassembly::set_config(Config config)
+  {
+    Expects(config.max_datagrams > 0 and config.timeout > 0);
+    table_.clear();
+    source_memory_.clear();
+    memory_ = 0;
+    expire_timer_.stop();
+    config_ = config;
+    table_.reserve(config_.max_datagrams);
+  }
+
+  void Reassembly::drop(Table::iterator it)
+  {
+    auto& dgram = it->second;
+    auto src = source_memory_.find(it->first.src);
+    if (src != source_memory_.end()) {
+      src->second -= dgram.memory;
+      if (src->second == 0)
+        source_memory_.erase(src);
     }
+    memory_ -= dgram.memory;
+    table_.erase(it);
 
-    if (fragoff == 0)
+    if (table_.empty())
+      expire_timer_.stop();
+  }
+
+  void Reassembly::expire(RTC::timestamp_t now)
+  {
+    for (auto it = table_.begin(); it != table_.end();)
     {
-      PRINT("Creating entry buffer\n");
-      // first fragment
-      try {
-        // NOTE: we can run out of memory here
-        auto raw = create_packet(MAX_DATAGRAM);
-        this->buffer = static_unique_ptr_cast<IP4::IP_packet> (std::move(raw));
+      if (now >= it->second.expires) {
+        PRINT("Reassembly: id=%u from %s timed out\n",
+              it->first.id, it->first.src.to_string().c_str());
+        timeouts_++;
+        auto next = std::next(it);
+        drop(it);
+        it = next;
       }
-      catch (std::exception&) {
-        return nullptr;
+      else {
+        ++it;
       }
-      // set header and options
-      buffer->set_ip_version(4);
-      buffer->set_ip_header_length(20);
-      buffer->set_ip_dscp(packet.ip_dscp());
-      buffer->set_ip_ecn(packet.ip_ecn());
-      buffer->set_ip_total_length(20);
-
-      buffer->set_ip_ttl(packet.ip_ttl());
-      buffer->set_protocol(packet.ip_protocol());
-      buffer->set_ip_checksum(0);
-
-      buffer->set_ip_src(packet.ip_src());
-      buffer->set_ip_dst(packet.ip_dst());
     }
-    else
+  }
+
+  void Reassembly::on_timeout()
+  {
+    expire(RTC::time_since_boot());
+    if (not table_.empty())
+      expire_timer_.start(std::chrono::seconds(config_.timeout));
+  }
+
+  Reassembly::IP_packet_ptr Reassembly::process(IP_packet_ptr packet, RTC::timestamp_t now)
+  {
+    // some basic validation
+    const int hlen = packet->ip_header_length();
+    const int len  = packet->ip_data_length();
+    if (UNLIKELY(len == 0)) return nullptr;
+    if (UNLIKELY(packet->ip_src() == IP4::ADDR_ANY)) return nullptr;
+
+    const bool last = packet->ip_flags() != ip4::Flags::MF;
+    // non-last fragments ...
+    if (not last)
     {
-      // verify member fields match
-      if (UNLIKELY(this->dscp != packet.ip_dscp())) {
-        PRINT("-> DSCP mismatch in entry, dropping entry\n");
-        this->disable();
-        return nullptr;
-      }
+      // must have length mult of 8
+      if (UNLIKELY(len % 8 != 0)) return nullptr;
+      // should be at least 400 octets long
+      if (UNLIKELY(len < 400)) return nullptr;
     }
-    // validate length
-    const int len = packet.ip_data_length();
-    if (this->received + len > MAX_DATAGRAM) {
-      PRINT("-> data overflow in entry (%u > %u), dropping entry\n",
-            this->received + len, MAX_DATAGRAM);
-      this->disable();
+
+    const int offset = packet->ip_frag_offs() * 8;
+    const int end    = offset + len;
+    if (UNLIKELY(hlen + end > MAX_DATAGRAM)) {
+      PRINT("-> datagram too large (%d), dropping fragment\n", hlen + end);
+      dropped_++;
       return nullptr;
     }
-    // add data, increase bytes received
-    auto* data = buffer->layer_begin() + buffer->ip_header_length();
-    auto* src_data = packet.layer_begin() + packet.ip_header_length();
-    std::memcpy(&data[fragoff], src_data, len);
-    this->received += len;
-
-    // when last fragment received, record total length
-    if (packet.ip_flags() != ip4::Flags::MF) {
-      this->total_length = fragoff + len;
-      PRINT("-> last fragment received, total length is %u\n",
-            this->total_length);
+
+    const Key key {packet->ip_src(), packet->ip_dst(), packet->ip_id(), packet->ip_protocol()};
+    auto it = table_.find(key);
+
+    if (it != table_.end() and now >= it->second.expires) {
+      timeouts_++;
+      drop(it);
+      it = table_.end();
     }
-    // if we've received all bytes,
-    if (this->total_length != 0)
+
+    if (it == table_.end())
     {
-      // if exact, we're done
-      if (this->received == this->total_length)
+      if (table_.size() >= config_.max_datagrams)
       {
-        buffer->set_ip_total_length(buffer->size());
-        buffer->set_ip_data_length(this->total_length);
-        PRINT("Shipping large packet (%u / %u)\n",
-              buffer->size(), buffer->bufsize());
-        return this->release();
+        expire(now);
+        // don't let new datagrams push out those in progress
+        if (table_.size() >= config_.max_datagrams) {
+          PRINT("-> reassembly table full, dropping fragment\n");
+          dropped_++;
+          return nullptr;
+        }
       }
-      else if (this->received > this->total_length)
-      {
-        // received too many bytes, possibly overlapping
-        PRINT("-> data overflow (%u > %u), dropping entry\n",
-              this->received, this->total_length);
-        this->disable();
+      it = table_.emplace(key, Datagram{}).first;
+      it->second.expires = now + config_.timeout;
+      if (not expire_timer_.is_running())
+        expire_timer_.start(std::chrono::seconds(config_.timeout));
+    }
+    auto& dgram = it->second;
+    PRINT("Reassembly on %s id=%u offset=%d len=%d\n",
+          key.src.to_string().c_str(), key.id, offset, len);
+
+    // enforce memory limits, counting the whole buffer a fragment occupies
+    const uint32_t cost = packet->bufsize();
+    auto& source = source_memory_[key.src];
+    if (UNLIKELY(memory_ + cost > config_.max_memory
+              or source + cost > config_.max_memory_per_source))
+    {
+      PRINT("-> memory limit reached for %s, dropping datagram\n",
+            key.src.to_string().c_str());
+      dropped_++;
+      if (source == 0) source_memory_.erase(key.src);
+      drop(it);
+      return nullptr;
+    }
+
+    // the last fragment determines the total length
+    if (last)
+    {
+      if (dgram.total != 0 and dgram.total != (uint32_t) end) {
+        PRINT("-> conflicting total length, dropping datagram\n");
+        dropped_++;
+        drop(it);
         return nullptr;
       }
+      dgram.total = end;
+    }
+    if (dgram.total != 0 and (uint32_t) end > dgram.total) {
+      PRINT("-> data beyond last fragment, dropping datagram\n");
+      dropped_++;
+      drop(it);
+      return nullptr;
     }
-    // otherwise, return nothing
-    return nullptr;
-  }
 
-  Entry::Entry(RTC::timestamp_t now, IP4::IP_packet& packet)
-    : frag_id(packet.ip_id()), received(0), total_length(0),
-      last_seen(now), buffer(nullptr)
-  {
-    this->src   = packet.ip_src();
-    this->proto = packet.ip_protocol();
-    this->dscp  = packet.ip_dscp();
-  }
+    // insert sorted on offset, rejecting overlaps (RFC 5722 applied to v4)
+    auto& frags = dgram.frags;
+    auto pos = std::lower_bound(frags.begin(), frags.end(), offset,
+      [] (const Fragment& frag, int off) { return frag.offset < off; });
 
-  struct Reassembly
-  {
-    Reassembly() = default;
-    std::array<Entry, REASSEMBLY_ENTRIES> entries {};
+    if (pos != frags.end() and pos->offset == offset and pos->length == len) {
+      // plain duplicate, e.g. retransmitted by a link layer
+      return nullptr;
+    }
+    const bool overlaps_prev = pos != frags.begin()
+        and std::prev(pos)->offset + std::prev(pos)->length > offset;
+    const bool overlaps_next = pos != frags.end() and end > pos->offset;
+    if (UNLIKELY(overlaps_prev or overlaps_next)) {
+      PRINT("-> overlapping fragment, dropping datagram\n");
+      dropped_++;
+      drop(it);
+      return nullptr;
+    }
+    if (last and pos != frags.end()) {
+      // fragments after the last one
+      dropped_++;
+      drop(it);
+      return nullptr;
+    }
 
-    int get_entry(RTC::timestamp_t, IP4::IP_packet&);
+    frags.insert(pos, Fragment{(uint16_t) offset, (uint16_t) len, std::move(packet)});
+    dgram.received += len;
+    dgram.memory   += cost;
+    source         += cost;
+    memory_        += cost;
 
-    IP4::IP_packet_ptr process(IP4::IP_packet_ptr packet);
-  };
-  static std::vector<std::pair<IP4&, Reassembly>> assemblies;
+    if (dgram.total == 0 or dgram.received != dgram.total)
+      return nullptr;
 
-  static inline auto& get_assembly(IP4& current)
-  {
-    for (auto& stk : assemblies) {
-      if (&stk.first == &current) return stk.second;
-    }
-    // create new
-    assemblies.emplace_back(current, Reassembly{});
-    return assemblies.back().second;
+    // all bytes received, without overlaps
+    auto result = assemble(dgram);
+    drop(it);
+    if (result != nullptr) reassembled_++;
+    else dropped_++;
+    return result;
   }
 
-  IP4::IP_packet_ptr IP4::reassemble(IP4::IP_packet_ptr packet)
+  Reassembly::IP_packet_ptr Reassembly::assemble(Datagram& dgram)
   {
-    assert(packet != nullptr);
-    auto& assembly = get_assembly(*this);
-    return assembly.process(std::move(packet));
-  }
+    auto& frags = dgram.frags;
+    Expects(not frags.empty() and frags.front().offset == 0);
 
-  int Reassembly::get_entry(RTC::timestamp_t now, IP4::IP_packet& packet)
-  {
-    // first fragment
-    if (packet.ip_frag_offs() == 0)
+    auto& head = frags.front().packet;
+    const int hlen   = head->ip_header_length();
+    const int needed = hlen + dgram.total;
+
+    IP_packet_ptr buffer;
+    size_t first = 0;
+    if (head->capacity() >= needed)
     {
-      // assign new entry
-      for (int i = 0; i < (int) entries.size(); i++) {
-        if (entries[i].is_dead(now)) {
-          entries[i] = Entry(now, packet);
-          return i;
-        }
-      }
-      // no free entries
-      return -1;
+      // the first fragment has room for everything
+      buffer = std::move(head);
+      first  = 1;
     }
-    // find matching entry
-    for (int i = 0; i < (int) entries.size(); i++)
+    else
     {
-      if (entries[i].matches(now, packet)) return i;
+      try {
+        // NOTE: we can run out of memory here
+        buffer = static_unique_ptr_cast<PacketIP4>(create_packet(needed));
+      }
+      catch (const std::bad_alloc&) {
+        return nullptr;
+      }
+      buffer->set_data_end(hlen);
+      std::memcpy(buffer->layer_begin(), head->layer_begin(), hlen);
     }
-    // no match, and we don't allow initial non-zero offsets
-    return -1;
-  }
 
-  IP4::IP_packet_ptr Reassembly::process(IP4::IP_packet_ptr packet)
-  {
-    // some basic validation
-    if (UNLIKELY(packet->ip_data_length() == 0)) return nullptr;
-    if (UNLIKELY(packet->ip_src() == IP4::ADDR_ANY)) return nullptr;
-    // non-last fragments ...
-    if (packet->ip_flags() == ip4::Flags::MF)
+    auto* data = buffer->layer_begin() + hlen;
+    for (size_t i = first; i < frags.size(); i++)
     {
-      // must have length mult of 8
-      if (UNLIKELY(packet->ip_data_length() % 8 != 0)) return nullptr;
-      // should be at least 400 octets long
-      if (UNLIKELY(packet->ip_data_length() < 400)) return nullptr;
+      auto& frag = frags[i];
+      std::memcpy(data + frag.offset, frag.packet->ip_data().data(), frag.length);
     }
-    // create timestamp used for timeouts
-    RTC::timestamp_t now = RTC::now();
-    // get entry for this fragment
-    int idx = this->get_entry(now, *packet);
-    if (idx < 0) return nullptr;
-    PRINT("Reassembly on %s  id=%u (entry %d)\n",
-          packet->ip_src().to_string().c_str(), packet->ip_id(), idx);
-
-    auto& entry = this->entries.at(idx);
-    return entry.assemble_from(*packet);
+    PRINT("Shipping large packet (%d bytes, %zu fragments)\n", needed, frags.size());
+
+    buffer->set_data_end(needed);
+    buffer->set_ip_total_length(needed);
+    buffer->set_ip_frag_off_flags(ip4::Flags::NONE, 0);
+    buffer->set_ip_checksum();
+    return buffer;
   }
-}
+
+} //< namespace ip4
+} //< namespace net
@@ -35,6 +35,11 @@ namespace net
   requests_tx_    {Statman::get().create(Stat::UINT32, inet.ifname() + ".ndp.requests_tx").get_uint32()},
   replies_rx_     {Statman::get().create(Stat::UINT32, inet.ifname() + ".ndp.replies_rx").get_uint32()},
   replies_tx_     {Statman::get().create(Stat::UINT32, inet.ifname() + ".ndp.replies_tx").get_uint32()},
+  cache_hits_     {Statman::get().create(Stat::UINT64, inet.ifname() + ".ndp.cache_hits").get_uint64()},
+  cache_misses_   {Statman::get().create(Stat::UINT64, inet.ifname() + ".ndp.cache_misses").get_uint64()},
+  cache_stalls_   {Statman::get().create(Stat::UINT64, inet.ifname() + ".ndp.cache_stalls").get_uint64()},
+  cache_evictions_{Statman::get().create(Stat::UINT64, inet.ifname() + ".ndp.cache_evictions").get_uint64()},
+  cache_refreshes_{Statman::get().create(Stat::UINT64, inet.ifname() + ".ndp.cache_refreshes").get_uint64()},
   inet_           {inet},
   host_params_    {},
   router_params_  {},
@@ -601,9 +606,8 @@ namespace net
   ip6::Addr Ndp::next_hop(const ip6::Addr& dst) const
   {
     // First check destination cache
-    auto search = dest_cache_.find(dst);
-    if(search != dest_cache_.end())
-      return search->second.next_hop();
+    if (const auto* entry = dest_cache_.find(dst); entry != nullptr)
+      return entry->next_hop();
 
     const ip6::Stateful_addr* match = nullptr;
     // Check prefix list (longest prefix match)
@@ -634,11 +638,7 @@ namespace net
 
   bool Ndp::lookup(ip6::Addr ip)
   {
-    auto entry = neighbour_cache_.find(ip);
-    if (entry != neighbour_cache_.end()) {
-      return true;
-    }
-    return false;
+    return neighbour_cache_.find(ip) != nullptr;
   }
 
   void Ndp::cache(ip6::Addr ip, uint8_t *ll_addr, NeighbourStates state, uint32_t flags, bool update)
@@ -652,22 +652,23 @@ namespace net
   void Ndp::cache(ip6::Addr ip, MAC::Addr mac, NeighbourStates state, uint32_t flags, bool update)
   {
     PRINT("Ndp Caching IP %s for %s\n", ip.str().c_str(), mac.str().c_str());
-    auto entry = neighbour_cache_.find(ip);
-    if (entry != neighbour_cache_.end()) {
+    auto* entry = neighbour_cache_.find(ip);
+    if (entry != nullptr) {
       PRINT("Cached entry found: %s recorded @ %zu. Updating timestamp\n",
-         entry->second.mac().str().c_str(), entry->second.timestamp());
-      if (entry->second.mac() != mac) {
-        neighbour_cache_.erase(entry);
-        neighbour_cache_.emplace(
-           std::make_pair(ip, Neighbour_Cache_entry{mac, state, flags})); // Insert
+         entry->mac().str().c_str(), entry->timestamp());
+      // A pending resolution must never clobber a known address
+      if (mac == MAC::EMPTY)
+        return;
+      if (entry->mac() != mac) {
+        neighbour_cache_.insert(ip, Neighbour_Cache_entry{mac, state, flags});
       } else if (update) {
-        entry->second.set_state(state);
-        entry->second.set_flags(flags);
-        entry->second.update();
+        entry->set_state(state);
+        entry->set_flags(flags);
+        entry->update();
       }
     } else {
-      neighbour_cache_.emplace(
-        std::make_pair(ip, Neighbour_Cache_entry{mac, state, flags})); // Insert
+      neighbour_cache_.insert(ip, Neighbour_Cache_entry{mac, state, flags});
+      cache_evictions_ = neighbour_cache_.evictions();
       if (UNLIKELY(not flush_neighbour_timer_.is_running())) {
         flush_neighbour_timer_.start(flush_interval_);
       }
@@ -676,12 +677,10 @@ namespace net
 
   void Ndp::dest_cache(ip6::Addr dest_ip, ip6::Addr next_hop)
   {
-    auto entry = dest_cache_.find(dest_ip);
-    if (entry != dest_cache_.end()) {
-      entry->second.update(next_hop);
+    if (auto* entry = dest_cache_.find(dest_ip); entry != nullptr) {
+      entry->update(next_hop);
     } else {
-      dest_cache_.emplace(std::make_pair(dest_ip,
-            Destination_Cache_entry{next_hop}));
+      dest_cache_.insert(dest_ip, Destination_Cache_entry{next_hop});
     }
   }
 
@@ -732,13 +731,9 @@ namespace net
   {
     //TODO: Better to have a list of destination
     // list entries inside router entries for faster cleanup
-    for(auto it = dest_cache_.begin(); it != dest_cache_.end(); )
-    {
-      if(it->second.next_hop() == ip)
-        it = dest_cache_.erase(it);
-      else
-        it++;
-    }
+    dest_cache_.erase_if([ip] (const ip6::Addr&, const Destination_Cache_entry& entry) {
+      return entry.next_hop() == ip;
+    });
   }
 
   void Ndp::flush_expired_routers()
@@ -763,16 +758,9 @@ namespace net
   void Ndp::flush_expired_neighbours()
   {
     PRINT("NDP: Flushing expired entries\n");
-    std::vector<IP6::addr> expired;
-    for (auto ent : neighbour_cache_) {
-      if (ent.second.expired()) {
-        expired.push_back(ent.first);
-      }
-    }
-
-    for (auto ip : expired) {
-      neighbour_cache_.erase(ip);
-    }
+    neighbour_cache_.erase_if([] (const ip6::Addr&, const Neighbour_Cache_entry& entry) {
+      return entry.expired();
+    });
 
     if (not neighbour_cache_.empty()) {
       flush_neighbour_timer_.start(flush_interval_);
@@ -812,16 +800,30 @@ namespace net
     Expects(pckt->size());
 
     if (mac == MAC::EMPTY) {
-      // If we don't have a cached IP, perform NDP sol
-      auto neighbour_cache_entry = neighbour_cache_.find(next_hop);
-      if (UNLIKELY(neighbour_cache_entry == neighbour_cache_.end())) {
+      // If we don't have a resolved cached IP, perform NDP sol
+      auto* entry = neighbour_cache_.lookup(next_hop);
+      if (UNLIKELY(entry == nullptr or not entry->resolved() or entry->expired())) {
         PRINT("NDP: No cache entry for IP %s.  Resolving. \n", next_hop.to_string().c_str());
+        if (entry != nullptr and entry->resolved()) {
+          // The entry was in use but expired before a refresh was answered
+          cache_stalls_++;
+          neighbour_cache_.erase(next_hop);
+        }
+        cache_misses_++;
         await_resolution(std::move(pckt), next_hop);
         return;
       }
 
-      // Get MAC from cache
-      mac = neighbour_cache_[next_hop].mac();
+      cache_hits_++;
+      mac = entry->mac();
+
+      // Revalidate in the background before the entry expires
+      const auto now = RTC::time_since_boot();
+      if (UNLIKELY(entry->needs_refresh(now))) {
+        entry->refreshing(now);
+        cache_refreshes_++;
+        ndp_resolver_(next_hop);
+      }
 
       PRINT("NDP: Found cache entry for IP %s -> %s \n",
           next_hop.to_string().c_str(), mac.to_string().c_str());
@@ -1,5 +1,11 @@
 #include <net/openssl/init.hpp>
 #include <net/openssl/tls_stream.hpp>
+#include <net/tls/session_cache.hpp>
+#include <net/tls/ticket_keys.hpp>
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
 #include <memdisk>
 #include <cassert>
 #define LOAD_FROM_MEMDISK
@@ -35,6 +41,88 @@ namespace openssl
     BIO_free(kbio);
   }
 
+  static const unsigned char SESSION_ID_CONTEXT[] = "includeos-https";
+
+  // the session ID is the cache key, the session is stored DER-encoded
+  static int new_session(SSL*, SSL_SESSION* sess)
+  {
+    unsigned int id_len = 0;
+    const auto* id = SSL_SESSION_get_id(sess, &id_len);
+    const int len = i2d_SSL_SESSION(sess, nullptr);
+    if (len <= 0) return 0;
+
+    std::string der(len, '\0');
+    auto* p = (unsigned char*) der.data();
+    i2d_SSL_SESSION(sess, &p);
+    net::tls::Session_cache::get().store({(const char*) id, id_len}, der);
+    // we don't keep a reference to the session
+    return 0;
+  }
+
+  static SSL_SESSION* get_session(SSL*, const unsigned char* id, int id_len, int* copy)
+  {
+    *copy = 0;
+    auto der = net::tls::Session_cache::get().find({(const char*) id, (size_t) id_len});
+    if (der.empty()) return nullptr;
+    const auto* p = (const unsigned char*) der.data();
+    return d2i_SSL_SESSION(nullptr, &p, der.size());
+  }
+
+  static void remove_session(SSL_CTX*, SSL_SESSION* sess)
+  {
+    unsigned int id_len = 0;
+    const auto* id = SSL_SESSION_get_id(sess, &id_len);
+    net::tls::Session_cache::get().remove({(const char*) id, id_len});
+  }
+
+  static int set_hmac_key(EVP_MAC_CTX* hctx, const net::tls::Ticket_keys::Key& key)
+  {
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] {
+      OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY,
+          (void*) key.hmac_key, sizeof(key.hmac_key)),
+      OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+      OSSL_PARAM_construct_end()
+    };
+    return EVP_MAC_CTX_set_params(hctx, params);
+  }
+
+  static int ticket_key(SSL*, unsigned char* name, unsigned char* iv,
+                        EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc)
+  {
+    auto& keys = net::tls::Ticket_keys::get();
+    if (enc)
+    {
+      const auto& key = keys.current();
+      if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1) return -1;
+      memcpy(name, key.name, sizeof(key.name));
+      if (EVP_EncryptInit_ex(cctx, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1
+          or set_hmac_key(hctx, key) != 1) return -1;
+      return 1;
+    }
+    const auto* key = keys.find(name);
+    // unknown or expired key: full handshake
+    if (key == nullptr) return 0;
+    if (set_hmac_key(hctx, *key) != 1
+        or EVP_DecryptInit_ex(cctx, EVP_aes_256_cbc(), nullptr, key->aes_key, iv) != 1)
+      return -1;
+    // ask for a new ticket when the key is no longer the current one
+    return (key == &keys.current()) ? 1 : 2;
+  }
+
+  static void enable_resumption(SSL_CTX* ctx)
+  {
+    SSL_CTX_set_session_id_context(ctx, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT)-1);
+    // keep sessions in the shared cache only
+    SSL_CTX_set_session_cache_mode(ctx,
+        SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx, new_session);
+    SSL_CTX_sess_set_get_cb(ctx, get_session);
+    SSL_CTX_sess_set_remove_cb(ctx, remove_session);
+    SSL_CTX_set_timeout(ctx, net::tls::Session_cache::get().lifetime().count());
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_key);
+  }
+
   SSL_CTX* create_server(const std::string& cert_file,
                          const std::string& key_file)
   {
@@ -74,6 +162,9 @@ namespace openssl
     /* Recommended to avoid SSLv2 & SSLv3 */
     SSL_CTX_set_options(ctx, SSL_OP_ALL|SSL_OP_NO_SSLv2|SSL_OP_NO_SSLv3);
 
+    /* Resume sessions by ID and by ticket */
+    enable_resumption(ctx);
+
     int error = ERR_get_error();
     if (error) {
       printf("Status: %s\n", ERR_error_string(error, nullptr));
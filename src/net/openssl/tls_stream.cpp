@@ -1,5 +1,7 @@
 #include <net/openssl/tls_stream.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 using namespace openssl;
 
@@ -7,9 +9,6 @@ TLS_stream::TLS_stream(SSL_CTX* ctx, Stream_ptr t, bool outgoing)
   : m_transport(std::move(t))
 {
   ERR_clear_error(); // prevent old errors from mucking things up
-  this->m_bio_rd = BIO_new(BIO_s_mem());
-  this->m_bio_wr = BIO_new(BIO_s_mem());
-  assert(ERR_get_error() == 0 && "Initializing BIOs");
   this->m_ssl = SSL_new(ctx);
   assert(this->m_ssl != nullptr);
   assert(ERR_get_error() == 0 && "Initializing SSL");
@@ -19,7 +18,7 @@ TLS_stream::TLS_stream(SSL_CTX* ctx, Stream_ptr t, bool outgoing)
   else
       SSL_set_connect_state(this->m_ssl);
 
-  SSL_set_bio(this->m_ssl, this->m_bio_rd, this->m_bio_wr);
+  this->install_bio();
 
   // always-on callbacks
   m_transport->on_data({this,&TLS_stream::handle_data});
@@ -32,11 +31,27 @@ TLS_stream::TLS_stream(SSL_CTX* ctx, Stream_ptr t, bool outgoing)
   }
 }
 TLS_stream::TLS_stream(Stream_ptr t, SSL* ssl, BIO* rd, BIO* wr)
-  : m_transport(std::move(t)), m_ssl(ssl), m_bio_rd(rd), m_bio_wr(wr)
+  : m_transport(std::move(t)), m_ssl(ssl)
 {
+  // move over what is still buffered in the memory BIOs
+  buffer_t input = nullptr;
+  if (const int pending = BIO_ctrl_pending(rd); pending > 0) {
+    input = net::StreamBuffer::construct_read_buffer(pending);
+    if (input) BIO_read(rd, input->data(), input->size());
+  }
+  if (const int pending = BIO_ctrl_pending(wr); pending > 0) {
+    m_wr_buffer = net::StreamBuffer::construct_write_buffer(pending);
+    if (m_wr_buffer) BIO_read(wr, m_wr_buffer->data(), m_wr_buffer->size());
+  }
+  // frees the memory BIOs
+  this->install_bio();
+
   // always-on callbacks
   m_transport->on_data({this, &TLS_stream::handle_data});
   m_transport->on_close({this, &TLS_stream::close_callback_once});
+
+  tls_perform_stream_write();
+  if (input) tls_read(std::move(input));
 }
 TLS_stream::~TLS_stream()
 {
@@ -44,24 +59,143 @@ TLS_stream::~TLS_stream()
   SSL_free(this->m_ssl);
 }
 
+BIO_METHOD* TLS_stream::bio_method()
+{
+  static BIO_METHOD* method = [] {
+    auto* meth = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,
+                              "IncludeOS TLS stream");
+    assert(meth != nullptr);
+    BIO_meth_set_read(meth, TLS_stream::bio_read);
+    BIO_meth_set_write(meth, TLS_stream::bio_write);
+    BIO_meth_set_ctrl(meth, TLS_stream::bio_ctrl);
+    BIO_meth_set_create(meth, [] (BIO* bio) -> int {
+      BIO_set_init(bio, 1);
+      return 1;
+    });
+    return meth;
+  }();
+  return method;
+}
+
+void TLS_stream::install_bio()
+{
+  this->m_bio = BIO_new(bio_method());
+  assert(this->m_bio != nullptr);
+  BIO_set_data(this->m_bio, this);
+  // the same BIO in both directions, owned by the SSL object
+  SSL_set_bio(this->m_ssl, this->m_bio, this->m_bio);
+  // read as much as is available, not one record header at a time
+  SSL_set_read_ahead(this->m_ssl, 1);
+  // retried writes come from the pending buffer, which may have moved
+  SSL_set_mode(this->m_ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+}
+
+int TLS_stream::bio_read(BIO* bio, char* out, int len)
+{
+  auto* self = static_cast<TLS_stream*> (BIO_get_data(bio));
+  BIO_clear_retry_flags(bio);
+  auto& buffer = self->m_rd_buffer;
+  if (buffer == nullptr or buffer->size() == self->m_rd_offset) {
+    buffer = nullptr;
+    self->m_rd_offset = 0;
+    BIO_set_retry_read(bio);
+    return -1;
+  }
+  const size_t n = std::min((size_t) len, buffer->size() - self->m_rd_offset);
+  std::memcpy(out, buffer->data() + self->m_rd_offset, n);
+  self->m_rd_offset += n;
+  // done with this buffer
+  if (self->m_rd_offset == buffer->size()) {
+    buffer = nullptr;
+    self->m_rd_offset = 0;
+  }
+  return n;
+}
+
+int TLS_stream::bio_write(BIO* bio, const char* in, int len)
+{
+  auto* self = static_cast<TLS_stream*> (BIO_get_data(bio));
+  BIO_clear_retry_flags(bio);
+  auto& buffer = self->m_wr_buffer;
+  if (buffer == nullptr) {
+    buffer = self->construct_write_buffer();
+    if (buffer == nullptr) {
+      BIO_set_retry_write(bio);
+      return -1;
+    }
+  }
+  try {
+    // room for a full record, so the usual write is one allocation
+    if (buffer->capacity() - buffer->size() < (size_t) len)
+      buffer->reserve(buffer->size() + std::max((size_t) len, RECORD_SIZE + RECORD_OVERHEAD));
+    buffer->insert(buffer->end(), in, in + len);
+  }
+  catch (std::bad_alloc&) {
+    BIO_set_retry_write(bio);
+    return -1;
+  }
+  return len;
+}
+
+long TLS_stream::bio_ctrl(BIO* bio, int cmd, long, void*)
+{
+  auto* self = static_cast<TLS_stream*> (BIO_get_data(bio));
+  switch (cmd)
+  {
+  case BIO_CTRL_FLUSH:
+      return 1;
+  case BIO_CTRL_PENDING:
+      return (self->m_rd_buffer) ? self->m_rd_buffer->size() - self->m_rd_offset : 0;
+  default:
+      return 0;
+  }
+}
+
 void TLS_stream::write(buffer_t buffer)
+{
+  this->write(buffer->data(), buffer->size());
+}
+
+void TLS_stream::write(const std::string& str)
+{
+  this->write(str.data(), str.size());
+}
+
+void TLS_stream::write(const void* data, const size_t len)
 {
   if (UNLIKELY(this->is_connected() == false)) {
     TLS_PRINT("::write() called on closed stream\n");
     return;
   }
-  int n = SSL_write(this->m_ssl, buffer->data(), buffer->size());
-  auto status = this->status(n);
-  if (status == STATUS_FAIL) {
+  ERR_clear_error();
+  int n = 0;
+  // coalesce small writes made from within our callbacks
+  if (m_pending != nullptr or (m_busy > 0 and len < RECORD_SIZE))
+  {
+    if (m_pending == nullptr) {
+      m_pending = net::StreamBuffer::construct_write_buffer();
+      if (m_pending) m_pending->reserve(RECORD_SIZE);
+    }
+    if (m_pending != nullptr) {
+      auto* buf = static_cast<const uint8_t*> (data);
+      m_pending->insert(m_pending->end(), buf, buf + len);
+      // sent when leaving the callback, unless there's a full record
+      if (m_busy > 0 and m_pending->size() < RECORD_SIZE) return;
+      n = flush_pending();
+    }
+    else {
+      n = encrypt(data, len);
+    }
+  }
+  else {
+    n = encrypt(data, len);
+  }
+
+  if (this->status(n) == STATUS_FAIL) {
     TLS_PRINT("::write() Fail status %d\n",n);
     this->close();
     return;
   }
-
-  do {
-    n = tls_perform_stream_write();
-  } while (n > 0);
-
   if (this->m_deferred_close) {
     TLS_PRINT("::write() close on m_deferred_close after tls_perform_stream_write\n");
     this->close();
@@ -69,40 +203,53 @@ void TLS_stream::write(buffer_t buffer)
   }
 }
 
-void TLS_stream::write(const std::string& str)
+int TLS_stream::encrypt(const void* data, const size_t len)
 {
-  //TODO handle failed alloc
-  write(net::StreamBuffer::construct_write_buffer(str.data(),str.data()+str.size()));
+  const int n = SSL_write(this->m_ssl, data, len);
+  if (n <= 0 and this->status(n) == STATUS_WANT_IO)
+  {
+    // retried later, with the same data
+    m_pending = net::StreamBuffer::construct_write_buffer();
+    if (m_pending) {
+      auto* buf = static_cast<const uint8_t*> (data);
+      m_pending->assign(buf, buf + len);
+    }
+  }
+  tls_perform_stream_write();
+  return n;
 }
 
-void TLS_stream::write(const void* data, const size_t len)
+int TLS_stream::flush_pending()
 {
-  //TODO handle failed alloc
-  auto* buf = static_cast<const uint8_t*> (data);
-  write(net::StreamBuffer::construct_write_buffer(buf, buf + len));
+  auto buffer = std::move(m_pending);
+  const int n = SSL_write(this->m_ssl, buffer->data(), buffer->size());
+  if (n <= 0 and this->status(n) == STATUS_WANT_IO) {
+    // keep it for the retry
+    m_pending = std::move(buffer);
+  }
+  tls_perform_stream_write();
+  return n;
 }
 
-int TLS_stream::decrypt(const void *indata, int size)
+void TLS_stream::leave_busy()
 {
-  int n = BIO_write(this->m_bio_rd, indata, size);
-  if (UNLIKELY(n < 0)) {
-    //TODO can we handle this more gracefully?
-    TLS_PRINT("BIO_write failed\n");
-    this->close();
-    return -1;
+  this->m_busy -= 1;
+  if (this->m_busy == 0 and m_pending != nullptr and this->is_connected())
+  {
+    const int n = flush_pending();
+    // callers check for deferred close
+    if (this->status(n) == STATUS_FAIL) this->m_deferred_close = true;
   }
+}
 
+int TLS_stream::decrypt()
+{
   // if we aren't finished initializing session
   if (UNLIKELY(!handshake_completed()))
   {
     int num = SSL_do_handshake(this->m_ssl);
     auto status = this->status(num);
-    // OpenSSL wants to write
-    if (status == STATUS_WANT_IO)
-    {
-      tls_perform_stream_write();
-    }
-    else if (status == STATUS_FAIL)
+    if (status == STATUS_FAIL)
     {
       if (num < 0) {
         TLS_PRINT("TLS_stream::SSL_do_handshake() returned %d\n", num);
@@ -113,12 +260,14 @@ int TLS_stream::decrypt(const void *indata, int size)
       this->close();
       return -1;
     }
+    // send what the handshake wrote
+    tls_perform_stream_write();
     // nothing more to do if still not finished
     if (handshake_completed() == false) return 0;
     // handshake success
     this->m_busy += 1;
     connected();
-    this->m_busy -= 1;
+    this->leave_busy();
 
     if (this->m_deferred_close) {
       TLS_PRINT("::read() close on m_deferred_close after tls_perform_stream_write\n");
@@ -126,23 +275,39 @@ int TLS_stream::decrypt(const void *indata, int size)
       return -1;
     }
   }
-  return n;
+  return 1;
 }
 
 int TLS_stream::send_decrypted()
 {
+  buffer_t buffer = nullptr;
+  size_t   used = 0;
   int n;
-  // read decrypted data
+  // read decrypted data, filling whole buffers
   do {
-    //TODO "increase the size or constructor based ??")
-    auto buffer=StreamBuffer::construct_read_buffer(8192);
-    if (!buffer) return 0;
-    n = SSL_read(this->m_ssl,buffer->data(),buffer->size());
+    if (buffer == nullptr) {
+      // only allocate once a record is decrypted, not for a partial one
+      char next;
+      n = SSL_peek(this->m_ssl, &next, 1);
+      if (n <= 0) break;
+      buffer = StreamBuffer::construct_read_buffer(RECORD_SIZE);
+      if (!buffer) return -1;
+      used = 0;
+    }
+    n = SSL_read(this->m_ssl, buffer->data() + used, buffer->size() - used);
     if (n > 0) {
-      buffer->resize(n);
-      enqueue_data(buffer);
+      used += n;
+      if (used == buffer->size()) {
+        enqueue_data(std::move(buffer));
+        buffer = nullptr;
+      }
     }
   } while (n > 0);
+
+  if (buffer != nullptr and used > 0) {
+    buffer->resize(used);
+    enqueue_data(std::move(buffer));
+  }
   return n;
 }
 
@@ -152,7 +317,7 @@ void TLS_stream::handle_read_congestion()
   send_decrypted(); //decrypt any incomplete
   this->m_busy += 1;
   signal_data(); //send any pending
-  this->m_busy -= 1;
+  this->leave_busy();
 
   if (this->m_deferred_close) {
     TLS_PRINT("::read() close on m_deferred_close after tls_perform_stream_write\n");
@@ -165,7 +330,13 @@ void TLS_stream::handle_write_congestion()
 {
   //this should resolve the potential malloc congestion
   //might be missing some TLS signalling but without malloc we cant do that either
-  while(tls_perform_stream_write() >  0);
+  if (m_pending != nullptr and this->is_connected()) {
+    if (this->status(flush_pending()) == STATUS_FAIL) {
+      this->close();
+      return;
+    }
+  }
+  tls_perform_stream_write();
 }
 void TLS_stream::handle_data()
 {
@@ -176,7 +347,7 @@ void TLS_stream::handle_data()
     }
     auto buffer = m_transport->read_next();
     if (UNLIKELY(!buffer)) break;
-    const bool closed = tls_read(buffer);
+    const bool closed = tls_read(std::move(buffer));
     // tls_read can close this stream
     if (closed) break;
     assert(m_transport != nullptr);
@@ -187,65 +358,62 @@ bool TLS_stream::tls_read(buffer_t buffer)
 {
   assert(buffer != nullptr);
   ERR_clear_error();
-  uint8_t* buf_ptr = buffer->data();
-  int      len = buffer->size();
-
-  while (len > 0)
-  {
-    if (this->m_deferred_close) {
-      TLS_PRINT("::read() close on m_deferred_close");
-      this->close();
-      return true;
-    }
+  if (this->m_deferred_close) {
+    TLS_PRINT("::read() close on m_deferred_close");
+    this->close();
+    return true;
+  }
+  // the BIO reads the ciphertext straight out of the buffer
+  if (LIKELY(m_rd_buffer == nullptr)) {
+    m_rd_buffer = std::move(buffer);
+    m_rd_offset = 0;
+  }
+  else {
+    // left over from read congestion
+    m_rd_buffer->insert(m_rd_buffer->end(), buffer->begin(), buffer->end());
+  }
 
-    const int decrypted_bytes = decrypt(buf_ptr, len);
-    if (UNLIKELY(decrypted_bytes == 0)) {
-      return false;
-    }
-    else if (UNLIKELY(decrypted_bytes < 0)) {
-      return true;
-    }
-    buf_ptr += decrypted_bytes;
-    len -= decrypted_bytes;
+  const int res = decrypt();
+  if (UNLIKELY(res == 0)) {
+    return false;
+  }
+  else if (UNLIKELY(res < 0)) {
+    return true;
+  }
 
-    // enqueues decrypted data
-    int ret = send_decrypted();
+  // enqueues decrypted data
+  int ret = send_decrypted();
+  // alerts and post-handshake messages
+  tls_perform_stream_write();
 
-    // this goes here?
-    if (UNLIKELY(this->is_closing() || this->is_closed())) {
-      TLS_PRINT("TLS_stream::SSL_read closed during read\n");
-      return true;
-    }
-    if (this->m_deferred_close) {
-      TLS_PRINT("::read() close on m_deferred_close");
-      this->close();
-      return true;
-    }
+  // this goes here?
+  if (UNLIKELY(this->is_closing() || this->is_closed())) {
+    TLS_PRINT("TLS_stream::SSL_read closed during read\n");
+    return true;
+  }
+  if (this->m_deferred_close) {
+    TLS_PRINT("::read() close on m_deferred_close");
+    this->close();
+    return true;
+  }
 
+  // out of memory: the rest is decrypted when congestion is handled
+  if (LIKELY(not this->read_congested()))
+  {
     auto status = this->status(ret);
-    // did peer request stream renegotiation?
-    if (status == STATUS_WANT_IO)
-    {
-      TLS_PRINT("::read() STATUS_WANT_IO\n");
-      int ret;
-      do {
-        ret = tls_perform_stream_write();
-      } while (ret > 0);
-    }
-    else if (status == STATUS_FAIL)
+    if (status == STATUS_FAIL)
     {
       TLS_PRINT("::read() close on STATUS_FAIL after tls_perform_stream_write\n");
       this->close();
       return true;
     }
-
-  } // while it < end
+  }
 
   //forward data
   this->m_busy += 1;
   TLS_PRINT("::read() signalling data available (busy=%d)\n", this->m_busy);
   signal_data();
-  this->m_busy -= 1;
+  this->leave_busy();
   assert(this->m_transport != nullptr);
 
   // check deferred closing
@@ -259,41 +427,19 @@ bool TLS_stream::tls_read(buffer_t buffer)
 
 int TLS_stream::tls_perform_stream_write()
 {
-  ERR_clear_error();
-  int pending = BIO_ctrl_pending(this->m_bio_wr);
-  if (pending > 0)
+  if (m_wr_buffer == nullptr) return 0;
+  // hand the records over to the transport's write queue
+  auto buffer = std::move(m_wr_buffer);
+  const int n = buffer->size();
+  TLS_PRINT("::tls_perform_stream_write() %d bytes\n", n);
+  //What if we cant write..
+  if (m_transport->is_writable())
   {
-    TLS_PRINT("::tls_perform_stream_write() pending=%d bytes\n",pending);
-    auto buffer = net::StreamBuffer::construct_write_buffer(pending);
-    if (buffer == nullptr) {
-      return 0;
-    }
-    int n = BIO_read(this->m_bio_wr, buffer->data(), buffer->size());
-    assert(n == pending);
-    //What if we cant write..
-    if (m_transport->is_writable())
-    {
-      m_transport->write(buffer);
-
-      this->m_busy += 1;
-      stream_on_write(n);
-      this->m_busy -= 1;
-    }
-
-    if (UNLIKELY((pending = BIO_ctrl_pending(this->m_bio_wr)) > 0))
-    {
-      return pending;
-    }
-    return 0;
-  }
-
-  BIO_read(this->m_bio_wr, nullptr, 0);
+    m_transport->write(std::move(buffer));
 
-  if (!BIO_should_retry(this->m_bio_wr))
-  {
-    TLS_PRINT("::tls_perform_stream_write() close on !BIO_should_retry\n");
-    this->close();
-    return -1;
+    this->m_busy += 1;
+    stream_on_write(n);
+    this->leave_busy();
   }
   return 0;
 }
@@ -301,19 +447,13 @@ int TLS_stream::tls_perform_stream_write()
 int TLS_stream::tls_perform_handshake()
 {
   ERR_clear_error(); // prevent old errors from mucking things up
-  // will return -1:SSL_ERROR_WANT_WRITE
+  // will return -1:SSL_ERROR_WANT_READ
   int ret = SSL_do_handshake(this->m_ssl);
   int n = this->status(ret);
   ERR_print_errors_fp(stderr);
   if (n == STATUS_WANT_IO)
   {
-    do {
-      n = tls_perform_stream_write();
-      if (n < 0) {
-        TLS_PRINT("TLS_stream::tls_perform_handshake() stream write failed\n");
-      }
-    } while (n > 0);
-    return n;
+    return tls_perform_stream_write();
   }
   else {
     TLS_PRINT("TLS_stream::tls_perform_handshake() returned %d\n", ret);
@@ -330,6 +470,14 @@ void TLS_stream::close()
     TLS_PRINT("::close() deferred\n");
     this->m_deferred_close = true; return;
   }
+  // send what was coalesced before closing
+  if (m_pending != nullptr and this->is_connected()) {
+    this->m_busy += 1;
+    auto buffer = std::move(m_pending);
+    SSL_write(this->m_ssl, buffer->data(), buffer->size());
+    tls_perform_stream_write();
+    this->m_busy -= 1;
+  }
   CloseCallback func = getCloseCallback();
   this->reset_callbacks();
   if (m_transport->is_connected())
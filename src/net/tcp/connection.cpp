@@ -23,6 +23,7 @@
 #include <net/tcp/connection_states.hpp>
 #include <net/tcp/tcp.hpp>
 #include <net/tcp/tcp_errors.hpp>
+#include <rtc>
 
 using namespace net::tcp;
 using namespace std;
@@ -42,6 +43,7 @@ Connection::Connection(TCP& host, Socket local, Socket remote, ConnectCallback c
     timewait_dack_timer({this, &Connection::dack_timeout}),
     recv_wnd_getter{nullptr},
     queued_(false),
+    rack_timer_({this, &Connection::rack_timeout}),
     dack_{0},
     last_ack_sent_{cb.RCV.NXT},
     smss_{MSS()}
@@ -148,6 +150,7 @@ void Connection::reset_callbacks()
   writeq.on_write(nullptr);
   on_close_.reset();
   recv_wnd_getter.reset();
+  on_read_chain_.reset();
   if(read_request) {
     read_request->on_read_callback.reset();
     read_request->on_data_callback.reset();
@@ -288,6 +291,9 @@ void Connection::writeq_reset() {
   debug2("<Connection::writeq_reset> Reseting.\n");
   writeq.reset();
   rtx_timer.stop();
+  rack_timer_.stop();
+  if(scoreboard_)
+    scoreboard_->clear();
 }
 
 void Connection::open(bool active)
@@ -331,6 +337,8 @@ void Connection::update_fin(const Packet_view& pkt)
   // as long as fin do not change (which it absolutely shouldnt)
   fin_recv_ = true;
   fin_seq_  = pkt.end();
+  // the peer is done sending, hand over what is pending
+  deliver_chain();
 }
 
 void Connection::handle_fin()
@@ -439,6 +447,20 @@ void Connection::transmit(Packet_view_ptr packet) {
   if(packet->isset(ACK))
     last_ack_sent_ = cb.RCV.NXT;
 
+  // keep track of sent data for SACK based recovery
+  if(sack_perm and packet->has_tcp_data())
+  {
+    if(UNLIKELY(scoreboard_ == nullptr))
+      scoreboard_ = std::make_unique<Scoreboard>();
+    scoreboard_->on_send(packet->seq(), packet->end(), sack_clock());
+    // [RFC 8985] 7.2 schedule a probe timeout when sending new data
+    if(not rack_timer_.is_running() and not tlp_pending_ and not in_loss_recovery())
+    {
+      rack_reo_armed_ = false;
+      rack_timer_.start(probe_timeout());
+    }
+  }
+
   //printf("<Connection::transmit> TX %s\n%s\n", packet->to_string().c_str(), to_string().c_str());
 
   host_.transmit(std::move(packet));
@@ -464,7 +486,10 @@ bool Connection::handle_ack(const Packet_view& in)
   if(UNLIKELY(is_dup_ack(in, true_win)))
   {
     dup_acks_++;
-    on_dup_ack(in);
+    if(scoreboard_ != nullptr)
+      sack_ack(in, true);
+    else
+      on_dup_ack(in);
     return false;
   } // < dup ack
 
@@ -504,9 +529,12 @@ bool Connection::handle_ack(const Packet_view& in)
 
   take_rtt_measure(in);
 
-  // do either congctrl or fastrecov according to New Reno
-  (not fast_recovery_)
-    ? congestion_control(in) : fast_recovery(in);
+  // SACK based recovery if there is a scoreboard,
+  // else do either congctrl or fastrecov according to New Reno
+  if(scoreboard_ != nullptr)
+    sack_ack(in, false);
+  else
+    (not fast_recovery_) ? congestion_control(in) : fast_recovery(in);
 
   dup_acks_ = 0;
 
@@ -697,6 +725,211 @@ void Connection::on_dup_ack(const Packet_view& in)
   }
 }
 
+uint32_t Connection::sack_clock() noexcept
+{
+  // the timestamp clock is too coarse for RACK
+  return RTC::nanos_now() / 1000000;
+}
+
+void Connection::sack_ack(const Packet_view& in, const bool dup)
+{
+  // blocks are at most 4 [RFC 2018]
+  std::array<sack::Block, 4> blocks;
+  size_t n = 0;
+  if(const auto* opt = in.parse_sack_option(); opt != nullptr)
+  {
+    n = std::min(blocks.size(), (size_t)(opt->length - 2) / sizeof(sack::Block));
+    std::memcpy(blocks.data(), opt->val, n * sizeof(sack::Block));
+    for(size_t i = 0; i < n; i++)
+      blocks[i].swap_endian();
+  }
+
+  const auto now = sack_clock();
+  scoreboard_->on_ack(cb.SND.UNA, blocks.data(), n, now);
+
+  // [RFC 8985] 7.4 the probe (or what it probed for) has been delivered
+  if(tlp_pending_ and static_cast<int32_t>(cb.SND.UNA - tlp_end_seq_) >= 0)
+    tlp_pending_ = false;
+
+  // [RFC 6675] 5 (B) leave recovery when everything up to recover is acked
+  if(in_loss_recovery() and static_cast<int32_t>(cb.SND.UNA - cb.recover) >= 0)
+  {
+    if(fast_recovery_)
+      finish_fast_recovery();
+    rto_recovery_ = false;
+  }
+
+  const auto reo_timeout = scoreboard_->detect_loss(now, in_loss_recovery());
+
+  if(scoreboard_->has_lost() and not in_loss_recovery())
+  {
+    sack_enter_recovery();
+  }
+  else if(not in_loss_recovery())
+  {
+    // limited transmit (dup_acks_ < 3) and regular congestion control
+    if(dup)
+    {
+      if(dup_acks_ < 3)
+        on_dup_ack(in);
+    }
+    else
+    {
+      congestion_control(in);
+    }
+  }
+  else if(rto_recovery_ and not dup)
+  {
+    // slow start from the reduced window after a timeout
+    reno_increase_cwnd(highest_ack_ - prev_highest_ack_);
+  }
+
+  if(in_loss_recovery())
+    sack_send();
+
+  rack_arm(reo_timeout);
+}
+
+void Connection::sack_enter_recovery()
+{
+  debug("<Connection::sack_enter_recovery> Enter Recovery %u - Pipe: %u\n",
+    cb.SND.NXT, scoreboard_->pipe());
+  cb.recover = cb.SND.NXT;
+  reduce_ssthresh();
+  cb.cwnd = cb.ssthresh;
+  fast_recovery_ = true;
+  tlp_pending_ = false;
+}
+
+void Connection::sack_send()
+{
+  while(scoreboard_->pipe() + SMSS() <= cb.cwnd)
+  {
+    const auto* seg = scoreboard_->next_lost();
+    if(seg == nullptr or not sack_retransmit(seg->start, seg->end))
+      break;
+  }
+  send_much();
+}
+
+bool Connection::sack_retransmit(const seq_t start, const seq_t end)
+{
+  auto packet = create_outgoing_packet();
+  packet->set_flag(ACK);
+
+  uint32_t offset = start - cb.SND.UNA;
+  size_t left = end - start;
+  while(left)
+  {
+    const auto data = writeq.data_at(offset);
+    if(data.first == nullptr)
+      break;
+    const auto n = fill_packet(*packet, data.first, std::min(left, data.second));
+    if(n == 0)
+      break;
+    offset += n;
+    left -= n;
+  }
+  if(not packet->has_tcp_data())
+    return false;
+
+  packet->set_seq(start);
+  packet->set_flag(PSH);
+  scoreboard_->on_retransmit(start, sack_clock());
+
+  if(!rtx_timer.is_running())
+    rtx_start();
+
+  debug("<Connection::sack_retransmit> RTX: %s\n", packet->to_string().c_str());
+  host_.transmit(std::move(packet));
+  return true;
+}
+
+void Connection::rack_arm(const uint32_t reo_timeout)
+{
+  if(scoreboard_->empty())
+  {
+    rack_timer_.stop();
+    return;
+  }
+
+  if(reo_timeout > 0)
+  {
+    rack_reo_armed_ = true;
+    rack_timer_.restart(std::chrono::milliseconds{reo_timeout});
+  }
+  else if(not tlp_pending_ and not in_loss_recovery())
+  {
+    rack_reo_armed_ = false;
+    rack_timer_.restart(probe_timeout());
+  }
+  else
+  {
+    rack_timer_.stop();
+  }
+}
+
+void Connection::rack_timeout()
+{
+  if(scoreboard_ == nullptr or scoreboard_->empty())
+    return;
+
+  const auto reo_timeout = scoreboard_->detect_loss(sack_clock(), in_loss_recovery());
+
+  if(scoreboard_->has_lost())
+  {
+    if(not in_loss_recovery())
+      sack_enter_recovery();
+    sack_send();
+    rack_arm(reo_timeout);
+  }
+  // reordering window has not passed yet, or it passed
+  // without loss and it's time for a probe timeout
+  else if(reo_timeout > 0 or rack_reo_armed_)
+  {
+    rack_arm(reo_timeout);
+  }
+  else if(not in_loss_recovery() and not tlp_pending_)
+  {
+    tail_loss_probe();
+  }
+}
+
+std::chrono::milliseconds Connection::probe_timeout() const
+{
+  using namespace std::chrono;
+  if(rttm.samples == 0)
+    return milliseconds{1000};
+
+  auto pto = 2 * duration_cast<milliseconds>(rttm.SRTT);
+  // a single segment in flight may be held by a delayed ACK
+  if(flight_size() <= SMSS())
+    pto += milliseconds{200};
+  return std::min(pto, rttm.rto_ms());
+}
+
+void Connection::tail_loss_probe()
+{
+  // prefer new data, else probe with the last segment
+  if(writeq.has_remaining_requests() and cb.SND.WND >= SMSS())
+  {
+    limited_tx();
+  }
+  else if(const auto* seg = scoreboard_->last_unsacked(); seg != nullptr)
+  {
+    if(not sack_retransmit(seg->start, seg->end))
+      return;
+  }
+  else
+  {
+    return;
+  }
+  debug("<Connection::tail_loss_probe> TLP sent, NXT=%u\n", cb.SND.NXT);
+  tlp_pending_ = true;
+  tlp_end_seq_ = cb.SND.NXT;
+  rtx_reset();
+}
+
 /*
   [RFC 6298]
 
@@ -750,11 +983,20 @@ uint32_t Connection::calculate_rcv_wnd() const
 
   const auto& rbuf = read_request->front();
   auto remaining = rbuf.capacity() - rbuf.size();
+  // data held in packets takes up buffer space as well
+  remaining -= std::min(remaining, rx_chain_bytes_);
 
   auto buf_avail = bufalloc->allocatable() + remaining;
   auto reserve   = (host_.max_bufsize() * Read_request::buffer_limit);
   auto win = buf_avail > reserve ? buf_avail - reserve : 0;
 
+  // no more than the (tuned) receive buffer has room for
+  if(rcvbuf_ != 0)
+  {
+    const auto buffered = read_request->size() + rx_chain_bytes_;
+    win = std::min(win, (rcvbuf_ > buffered) ? rcvbuf_ - buffered : 0);
+  }
+
   return (win < SMSS()) ? 0 : win; // Avoid small silly windows
 
   // REPORT CHUNKWISE
@@ -860,8 +1102,17 @@ void Connection::recv_data(const Packet_view& in)
     // since user callback can result in sending new data, which means we
     // want to ACK the data recv at the same time
     cb.RCV.NXT += length;
+
+    if(rcvbuf_ != 0)
+      rcvbuf_adjust();
     // only actually recv the data if there is a read request (created with on_read)
-    if(read_request != nullptr)
+    if(read_request != nullptr and on_read_chain_ != nullptr
+       and read_request->size() == 0 and (sack_list == nullptr or sack_list->size() == 0))
+    {
+      // nothing is waiting to be reassembled, hand over the packet itself
+      recv_chain(in, length);
+    }
+    else if(read_request != nullptr)
     {
       const auto recv = read_request->insert(in.seq(), in.tcp_data(), length, in.isset(PSH));
       // this ensures that the data we ACK is actually put in our buffer.
@@ -884,6 +1135,68 @@ void Connection::recv_data(const Packet_view& in)
   // [RFC 5681] ???
 }
 
+void Connection::set_rcvbuf(size_t size)
+{
+  rcvbuf_ = size;
+  // room for the read buffers on top, see calculate_rcv_wnd
+  if(bufalloc != nullptr)
+    bufalloc->set_capacity((size != 0) ? size + host_.max_bufsize() * Read_request::buffer_limit : 0);
+}
+
+void Connection::rcvbuf_adjust()
+{
+  // prefer the sender side RTT, the tuner measures one otherwise
+  const uint32_t srtt = (rttm.samples > 0)
+    ? std::max<uint32_t>(rttm.SRTT.count() * 1000, 1) : 0;
+  const auto target = rcvbuf_tuner_.on_data(host_.now_ms(), cb.RCV.NXT, cb.RCV.WND, srtt);
+  if(target > rcvbuf_ and not host_.memory_pressure())
+    set_rcvbuf(std::min<size_t>(target, host_.max_rcvbuf()));
+}
+
+void Connection::rcvbuf_reclaim(uint32_t now, uint32_t idle)
+{
+  if(not rcvbuf_tuner_.idle(now, idle))
+    return;
+
+  if(rcvbuf_ > host_.rcvbuf())
+  {
+    set_rcvbuf(host_.rcvbuf());
+    rcvbuf_tuner_.restart();
+  }
+  if(read_request != nullptr)
+    read_request->shrink();
+}
+
+void Connection::recv_chain(const Packet_view& in, size_t length)
+{
+  // the packet is kept by TCP::receive once the segment is handled
+  rx_chain_.emplace_back(host_.hold_rx_packet(), in.tcp_data(), length);
+  rx_chain_bytes_ += length;
+  // the read buffer continues after this data
+  read_request->set_start(cb.RCV.NXT);
+
+  if(in.isset(PSH) or rx_chain_bytes_ >= host_.max_bufsize())
+    deliver_chain();
+}
+
+void Connection::recv_chain_buffer(buffer_t buf)
+{
+  rx_chain_bytes_ += buf->size();
+  rx_chain_.emplace_back(std::move(buf));
+  deliver_chain();
+}
+
+void Connection::deliver_chain()
+{
+  if(rx_chain_.empty() or on_read_chain_ == nullptr)
+    return;
+  // the callback may close the connection, so don't touch it after
+  auto chain = std::move(rx_chain_);
+  rx_chain_.clear();
+  rx_chain_bytes_ = 0;
+  on_read_chain_(std::move(chain));
+}
+
 // This function need to sync both SACK and the read buffer, meaning:
 // * Data cannot be old segments (already acked)
 // * Data cannot be duplicate (already S-acked)
@@ -1127,8 +1440,13 @@ void Connection::rtx_timeout() {
     return;
   }
 
-  // retransmit SND.UNA
-  retransmit();
+  // with SACK everything outstanding is considered lost [RFC 6675] 5.1,
+  // and retransmitted through the scoreboard below
+  const bool sack_rto = scoreboard_ != nullptr and not scoreboard_->empty();
+  if(sack_rto)
+    scoreboard_->mark_all_lost();
+  else // retransmit SND.UNA
+    retransmit();
   rtx_attempt_++;
 
   // "back off" timer
@@ -1181,10 +1499,18 @@ void Connection::rtx_timeout() {
   /*
     NOTE: It's unclear which one comes first, or if finish_fast_recovery includes changing the cwnd.
   */
+
+  if(sack_rto)
+  {
+    rto_recovery_ = true;
+    tlp_pending_ = false;
+    rack_timer_.stop();
+    sack_send();
+  }
 }
 
-seq_t Connection::generate_iss() {
-  return TCP::generate_iss();
+seq_t Connection::generate_iss() const {
+  return host_.generate_iss(local_, remote_);
 }
 
 void Connection::set_state(State& state) {
@@ -1258,6 +1584,7 @@ void Connection::signal_close()
 void Connection::clean_up() {
   // clear timers if active
   rtx_clear();
+  rack_timer_.stop();
   if(timewait_dack_timer.is_running())
     timewait_dack_timer.stop();
 
@@ -1266,6 +1593,8 @@ void Connection::clean_up() {
   on_disconnect_.reset();
   on_close_.reset();
   recv_wnd_getter.reset();
+  on_read_chain_.reset();
+  rx_chain_.clear();
   if(read_request) {
     read_request->on_read_callback.reset();
     read_request->on_data_callback.reset();
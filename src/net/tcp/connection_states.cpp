@@ -375,7 +375,7 @@ void Connection::Closed::open(Connection& tcp, bool active) {
     // There is a remote host
     if(!tcp.remote().is_empty()) {
       auto& tcb = tcp.tcb();
-      tcb.init();
+      tcb.init(tcp.generate_iss());
       auto packet = tcp.outgoing_packet();
       packet->set_seq(tcb.ISS).set_flag(SYN);
 
@@ -397,7 +397,7 @@ void Connection::Closed::open(Connection& tcp, bool active) {
 void Connection::Listen::open(Connection& tcp, bool) {
   if(!tcp.remote().is_empty()) {
     auto& tcb = tcp.tcb();
-    tcb.init();
+    tcb.init(tcp.generate_iss());
     auto packet = tcp.outgoing_packet();
     packet->set_seq(tcb.ISS).set_flag(SYN);
     tcb.SND.UNA = tcb.ISS;
@@ -644,7 +644,7 @@ State::Result Connection::Listen::handle(Connection& tcp, Packet_view& in) {
     auto& tcb = tcp.tcb();
     tcb.RCV.NXT   = in.seq()+1;
     tcb.IRS       = in.seq();
-    tcb.init();
+    tcb.init(tcp.generate_iss());
     tcb.SND.NXT   = tcb.ISS+1;
     tcb.SND.UNA   = tcb.ISS;
     debug("<Connection::Listen::handle> Received SYN Packet: %s TCB Updated:\n %s \n",
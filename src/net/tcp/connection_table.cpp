@@ -0,0 +1,171 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tcp/connection_table.hpp>
+#include <kernel/rng.hpp>
+#include <util/bitops.hpp>
+#include <expects>
+
+namespace net {
+namespace tcp {
+
+// fold the 128-bit product of a and b
+static inline uint64_t mix(uint64_t a, uint64_t b) noexcept
+{
+  const auto r = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+Connection_table::Connection_table(size_t capacity)
+{
+  Expects(capacity > 0);
+  const auto buckets = util::bits::next_pow2(
+      util::bits::multip<BUCKET_SLOTS>(capacity * 8 / 7 + 1));
+  buckets_.resize(buckets);
+  rng_extract(key_, sizeof(key_));
+}
+
+uint64_t Connection_table::hash(const Socket& local, const Socket& remote) const noexcept
+{
+  const auto& l = local.address().v6();
+  const auto& r = remote.address().v6();
+  const uint64_t ports = (uint64_t(local.port()) << 16) | remote.port();
+  // chained, so (a, b) and (b, a) hash differently
+  auto h = mix(l.i64[0] ^ key_[0], l.i64[1] ^ 0xa0761d6478bd642fULL);
+  h = mix(h ^ r.i64[0] ^ key_[1], r.i64[1] ^ 0xe7037ed1a0b428dbULL);
+  return mix(h ^ ports ^ key_[2], 0x8ebc6af09c88c6e3ULL);
+}
+
+const Connection_ptr* Connection_table::find(const Tuple& tuple, uint64_t hash) const noexcept
+{
+  const auto t = tag(hash);
+  auto idx = hash & mask();
+  for(size_t probes = 0; probes < buckets_.size(); probes++)
+  {
+    const auto& bucket = buckets_[idx];
+    for(size_t i = 0; i < BUCKET_SLOTS; i++)
+    {
+      if(bucket.tags[i] == t)
+      {
+        const auto& entry = entries_[bucket.slots[i]];
+        if(entry.hash == hash and entry.tuple == tuple)
+          return &entry.conn;
+      }
+    }
+    if(bucket.overflow == 0)
+      break;
+    idx = (idx + 1) & mask();
+  }
+  return nullptr;
+}
+
+bool Connection_table::insert(const Tuple& tuple, uint64_t hash, Connection_ptr conn)
+{
+  Expects(conn != nullptr);
+  if(find(tuple, hash) != nullptr)
+    return false;
+
+  if(size_ + 1 > capacity())
+    grow();
+
+  uint32_t slot;
+  if(not free_.empty())
+  {
+    slot = free_.back();
+    free_.pop_back();
+    entries_[slot] = {tuple, hash, std::move(conn)};
+  }
+  else
+  {
+    slot = entries_.size();
+    entries_.push_back({tuple, hash, std::move(conn)});
+  }
+  place(slot, hash);
+  size_++;
+  return true;
+}
+
+void Connection_table::place(uint32_t slot, uint64_t hash) noexcept
+{
+  auto idx = hash & mask();
+  // there is always a free slot, the load is kept below 7/8
+  while(true)
+  {
+    auto& bucket = buckets_[idx];
+    for(size_t i = 0; i < BUCKET_SLOTS; i++)
+    {
+      if(bucket.tags[i] == 0)
+      {
+        bucket.tags[i]  = tag(hash);
+        bucket.slots[i] = slot;
+        return;
+      }
+    }
+    // saturated counters are never decremented
+    if(bucket.overflow < 0xFF)
+      bucket.overflow++;
+    idx = (idx + 1) & mask();
+  }
+}
+
+bool Connection_table::erase(const Tuple& tuple, uint64_t hash) noexcept
+{
+  const auto t = tag(hash);
+  const auto home = hash & mask();
+  auto idx = home;
+  for(size_t probes = 0; probes < buckets_.size(); probes++)
+  {
+    auto& bucket = buckets_[idx];
+    for(size_t i = 0; i < BUCKET_SLOTS; i++)
+    {
+      if(bucket.tags[i] != t)
+        continue;
+      const auto slot = bucket.slots[i];
+      auto& entry = entries_[slot];
+      if(entry.hash != hash or entry.tuple != tuple)
+        continue;
+
+      bucket.tags[i] = 0;
+      entry.conn = nullptr;
+      free_.push_back(slot);
+      size_--;
+      // the buckets it probed past have one overflow less
+      for(auto j = home; j != idx; j = (j + 1) & mask())
+      {
+        if(buckets_[j].overflow < 0xFF)
+          buckets_[j].overflow--;
+      }
+      return true;
+    }
+    if(bucket.overflow == 0)
+      break;
+    idx = (idx + 1) & mask();
+  }
+  return false;
+}
+
+void Connection_table::grow()
+{
+  buckets_.assign(buckets_.size() * 2, Bucket{});
+  for(uint32_t slot = 0; slot < entries_.size(); slot++)
+  {
+    if(entries_[slot].conn != nullptr)
+      place(slot, entries_[slot].hash);
+  }
+}
+
+} // < namespace tcp
+} // < namespace net
@@ -0,0 +1,57 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tcp/rcvbuf_tuner.hpp>
+#include <algorithm>
+
+using namespace net::tcp;
+
+uint32_t Rcvbuf_tuner::on_data(uint32_t now, seq_t rcv_nxt, uint32_t rcv_wnd, uint32_t srtt)
+{
+  last_rcv = now;
+
+  // Receiver side RTT: a window of data takes about one RTT to arrive
+  if(rcv_rtt_time == 0)
+  {
+    rcv_rtt_seq  = rcv_nxt + rcv_wnd;
+    rcv_rtt_time = now;
+  }
+  else if(static_cast<int32_t>(rcv_nxt - rcv_rtt_seq) >= 0)
+  {
+    const uint32_t sample = std::max(now - rcv_rtt_time, 1u);
+    rcv_rtt = (rcv_rtt == 0) ? sample : (7 * rcv_rtt + sample) / 8;
+    rcv_rtt_time = 0;
+  }
+
+  // prefer the sender side measurement when we have one
+  const uint32_t rtt = (srtt != 0) ? srtt : rcv_rtt;
+  if(rtt == 0)
+    return 0;
+
+  if(space.time == 0)
+  {
+    space = {now, rcv_nxt, 0};
+    return 0;
+  }
+  if(now - space.time < rtt)
+    return 0;
+
+  // Leave room for two RTTs, so the sender can keep growing its window
+  const uint32_t recvd = rcv_nxt - space.seq;
+  const uint32_t target = (recvd > space.bytes) ? 2 * recvd : 0;
+  space = {now, rcv_nxt, recvd};
+  return target;
+}
@@ -0,0 +1,230 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tcp/scoreboard.hpp>
+#include <algorithm>
+
+using namespace net::tcp;
+
+void Scoreboard::on_send(seq_t start, seq_t end, uint32_t now)
+{
+  if (segments_.empty() or seq_leq(segments_.back().end, start))
+  {
+    segments_.push_back({start, end, now});
+    outstanding_ += end - start;
+    return;
+  }
+  on_retransmit(start, now);
+}
+
+void Scoreboard::on_retransmit(seq_t start, uint32_t now)
+{
+  // segments are sorted on sequence number, find the one containing start
+  auto it = std::lower_bound(segments_.begin(), segments_.end(), start,
+    [] (const Segment& seg, seq_t seq) { return seq_leq(seg.end, seq); });
+
+  if (it == segments_.end() or it->sacked or seq_lt(start, it->start))
+    return;
+
+  auto& seg = *it;
+  if (not seg.retransmitted)
+  {
+    count(seg, false);
+    seg.retransmitted = true;
+    count(seg, true);
+  }
+  seg.xmit_ts = now;
+}
+
+void Scoreboard::count(const Segment& seg, bool add) noexcept
+{
+  const uint32_t sz = add ? seg.size() : -seg.size();
+  if (seg.sacked)
+  {
+    sacked_ += sz;
+    sacked_segs_ += add ? 1 : -1;
+    return;
+  }
+  if (seg.lost)
+    lost_ += sz;
+  if (seg.retransmitted)
+    retrans_ += sz;
+  if (seg.lost and seg.retransmitted)
+    retrans_lost_ += sz;
+}
+
+void Scoreboard::deliver(const Segment& seg, uint32_t now)
+{
+  const uint32_t rtt = now - seg.xmit_ts;
+  // a delivered retransmission can't be told apart from the original,
+  // ignore it when the RTT is implausibly short [RFC 8985] 6.2 step 2
+  if (seg.retransmitted and rack_valid_ and rtt < min_rtt_)
+    return;
+
+  min_rtt_ = std::min(min_rtt_, rtt);
+
+  if (not rack_valid_ or sent_after(seg.xmit_ts, seg.end, rack_xmit_ts_, rack_end_seq_))
+  {
+    rack_rtt_     = rtt;
+    rack_xmit_ts_ = seg.xmit_ts;
+    rack_end_seq_ = seg.end;
+    rack_valid_   = true;
+  }
+
+  // step 3: delivered below a higher already delivered sequence,
+  // nothing is delivered yet the first time
+  if (not fack_valid_)
+  {
+    rack_fack_  = seg.end;
+    fack_valid_ = true;
+  }
+  else if (not seg.retransmitted and seq_lt(seg.end, rack_fack_))
+    reordering_seen_ = true;
+  else if (seq_lt(rack_fack_, seg.end))
+    rack_fack_ = seg.end;
+}
+
+uint32_t Scoreboard::on_ack(seq_t una, const sack::Block* blocks, size_t n, uint32_t now)
+{
+  // cumulatively acknowledged
+  while (not segments_.empty() and seq_leq(segments_.front().end, una))
+  {
+    auto& seg = segments_.front();
+    if (not seg.sacked)
+      deliver(seg, now);
+    count(seg, false);
+    outstanding_ -= seg.size();
+    segments_.pop_front();
+  }
+  if (not segments_.empty() and seq_lt(segments_.front().start, una))
+  {
+    auto& seg = segments_.front();
+    count(seg, false);
+    outstanding_ -= una - seg.start;
+    seg.start = una;
+    count(seg, true);
+  }
+
+  // selectively acknowledged
+  uint32_t newly_sacked = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    const auto& block = blocks[i];
+    // DSACK or stale block
+    if (seq_leq(block.end, una) or not seq_lt(block.start, block.end))
+      continue;
+
+    auto it = std::lower_bound(segments_.begin(), segments_.end(), block.start,
+      [] (const Segment& seg, seq_t seq) { return seq_lt(seg.start, seq); });
+
+    for (; it != segments_.end() and seq_leq(it->end, block.end); ++it)
+    {
+      auto& seg = *it;
+      if (seg.sacked)
+        continue;
+      deliver(seg, now);
+      count(seg, false);
+      seg.sacked = true;
+      count(seg, true);
+      newly_sacked += seg.size();
+    }
+  }
+  return newly_sacked;
+}
+
+uint32_t Scoreboard::reo_wnd(bool in_recovery) const noexcept
+{
+  // [RFC 8985] 6.2 step 4
+  if (not reordering_seen_ and (in_recovery or sacked_segs_ >= dup_thresh))
+    return 0;
+  return min_rtt_ / 4;
+}
+
+void Scoreboard::set_lost(Segment& seg)
+{
+  if (seg.sacked)
+    return;
+  count(seg, false);
+  // a lost retransmission has to be sent again
+  seg.retransmitted = false;
+  seg.lost = true;
+  count(seg, true);
+}
+
+uint32_t Scoreboard::detect_loss(uint32_t now, bool in_recovery)
+{
+  if (not rack_valid_)
+    return 0;
+
+  const uint32_t reo = reo_wnd(in_recovery);
+  uint32_t timeout = 0;
+
+  for (auto& seg : segments_)
+  {
+    if (seg.sacked or (seg.lost and not seg.retransmitted))
+      continue;
+
+    if (not sent_after(rack_xmit_ts_, rack_end_seq_, seg.xmit_ts, seg.end))
+    {
+      // original transmissions are in sequence order, everything
+      // after this one was sent later as well
+      if (not seg.retransmitted)
+        break;
+      continue;
+    }
+
+    const uint32_t elapsed = now - seg.xmit_ts;
+    const uint32_t limit   = rack_rtt_ + reo;
+    if (elapsed >= limit)
+      set_lost(seg);
+    else
+      timeout = std::max(timeout, limit - elapsed);
+  }
+  return timeout;
+}
+
+void Scoreboard::mark_all_lost()
+{
+  for (auto& seg : segments_)
+    set_lost(seg);
+}
+
+const Scoreboard::Segment* Scoreboard::next_lost() const noexcept
+{
+  if (not has_lost())
+    return nullptr;
+  for (const auto& seg : segments_)
+  {
+    if (seg.lost and not seg.retransmitted and not seg.sacked)
+      return &seg;
+  }
+  return nullptr;
+}
+
+const Scoreboard::Segment* Scoreboard::last_unsacked() const noexcept
+{
+  for (auto it = segments_.rbegin(); it != segments_.rend(); ++it)
+  {
+    if (not it->sacked)
+      return &*it;
+  }
+  return nullptr;
+}
+
+void Scoreboard::clear()
+{
+  *this = Scoreboard{};
+}
@@ -29,6 +29,7 @@
 #include <rtc> // nanos_now (get_ts_value)
 #include <net/tcp/packet4_view.hpp>
 #include <net/tcp/packet6_view.hpp>
+#include <algorithm>
 
 using namespace std;
 using namespace net;
@@ -41,6 +42,8 @@ TCP::TCP(IPStack& inet, bool smp_enable) :
   total_bufsize_{default_total_bufsize},
   mempool_{total_bufsize_},
   min_bufsize_{default_min_bufsize}, max_bufsize_{default_max_bufsize},
+  rcvbuf_{default_rcvbuf}, max_rcvbuf_{default_max_rcvbuf},
+  rcvbuf_timer_{{this, &TCP::rcvbuf_reclaim}},
   ports_(inet.tcp_ports()),
   writeq(),
   max_seg_lifetime_{default_msl},       // 30s
@@ -54,6 +57,8 @@ TCP::TCP(IPStack& inet, bool smp_enable) :
   Expects(wscale_ <= 14 && "WScale factor cannot exceed 14");
   Expects(win_size_ <= 0x40000000 && "Invalid size");
 
+  rng_extract(&iss_key_, sizeof(iss_key_));
+
   this->cpu_id = SMP::cpu_id();
   this->smp_enabled = smp_enable;
   std::string stat_prefix;
@@ -94,9 +99,8 @@ Listener& TCP::listen(const Socket& socket, ConnectCallback cb)
 {
   bind(socket);
 
-  auto& listener = listeners_.emplace(socket,
-    std::make_unique<tcp::Listener>(*this, socket, std::move(cb))
-    ).first->second;
+  auto listener = std::make_shared<tcp::Listener>(*this, socket, std::move(cb));
+  add_listener(socket, listener);
   debug("<TCP::listen> Bound to socket %s \n", socket.to_string().c_str());
   return *listener;
 }
@@ -107,16 +111,16 @@ Listener& TCP::listen(const tcp::port_t port, ConnectCallback cb, const bool ipv
   bind(socket);
 
   auto ptr = std::make_shared<tcp::Listener>(*this, socket, std::move(cb), ipv6_only);
-  auto& listener = listeners_.emplace(socket, ptr).first->second;
+  add_listener(socket, ptr);
 
   if(not ipv6_only)
   {
     Socket ip4_sock{ip4::Addr::addr_any, port};
     bind(ip4_sock);
-    Ensures(listeners_.emplace(ip4_sock, ptr).second && "Could not insert IPv4 listener");
+    Ensures(add_listener(ip4_sock, ptr) && "Could not insert IPv4 listener");
   }
 
-  return *listener;
+  return *ptr;
 }
 
 bool TCP::close(const Socket& socket)
@@ -149,12 +153,12 @@ void TCP::connect(Socket remote, ConnectCallback callback)
     }
   }();
 
-  create_connection(bind(addr), remote, std::move(callback))->open(true);
+  create_connection(bind(addr, remote), remote, std::move(callback))->open(true);
 }
 
 void TCP::connect(Address source, Socket remote, ConnectCallback callback)
 {
-  connect(bind(source), remote, std::move(callback));
+  create_connection(bind(source, remote), remote, std::move(callback))->open(true);
 }
 
 void TCP::connect(Socket local, Socket remote, ConnectCallback callback)
@@ -177,14 +181,14 @@ Connection_ptr TCP::connect(Socket remote)
     }
   }();
 
-  auto conn = create_connection(bind(addr), remote);
+  auto conn = create_connection(bind(addr, remote), remote);
   conn->open(true);
   return conn;
 }
 
 Connection_ptr TCP::connect(Address source, Socket remote)
 {
-  auto conn = create_connection(bind(source), remote);
+  auto conn = create_connection(bind(source, remote), remote);
   conn->open(true);
   return conn;
 }
@@ -199,10 +203,7 @@ Connection_ptr TCP::connect(Socket local, Socket remote)
 
 void TCP::insert_connection(Connection_ptr conn)
 {
-  connections_.emplace(
-      std::piecewise_construct,
-      std::forward_as_tuple(conn->local(), conn->remote()),
-      std::forward_as_tuple(conn));
+  connections_.insert(conn->tuple(), conn);
 }
 
 void TCP::receive4(net::Packet_ptr ptr)
@@ -229,9 +230,14 @@ void TCP::receive6(net::Packet_ptr ptr)
 
 void TCP::receive(Packet_view& packet)
 {
+  assert(get_cpuid() == SMP::cpu_id());
+
+  // Hand the segment over if another instance owns its connection
+  if (UNLIKELY(not reuse_ports_.empty()) and reuse_port_dispatch(packet))
+    return;
+
   // Stat increment packets received
   (*packets_rx_)++;
-  assert(get_cpuid() == SMP::cpu_id());
 
   // validate some unlikely but invalid packet properties
   if (UNLIKELY(packet.src_port() == 0)) {
@@ -263,27 +269,39 @@ void TCP::receive(Packet_view& packet)
   }
 
   const auto dest = packet.destination();
-  const Connection::Tuple tuple { dest, packet.source() };
+  const auto src = packet.source();
+
+  // Same connection as the last segment
+  if (last_conn_ != nullptr and last_conn_->remote() == src
+      and last_conn_->local() == dest)
+  {
+    last_conn_->segment_arrived(packet);
+    release_held(packet);
+    return;
+  }
 
   // Try to find the receiver
-  auto conn_it = connections_.find(tuple);
+  const Connection::Tuple tuple { dest, src };
+  auto* conn = connections_.find(tuple);
 
   // Connection found
-  if (conn_it != connections_.end()) {
-    PRINT("<TCP::receive> Connection found: %s \n", conn_it->second->to_string().c_str());
-    conn_it->second->segment_arrived(packet);
+  if (conn != nullptr) {
+    PRINT("<TCP::receive> Connection found: %s \n", (*conn)->to_string().c_str());
+    last_conn_ = conn->get();
+    last_conn_->segment_arrived(packet);
+    release_held(packet);
     return;
   }
 
   // No open connection found, find listener for destination
   debug("<TCP::receive> No connection found - looking for listener..\n");
-  auto listener_it = find_listener(dest);
+  auto* listener = find_listener(dest);
 
   // Listener found => Create Listener
-  if (listener_it != listeners_.end()) {
-    auto& listener = listener_it->second;
+  if (listener != nullptr) {
     PRINT("<TCP::receive> Listener found: %s\n", listener->to_string().c_str());
     listener->segment_arrived(packet);
+    release_held(packet);
     PRINT("<TCP::receive> Listener done with packet\n");
     return;
   }
@@ -305,11 +323,11 @@ string TCP::to_string() const {
   }
   str +=
   "\nCONNECTIONS:\nLocal\tRemote\tState\n";
-  for(auto& con_it : connections_) {
-    auto& c = *(con_it.second);
+  connections_.for_each([&str] (const auto&, const Connection_ptr& conn) {
+    auto& c = *conn;
     str += c.local().to_string() + "\t" + c.remote().to_string() + "\t"
         + c.state().to_string() + "\n";
-  }
+  });
   return str;
 }
 
@@ -336,8 +354,8 @@ void TCP::error_report(const Error& err, Socket dest) {
 
       // Find all connections sending to this destination
       // Notify the TCP Connection that the sent packet has been dropped and needs to be retransmitted
-      for (auto& conn_entry : connections_) {
-        if (conn_entry.first.second == dest) {
+      connections_.for_each([&] (const Connection::Tuple& tuple, const Connection_ptr& conn) {
+        if (tuple.second == dest) {
           /*
           Note: One MUST not retransmit in response to every Datagram Too Big message, since
           a burst of several oversized segments will give rise to several such messages and hence
@@ -352,8 +370,8 @@ void TCP::error_report(const Error& err, Socket dest) {
           // minus the size of the IP header and minus the size of the TCP header
           auto new_smss = icmp_err->pmtu() - sizeof(ip4::Header) - sizeof(tcp::Header);
 
-          if (conn_entry.second->SMSS() > new_smss) {
-            conn_entry.second->set_SMSS(new_smss);
+          if (conn->SMSS() > new_smss) {
+            conn->set_SMSS(new_smss);
 
             // TODO Check that this works as expected:
             // Unlike a retransmission caused by a TCP retransmission timeout, a retransmission
@@ -366,11 +384,11 @@ void TCP::error_report(const Error& err, Socket dest) {
 
             // Note:
             // Check if it is necessary to call reduce_ssthresh() (slow start)
-            conn_entry.second->reduce_ssthresh();
-            conn_entry.second->retransmit();
+            conn->reduce_ssthresh();
+            conn->retransmit();
           }
         }
-      }
+      });
 
       // return;
     }
@@ -386,10 +404,10 @@ void TCP::reset_pmtu(Socket dest, IP4::PMTU pmtu) {
 
   // Find all connections sending to this destination and update their SMSS value
   // based on the new increased pmtu
-  for (auto& conn_entry : connections_) {
-    if (conn_entry.first.second == dest)
-      conn_entry.second->set_SMSS(pmtu - sizeof(ip4::Header) - sizeof(tcp::Header));
-  }
+  connections_.for_each([&] (const Connection::Tuple& tuple, const Connection_ptr& conn) {
+    if (tuple.second == dest)
+      conn->set_SMSS(pmtu - sizeof(ip4::Header) - sizeof(tcp::Header));
+  });
 }
 
 void TCP::transmit(tcp::Packet_view_ptr packet)
@@ -438,9 +456,17 @@ void TCP::send_reset(const tcp::Packet_view& in)
   transmit(std::move(out));
 }
 
-seq_t TCP::generate_iss() {
-  // Do something to get a iss.
-  return rand();
+seq_t TCP::generate_iss(const Socket& local, const Socket& remote) const
+{
+  // ISN = M + F(localip, localport, remoteip, remoteport, secretkey)
+  uint8_t id[36];
+  memcpy(id, &local.address().v6(), 16);
+  memcpy(id + 16, &remote.address().v6(), 16);
+  const uint16_t ports[2] {local.port(), remote.port()};
+  memcpy(id + 32, ports, sizeof(ports));
+
+  const seq_t M = os::nanos_since_boot() / 4000;
+  return M + static_cast<seq_t>(siphash(iss_key_, id, sizeof(id)));
 }
 
 uint32_t TCP::get_ts_value() const
@@ -448,6 +474,11 @@ uint32_t TCP::get_ts_value() const
   return ((RTC::nanos_now() / 1000000000ull) & 0xffffffff);
 }
 
+uint32_t TCP::now_ms() const
+{
+  return ((RTC::nanos_now() / 1000000ull) & 0xffffffff);
+}
+
 void TCP::drop(const tcp::Packet_view&) {
   // Stat increment packets dropped
   (*packets_dropped_)++;
@@ -490,6 +521,17 @@ Socket TCP::bind(const Address& addr)
   return {addr, port};
 }
 
+Socket TCP::bind(const Address& addr, const Socket& remote)
+{
+  if(UNLIKELY( is_valid_source(addr) == false ))
+    throw TCP_error{"Cannot bind to address: " + addr.to_string()};
+
+  auto& port_util = ports_[addr];
+  const auto port = port_util.get_next_ephemeral(remote);
+  port_util.bind(port);
+  return {addr, port};
+}
+
 bool TCP::unbind(const Socket& socket)
 {
   auto it = ports_.find(socket.address());
@@ -528,8 +570,9 @@ bool TCP::add_connection(tcp::Connection_ptr conn)
   //printf("New inc conn %s allocatable=%zu\n", conn->to_string().c_str(), conn->bufalloc->allocatable());
 
   Expects(conn->bufalloc != nullptr);
+  init_rcvbuf(*conn);
   conn->_on_cleanup({this, &TCP::close_connection});
-  return connections_.emplace(conn->tuple(), conn).second;
+  return connections_.insert(conn->tuple(), conn);
 }
 
 Connection_ptr TCP::create_connection(Socket local, Socket remote, ConnectCallback cb)
@@ -546,17 +589,15 @@ Connection_ptr TCP::create_connection(Socket local, Socket remote, ConnectCallba
   // Stat increment number of outgoing connections
   (*outgoing_connections_)++;
 
-  auto& conn = (connections_.emplace(
-      Connection::Tuple{ local, remote },
-      std::make_shared<Connection>(*this, local, remote, std::move(cb))
-      )
-    ).first->second;
+  auto conn = std::make_shared<Connection>(*this, local, remote, std::move(cb));
+  connections_.insert({ local, remote }, conn);
   conn->_on_cleanup({this, &TCP::close_connection});
   conn->bufalloc = std::move(resource);
 
   //printf("New out conn %s allocatable=%zu\n", conn->to_string().c_str(), conn->bufalloc->allocatable());
 
   Expects(conn->bufalloc != nullptr);
+  init_rcvbuf(*conn);
   return conn;
 }
 
@@ -626,9 +667,9 @@ void TCP::kick()
 
 void TCP::close_listener(tcp::Listener& listener)
 {
-  const auto& socket = listener.local();
+  const auto socket = listener.local();
   unbind(socket);
-  listeners_.erase(socket);
+  remove_listener(socket);
 
   // if the listener is "dual-stack", make sure to clean up the
   // ip4 any addr copy as well
@@ -636,33 +677,116 @@ void TCP::close_listener(tcp::Listener& listener)
   {
     Socket ip4_sock{ip4::Addr::addr_any, socket.port()};
     unbind(ip4_sock);
-    listeners_.erase(ip4_sock);
+    remove_listener(ip4_sock);
   }
 }
 
-TCP::Listeners::iterator TCP::find_listener(const Socket& socket)
+bool TCP::add_listener(const Socket& socket, std::shared_ptr<tcp::Listener> listener)
 {
-  Listeners::iterator it = listeners_.find(socket);
-  if(it != listeners_.end())
-    return it;
+  auto* ptr = listener.get();
+  if(not listeners_.emplace(socket, std::move(listener)).second)
+    return false;
+  listener_ports_[socket.port()].emplace_back(socket, ptr);
+  return true;
+}
 
-  if(not socket.address().is_any())
-    it = listeners_.find({socket.address().any_addr(), socket.port()});
+void TCP::remove_listener(const Socket& socket)
+{
+  if(listeners_.erase(socket) == 0)
+    return;
 
-  return it;
+  auto it = listener_ports_.find(socket.port());
+  auto& bound = it->second;
+  bound.erase(std::find_if(bound.begin(), bound.end(),
+    [&socket] (const auto& entry) { return entry.first == socket; }));
+  if(bound.empty())
+    listener_ports_.erase(it);
 }
 
-TCP::Listeners::const_iterator TCP::cfind_listener(const Socket& socket) const
+tcp::Listener* TCP::find_listener(const Socket& socket) const
 {
-  Listeners::const_iterator it = listeners_.find(socket);
-  if(it != listeners_.cend())
-    return it;
+  // one lookup for the port, there are rarely more than a couple
+  // of listeners on it
+  auto it = listener_ports_.find(socket.port());
+  if(it == listener_ports_.end())
+    return nullptr;
+
+  const auto any = socket.address().any_addr();
+  tcp::Listener* match = nullptr;
+  for(const auto& entry : it->second)
+  {
+    const auto& addr = entry.first.address();
+    if(addr == socket.address())
+      return entry.second;
+    if(addr == any)
+      match = entry.second;
+  }
+  return match;
+}
 
-  if(not socket.address().is_any())
-    it = listeners_.find({socket.address().any_addr(), socket.port()});
+void TCP::init_rcvbuf(tcp::Connection& conn)
+{
+  if (rcvbuf_ == 0)
+    return;
+  conn.set_rcvbuf(rcvbuf_);
+  if (not rcvbuf_timer_.is_running())
+    rcvbuf_timer_.start(default_rcvbuf_idle);
+}
+
+void TCP::rcvbuf_reclaim()
+{
+  if (connections_.empty())
+    return;
 
-  return it;
+  if (memory_pressure())
+  {
+    const auto now  = now_ms();
+    const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(default_rcvbuf_idle).count();
+    connections_.for_each([now, idle] (const auto&, const Connection_ptr& conn) {
+      conn->rcvbuf_reclaim(now, idle);
+    });
+  }
+  rcvbuf_timer_.start(default_rcvbuf_idle);
 }
 
+void TCP::reuse_port(const tcp::port_t port, TCP& instance)
+{
+  auto& group = reuse_ports_[port];
+  Expects(std::find(group.begin(), group.end(), &instance) == group.end());
+  group.push_back(&instance);
+}
+
+bool TCP::reuse_port_dispatch(tcp::Packet_view& packet)
+{
+  auto it = reuse_ports_.find(packet.dst_port());
+  if(it == reuse_ports_.end())
+    return false;
 
+  const auto& group = it->second;
+  const auto hash = connections_.hash(packet.destination(), packet.source());
+  TCP* target = group[hash % group.size()];
+  if(target == this)
+    return false;
+
+  const auto ipv = packet.ipv();
+  if(target->cpu_id == this->cpu_id)
+  {
+    target->receive_dispatched(packet.release(), ipv);
+    return true;
+  }
+  auto* pkt = packet.release().release();
+  SMP::add_task(
+  [target, pkt, ipv] () {
+    target->receive_dispatched(net::Packet_ptr{pkt}, ipv);
+  }, target->cpu_id);
+  SMP::signal(target->cpu_id);
+  return true;
+}
 
+void TCP::receive_dispatched(net::Packet_ptr ptr, const Protocol ipv)
+{
+  if(ipv == Protocol::IPv6)
+    receive6(std::move(ptr));
+  else
+    receive4(std::move(ptr));
+}
@@ -50,6 +50,18 @@ void Write_queue::advance(size_t bytes)
   }
 }
 
+std::pair<const uint8_t*, size_t> Write_queue::data_at(uint32_t offset) const
+{
+  offset += acked_;
+  for(const auto& buf : q)
+  {
+    if(offset < buf->size())
+      return {buf->data() + offset, buf->size() - offset};
+    offset -= buf->size();
+  }
+  return {nullptr, 0};
+}
+
 void Write_queue::acknowledge(size_t bytes)
 {
   debug2("<WriteQueue> Acknowledge %u bytes, ack=%u\n", bytes, acked_);
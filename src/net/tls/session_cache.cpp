@@ -0,0 +1,84 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tls/session_cache.hpp>
+#include <expects>
+
+namespace net::tls {
+
+  Session_cache::Session_cache(size_t capacity, std::chrono::seconds lifetime)
+    : capacity_{capacity}, lifetime_{lifetime}
+  {
+    Expects(capacity > 0);
+    index_.reserve(capacity);
+  }
+
+  Session_cache& Session_cache::get()
+  {
+    static Session_cache cache;
+    return cache;
+  }
+
+  void Session_cache::store(std::string_view id, std::string_view session,
+                            timestamp_t now)
+  {
+    if (id.empty() or id.size() > MAX_ID_LEN) return;
+    remove(id);
+    if (lru_.size() == capacity_) {
+      index_.erase(lru_.back().id);
+      lru_.pop_back();
+    }
+    lru_.push_front({std::string(id), std::string(session),
+                     now + (timestamp_t) lifetime_.count()});
+    // the key views the entry's own copy of the id
+    index_.emplace(lru_.front().id, lru_.begin());
+  }
+
+  std::string_view Session_cache::find(std::string_view id, timestamp_t now)
+  {
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+      misses_++;
+      return {};
+    }
+    auto entry = it->second;
+    if (now >= entry->expires) {
+      index_.erase(it);
+      lru_.erase(entry);
+      misses_++;
+      return {};
+    }
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, entry);
+    return entry->session;
+  }
+
+  void Session_cache::remove(std::string_view id)
+  {
+    auto it = index_.find(id);
+    if (it == index_.end()) return;
+    auto entry = it->second;
+    index_.erase(it);
+    lru_.erase(entry);
+  }
+
+  void Session_cache::clear()
+  {
+    index_.clear();
+    lru_.clear();
+  }
+
+} //< namespace net::tls
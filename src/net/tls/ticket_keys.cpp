@@ -0,0 +1,114 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <net/tls/ticket_keys.hpp>
+#include <kernel/rng.hpp>
+#include <cstring>
+#include <stdexcept>
+
+namespace net::tls {
+
+  static constexpr uint32_t SERIAL_MAGIC = 0x544b4559; // "TKEY"
+
+  struct serialized_keys {
+    uint32_t magic;
+    uint32_t count;
+    int64_t  lifetime;
+    // followed by the keys
+    Ticket_keys::Key* keys() const noexcept
+    { return (Ticket_keys::Key*) (this + 1); }
+  };
+
+  Ticket_keys::~Ticket_keys()
+  {
+    // don't leave key material around
+    volatile uint8_t* p = reinterpret_cast<volatile uint8_t*>(keys_.data());
+    for (size_t i = 0; i < sizeof(keys_); i++) p[i] = 0;
+  }
+
+  Ticket_keys& Ticket_keys::get()
+  {
+    static Ticket_keys keys;
+    return keys;
+  }
+
+  const Ticket_keys::Key& Ticket_keys::current(timestamp_t now)
+  {
+    if (count_ == 0 or age(keys_[0], now) >= (timestamp_t) lifetime_.count())
+      rotate(now);
+    return keys_[0];
+  }
+
+  const Ticket_keys::Key* Ticket_keys::find(const uint8_t* name, timestamp_t now) const noexcept
+  {
+    for (size_t i = 0; i < count_; i++)
+    {
+      const auto& key = keys_[i];
+      if (std::memcmp(key.name, name, NAME_LEN) == 0)
+        return expired(key, now) ? nullptr : &key;
+    }
+    return nullptr;
+  }
+
+  void Ticket_keys::rotate(timestamp_t now)
+  {
+    // drop the oldest, and any expired keys
+    if (count_ == MAX_KEYS) count_--;
+    while (count_ > 0 and expired(keys_[count_-1], now)) count_--;
+
+    for (size_t i = count_; i > 0; i--)
+      keys_[i] = keys_[i-1];
+    count_++;
+
+    auto& key = keys_[0];
+    rng_extract(key.name, sizeof(key.name));
+    rng_extract(key.aes_key, sizeof(key.aes_key));
+    rng_extract(key.hmac_key, sizeof(key.hmac_key));
+    key.created = now;
+  }
+
+  size_t Ticket_keys::serialized_size() const noexcept
+  {
+    return sizeof(serialized_keys) + count_ * sizeof(Key);
+  }
+
+  size_t Ticket_keys::serialize_to(void* addr, size_t size) const
+  {
+    if (size < serialized_size())
+      throw std::runtime_error("Not enough room to serialize ticket keys");
+
+    auto* hdr = (serialized_keys*) addr;
+    hdr->magic    = SERIAL_MAGIC;
+    hdr->count    = count_;
+    hdr->lifetime = lifetime_.count();
+    std::memcpy(hdr->keys(), keys_.data(), count_ * sizeof(Key));
+    return serialized_size();
+  }
+
+  void Ticket_keys::deserialize_from(const void* addr, size_t size)
+  {
+    auto* hdr = (const serialized_keys*) addr;
+    if (size < sizeof(serialized_keys) or hdr->magic != SERIAL_MAGIC
+        or hdr->count > MAX_KEYS
+        or size < sizeof(serialized_keys) + hdr->count * sizeof(Key))
+      throw std::runtime_error("Invalid serialized ticket keys");
+
+    count_    = hdr->count;
+    lifetime_ = std::chrono::seconds(hdr->lifetime);
+    std::memcpy(keys_.data(), hdr->keys(), count_ * sizeof(Key));
+  }
+
+} //< namespace net::tls
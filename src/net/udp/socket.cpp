@@ -30,10 +30,52 @@ namespace net::udp
 
   void Socket::internal_read(const Packet_view& udp)
   {
+    if (is_batched()) {
+      const Datagram dgram {udp.ip_src(), udp.src_port(),
+                            udp.udp_data(), udp.udp_data_length()};
+      on_batch_handler(&dgram, 1);
+      return;
+    }
     on_read_handler(udp.ip_src(), udp.src_port(),
                    (const char*) udp.udp_data(), udp.udp_data_length());
   }
 
+  void Socket::on_read_batch(batch_handler callback, size_t max_batch)
+  {
+    Expects(max_batch > 0);
+    on_batch_handler = callback;
+    max_batch_ = max_batch;
+    rxq_.reserve(max_batch);
+  }
+
+  void Socket::queue_read(Packet_view_ptr udp)
+  {
+    if (rxq_.empty())
+      udp_.schedule_batch(socket_);
+    rxq_.push_back(std::move(udp));
+
+    if (rxq_.size() >= max_batch_)
+      deliver_batch();
+  }
+
+  void Socket::deliver_batch()
+  {
+    if (rxq_.empty()) return;
+    // the handler may close this socket, so keep what it uses on the stack
+    auto packets = std::move(rxq_);
+    rxq_.clear();
+    rxq_.reserve(max_batch_);
+    auto handler = on_batch_handler;
+
+    std::vector<Datagram> batch;
+    batch.reserve(packets.size());
+    for (const auto& pkt : packets)
+      batch.push_back({pkt->ip_src(), pkt->src_port(),
+                       pkt->udp_data(), pkt->udp_data_length()});
+
+    handler(batch.data(), batch.size());
+  }
+
   void Socket::sendto(
      addr_t destIP,
      port_t port,
@@ -43,8 +85,13 @@ namespace net::udp
      error_handler ecb)
   {
     if (UNLIKELY(length == 0)) return;
+    const net::Socket dest{destIP, port};
+    // small datagrams go straight into a packet when nothing is queued
+    if (udp_.send_now(socket_, dest, (const uint8_t*) buffer, length, cb, ecb))
+      return;
+
     udp_.sendq.emplace_back(this->udp_,
-      socket_, net::Socket{destIP, port},
+      socket_, dest,
       (const uint8_t*) buffer, length,
       cb, ecb);
 
@@ -52,6 +99,27 @@ namespace net::udp
     udp_.flush();
   }
 
+  size_t Socket::sendmmsg(const Datagram* datagrams, size_t count)
+  {
+    return udp_.send_batch(socket_, datagrams, count);
+  }
+
+  Packet_view_ptr Socket::create_datagram(addr_t dest_ip, port_t port)
+  {
+    return udp_.create_packet(socket_, {dest_ip, port});
+  }
+
+  void Socket::send(Packet_view_ptr datagram, error_handler ecb)
+  {
+    Expects(datagram->udp_data_length() <= payload_capacity());
+    udp_.send_packet(std::move(datagram), ecb);
+  }
+
+  size_t Socket::payload_capacity() const
+  {
+    return udp_.max_datagram_size();
+  }
+
   void Socket::bcast(
     addr_t srcIP,
     port_t port,
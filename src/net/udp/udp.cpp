@@ -31,6 +31,7 @@
 #include <net/util.hpp>
 #include <memory>
 #include <net/ip4/icmp4.hpp>
+#include <kernel/events.hpp>
 
 namespace net {
 
@@ -92,7 +93,10 @@ namespace net {
     if (it != sockets_.end()) {
       PRINT("<%s> UDP found listener on %s\n",
               stack_.ifname().c_str(), udp_packet->destination().to_string().c_str());
-      it->second.internal_read(*udp_packet);
+      if (it->second.is_batched())
+        it->second.queue_read(std::move(udp_packet));
+      else
+        it->second.internal_read(*udp_packet);
       return;
     }
 
@@ -260,8 +264,98 @@ namespace net {
       flush_timer_.start(flush_interval_);
   }
 
+  void UDP::add_error_callback(const net::Socket& dst, error_handler ecb)
+  {
+    error_callbacks_.emplace(std::piecewise_construct,
+                        std::forward_as_tuple(dst),
+                        std::forward_as_tuple(Error_entry{ecb}));
+
+    if (UNLIKELY(not flush_timer_.is_running()))
+      flush_timer_.start(flush_interval_);
+  }
+
+  bool UDP::send_now(const net::Socket& src, const net::Socket& dst,
+                     const uint8_t* data, size_t length,
+                     sendto_handler cb, error_handler ecb)
+  {
+    // keep the order of queued data, and let big datagrams be split up
+    if (not sendq.empty() or not packetq_.empty()
+        or length > max_datagram_size()
+        or stack_.transmit_queue_available() == 0)
+      return false;
+
+    auto pkt = create_packet(src, dst);
+    if (UNLIKELY(pkt == nullptr)) return false;
+    pkt->fill(data, length);
+    transmit(std::move(pkt));
+
+    if (cb != nullptr) cb();
+    if (ecb != nullptr) add_error_callback(dst, ecb);
+    return true;
+  }
+
+  void UDP::send_packet(udp::Packet_view_ptr pkt, error_handler ecb)
+  {
+    if (ecb != nullptr) add_error_callback(pkt->destination(), ecb);
+
+    if (packetq_.empty() and stack_.transmit_queue_available() > 0)
+      transmit(std::move(pkt));
+    else
+      packetq_.push_back(std::move(pkt));
+  }
+
+  size_t UDP::send_batch(const net::Socket& src, const udp::Datagram* dgrams, size_t count)
+  {
+    flush();
+    if (not sendq.empty() or not packetq_.empty()) return 0;
+
+    count = std::min(count, stack_.transmit_queue_available());
+    size_t sent = 0;
+    for (; sent < count; sent++)
+    {
+      const auto& dgram = dgrams[sent];
+      Expects(dgram.length <= max_datagram_size());
+      auto pkt = create_packet(src, {dgram.addr, dgram.port});
+      if (UNLIKELY(pkt == nullptr)) break;
+      pkt->fill(dgram.data, dgram.length);
+      // each datagram gets its own IP header, filtering and next hop
+      transmit(std::move(pkt));
+    }
+    return sent;
+  }
+
+  void UDP::schedule_batch(const net::Socket& socket)
+  {
+    if (UNLIKELY(batch_event_ < 0))
+      batch_event_ = Events::get().subscribe({this, &UDP::deliver_batches});
+
+    if (batch_pending_.empty())
+      Events::get().trigger_event(batch_event_);
+    batch_pending_.push_back(socket);
+  }
+
+  void UDP::deliver_batches()
+  {
+    auto pending = std::move(batch_pending_);
+    batch_pending_.clear();
+    // sockets may have been closed meanwhile
+    for (const auto& socket : pending)
+    {
+      auto it = find(socket);
+      if (it != sockets_.end())
+        it->second.deliver_batch();
+    }
+  }
+
   void UDP::process_sendq(size_t num)
   {
+    while (!packetq_.empty() && num != 0)
+    {
+      transmit(std::move(packetq_.front()));
+      packetq_.pop_front();
+      num--;
+    }
+
     while (!sendq.empty() && num != 0)
     {
       WriteBuffer& buffer = sendq.front();
@@ -279,14 +373,8 @@ namespace net {
         if (buffer.send_callback != nullptr)
           buffer.send_callback();
 
-        if (buffer.error_callback != nullptr) {
-          error_callbacks_.emplace(std::piecewise_construct,
-                              std::forward_as_tuple(buffer.dst),
-                              std::forward_as_tuple(Error_entry{buffer.error_callback}));
-
-          if (UNLIKELY(not flush_timer_.is_running()))
-            flush_timer_.start(flush_interval_);
-        }
+        if (buffer.error_callback != nullptr)
+          add_error_callback(buffer.dst, buffer.error_callback);
 
         // remove buffer from queue
         sendq.pop_front();
@@ -18,11 +18,14 @@
 #include "apic_timer.hpp"
 #include "apic.hpp"
 #include "pit.hpp"
+#include <arch/x86/cpu.hpp>
+#include <kernel/cpuid.hpp>
 #include <kernel/events.hpp>
 #include <kernel/timers.hpp>
 #include <smp>
 #include <cstdio>
 #include <info>
+#include <os>
 
 #define TIMER_ONESHOT     0x0
 #define TIMER_PERIODIC    0x20000
@@ -33,12 +36,16 @@
 
 #define CALIBRATION_MS   125
 
+#define IA32_TSC_DEADLINE  0x6E0
+
 using namespace std::chrono;
 
 namespace x86
 {
   // calculated once on BSP
   static uint32_t ticks_per_micro = 0;
+  // TSC frequency, when the timer runs in TSC-deadline mode
+  static uint64_t tsc_khz = 0;
 
   struct alignas(SMP_ALIGN) timer_data
   {
@@ -60,13 +67,36 @@ namespace x86
     GET_TIMER().intr =
         Events::get().subscribe(Timers::timers_handler);
     // initialize local APIC timer
-    APIC::get().timer_init(GET_TIMER().intr);
+    APIC::get().timer_init(GET_TIMER().intr, tsc_khz != 0);
   }
+
+  // Avoid measuring the timer when its rate is already known
+  static void select_mode()
+  {
+    // the TSC-deadline mode counts TSC cycles, whose rate the clocks
+    // (kvmclock, CPUID or PIT sampling) have already determined
+    const auto khz = os::cpu_freq().count();
+    if (CPUID::has_feature(CPUID::Feature::TSC_DEADLINE) && khz > 0) {
+      tsc_khz = khz;
+      INFO("APIC", "Using TSC-deadline timer (%lu kHz)", tsc_khz);
+      return;
+    }
+    // otherwise CPUID may report the timer input frequency,
+    // which timer_init() divides by 4
+    const auto apic_khz = CPUID::apic_timer_khz();
+    if (apic_khz / 4 / 1000 != 0) {
+      ticks_per_micro = apic_khz / 4 / 1000;
+      INFO("APIC", "Timer frequency from CPUID (%lu kHz)", apic_khz);
+    }
+  }
+
   void APIC_Timer::calibrate()
   {
+    if (ready() == false)
+        select_mode();
     init();
 
-    if (ticks_per_micro != 0) {
+    if (ready()) {
       start_timers();
       // with SMP, signal everyone else too (IRQ 1)
       if (SMP::cpu_count() > 1) {
@@ -115,17 +145,45 @@ namespace x86
   void APIC_Timer::start_timers() noexcept
   {
     assert(ready());
+    // APs initialized their timer before the mode was selected
+    if (tsc_khz != 0) {
+      GET_TIMER().intr_enabled = false;
+      APIC::get().timer_init(GET_TIMER().intr, true);
+    }
     // delay-start all timers
     Events::get().defer(Timers::ready);
   }
 
   bool APIC_Timer::ready() noexcept
   {
-    return ticks_per_micro != 0;
+    return ticks_per_micro != 0 || tsc_khz != 0;
+  }
+
+  static void deadline(std::chrono::nanoseconds nanos) noexcept
+  {
+    // prevent oneshots less than a microsecond, and overflow
+    uint64_t micros = nanos.count() / 1000;
+    if (micros > 1000000000)
+        micros = 1000000000;
+    else if (UNLIKELY(micros == 0))
+        micros = 1;
+
+    if (GET_TIMER().intr_enabled == false) {
+      GET_TIMER().intr_enabled = true;
+      APIC::get().timer_interrupt(true);
+      // order the LVT write before arming, see Vol3a 10.5.4.1
+      asm volatile("mfence" ::: "memory");
+    }
+    const uint64_t cycles = micros * tsc_khz / 1000;
+    CPU::write_msr(IA32_TSC_DEADLINE, os::cycles_since_boot() + cycles);
   }
 
   void APIC_Timer::oneshot(std::chrono::nanoseconds nanos) noexcept
   {
+    if (tsc_khz != 0) {
+      deadline(nanos);
+      return;
+    }
     // prevent overflow
     uint64_t ticks = nanos.count() / 1000 * ticks_per_micro;
     if (ticks > 0xFFFFFFFF)
@@ -148,6 +206,9 @@ namespace x86
   {
     GET_TIMER().intr_enabled = false;
     APIC::get().timer_interrupt(false);
+    // disarm
+    if (tsc_khz != 0)
+        CPU::write_msr(IA32_TSC_DEADLINE, 0);
   }
 
   // used by soft-reset
@@ -160,3 +221,8 @@ namespace x86
     ticks_per_micro = tpm;
   }
 }
+
+uint8_t __arch_timer_irq() noexcept
+{
+  return PER_CPU(x86::timerdata).intr;
+}
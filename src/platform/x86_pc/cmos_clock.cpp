@@ -22,6 +22,7 @@
 #include <os.hpp>
 #include <info>
 #include "pit.hpp"
+#include <kernel/cpuid.hpp>
 #include <rtc>
 #include <util/units.hpp>
 
@@ -68,6 +69,12 @@ namespace x86
 
   KHz CMOS_clock::get_tsc_khz()
   {
+    // Sampling takes a while, so prefer what the CPU reports
+    const auto khz = CPUID::tsc_khz();
+    if (khz != 0) {
+      INFO("CMOS", "TSC frequency from CPUID");
+      return KHz(khz);
+    }
     // Estimate CPU frequency
     INFO("CMOS", "Estimating CPU-frequency");
     INFO2("|");
@@ -48,7 +48,7 @@ int kernel_main(int, char * *, char * *)
 {
   KDEBUG("<kernel_main> libc initialization complete \n");
   kernel::state().libc_initialized = true;
-  kernel::diag::hook<kernel::diag::post_init_libc>();
+  kernel::diag::hook<kernel::diag::post_init_libc>("libc");
   KDEBUG("<kernel_main> OS start \n");
 
   // Initialize early OS, platform and devices
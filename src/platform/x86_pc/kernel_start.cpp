@@ -15,6 +15,7 @@
 // limitations under the License.
 
 #include <kernel.hpp>
+#include <kernel/boot_trace.hpp>
 #include <kernel/rng.hpp>
 #include <kernel/diag.hpp>
 #include <os.hpp>
@@ -72,6 +73,7 @@ extern "C"
 __attribute__((no_sanitize("all")))
 void kernel_start(uint32_t magic, uint32_t addr)
 {
+  const uint64_t boot_cycles = os::Arch::cpu_cycles();
   KDEBUG("\n//////////////////  IncludeOS kernel start ////////////////// \n");
   KDEBUG("* Booted with magic 0x%x, grub @ 0x%x \n",
           magic, addr);
@@ -99,11 +101,15 @@ void kernel_start(uint32_t magic, uint32_t addr)
   KDEBUG("* Moving symbols. \n");
   // Preserve symbols from the ELF binary
   free_mem_begin += _move_symbols(free_mem_begin);
+  const uint64_t symbols_cycles = os::Arch::cpu_cycles();
   KDEBUG("* Free mem moved to: %p \n", (void*) free_mem_begin);
 
   KDEBUG("* Init .bss\n");
   _init_bss();
-  kernel::diag::hook<kernel::diag::post_bss>();
+  // the boot trace lives in .bss
+  kernel::boot_trace::begin(boot_cycles);
+  kernel::boot_trace::mark("symbols", symbols_cycles);
+  kernel::diag::hook<kernel::diag::post_bss>("bss");
 
   // Instantiate machine
   size_t memsize = memory_end - free_mem_begin;
@@ -111,10 +117,11 @@ void kernel_start(uint32_t magic, uint32_t addr)
 
   KDEBUG("* Init ELF parser\n");
   _init_elf_parser();
+  kernel::boot_trace::mark("elf parser");
 
   // Begin portable HAL initialization
   __machine->init();
-  kernel::diag::hook<kernel::diag::post_machine_init>();
+  kernel::diag::hook<kernel::diag::post_machine_init>("machine init");
 
   // TODO: Move more stuff into Machine::init
   RNG::init();
@@ -124,6 +131,7 @@ void kernel_start(uint32_t magic, uint32_t addr)
 
   KDEBUG("* Init CPU exceptions\n");
   x86::idt_initialize_for_cpu(0);
+  kernel::boot_trace::mark("rng, crash contexts, idt");
 
   x86::init_libc(magic, addr);
 }
@@ -22,6 +22,7 @@
 #include <kernel.hpp>
 #include <os.hpp>
 #include <rtc>
+#include <kernel/boot_trace.hpp>
 #include <kernel/events.hpp>
 #include <kernel/memory.hpp>
 #include <kprint>
@@ -110,6 +111,7 @@ void kernel::start(uint32_t boot_magic, uint32_t boot_addr)
   // PAGING //
   PROFILE("Enable paging");
   __arch_init_paging();
+  kernel::boot_trace::mark("paging");
 
   // BOOT METHOD //
   PROFILE("Multiboot / legacy");
@@ -171,6 +173,7 @@ void kernel::start(uint32_t boot_magic, uint32_t boot_addr)
   MYINFO("Virtual memory map");
   for (const auto& entry : memmap)
       INFO2("%s", entry.second.to_string().c_str());
+  kernel::boot_trace::mark("memory map");
 
   PROFILE("Platform init");
   __platform_init();
@@ -178,6 +181,7 @@ void kernel::start(uint32_t boot_magic, uint32_t boot_addr)
   PROFILE("RTC init");
   // Realtime/monotonic clock
   RTC::init();
+  kernel::boot_trace::mark("rtc");
 }
 
 extern void __arch_poweroff();
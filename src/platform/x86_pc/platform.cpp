@@ -23,6 +23,7 @@
 #include "smbios.hpp"
 #include "smp.hpp"
 #include <arch/x86/gdt.hpp>
+#include <kernel/boot_trace.hpp>
 #include <kernel/events.hpp>
 #include <hw/pci_manager.hpp>
 #include <kernel.hpp>
@@ -57,6 +58,7 @@ void __platform_init()
 
   // read SMBIOS tables
   x86::SMBIOS::init();
+  kernel::boot_trace::mark("acpi, smbios");
 
   // enable fs/gs for local APIC
   INFO("x86", "Setting up GDT, TLS, IST");
@@ -72,6 +74,7 @@ void __platform_init()
 
   // setup APIC, APIC timer, SMP etc.
   x86::APIC::init();
+  kernel::boot_trace::mark("apic");
 
   // enable interrupts
   MYINFO("Enabling interrupts");
@@ -80,6 +83,7 @@ void __platform_init()
   // initialize and start registered APs found in ACPI-tables
 #ifdef INCLUDEOS_SMP_ENABLE
   x86::init_SMP();
+  kernel::boot_trace::mark("smp");
 #endif
 
   // Setup kernel clocks
@@ -90,26 +94,31 @@ void __platform_init()
     kernel::state().cpu_khz = x86::Clocks::get_khz();
   }
   INFO2("+--> %f MHz", os::cpu_freq().count() / 1000.0);
+  kernel::boot_trace::mark("clocks");
 
   // Note: CPU freq must be known before we can start timer system
   // Initialize APIC timers and timer systems
   // Deferred call to Service::ready() when calibration is complete
   x86::APIC_Timer::calibrate();
+  kernel::boot_trace::mark("apic timer");
 
   INFO2("Initializing drivers");
   extern kernel::ctor_t __driver_ctors_start;
   extern kernel::ctor_t __driver_ctors_end;
   kernel::run_ctors(&__driver_ctors_start, &__driver_ctors_end);
+  kernel::boot_trace::mark("driver ctors");
 
   // Scan PCI buses
   hw::PCI_manager::init();
+  kernel::boot_trace::mark("pci probe");
   // Initialize storage devices
   hw::PCI_manager::init_devices(PCI::STORAGE);
   kernel::state().block_drivers_ready = true;
-  // Initialize network devices
+  // Initialize network devices, in parallel on the APs when possible
   hw::PCI_manager::init_devices(PCI::NIC);
   // Print registered devices
   os::machine().print_devices();
+  kernel::boot_trace::mark("devices");
 }
 
 #ifdef ARCH_i686
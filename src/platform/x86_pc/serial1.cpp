@@ -28,9 +28,16 @@ void __serial_print1(const char* cstr)
     hw::outb(port, *cstr++);
   }
 }
+// Set by hw::Serial when output on port 1 is buffered
+extern "C" __attribute__((weak)) void (*__serial_print_buffered)(const char*, size_t);
+
 extern "C"
 void __serial_print(const char* str, size_t len)
 {
+  if (&__serial_print_buffered != nullptr and __serial_print_buffered != nullptr) {
+    __serial_print_buffered(str, len);
+    return;
+  }
   init_if_needed();
   for (size_t i = 0; i < len; i++) {
     while (not (hw::inb(port + 5) & 0x20));
@@ -201,14 +201,16 @@ namespace x86 {
       write(xAPIC_ICRL, ICR_ALL_EXCLUDING_SELF | ICR_ASSERT | vector);
     }
 
-    void timer_init(const uint8_t timer_intr) noexcept override
+    void timer_init(const uint8_t timer_intr, bool tsc_deadline) noexcept override
     {
-      static const uint32_t TIMER_ONESHOT = 0x0;
+      static const uint32_t TIMER_ONESHOT  = 0x0;
+      static const uint32_t TIMER_DEADLINE = 0x40000;
+      const uint32_t mode = (tsc_deadline) ? TIMER_DEADLINE : TIMER_ONESHOT;
       // decrement every other tick
       write(xAPIC_TMRDIV, 0x1);
-      // start in one-shot mode and set the interrupt vector
-      // but also disable interrupts
-      write(xAPIC_LVT_TMR, TIMER_ONESHOT | (32+timer_intr) | INTR_MASK);
+      // start in one-shot (or TSC-deadline) mode and set the interrupt
+      // vector but also disable interrupts
+      write(xAPIC_LVT_TMR, mode | (32+timer_intr) | INTR_MASK);
     }
     void timer_begin(uint32_t value) noexcept override
     {
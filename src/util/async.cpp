@@ -14,102 +14,317 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
-
 #include <async>
 #include <debug>
+#include <expects>
 #include <likely>
 #include <memory>
+#include <os>
+#include <statman>
+#include <vector>
 
 inline unsigned roundup(unsigned n, unsigned div) {
   return (n + div - 1) / div;
 }
 
-void Async::upload_file(
-    Disk          disk,
-    const Dirent& ent,
-    Stream*       stream,
-    on_after_func callback,
-    const size_t  CHUNK_SIZE)
+namespace {
+
+/**
+ * Reads a file in chunks, keeping up to depth chunks read ahead,
+ * and hands them to a sink in file order, as fast as the sink allows.
+ */
+class Transfer : public std::enable_shared_from_this<Transfer>
 {
-  disk_transfer(disk, ent,
-  [stream] (fs::buffer_t buffer,
-            next_func    next) mutable
+public:
+  Transfer(Async::Disk disk, const Async::Dirent& ent,
+           Async::on_after_func callback, size_t chunk_size, size_t depth)
+    : disk_{std::move(disk)}, ent_{ent}, callback_{std::move(callback)},
+      chunk_size_{chunk_size}, chunks_{roundup(ent.size(), chunk_size)},
+      slots_(depth)
   {
-    auto length = buffer->size();
-    // temp
-    stream->on_write(
-      net::tcp::Connection::WriteCallback::make_packed(
-      [length, next] (size_t n) {
-
-        // if all data written, go to next chunk
-        debug("<Async::upload_file> %u / %u\n", n, length);
-        next(n == length);
-      })
-    );
+    Expects(chunk_size > 0 and depth > 0);
+  }
+
+  virtual ~Transfer() = default;
+
+  void start()
+  {
+    started_ = os::nanos_since_boot();
+    pump();
+  }
+
+protected:
+  // sink interface
+  virtual bool sink_ready() const = 0;
+  virtual void sink_write(fs::buffer_t) = 0;
+  virtual bool sink_drained() const = 0;
+  virtual void on_finish(bool /*good*/) {}
+
+  bool finished() const noexcept
+  { return finished_; }
+
+  uint64_t elapsed_ns() const noexcept
+  { return os::nanos_since_boot() - started_; }
+
+  void pump();
+  void finish(fs::error_t err, bool good);
+
+  uint32_t stalls_ = 0;
+
+private:
+  void read_chunk(size_t idx);
+  void on_read(size_t idx, fs::error_t err, fs::buffer_t buffer);
+
+  Async::Disk          disk_;
+  Async::Dirent        ent_;
+  Async::on_after_func callback_;
+  const size_t         chunk_size_;
+  const size_t         chunks_;
+  // chunk N is kept in slot N % depth until it's written
+  std::vector<fs::buffer_t> slots_;
+  size_t   next_read_  = 0;
+  size_t   next_write_ = 0;
+  uint64_t started_    = 0;
+  bool     finished_   = false;
+  bool     pumping_    = false;
+  bool     again_      = false;
+};
 
-    // write chunk to TCP connection
-    stream->write(buffer);
+void Transfer::pump()
+{
+  // reads and writes may complete synchronously, so don't recurse
+  if (pumping_) {
+    again_ = true;
+    return;
+  }
+  // the sink may let go of us when we finish
+  auto self = shared_from_this();
+  pumping_ = true;
+  do {
+    again_ = false;
+    if (finished_) break;
+
+    // hand over chunks in order, as long as the sink accepts them
+    while (next_write_ < next_read_)
+    {
+      auto& slot = slots_[next_write_ % slots_.size()];
+      if (slot == nullptr) break;
+      if (not sink_ready()) {
+        stalls_++;
+        break;
+      }
+      auto buffer = std::move(slot);
+      slot = nullptr;
+      next_write_++;
+      sink_write(std::move(buffer));
+      if (finished_) break;
+    }
+    if (finished_) break;
+
+    // keep the read window full
+    while (next_read_ < chunks_ and next_read_ - next_write_ < slots_.size())
+    {
+      read_chunk(next_read_++);
+      if (finished_) break;
+    }
+    if (finished_) break;
 
-  }, callback, CHUNK_SIZE);
+    if (next_write_ == chunks_ and sink_drained())
+      finish(fs::no_error, true);
+
+  } while (again_);
+  pumping_ = false;
 }
 
-void Async::disk_transfer(
-    Disk          disk,
-    const Dirent& ent,
-    on_write_func write_func,
-    on_after_func callback,
-    const size_t  CHUNK_SIZE)
+void Transfer::read_chunk(size_t idx)
 {
-  typedef delegate<void(size_t)> next_func_t;
-  auto next = std::make_shared<next_func_t> ();
-  auto weak_next = std::weak_ptr<next_func_t>(next);
+  disk_->fs().read(
+    ent_,
+    idx * chunk_size_,
+    chunk_size_,
+    fs::on_read_func::make_packed(
+    [self = shared_from_this(), idx] (fs::error_t err, fs::buffer_t buffer)
+    {
+      self->on_read(idx, err, std::move(buffer));
+    })
+  );
+}
 
-  *next = next_func_t::make_packed(
-  [weak_next, disk, ent, write_func, callback, CHUNK_SIZE] (size_t pos) {
+void Transfer::on_read(size_t idx, fs::error_t err, fs::buffer_t buffer)
+{
+  if (finished_) return;
+  if (UNLIKELY(err)) {
+    printf("%s\n", err.to_string().c_str());
+    finish(err, false);
+    return;
+  }
+  if (UNLIKELY(buffer == nullptr)) {
+    finish({fs::error_t::E_IO, "Read failed"}, false);
+    return;
+  }
+  debug("<Async> chunk=%zu len=%zu\n", idx, buffer->size());
+  slots_[idx % slots_.size()] = std::move(buffer);
+  pump();
+}
 
-    // number of write calls necessary
-    const size_t writes = roundup(ent.size(), CHUNK_SIZE);
+void Transfer::finish(fs::error_t err, bool good)
+{
+  if (finished_) return;
+  // the sink may let go of us when we finish
+  auto self = shared_from_this();
+  finished_ = true;
+  for (auto& slot : slots_) slot = nullptr;
+  on_finish(good);
+  callback_(err, good);
+}
+
+/** Writes to a stream, held back by the size of its write queue */
+class Upload : public Transfer
+{
+public:
+  Upload(Async::Disk disk, const Async::Dirent& ent, Async::Stream* stream,
+         Async::on_after_func callback, size_t chunk_size, size_t depth,
+         size_t max_queued)
+    : Transfer{std::move(disk), ent, std::move(callback), chunk_size, depth},
+      stream_{stream}, max_queued_{max_queued}
+  {}
 
-    // done condition
-    if (pos >= writes) {
-      callback(fs::no_error, true);
+  void start()
+  {
+    auto self = std::static_pointer_cast<Upload>(shared_from_this());
+    // the stream owns this callback (and us) until we finish
+    stream_->on_write(
+      net::Stream::WriteCallback::make_packed(
+      [self] (size_t n) { self->on_written(n); })
+    );
+    Transfer::start();
+  }
+
+private:
+  bool sink_ready() const override
+  { return queued_ < max_queued_; }
+
+  void sink_write(fs::buffer_t buffer) override
+  {
+    if (UNLIKELY(not stream_->is_writable())) {
+      finish({fs::error_t::E_IO, "Write failed"}, false);
+      return;
+    }
+    queued_ += buffer->size();
+    bytes_  += buffer->size();
+    stream_->write(std::move(buffer));
+  }
+
+  bool sink_drained() const override
+  { return queued_ == 0; }
+
+  void on_written(size_t n)
+  {
+    if (finished()) return;
+    debug("<Async::upload_file> %zu written, %zu queued\n", n, queued_);
+    queued_ -= std::min(n, queued_);
+    if (UNLIKELY(not stream_->is_writable() and not sink_drained())) {
+      finish({fs::error_t::E_IO, "Write failed"}, false);
       return;
     }
-    auto next = weak_next.lock();
-    // read chunk from file
-    disk->fs().read(
-      ent,
-      pos * CHUNK_SIZE,
-      CHUNK_SIZE,
-      fs::on_read_func::make_packed(
-      [next, pos, write_func, callback] (
-          fs::error_t  err,
-          fs::buffer_t buffer)
+    pump();
+  }
+
+  void on_finish(bool good) override
+  {
+    // let go of the stream, and the stream of us
+    stream_->on_write(nullptr);
+    const auto ns = elapsed_ns();
+
+    static auto& stat_files  = Statman::get().get_or_create(Stat::UINT64, "async.upload.files").get_uint64();
+    static auto& stat_bytes  = Statman::get().get_or_create(Stat::UINT64, "async.upload.bytes").get_uint64();
+    static auto& stat_stalls = Statman::get().get_or_create(Stat::UINT64, "async.upload.stalls").get_uint64();
+    static auto& stat_kbps   = Statman::get().get_or_create(Stat::UINT64, "async.upload.last_kbps").get_uint64();
+    if (good) stat_files++;
+    stat_bytes  += bytes_;
+    stat_stalls += stalls_;
+    if (ns > 0) stat_kbps = bytes_ * 8'000'000ull / ns;
+
+    debug("<Async::upload_file> %zu bytes in %lu us, %u stalls\n",
+          bytes_, (unsigned long) (ns / 1000), stalls_);
+  }
+
+  Async::Stream* stream_;
+  const size_t   max_queued_;
+  size_t         queued_ = 0;
+  size_t         bytes_  = 0;
+};
+
+/** Hands chunks to a callback, one at a time */
+class Callback_transfer : public Transfer
+{
+public:
+  Callback_transfer(Async::Disk disk, const Async::Dirent& ent,
+                    Async::on_write_func write_func,
+                    Async::on_after_func callback,
+                    size_t chunk_size, size_t depth)
+    : Transfer{std::move(disk), ent, std::move(callback), chunk_size, depth},
+      write_func_{std::move(write_func)}
+  {}
+
+private:
+  bool sink_ready() const override
+  { return not busy_; }
+
+  void sink_write(fs::buffer_t buffer) override
+  {
+    busy_ = true;
+    auto self = std::static_pointer_cast<Callback_transfer>(shared_from_this());
+    write_func_(
+      std::move(buffer),
+      Async::next_func::make_packed(
+      [self] (bool good)
       {
-        debug("<Async> len=%lu\n", buffer->size());
-        if (err) {
-          printf("%s\n", err.to_string().c_str());
-          callback(err, false);
-          return;
-        }
-
-        // call write callback with data
-        write_func(
-          buffer,
-          next_func::make_packed(
-          [next, pos, callback] (bool good)
-          {
-            // if the write succeeded, call next
-            if (LIKELY(good))
-              (*next)(pos+1);
-            else
-              // otherwise, fail
-              callback({fs::error_t::E_IO, "Write failed"}, false);
-          })
-        );
+        self->busy_ = false;
+        // if the write succeeded, continue
+        if (LIKELY(good))
+          self->pump();
+        else
+          // otherwise, fail
+          self->finish({fs::error_t::E_IO, "Write failed"}, false);
       })
     );
-  });
-  // start async loop
-  (*next)(0);
+  }
+
+  bool sink_drained() const override
+  { return not busy_; }
+
+  Async::on_write_func write_func_;
+  bool busy_ = false;
+};
+
+} //< namespace
+
+void Async::upload_file(
+    Disk          disk,
+    const Dirent& ent,
+    Stream*       stream,
+    on_after_func callback,
+    const size_t  chunk_size,
+    const size_t  depth,
+    const size_t  max_queued)
+{
+  auto upload = std::make_shared<Upload>(
+      std::move(disk), ent, stream, std::move(callback),
+      chunk_size, depth, max_queued);
+  upload->start();
+}
+
+void Async::disk_transfer(
+    Disk          disk,
+    const Dirent& ent,
+    on_write_func write_func,
+    on_after_func callback,
+    const size_t  chunk_size,
+    const size_t  depth)
+{
+  auto transfer = std::make_shared<Callback_transfer>(
+      std::move(disk), ent, std::move(write_func), std::move(callback),
+      chunk_size, depth);
+  transfer->start();
 }
@@ -0,0 +1,311 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2017 Oslo and Akershus University College of Applied Sciences
+// and Alfred Bratterud
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <util/path_router.hpp>
+
+#include <algorithm>
+#include <charconv>
+
+namespace path2regex {
+
+static inline char lower(const char c) noexcept {
+  return (c >= 'A' and c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static bool option(const Options& options, const char* name, const bool def) {
+  auto it = options.find(name);
+  return (it not_eq options.end()) ? it->second : def;
+}
+
+static bool all_digits(std::string_view str) noexcept {
+  return std::all_of(str.begin(), str.end(), [](const char c) { return c >= '0' and c <= '9'; });
+}
+
+std::string_view Router::Match::get(std::string_view name) const noexcept {
+  for (const auto& param : *this)
+    if (param.name == name)
+      return param.value;
+  return {};
+}
+
+std::optional<uint64_t> Router::Match::get_uint(std::string_view name) const noexcept {
+  const auto value = get(name);
+  uint64_t result;
+  const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+  if (value.empty() or ec not_eq std::errc{} or ptr not_eq value.data() + value.size())
+    return std::nullopt;
+  return result;
+}
+
+Router::Router(const Options& options)
+  : options_{options},
+    strict_{option(options, "strict", false)},
+    sensitive_{option(options, "sensitive", false)},
+    end_{option(options, "end", true)},
+    nodes_(1)
+{}
+
+Router::Route_id Router::add(const std::string& path) {
+  const Route_id id = routes_++;
+  info_.emplace_back();
+
+  const auto tokens = parse(path);
+  std::vector<Segment> segments;
+
+  if (not compile(tokens, segments)) {
+    Fallback fallback{id, tokens_to_regex(tokens, options_), {}};
+    tokens_to_keys(tokens, fallback.keys);
+    fallbacks_.push_back(std::move(fallback));
+    return id;
+  }
+
+  // In non-strict mode a trailing slash is optional, so "/users/" is
+  // stored the same way as "/users"
+  if (not strict_ and not segments.empty()
+      and segments.back().kind == Segment::STATIC and segments.back().text.empty())
+    segments.pop_back();
+
+  uint32_t node = 0;
+  for (auto& segment : segments) {
+    if (segment.kind == Segment::STATIC) {
+      if (not sensitive_)
+        std::transform(segment.text.begin(), segment.text.end(), segment.text.begin(), lower);
+      node = static_child(node, segment.text);
+    }
+    else {
+      // the route also ends before an optional (trailing) parameter
+      if (segment.optional)
+        set_route(node, id);
+      node = param_child(node, segment.type);
+      info_[id].names.push_back(std::move(segment.text));
+    }
+  }
+  set_route(node, id);
+  return id;
+}
+
+Router::Match Router::match(std::string_view path) const {
+  Match m;
+  size_t len = path.size();
+  if (not strict_ and len > 0 and path.back() == '/')
+    --len;
+
+  const bool found = (path.empty() or path.front() == '/')
+    and match_node(0, path, len, 0, m);
+
+  // fallbacks added before the route found in the tree take precedence
+  for (const auto& fallback : fallbacks_) {
+    if (found and fallback.route > m.route)
+      break;
+    Match fm;
+    if (match_fallback(fallback, path, fm))
+      return fm;
+  }
+
+  return found ? m : Match{};
+}
+
+bool Router::compile(const Tokens& tokens, std::vector<Segment>& segments) {
+  bool open = false;
+  size_t params = 0;
+
+  for (const auto& token : tokens) {
+    if (token.is_string) {
+      for (const char c : token.name) {
+        if (c == '/') {
+          segments.push_back({Segment::STATIC, {}, Edge_type::SEGMENT, false});
+          open = true;
+        }
+        else if (open)
+          segments.back().text += c;
+        else
+          return false; // text directly after a parameter
+      }
+      continue;
+    }
+
+    if (token.prefix not_eq "/" or token.partial or token.repeat)
+      return false;
+
+    Edge_type type;
+    if (token.pattern == "[^/]+?")
+      type = Edge_type::SEGMENT;
+    else if (token.pattern == "\\d+")
+      type = Edge_type::INTEGER;
+    else if (token.pattern == ".*" and not token.optional)
+      type = Edge_type::WILDCARD;
+    else
+      return false; // custom pattern
+
+    if (++params > MAX_PARAMS)
+      return false;
+
+    segments.push_back({Segment::PARAM, token.name, type, token.optional});
+    open = false;
+  }
+
+  // optional parameters and wildcards are only supported at the end
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    const auto& segment = segments[i];
+    if (segment.kind == Segment::PARAM
+        and (segment.optional or segment.type == Edge_type::WILDCARD))
+      return false;
+  }
+  return true;
+}
+
+uint32_t Router::static_child(uint32_t node, const std::string& label) {
+  auto& statics = nodes_[node].statics;
+  auto it = std::lower_bound(statics.begin(), statics.end(), label,
+    [](const auto& entry, const std::string& l) { return entry.first < l; });
+
+  if (it not_eq statics.end() and it->first == label)
+    return it->second;
+
+  const auto child = static_cast<uint32_t>(nodes_.size());
+  nodes_[node].statics.insert(it, {label, child});
+  nodes_.emplace_back();
+  return child;
+}
+
+uint32_t Router::param_child(uint32_t node, Edge_type type) {
+  auto& params = nodes_[node].params;
+  for (const auto& edge : params)
+    if (edge.type == type)
+      return edge.child;
+
+  const auto child = static_cast<uint32_t>(nodes_.size());
+  // keep the edges ordered from most to least specific
+  auto it = std::upper_bound(params.begin(), params.end(), type,
+    [](const Edge_type t, const Param_edge& edge) {
+      // integers are tried before any segment
+      auto rank = [](Edge_type e) {
+        return e == Edge_type::INTEGER ? 0 : (e == Edge_type::SEGMENT ? 1 : 2);
+      };
+      return rank(t) < rank(edge.type);
+    });
+  nodes_[node].params.insert(it, {type, child});
+  nodes_.emplace_back();
+  return child;
+}
+
+void Router::set_route(uint32_t node, Route_id id) {
+  // the first route added wins
+  if (nodes_[node].route == NO_ROUTE)
+    nodes_[node].route = id;
+}
+
+bool Router::match_node(uint32_t idx, std::string_view path, size_t len,
+                        size_t pos, Match& m) const
+{
+  const auto& node = nodes_[idx];
+
+  if (pos >= len) {
+    if (finish(idx, m))
+      return true;
+    // "/files/" still matches "/files/*" with an empty wildcard
+    if (pos < path.size()) {
+      for (const auto& edge : node.params) {
+        if (edge.type not_eq Edge_type::WILDCARD)
+          continue;
+        m.params[m.count++].value = path.substr(pos + 1);
+        if (finish(edge.child, m))
+          return true;
+        --m.count;
+      }
+    }
+    return false;
+  }
+
+  // path[pos] is a delimiter, extract the next segment
+  const size_t begin = pos + 1;
+  size_t next = path.find('/', begin);
+  if (next == std::string_view::npos or next > len)
+    next = len;
+  const auto segment = path.substr(begin, next - begin);
+
+  // static segments first
+  const auto& statics = node.statics;
+  auto it = std::lower_bound(statics.begin(), statics.end(), segment,
+    [this](const auto& entry, std::string_view seg) {
+      if (sensitive_)
+        return std::string_view{entry.first} < seg;
+      return std::lexicographical_compare(entry.first.begin(), entry.first.end(),
+        seg.begin(), seg.end(),
+        [](const char a, const char b) { return a < lower(b); });
+    });
+
+  if (it not_eq statics.end() and it->first.size() == segment.size()
+      and std::equal(segment.begin(), segment.end(), it->first.begin(),
+        [this](const char a, const char b) { return (sensitive_ ? a : lower(a)) == b; })
+      and match_node(it->second, path, len, next, m))
+    return true;
+
+  // then parameters, backtracking if the rest of the path doesn't match
+  for (const auto& edge : node.params) {
+    if (m.count == MAX_PARAMS)
+      break;
+
+    if (edge.type == Edge_type::WILDCARD) {
+      m.params[m.count++].value = path.substr(begin);
+      if (finish(edge.child, m))
+        return true;
+      --m.count;
+      continue;
+    }
+
+    if (segment.empty() or (edge.type == Edge_type::INTEGER and not all_digits(segment)))
+      continue;
+
+    m.params[m.count++].value = segment;
+    if (match_node(edge.child, path, len, next, m))
+      return true;
+    --m.count;
+  }
+
+  // in non-ending mode a route matches any path it's a prefix of
+  return not end_ and finish(idx, m);
+}
+
+bool Router::finish(uint32_t node, Match& m) const {
+  const auto route = nodes_[node].route;
+  if (route == NO_ROUTE)
+    return false;
+
+  m.route = route;
+  const auto& names = info_[route].names;
+  for (size_t i = 0; i < m.count and i < names.size(); ++i)
+    m.params[i].name = names[i];
+  return true;
+}
+
+bool Router::match_fallback(const Fallback& fallback, std::string_view path, Match& m) const {
+  std::cmatch res;
+  if (not std::regex_search(path.data(), path.data() + path.size(), res, fallback.regex))
+    return false;
+
+  m.route = fallback.route;
+  for (size_t i = 0; i < fallback.keys.size() and m.count < MAX_PARAMS; ++i) {
+    if (not res[i + 1].matched)
+      continue;
+    m.params[m.count++] = {fallback.keys[i].name,
+      path.substr(res.position(i + 1), res.length(i + 1))};
+  }
+  return true;
+}
+
+} //< namespace path2regex
@@ -0,0 +1,387 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <util/syslog_ring.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <expects>
+
+/**
+ * Records are a Header followed by the arguments, each a tag byte and
+ * the value: 'i' int64, 'u' uint64, 'd' double, 'p' pointer,
+ * 's' length byte and the characters (without terminator).
+ */
+namespace {
+
+  enum Length { NONE, HH, H, L, LL, J, Z, T, BIG_L };
+
+  struct Spec {
+    const char* start;   // the '%'
+    const char* length;  // where the length modifier starts
+    Length      len;
+    char        conv;
+    const char* next;    // after the conversion
+    int         stars;   // '*' width/precision arguments
+  };
+
+  // parse a conversion specification, p points at the char after '%'
+  bool parse_spec(const char* p, Spec& spec)
+  {
+    spec.start = p - 1;
+    spec.stars = 0;
+    while (*p and strchr("-+ #0'", *p)) p++;
+    if (*p == '*') { spec.stars++; p++; }
+    else while (*p >= '0' and *p <= '9') p++;
+    if (*p == '.') {
+      p++;
+      if (*p == '*') { spec.stars++; p++; }
+      else while (*p >= '0' and *p <= '9') p++;
+    }
+    spec.length = p;
+    spec.len = NONE;
+    switch (*p) {
+      case 'h': spec.len = (p[1] == 'h') ? HH : H; p += (p[1] == 'h') ? 2 : 1; break;
+      case 'l': spec.len = (p[1] == 'l') ? LL : L; p += (p[1] == 'l') ? 2 : 1; break;
+      case 'j': spec.len = J; p++; break;
+      case 'z': spec.len = Z; p++; break;
+      case 't': spec.len = T; p++; break;
+      case 'L': spec.len = BIG_L; p++; break;
+      default: break;
+    }
+    spec.conv = *p;
+    if (spec.conv == 0 or not strchr("diuoxXcsfFeEgGaApn", spec.conv))
+      return false;
+    spec.next = p + 1;
+    return true;
+  }
+
+  struct Writer {
+    uint8_t* pos;
+    uint8_t* end;
+    bool     full = false;
+
+    void put(const char tag, const void* value, const size_t len)
+    {
+      if (pos + 1 + len > end) { full = true; return; }
+      *pos++ = tag;
+      memcpy(pos, value, len);
+      pos += len;
+    }
+    void put_int(int64_t v)  { put('i', &v, sizeof(v)); }
+    void put_uint(uint64_t v) { put('u', &v, sizeof(v)); }
+
+    void put_string(const char* str)
+    {
+      if (str == nullptr) str = "(null)";
+      const uint8_t len = strnlen(str, Syslog_ring::max_string);
+      if (pos + 2 + len > end) { full = true; return; }
+      *pos++ = 's';
+      *pos++ = len;
+      memcpy(pos, str, len);
+      pos += len;
+    }
+  };
+
+  struct Reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+
+    template <typename T>
+    bool get(const char tag, T& value)
+    {
+      if (pos + 1 + sizeof(T) > end or *pos != tag) return false;
+      memcpy(&value, pos + 1, sizeof(T));
+      pos += 1 + sizeof(T);
+      return true;
+    }
+
+    bool get_string(char* out)
+    {
+      if (pos + 2 > end or *pos != 's') return false;
+      const uint8_t len = pos[1];
+      if (pos + 2 + len > end) return false;
+      memcpy(out, pos + 2, len);
+      out[len] = 0;
+      pos += 2 + len;
+      return true;
+    }
+  };
+
+  void encode_arg(const Spec& spec, Writer& w, va_list& args)
+  {
+    switch (spec.conv) {
+    case 'd': case 'i':
+      switch (spec.len) {
+        case L:  w.put_int(va_arg(args, long)); break;
+        case LL: w.put_int(va_arg(args, long long)); break;
+        case J:  w.put_int(va_arg(args, intmax_t)); break;
+        case Z:  w.put_int(va_arg(args, ssize_t)); break;
+        case T:  w.put_int(va_arg(args, ptrdiff_t)); break;
+        case H:  w.put_int((short) va_arg(args, int)); break;
+        case HH: w.put_int((signed char) va_arg(args, int)); break;
+        default: w.put_int(va_arg(args, int));
+      }
+      break;
+    case 'u': case 'o': case 'x': case 'X':
+      switch (spec.len) {
+        case L:  w.put_uint(va_arg(args, unsigned long)); break;
+        case LL: w.put_uint(va_arg(args, unsigned long long)); break;
+        case J:  w.put_uint(va_arg(args, uintmax_t)); break;
+        case Z:  w.put_uint(va_arg(args, size_t)); break;
+        case T:  w.put_uint(va_arg(args, ptrdiff_t)); break;
+        case H:  w.put_uint((unsigned short) va_arg(args, unsigned int)); break;
+        case HH: w.put_uint((unsigned char) va_arg(args, unsigned int)); break;
+        default: w.put_uint(va_arg(args, unsigned int));
+      }
+      break;
+    case 'c':
+      w.put_int(va_arg(args, int));
+      break;
+    case 'f': case 'F': case 'e': case 'E':
+    case 'g': case 'G': case 'a': case 'A': {
+      const double v = (spec.len == BIG_L) ? (double) va_arg(args, long double)
+                                           : va_arg(args, double);
+      w.put('d', &v, sizeof(v));
+      break;
+    }
+    case 's':
+      w.put_string(va_arg(args, const char*));
+      break;
+    case 'p': {
+      const void* v = va_arg(args, void*);
+      w.put('p', &v, sizeof(v));
+      break;
+    }
+    case 'n':
+      (void) va_arg(args, void*); // not supported, skip
+      break;
+    }
+  }
+
+  template <typename T>
+  int emit(char* out, size_t len, const char* fmt, const int* stars, int nstars, T value)
+  {
+    switch (nstars) {
+      case 0:  return snprintf(out, len, fmt, value);
+      case 1:  return snprintf(out, len, fmt, stars[0], value);
+      default: return snprintf(out, len, fmt, stars[0], stars[1], value);
+    }
+  }
+
+} // < anonymous namespace
+
+Syslog_ring::Syslog_ring(size_t capacity)
+  : data_{new uint8_t[capacity]}, capacity_{capacity}
+{
+  Expects(capacity >= 256 and (capacity & (capacity - 1)) == 0);
+}
+
+bool Syslog_ring::record(int priority, const char* fmt, va_list ap, int saved_errno)
+{
+  // encode the arguments on the stack first, to know the record size
+  uint8_t args_buf[1024];
+  Writer w {args_buf, args_buf + sizeof(args_buf)};
+
+  va_list args;
+  va_copy(args, ap);
+  for (const char* p = fmt; *p and not w.full; p++)
+  {
+    if (*p != '%') continue;
+    if (p[1] == '%' or p[1] == 'm') { p++; continue; }
+
+    Spec spec;
+    if (not parse_spec(p + 1, spec))
+      break; // formatted as far as we understood it
+    for (int i = 0; i < spec.stars; i++)
+      w.put_int(va_arg(args, int));
+    encode_arg(spec, w, args);
+    p = spec.next - 1;
+  }
+  va_end(args);
+
+  const size_t payload = w.pos - args_buf;
+  const size_t total = (sizeof(Header) + payload + 7) & ~size_t(7);
+
+  const size_t head = head_.load(std::memory_order_relaxed);
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  const size_t off  = head & (capacity_ - 1);
+  const size_t to_end = capacity_ - off;
+  const size_t needed = (to_end < total) ? to_end + total : total;
+
+  if (needed > capacity_ - (head - tail))
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  size_t pos = head;
+  if (to_end < total)
+  {
+    // pad to the end, records are always contiguous
+    if (to_end >= sizeof(Header))
+    {
+      Header pad {(uint32_t) to_end, -1, 0, 0, nullptr};
+      memcpy(&data_[off], &pad, sizeof(pad));
+    }
+    pos += to_end;
+  }
+
+  uint8_t* rec = &data_[pos & (capacity_ - 1)];
+  Header hdr {(uint32_t) total, (int16_t) priority, 0, saved_errno, fmt};
+  memcpy(rec, &hdr, sizeof(hdr));
+  memcpy(rec + sizeof(hdr), args_buf, payload);
+
+  head_.store(pos + total, std::memory_order_release);
+  return true;
+}
+
+size_t Syslog_ring::drain(Sink sink)
+{
+  char msg[max_message];
+  size_t count = 0;
+  size_t tail = tail_.load(std::memory_order_relaxed);
+
+  while (tail != head_.load(std::memory_order_acquire))
+  {
+    const size_t off = tail & (capacity_ - 1);
+    const size_t to_end = capacity_ - off;
+    if (to_end < sizeof(Header)) {
+      tail += to_end;
+      continue;
+    }
+
+    Header hdr;
+    memcpy(&hdr, &data_[off], sizeof(hdr));
+    if (hdr.priority < 0) {
+      tail += to_end;
+      continue;
+    }
+
+    const uint8_t* args = &data_[off] + sizeof(Header);
+    const size_t len = format(msg, sizeof(msg), hdr.fmt, args,
+                              &data_[off] + hdr.size, hdr.saved_errno);
+    // release the space before the sink, which may log again
+    tail += hdr.size;
+    tail_.store(tail, std::memory_order_release);
+
+    sink(hdr.priority, msg, len);
+    count++;
+  }
+  tail_.store(tail, std::memory_order_release);
+  return count;
+}
+
+size_t Syslog_ring::format(char* buf, size_t len, const char* fmt,
+                           const uint8_t* args, const uint8_t* end, int saved_errno)
+{
+  Expects(len > 0);
+  size_t pos = 0;
+  auto out = [&] (const char* str, size_t n) {
+    n = std::min(n, len - 1 - pos);
+    memcpy(buf + pos, str, n);
+    pos += n;
+  };
+
+  Reader r {args, end};
+  const char* p = fmt;
+  while (*p and pos < len - 1)
+  {
+    const char* pct = strchr(p, '%');
+    if (pct == nullptr) {
+      out(p, strlen(p));
+      break;
+    }
+    out(p, pct - p);
+    p = pct + 1;
+
+    if (*p == '%') { out("%", 1); p++; continue; }
+    if (*p == 'm') {
+      const char* err = strerror(saved_errno);
+      out(err, strlen(err));
+      p++;
+      continue;
+    }
+
+    Spec spec;
+    if (not parse_spec(p, spec)) {
+      // print the rest verbatim
+      out(pct, strlen(pct));
+      break;
+    }
+    p = spec.next;
+
+    int stars[2] = {0, 0};
+    bool ok = true;
+    for (int i = 0; i < spec.stars; i++) {
+      int64_t v = 0;
+      ok = ok and r.get('i', v);
+      stars[i] = v;
+    }
+    if (spec.conv == 'n' or not ok) continue;
+
+    // the spec without its length modifier, then our own
+    char sfmt[32];
+    const size_t plen = std::min<size_t>(spec.length - spec.start, sizeof(sfmt) - 4);
+    memcpy(sfmt, spec.start, plen);
+    size_t slen = plen;
+    const bool integer = strchr("diuoxX", spec.conv) != nullptr;
+    if (integer) { sfmt[slen++] = 'l'; sfmt[slen++] = 'l'; }
+    sfmt[slen++] = spec.conv;
+    sfmt[slen] = 0;
+
+    char* dst = buf + pos;
+    const size_t room = len - pos;
+    int n = 0;
+    switch (spec.conv) {
+    case 'd': case 'i': case 'c': {
+      int64_t v;
+      if (not r.get('i', v)) { buf[pos] = 0; return pos; }
+      n = (spec.conv == 'c') ? emit(dst, room, sfmt, stars, spec.stars, (int) v)
+                             : emit(dst, room, sfmt, stars, spec.stars, (long long) v);
+      break;
+    }
+    case 'u': case 'o': case 'x': case 'X': {
+      uint64_t v;
+      if (not r.get('u', v)) { buf[pos] = 0; return pos; }
+      n = emit(dst, room, sfmt, stars, spec.stars, (unsigned long long) v);
+      break;
+    }
+    case 's': {
+      char str[max_string + 1];
+      if (not r.get_string(str)) { buf[pos] = 0; return pos; }
+      n = emit(dst, room, sfmt, stars, spec.stars, (const char*) str);
+      break;
+    }
+    case 'p': {
+      const void* v;
+      if (not r.get('p', v)) { buf[pos] = 0; return pos; }
+      n = emit(dst, room, sfmt, stars, spec.stars, v);
+      break;
+    }
+    default: {
+      double v;
+      if (not r.get('d', v)) { buf[pos] = 0; return pos; }
+      n = emit(dst, room, sfmt, stars, spec.stars, v);
+    }
+    }
+    if (n > 0)
+      pos += std::min<size_t>(n, room - 1);
+  }
+  buf[pos] = 0;
+  return pos;
+}
@@ -16,10 +16,61 @@
 
 #include <syslogd>
 #include <service>
+#include <smp>
+#include <kernel/events.hpp>
+#include <util/syslog_ring.hpp>
+#include <cstring>
 #include <errno.h>		// errno
 #include <unistd.h>		// getpid
 
 std::unique_ptr<Syslog_facility> Syslog::fac_ = std::make_unique<Syslog_print>();
+bool Syslog::deferred_ = false;
+
+struct Deferred_log {
+  std::unique_ptr<Syslog_ring> ring;
+  uint8_t event = 0;
+};
+static SMP::Array<Deferred_log> deferred_logs;
+
+static Deferred_log& deferred_log()
+{
+  auto& log = PER_CPU(deferred_logs);
+  if (UNLIKELY(log.ring == nullptr)) {
+    log.ring  = std::make_unique<Syslog_ring>();
+    log.event = Events::get().subscribe(Syslog::flush);
+  }
+  return log;
+}
+
+/**
+ * Replace %m with the error message for err, escaping any % in it.
+ * Returns fmt itself if there is no %m.
+ */
+static const char* expand_errno(const char* fmt, char* buf, size_t len, int err)
+{
+  const char* m = strstr(fmt, "%m");
+  if (LIKELY(m == nullptr))
+    return fmt;
+
+  const char* errstr = strerror(err);
+  size_t pos = 0;
+  for (const char* p = fmt; *p and pos < len - 2; p++)
+  {
+    if (p[0] == '%' and p[1] == 'm') {
+      for (const char* e = errstr; *e and pos < len - 2; e++) {
+        if (*e == '%') buf[pos++] = '%';
+        buf[pos++] = *e;
+      }
+      p++;
+      continue;
+    }
+    buf[pos++] = *p;
+    // keep %% together, so %%m is not expanded
+    if (p[0] == '%' and p[1] == '%') buf[pos++] = *++p;
+  }
+  buf[pos] = 0;
+  return buf;
+}
 
 void Syslog::syslog(const int priority, const char* fmt, ...)
 {
@@ -34,13 +85,31 @@ void Syslog::syslog(const int priority, const char* fmt, va_list args)
 {
   // due to musl "bug" (strftime setting errno..)
   const int save_errno = errno;
-  // snprintf removes % if calling syslog with %m in addition to arguments
-  // Find %m here first and escape % if found
-  std::regex m_regex{"\\%m"};
-  std::string msg = std::regex_replace(fmt, m_regex, "%%m");
+
+  if (deferred_ and valid_priority(priority))
+  {
+    auto& log = deferred_log();
+    log.ring->record(priority, fmt, args, save_errno);
+    Events::get().trigger_event(log.event);
+    return;
+  }
+
+  /*
+    %m:
+    (The message body is generated from the message (argument) and following arguments
+    in the same manner as if these were arguments to printf(), except that the additional
+    conversion specification %m shall be recognized;)
+    it shall convert no arguments, shall cause the output of the error message string
+    associated with the value of errno on entry to syslog(), and may be mixed with argument
+    specifications of the "%n$" form. If a complete conversion specification with the m conversion
+    specifier character is not just %m, the behavior is undefined. A trailing <newline> may be
+    added if needed.
+  */
+  char fmt_buf[1024];
+  const char* format = expand_errno(fmt, fmt_buf, sizeof(fmt_buf), save_errno);
 
   char buf[2048];
-  vsnprintf(buf, sizeof(buf), msg.c_str(), args);
+  const int len = vsnprintf(buf, sizeof(buf), format, args);
 
 	/*
   	All syslog-calls comes through here in the end, so
@@ -57,30 +126,38 @@ void Syslog::syslog(const int priority, const char* fmt, va_list args)
   	syslog(LOG_ERR, "Syslog: Unknown priority %d. Message: %s", priority, buf);
     return;
   }
+  errno = save_errno;
+  send(priority, buf, std::min<size_t>(std::max(len, 0), sizeof(buf) - 1));
+}
+
+void Syslog::send(const int priority, const char* msg, const size_t len)
+{
  	fac_->set_priority(priority);
 
   /* Building the log message based on the facility used */
   std::string message = fac_->build_message_prefix(Service::binary_name());
-
- 	/*
- 		%m:
-		(The message body is generated from the message (argument) and following arguments
-		in the same manner as if these were arguments to printf(), except that the additional
-		conversion specification %m shall be recognized;)
-		it shall convert no arguments, shall cause the output of the error message string
-		associated with the value of errno on entry to syslog(), and may be mixed with argument
-		specifications of the "%n$" form. If a complete conversion specification with the m conversion
-		specifier character is not just %m, the behavior is undefined. A trailing <newline> may be
-		added if needed.
-	*/
-  errno = save_errno;
-  // Handle %m (replace it with strerror(errno)) and add the message (buf)
-  message += std::regex_replace(buf, m_regex, strerror(errno));
+  message.append(msg, len);
 
  	/* Last: Send the log string */
  	fac_->syslog(message);
 }
 
+void Syslog::flush()
+{
+  auto& log = PER_CPU(deferred_logs);
+  if (log.ring != nullptr)
+    log.ring->drain(&Syslog::send);
+}
+
+uint64_t Syslog::dropped()
+{
+  uint64_t total = 0;
+  for (const auto& log : deferred_logs)
+    if (log.ring != nullptr)
+      total += log.ring->dropped();
+  return total;
+}
+
 void Syslog::openlog(const char* ident, int logopt, int facility) {
   fac_->set_ident(ident);
 
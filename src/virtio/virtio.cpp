@@ -99,6 +99,7 @@ Virtio::Virtio(hw::PCI_Device& dev)
   // Where the standard isn't clear, we'll do our best to separate work
   // between this class and subclasses.
 
+  this->current_cpu = SMP::cpu_id();
   // initialize MSI-X if available
   if (dev.msix_cap())
   {
@@ -107,7 +108,6 @@ Virtio::Virtio(hw::PCI_Device& dev)
     if (msix_vectors)
     {
       INFO2("[x] Device has %u MSI-X vectors", msix_vectors);
-      this->current_cpu = SMP::cpu_id();
 
       // setup all the MSI-X vectors
       for (int i = 0; i < msix_vectors; i++)
@@ -221,6 +221,13 @@ void Virtio::move_to_this_cpu()
       _pcidev.rebalance_msix_vector(i, current_cpu, IRQ_BASE + this->irqs[i]);
     }
   }
+  else
+  {
+    // route the legacy interrupt to this CPU instead
+    Events::get(this->current_cpu).unsubscribe(this->irqs[0]);
+    this->current_cpu = SMP::cpu_id();
+    __arch_enable_legacy_irq(this->irqs[0]);
+  }
 }
 
 void Virtio::setup_complete(bool ok)
@@ -0,0 +1,36 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <os>
+#include <kernel/boot_trace.hpp>
+#include <statman>
+#include <cinttypes>
+#include <cstdio>
+
+void Service::start()
+{
+}
+
+void Service::ready()
+{
+  using namespace kernel;
+  boot_trace::print();
+  boot_trace::to_statman();
+
+  auto& total = Statman::get().get_by_name("boot.total");
+  printf("Boot time: %" PRIu64 " us\n", total.get_uint64());
+  os::shutdown();
+}
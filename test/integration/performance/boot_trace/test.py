@@ -0,0 +1,13 @@
+#!/usr/bin/env python3
+
+from vmrunner import vmrunner
+vm = vmrunner.vms[0]
+
+def boot_time(line):
+    micros = int(line.split(":")[1].split()[0])
+    print("Booted to Service::ready in {} ms".format(micros / 1000.0))
+    vm.exit(0, "Boot trace benchmark completed")
+
+vm.on_output("Boot time:", boot_time)
+
+vm.boot(20, image_name='boot_trace.elf.bin')
@@ -51,6 +51,8 @@ void* aligned_alloc(size_t align, size_t size) {
 
 char _DISK_START_;
 char _DISK_END_;
+char _PACK_START_;
+char _PACK_END_;
 char _ELF_SYM_START_;
 
 /// RTC ///
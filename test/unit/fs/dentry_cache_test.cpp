@@ -0,0 +1,83 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <fs/dentry_cache.hpp>
+
+using namespace fs;
+
+CASE("Dentry cache remembers entries and missing paths")
+{
+  Dentry_cache cache {4};
+  EXPECT(cache.capacity() == 4u);
+  EXPECT(cache.find(1, 0, "/a") == nullptr);
+  EXPECT(cache.misses() == 1u);
+
+  cache.insert(1, 0, "/a", Dirent(nullptr, fs::FILE, "a", 10, 0, 123));
+  cache.insert_negative(1, 0, "/b");
+
+  const auto* a = cache.find(1, 0, "/a");
+  EXPECT(a != nullptr);
+  EXPECT(a->is_file());
+  EXPECT(a->size() == 123u);
+  const auto* b = cache.find(1, 0, "/b");
+  EXPECT(b != nullptr);
+  EXPECT(not b->is_valid());
+  EXPECT(cache.hits() == 2u);
+
+  // the device and base directory are part of the key
+  EXPECT(cache.find(2, 0, "/a") == nullptr);
+  EXPECT(cache.find(1, 5, "/a") == nullptr);
+
+  // replacing an entry
+  cache.insert(1, 0, "/b", Dirent(nullptr, fs::DIR, "b", 11));
+  EXPECT(cache.size() == 2u);
+  EXPECT(cache.find(1, 0, "/b")->is_dir());
+}
+
+CASE("Dentry cache evicts the least recently used")
+{
+  Dentry_cache cache {3};
+  cache.insert(1, 0, "/1", Dirent(nullptr, fs::FILE, "1"));
+  cache.insert(1, 0, "/2", Dirent(nullptr, fs::FILE, "2"));
+  cache.insert(1, 0, "/3", Dirent(nullptr, fs::FILE, "3"));
+  // touch /1, so /2 is the oldest
+  EXPECT(cache.find(1, 0, "/1") != nullptr);
+  cache.insert(1, 0, "/4", Dirent(nullptr, fs::FILE, "4"));
+  EXPECT(cache.size() == 3u);
+  EXPECT(cache.find(1, 0, "/2") == nullptr);
+  EXPECT(cache.find(1, 0, "/1") != nullptr);
+  EXPECT(cache.find(1, 0, "/3") != nullptr);
+  EXPECT(cache.find(1, 0, "/4") != nullptr);
+}
+
+CASE("Dentry cache invalidates by device")
+{
+  Dentry_cache cache {8};
+  cache.insert(1, 0, "/a", Dirent(nullptr, fs::FILE, "a"));
+  cache.insert(2, 0, "/a", Dirent(nullptr, fs::FILE, "a"));
+  cache.insert_negative(1, 0, "/b");
+  cache.invalidate(1);
+  EXPECT(cache.size() == 1u);
+  EXPECT(cache.find(1, 0, "/a") == nullptr);
+  EXPECT(cache.find(2, 0, "/a") != nullptr);
+  cache.clear();
+  EXPECT(cache.size() == 0u);
+  // and is still usable
+  for (int i = 0; i < 20; i++)
+    cache.insert(3, 0, "/" + std::to_string(i), Dirent(nullptr, fs::FILE));
+  EXPECT(cache.size() == 8u);
+}
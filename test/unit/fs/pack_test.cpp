@@ -0,0 +1,144 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <fs/pack.hpp>
+#include <cstring>
+#include <map>
+#include <vector>
+
+using fs::Pack;
+
+// a minimal version of src/memdisk/mkpack.py
+struct Image {
+  std::vector<uint64_t> storage;
+  const void* data() const { return storage.data(); }
+  size_t size() const { return storage.size() * sizeof(uint64_t); }
+};
+
+static Image build(const std::map<std::string, std::vector<std::string>>& files)
+{
+  const uint32_t count = files.size();
+  uint32_t buckets = 2;
+  while (buckets < count * 2) buckets *= 2;
+
+  const size_t buckets_off = sizeof(Pack::Header);
+  const size_t entries_off = buckets_off + buckets * 4;
+  const size_t paths_off   = entries_off + count * sizeof(Pack::Entry);
+  size_t size = paths_off;
+  for (auto& f : files) size += f.first.size();
+  size_t data_off = size;
+  for (auto& f : files)
+    for (auto& v : f.second) size += v.size();
+
+  Image img;
+  img.storage.resize((size + 7) / 8);
+  auto* base = reinterpret_cast<char*>(img.storage.data());
+  auto* hdr  = reinterpret_cast<Pack::Header*>(base);
+  *hdr = {Pack::MAGIC, Pack::VERSION, count, buckets, 0,
+          buckets_off, entries_off, paths_off, size, 0};
+  auto* index   = reinterpret_cast<uint32_t*>(base + buckets_off);
+  auto* entries = reinterpret_cast<Pack::Entry*>(base + entries_off);
+
+  uint32_t i = 0;
+  size_t path_off = paths_off;
+  for (auto& f : files)
+  {
+    auto& e = entries[i];
+    std::memset(&e, 0, sizeof(e));
+    e.hash = Pack::hash(f.first);
+    e.path_offset = path_off;
+    e.path_length = f.first.size();
+    std::memcpy(base + path_off, f.first.data(), f.first.size());
+    path_off += f.first.size();
+    for (size_t v = 0; v < f.second.size(); v++) {
+      e.variant[v] = {data_off, f.second[v].size()};
+      std::memcpy(base + data_off, f.second[v].data(), f.second[v].size());
+      data_off += f.second[v].size();
+    }
+    uint32_t b = e.hash & (buckets - 1);
+    while (index[b] != 0) b = (b + 1) & (buckets - 1);
+    index[b] = ++i;
+  }
+  return img;
+}
+
+CASE("Pack finds files and their variants")
+{
+  auto img = build({
+    {"/index.html", {"<html></html>", "gz-html"}},
+    {"/app.js",     {"console.log(1);"}},
+    {"/a/b/c.txt",  {"abc", "", "br-abc"}}
+  });
+  Pack pack {img.data(), img.size()};
+  EXPECT(pack.size() == 3u);
+  EXPECT(pack.contains("/app.js"));
+  EXPECT(not pack.contains("/app.j"));
+  EXPECT(not pack.contains("index.html"));
+
+  auto file = pack.find("/index.html");
+  EXPECT(file.has_value());
+  EXPECT(file->path() == "/index.html");
+  EXPECT(file->data() == "<html></html>");
+  EXPECT(file->has(Pack::GZIP));
+  EXPECT(not file->has(Pack::BROTLI));
+  EXPECT(file->data(Pack::GZIP) == "gz-html");
+  // contents point into the image
+  EXPECT(file->data().data() >= static_cast<const char*>(img.data()));
+  EXPECT(file->data().data() < static_cast<const char*>(img.data()) + img.size());
+
+  EXPECT(pack.read("/a/b/c.txt") == "abc");
+  EXPECT(pack.read("/a/b/c.txt", Pack::BROTLI) == "br-abc");
+  EXPECT(pack.read("/missing").empty());
+
+  size_t n = 0;
+  pack.for_each([&n] (const Pack::File&) { n++; });
+  EXPECT(n == 3u);
+}
+
+CASE("Pack rejects malformed images")
+{
+  Pack empty {nullptr, 0};
+  EXPECT(empty.size() == 0u);
+  EXPECT(not empty.contains("/"));
+
+  auto img = build({{"/file", {"data"}}});
+  auto* hdr = reinterpret_cast<Pack::Header*>(img.storage.data());
+  EXPECT_THROWS_AS((Pack{img.data(), sizeof(Pack::Header) - 1}), Pack::Error);
+  EXPECT_THROWS_AS((Pack{img.data(), hdr->image_size - 1}), Pack::Error);
+
+  hdr->magic++;
+  EXPECT_THROWS_AS((Pack{img.data(), img.size()}), Pack::Error);
+  hdr->magic--;
+  hdr->bucket_count = 1;
+  EXPECT_THROWS_AS((Pack{img.data(), img.size()}), Pack::Error);
+  hdr->bucket_count = 2;
+  EXPECT_NO_THROW((Pack{img.data(), img.size()}));
+
+  // every bucket taken, a lookup for a missing name would never end
+  auto* index = reinterpret_cast<uint32_t*>(
+      reinterpret_cast<char*>(img.storage.data()) + hdr->buckets_offset);
+  index[0] = index[1] = 1;
+  EXPECT_THROWS_AS((Pack{img.data(), img.size()}), Pack::Error);
+
+  // without files there's no index to look in
+  hdr->file_count = 0;
+  EXPECT_THROWS_AS((Pack{img.data(), img.size()}), Pack::Error);
+  hdr->bucket_count = 0;
+  Pack none {img.data(), img.size()};
+  EXPECT(none.size() == 0u);
+  EXPECT(not none.contains("/file"));
+}
@@ -1,6 +1,7 @@
 #include <common.cxx>
 #include <fs/disk.hpp>
 #include <fs/memdisk.hpp>
+#include <fs/dentry_cache.hpp>
 #include <util/sha1.hpp>
 #include <unistd.h>
 using namespace fs;
@@ -152,3 +153,46 @@ CASE("Stat /folder/file.txt")
   const std::string text((const char*) buffer.data(), buffer.size());
   EXPECT(text == "This file contains text\n");
 }
+
+CASE("Stat is served from the dentry cache")
+{
+  auto& fs = disk->fs();
+  auto& cache = Dentry_cache::get();
+  cache.clear();
+
+  auto ent = fs.stat("/folder/file.txt");
+  EXPECT(ent.is_valid());
+  // both names on the way are cached
+  EXPECT(cache.size() == 2u);
+  const auto hits = cache.hits();
+  auto again = fs.stat("/folder/file.txt");
+  EXPECT(cache.hits() == hits + 1);
+  EXPECT(again.block() == ent.block());
+  EXPECT(again.size() == 24u);
+
+  // missing files are remembered too
+  EXPECT(not fs.stat("/folder/nope.txt").is_valid());
+  EXPECT(not fs.stat("/folder/nope.txt").is_valid());
+  EXPECT(not fs.stat("/folder/file.txt/nope").is_valid());
+
+  // lookup by string, without parsing the path
+  const auto& res = fs.resolve("/folder/file.txt");
+  EXPECT(res.is_valid());
+  EXPECT(res.size() == 24u);
+  EXPECT(not fs.resolve("/nope").is_valid());
+
+  // async, relative to a directory
+  auto folder = fs.stat("/folder");
+  bool called = false;
+  folder.stat("file.txt",
+  [&lest_env, &called] (auto err, const Dirent& ent)
+  {
+    EXPECT(!err);
+    EXPECT(ent.size() == 24u);
+    called = true;
+  });
+  EXPECT(called);
+
+  cache.invalidate(fs.device_id());
+  EXPECT(cache.size() == 0u);
+}
@@ -0,0 +1,68 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <hw/usernet.hpp>
+
+static std::string eth(int idx)
+{
+  return "eth" + std::to_string(idx);
+}
+
+CASE("NICs constructed out of order are named in the order reserved")
+{
+  // reserved in bus order
+  const int nic_first   = hw::Nic::reserve_index();
+  const int link_first  = net::Ethernet::reserve_index();
+  const int nic_second  = hw::Nic::reserve_index();
+  const int link_second = net::Ethernet::reserve_index();
+  EXPECT(nic_second == nic_first + 1);
+  EXPECT(link_second == link_first + 1);
+
+  // the second one finishes first
+  hw::Nic::use_index(nic_second);
+  net::Ethernet::use_index(link_second);
+  auto& second = UserNet::create(1500);
+
+  hw::Nic::use_index(nic_first);
+  net::Ethernet::use_index(link_first);
+  auto& first = UserNet::create(1500);
+
+  EXPECT(first.device_name() == eth(link_first));
+  EXPECT(second.device_name() == eth(link_second));
+}
+
+CASE("A reservation is used once, then indices are handed out in order")
+{
+  const int link = net::Ethernet::reserve_index();
+  net::Ethernet::use_index(link);
+  auto& reserved = UserNet::create(1500);
+  auto& next     = UserNet::create(1500);
+
+  EXPECT(reserved.device_name() == eth(link));
+  EXPECT(next.device_name() == eth(link + 1));
+}
+
+CASE("Cancelling a reservation takes the next free index")
+{
+  const int link = net::Ethernet::reserve_index();
+  net::Ethernet::use_index(link);
+  // e.g. the driver failed before constructing its link
+  net::Ethernet::use_index(-1);
+  auto& nic = UserNet::create(1500);
+
+  EXPECT(nic.device_name() == eth(link + 1));
+}
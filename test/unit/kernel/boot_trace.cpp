@@ -0,0 +1,79 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <kernel/boot_trace.hpp>
+#include <os.hpp>
+#include <statman>
+#include <cstring>
+
+using namespace kernel;
+
+CASE("Boot trace records phases and their durations")
+{
+  boot_trace::begin(1000);
+  boot_trace::mark("first", 1500);
+  boot_trace::mark("a phase with a name much longer than what fits", 1750);
+
+  EXPECT(boot_trace::begin_cycles() == 1000u);
+  EXPECT(boot_trace::size() == 2u);
+  EXPECT(std::strcmp(boot_trace::events()[0].name, "first") == 0);
+  EXPECT(boot_trace::duration(0) == 500u);
+  EXPECT(boot_trace::duration(1) == 250u);
+  // names are truncated
+  EXPECT(std::strlen(boot_trace::events()[1].name) == boot_trace::MAX_NAME);
+  EXPECT(boot_trace::dropped() == 0u);
+}
+
+CASE("Boot trace drops events when full")
+{
+  boot_trace::begin(0);
+  for (size_t i = 0; i < boot_trace::MAX_EVENTS + 3; i++)
+    boot_trace::mark("phase", i);
+
+  EXPECT(boot_trace::size() == boot_trace::MAX_EVENTS);
+  EXPECT(boot_trace::dropped() == 3u);
+
+  // starting over clears the trace
+  boot_trace::begin(0);
+  EXPECT(boot_trace::size() == 0u);
+  EXPECT(boot_trace::dropped() == 0u);
+}
+
+CASE("Boot trace sums repeated phases into Statman, once")
+{
+  const double khz = os::cpu_freq().count();
+  auto micros = [khz] (uint64_t cycles) -> uint64_t {
+    return (khz > 0) ? cycles * 1000.0 / khz : 0;
+  };
+
+  boot_trace::begin(0);
+  boot_trace::mark("driver", 2'000'000);
+  boot_trace::mark("stack",  3'000'000);
+  boot_trace::mark("driver", 6'000'000);
+
+  // left over from an earlier export
+  auto& statman = Statman::get();
+  statman.get_or_create(Stat::UINT64, "boot.driver").get_uint64() = 12345;
+
+  for (int i = 0; i < 2; i++)
+  {
+    boot_trace::to_statman();
+    EXPECT(statman.get_by_name("boot.driver").get_uint64() == micros(5'000'000));
+    EXPECT(statman.get_by_name("boot.stack").get_uint64() == micros(1'000'000));
+    EXPECT(statman.get_by_name("boot.total").get_uint64() == micros(6'000'000));
+  }
+}
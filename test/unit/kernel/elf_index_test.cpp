@@ -0,0 +1,152 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <kernel/elf.hpp>
+#include <util/crc32.hpp>
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+#include <random>
+
+extern "C" void _move_elf_syms_location(const void*, void*);
+extern "C" void _init_elf_parser();
+
+struct Symbol {
+  std::string name;
+  uintptr_t   addr;
+  uint64_t    size;
+};
+
+struct elfsyms_header {
+  uint32_t  symtab_entries;
+  uint32_t  strtab_size;
+  uint32_t  sanity_check;
+  uint32_t  checksum_syms;
+  uint32_t  checksum_strs;
+} __attribute__((packed));
+
+// the symbol section as the elf_syms tool writes it, handed to the parser
+static void load_symbols(const std::vector<Symbol>& symbols)
+{
+  std::string strings(1, '\0');
+  std::vector<Elf64_Sym> syms;
+  for (const auto& s : symbols)
+  {
+    Elf64_Sym sym {};
+    sym.st_name  = strings.size();
+    sym.st_info  = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+    sym.st_value = s.addr;
+    sym.st_size  = s.size;
+    syms.push_back(sym);
+    strings.append(s.name).push_back('\0');
+  }
+  const size_t symsize = syms.size() * sizeof(Elf64_Sym);
+
+  elfsyms_header hdr {(uint32_t) syms.size(), (uint32_t) strings.size(), 0,
+                      crc32c(syms.data(), symsize),
+                      crc32c(strings.data(), strings.size())};
+  hdr.sanity_check = crc32c(&hdr, sizeof(hdr));
+
+  static std::vector<char> section;
+  section.resize(sizeof(hdr) + symsize + strings.size());
+  std::memcpy(section.data(), &hdr, sizeof(hdr));
+  std::memcpy(&section[sizeof(hdr)], syms.data(), symsize);
+  std::memcpy(&section[sizeof(hdr) + symsize], strings.data(), strings.size());
+
+  // the parser keeps pointing into the relocated symbols
+  static std::vector<Elf64_Sym> relocated;
+  relocated.assign(syms.size() + strings.size() / sizeof(Elf64_Sym) + 1, {});
+  _move_elf_syms_location(section.data(), relocated.data());
+  _init_elf_parser();
+}
+
+struct Lookup {
+  uintptr_t   addr;
+  std::string name;
+  bool operator== (const Lookup& other) const {
+    return addr == other.addr and name == other.name;
+  }
+};
+
+static std::vector<Lookup> lookup_all(uintptr_t from, uintptr_t to, uintptr_t step)
+{
+  std::vector<Lookup> result;
+  char buffer[256];
+  for (uintptr_t addr = from; addr < to; addr += step)
+  {
+    const auto sym = Elf::safe_resolve_symbol((void*) addr, buffer, sizeof(buffer));
+    result.push_back({Elf::resolve_addr(addr), sym.name});
+  }
+  return result;
+}
+
+CASE("Address lookups with the index match the linear scan")
+{
+  std::mt19937 rng {1234};
+  std::vector<Symbol> symbols;
+  uintptr_t addr = 0x200000;
+  for (int i = 0; i < 500; i++)
+  {
+    // some are markers without a size, and some are undefined
+    const uint64_t size = (i % 7 == 0) ? 0 : rng() % 300 + 1;
+    symbols.push_back({"sym" + std::to_string(i), addr, size});
+    if (i % 50 == 0)
+      symbols.push_back({"undefined" + std::to_string(i), 0, 0});
+    addr += size + rng() % 800;
+  }
+  const uintptr_t end = addr + 1024;
+  // the symbol table isn't sorted
+  std::shuffle(symbols.begin(), symbols.end(), rng);
+
+  load_symbols(symbols);
+  const auto linear = lookup_all(0x200000 - 1024, end, 3);
+
+  Elf::build_symbol_index();
+  const auto indexed = lookup_all(0x200000 - 1024, end, 3);
+
+  EXPECT(indexed.size() == linear.size());
+  EXPECT(indexed == linear);
+  // not just misses
+  const auto found = std::count_if(linear.begin(), linear.end(),
+    [] (const Lookup& l) { return l.name.rfind("sym", 0) == 0; });
+  EXPECT(found > (long) linear.size() / 2);
+}
+
+CASE("Exact matches win over close ones, far addresses aren't found")
+{
+  load_symbols({
+    {"second", 0x10200, 0x10},
+    {"first",  0x10000, 0x100},
+    {"marker", 0x10180, 0},
+  });
+
+  for (int indexed = 0; indexed < 2; indexed++)
+  {
+    if (indexed) Elf::build_symbol_index();
+    EXPECT(Elf::resolve_addr(0x10000) == 0x10000u);
+    EXPECT(Elf::resolve_addr(0x100ff) == 0x10000u);
+    // past the end of first, closest is first
+    EXPECT(Elf::resolve_addr(0x10150) == 0x10000u);
+    // past the marker, closest is the marker
+    EXPECT(Elf::resolve_addr(0x101f0) == 0x10180u);
+    EXPECT(Elf::resolve_addr(0x10208) == 0x10200u);
+    EXPECT(Elf::resolve_addr(0x10300) == 0x10200u);
+    // more than 512 bytes from anything
+    EXPECT(Elf::resolve_addr(0x20000) == 0x20000u);
+    EXPECT(Elf::resolve_addr(0x8000) == 0x8000u);
+  }
+}
@@ -397,6 +397,41 @@ CASE("pmr::default resource cap") {
 
 }
 
+CASE("pmr::set resource capacity") {
+  // A resource can be given more (or less) than its share of the pool
+
+  using namespace util;
+  constexpr auto pool_cap = 400_KiB;
+
+  os::mem::Pmr_pool pool{pool_cap};
+  auto res1 = pool.get_resource();
+  auto res2 = pool.get_resource();
+  const auto share = pool_cap / (2 + os::mem::Pmr_pool::resource_division_offset);
+  EXPECT(res1->allocatable() == share);
+
+  res1->set_capacity(300_KiB);
+  EXPECT(res1->capacity() == 300_KiB);
+  EXPECT(res2->allocatable() == share);
+
+  auto* buf = res1->allocate(250_KiB);
+  EXPECT(res1->allocatable() == 50_KiB);
+
+  // bounded by what's left in the pool
+  res1->set_capacity(1_MiB);
+  EXPECT(res1->allocatable() == pool_cap - 250_KiB);
+  EXPECT_THROWS(res1->allocate(200_KiB));
+  res1->deallocate(buf, 250_KiB);
+
+  // back to sharing when returned to the pool
+  auto* raw = res1.get();
+  res1.reset();
+  res2.reset();
+  auto res3 = pool.get_resource();
+  auto res4 = pool.get_resource();
+  EXPECT((res3.get() == raw or res4.get() == raw));
+  EXPECT(raw->capacity() == pool_cap / (2 + os::mem::Pmr_pool::resource_division_offset));
+}
+
 CASE("allocation alignment") {
   // Check that allocator uses the size of the data type as alignment
   using namespace util;
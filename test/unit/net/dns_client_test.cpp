@@ -0,0 +1,249 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/inet>
+#include <net/interfaces>
+#include <net/dns/client.hpp>
+#include <net/dns/zone.hpp>
+#include <hw/async_device.hpp>
+
+using namespace net;
+using namespace net::dns;
+
+static uint64_t my_time = 0;
+
+static uint64_t get_time()
+{ return my_time; }
+
+#include <delegate>
+extern delegate<uint64_t()> systime_override;
+
+static std::unique_ptr<hw::Async_device<UserNet>> dev1 = nullptr;
+static std::unique_ptr<hw::Async_device<UserNet>> dev2 = nullptr;
+static std::unique_ptr<Zone_table> zones = nullptr;
+static size_t queries = 0;
+
+static const Addr server_addr {ip4::Addr{10,0,0,42}};
+
+// like some servers do, add the zone SOA to an alias
+// pointing out of the zone (example.com follows "alias" in the question)
+static size_t add_soa(uint8_t* msg, size_t len)
+{
+  static const uint8_t soa[] {
+    0xc0, 18, 0, 6, 0, 1, 0, 0, 0x0e, 0x10, 0, 39,
+    3, 'n', 's', '1', 0xc0, 18,
+    10, 'h', 'o', 's', 't', 'm', 'a', 's', 't', 'e', 'r', 0xc0, 18,
+    0, 0, 0, 1, 0, 0, 0x1c, 0x20, 0, 0, 0x0e, 0x10, 0, 0x12, 0x75, 0, 0, 0, 0, 60
+  };
+  auto& hdr = *(Header*) msg;
+  EXPECT(hdr.auth_count == 0);
+  EXPECT(hdr.add_count == 0);
+  hdr.auth_count = htons(1);
+  std::memcpy(msg + len, soa, sizeof(soa));
+  return len + sizeof(soa);
+}
+
+// answers from the zones, counting the queries that get through
+static void setup_server()
+{
+  std::vector<Zone> z;
+  z.emplace_back("example.com")
+   .soa("ns1", "hostmaster", 1, 7200, 3600, 1209600, 60)
+   .add("www", ip4::Addr{10,0,0,2}, 100)
+   .add_cname("alias", "cdn.example.net.");
+  zones = std::make_unique<Zone_table>(z);
+
+  auto& udp = Interfaces::get(0).udp();
+  auto& sock = udp.bind(SERVICE_PORT);
+  sock.on_read([&sock] (udp::addr_t addr, udp::port_t port, const char* data, size_t len)
+  {
+    queries++;
+    uint8_t out[Zone_table::MAX_UDP_SIZE];
+    auto olen = zones->respond((const uint8_t*) data, len, out, sizeof(out));
+    if (olen > 0 and std::string_view(data, len).find("\5alias") != std::string_view::npos)
+      olen = add_soa(out, olen);
+    if (olen > 0)
+      sock.sendto(addr, port, out, olen);
+  });
+}
+
+static void setup_inet()
+{
+  dev1 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev2 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev1->connect(*dev2);
+  dev2->connect(*dev1);
+
+  Interfaces::get(0).network_config({10,0,0,42}, {255,255,255,0}, {10,0,0,1});
+  Interfaces::get(1).network_config({10,0,0,43}, {255,255,255,0}, {10,0,0,1});
+  setup_server();
+}
+
+static void process_events()
+{
+  for (int i = 0; i < 16; i++)
+    Events::get().process_events();
+}
+
+struct Answer {
+  int calls = 0;
+  Response_ptr res = nullptr;
+};
+
+static void resolve(Client& client, const std::string& name, Answer& ans)
+{
+  client.resolve(server_addr, name, Record_type::A,
+    [&ans] (Response_ptr res, const Error& err) {
+      EXPECT(not err);
+      ans.calls++;
+      ans.res = std::move(res);
+    }, Client::DEFAULT_RESOLVE_TIMEOUT);
+}
+
+static const Client::Cache_entry* find(const Client& client, const std::string& name)
+{
+  auto it = client.cache().find({name, Record_type::A});
+  return it != client.cache().end() ? &it->second : nullptr;
+}
+
+CASE("Setup networks")
+{
+  systime_override = get_time;
+  my_time = 1000;
+  setup_inet();
+}
+
+CASE("Answers are cached for the record TTL")
+{
+  Client client{Interfaces::get(1)};
+  queries = 0;
+
+  Answer a;
+  resolve(client, "www.example.com", a);
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(queries == 1u);
+  EXPECT(a.res->get_first_ipv4() == ip4::Addr(10,0,0,2));
+  auto* entry = find(client, "www.example.com");
+  EXPECT(entry != nullptr);
+  EXPECT(entry->ttl == 100u);
+  EXPECT(not entry->is_negative());
+
+  // served from the cache with the remaining TTL
+  my_time += 40;
+  Answer b;
+  resolve(client, "WWW.Example.com", b);
+  EXPECT(b.calls == 1);
+  EXPECT(queries == 1u);
+  EXPECT(client.cache_hits() == 1u);
+  EXPECT(b.res->get_first_ipv4() == ip4::Addr(10,0,0,2));
+  EXPECT(b.res->answers.at(0).ttl == 60u);
+
+  // expired, asked again
+  my_time += 60;
+  Answer c;
+  resolve(client, "www.example.com", c);
+  EXPECT(c.calls == 0);
+  process_events();
+  EXPECT(c.calls == 1);
+  EXPECT(queries == 2u);
+  EXPECT(client.cache_misses() == 2u);
+}
+
+CASE("Negative answers are cached for the SOA minimum")
+{
+  Client client{Interfaces::get(1)};
+  queries = 0;
+
+  Answer a;
+  resolve(client, "nope.example.com", a);
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(a.res->rcode == Response_code::NAME_ERROR);
+  auto* entry = find(client, "nope.example.com");
+  EXPECT(entry != nullptr);
+  EXPECT(entry->is_negative());
+  EXPECT(entry->ttl == 60u);
+
+  my_time += 59;
+  Answer b;
+  resolve(client, "nope.example.com", b);
+  EXPECT(b.calls == 1);
+  EXPECT(b.res->rcode == Response_code::NAME_ERROR);
+  EXPECT(queries == 1u);
+
+  my_time += 1;
+  Answer c;
+  resolve(client, "nope.example.com", c);
+  process_events();
+  EXPECT(c.calls == 1);
+  EXPECT(queries == 2u);
+
+  // and bounded by the negative TTL
+  client.flush_cache();
+  client.set_negative_ttl(std::chrono::seconds(10));
+  Answer d;
+  resolve(client, "nope.example.com", d);
+  process_events();
+  EXPECT(find(client, "nope.example.com")->ttl == 10u);
+}
+
+CASE("A CNAME the server didn't follow is not cached as a negative answer")
+{
+  Client client{Interfaces::get(1)};
+  queries = 0;
+
+  Answer a;
+  resolve(client, "alias.example.com", a);
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(a.res->rcode == Response_code::NO_ERROR);
+  EXPECT(a.res->answers.size() == 1u);
+  EXPECT(a.res->answers.at(0).rtype == Record_type::ALIAS);
+  EXPECT(a.res->negative_ttl() == 60u);
+  EXPECT(find(client, "alias.example.com") == nullptr);
+
+  Answer b;
+  resolve(client, "alias.example.com", b);
+  process_events();
+  EXPECT(b.calls == 1);
+  EXPECT(queries == 2u);
+}
+
+CASE("Concurrent resolves of a name share one query")
+{
+  Client client{Interfaces::get(1)};
+  queries = 0;
+
+  Answer a, b, c;
+  resolve(client, "www.example.com", a);
+  resolve(client, "www.example.com", b);
+  resolve(client, "www.example.com", c);
+  EXPECT(client.coalesced() == 2u);
+  process_events();
+
+  EXPECT(queries == 1u);
+  for (auto* ans : {&a, &b, &c})
+  {
+    EXPECT(ans->calls == 1);
+    EXPECT(ans->res != nullptr);
+    EXPECT(ans->res->get_first_ipv4() == ip4::Addr(10,0,0,2));
+  }
+  // everyone got their own copy
+  EXPECT(a.res.get() != b.res.get());
+  EXPECT(b.res.get() != c.res.get());
+}
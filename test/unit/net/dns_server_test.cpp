@@ -0,0 +1,363 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/inet>
+#include <net/interfaces>
+#include <net/dns/server.hpp>
+#include <net/dns/query.hpp>
+#include <net/dns/response.hpp>
+#include <kernel/timers.hpp>
+#include <hw/async_device.hpp>
+
+using namespace net;
+using namespace net::dns;
+using namespace std::chrono;
+
+static uint64_t my_time = 0;
+
+static uint64_t get_time()
+{ return my_time; }
+
+#include <delegate>
+extern delegate<uint64_t()> systime_override;
+
+static std::unique_ptr<hw::Async_device<UserNet>> dev1 = nullptr;
+static std::unique_ptr<hw::Async_device<UserNet>> dev2 = nullptr;
+static Server* server = nullptr;
+
+static const ip4::Addr server_addr {10,0,0,42};
+static const ip4::Addr client_addr {10,0,0,43};
+static const uint16_t UPSTREAM_PORT = 5353;
+
+static std::vector<Zone> example_zones()
+{
+  std::vector<Zone> zones;
+  zones.emplace_back("example.com")
+       .soa("ns1", "hostmaster", 1, 7200, 3600, 1209600, 60)
+       .add("www", ip4::Addr{10,0,0,2}, 100);
+  return zones;
+}
+
+// a recursive server next to the client, holding its answers back
+static struct {
+  std::unique_ptr<Zone_table> zones;
+  udp::Socket* sock = nullptr;
+  std::vector<std::vector<uint8_t>> queries;
+  udp::port_t server_port = 0;
+} recursor;
+
+static void setup_upstream()
+{
+  std::vector<Zone> z;
+  z.emplace_back("example.net")
+   .soa("ns1", "hostmaster", 1, 7200, 3600, 1209600, 60)
+   .add("www", ip4::Addr{10,1,0,2}, 100);
+  recursor.zones = std::make_unique<Zone_table>(z);
+
+  recursor.sock = &Interfaces::get(1).udp().bind(UPSTREAM_PORT);
+  recursor.sock->on_read(
+  [] (udp::addr_t, udp::port_t port, const char* data, size_t len) {
+    recursor.server_port = port;
+    recursor.queries.emplace_back(data, data + len);
+  });
+}
+
+// answer the oldest query held back
+static void answer_upstream()
+{
+  EXPECT(not recursor.queries.empty());
+  const auto query = recursor.queries.front();
+  recursor.queries.erase(recursor.queries.begin());
+  uint8_t out[Zone_table::MAX_UDP_SIZE];
+  const auto len = recursor.zones->respond(query.data(), query.size(), out, sizeof(out));
+  EXPECT(len > 0u);
+  recursor.sock->sendto(server_addr, recursor.server_port, out, len);
+}
+
+static void setup_inet()
+{
+  dev1 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev2 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev1->connect(*dev2);
+  dev2->connect(*dev1);
+
+  Interfaces::get(0).network_config(server_addr, {255,255,255,0}, {10,0,0,1});
+  Interfaces::get(1).network_config(client_addr, {255,255,255,0}, {10,0,0,1});
+  setup_upstream();
+}
+
+static void process_events()
+{
+  for (int i = 0; i < 16; i++)
+    Events::get().process_events();
+}
+
+// let the time pass, firing the timers due
+static void advance(nanoseconds ns)
+{
+  my_time += ns.count();
+  Timers::timers_handler();
+  process_events();
+}
+
+static std::vector<uint8_t> query(id_t id, const std::string& name)
+{
+  std::vector<uint8_t> msg(Zone_table::MAX_UDP_SIZE);
+  msg.resize(Query{id, name, Record_type::A}.write((char*) msg.data()));
+  return msg;
+}
+
+static id_t id_of(const std::vector<uint8_t>& msg)
+{
+  return (msg.at(0) << 8) | msg.at(1);
+}
+
+static Response parse(const std::vector<uint8_t>& msg)
+{
+  return Response{(const char*) msg.data(), msg.size()};
+}
+
+// a client asking over UDP
+struct Udp_client {
+  udp::Socket& sock = Interfaces::get(1).udp().bind();
+  std::vector<std::vector<uint8_t>> answers;
+
+  Udp_client() {
+    sock.on_read(
+    [this] (udp::addr_t, udp::port_t port, const char* data, size_t len) {
+      EXPECT(port == SERVICE_PORT);
+      answers.emplace_back(data, data + len);
+    });
+  }
+  ~Udp_client() {
+    sock.close();
+  }
+
+  void ask(id_t id, const std::string& name) {
+    const auto msg = query(id, name);
+    sock.sendto(server_addr, SERVICE_PORT, msg.data(), msg.size());
+  }
+};
+
+// a client asking over TCP, splitting the length prefixed answers
+struct Tcp_client {
+  tcp::Connection_ptr conn;
+  std::vector<uint8_t> received;
+  std::vector<std::vector<uint8_t>> answers;
+
+  Tcp_client() {
+    Interfaces::get(1).tcp().connect({server_addr, SERVICE_PORT},
+    [this] (tcp::Connection_ptr c) {
+      conn = c;
+      conn->on_read(1024, [this] (tcp::buffer_t buf) {
+        received.insert(received.end(), buf->begin(), buf->end());
+        while (received.size() >= 2)
+        {
+          const size_t len = (received[0] << 8) | received[1];
+          if (received.size() < 2 + len)
+            break;
+          answers.emplace_back(received.begin() + 2, received.begin() + 2 + len);
+          received.erase(received.begin(), received.begin() + 2 + len);
+        }
+      });
+    });
+    process_events();
+    EXPECT(conn != nullptr);
+  }
+  ~Tcp_client() {
+    if (conn) conn->close();
+    process_events();
+  }
+
+  static void prefix(std::vector<uint8_t>& out, const std::vector<uint8_t>& msg) {
+    out.push_back(msg.size() >> 8);
+    out.push_back(msg.size() & 0xFF);
+    out.insert(out.end(), msg.begin(), msg.end());
+  }
+
+  void write(const std::vector<uint8_t>& data) {
+    conn->write(data.data(), data.size());
+  }
+};
+
+CASE("Setup networks")
+{
+  systime_override = get_time;
+  my_time = 1'000'000'000;
+  Timers::init([] (Timers::duration_t) {}, [] () {});
+  Timers::ready();
+  setup_inet();
+
+  // closed ports aren't reused, so the server is shared by the cases,
+  // and outlives the stack
+  server = new Server{Interfaces::get(0)};
+  server->load(example_zones());
+  server->listen();
+
+  // resolve the addresses before sending bursts
+  Udp_client client;
+  client.ask(1, "www.example.com");
+  process_events();
+  EXPECT(client.answers.size() == 1u);
+}
+
+CASE("Queries over UDP are answered from the zones")
+{
+  const auto queries = server->queries();
+  Udp_client client;
+
+  client.ask(1234, "www.example.com");
+  client.ask(1235, "nope.example.com");
+  client.ask(1236, "www.example.net");
+  process_events();
+
+  EXPECT(client.answers.size() == 3u);
+  EXPECT(server->queries() == queries + 3);
+
+  const auto& www = client.answers.at(0);
+  EXPECT(id_of(www) == 1234);
+  auto res = parse(www);
+  EXPECT(res.rcode == Response_code::NO_ERROR);
+  EXPECT(res.get_first_ipv4() == ip4::Addr(10,0,0,2));
+
+  EXPECT(id_of(client.answers.at(1)) == 1235);
+  EXPECT(parse(client.answers.at(1)).rcode == Response_code::NAME_ERROR);
+
+  // outside the zones, without a forwarder
+  EXPECT(id_of(client.answers.at(2)) == 1236);
+  EXPECT(parse(client.answers.at(2)).rcode == Response_code::OP_REFUSED);
+  EXPECT(server->refused() == 1u);
+
+  // reloading swaps the zones
+  auto zones = example_zones();
+  zones.at(0).add("ftp", ip4::Addr{10,0,0,3});
+  server->load(zones);
+  client.ask(1237, "ftp.example.com");
+  process_events();
+  EXPECT(client.answers.size() == 4u);
+  EXPECT(parse(client.answers.at(3)).get_first_ipv4() == ip4::Addr(10,0,0,3));
+}
+
+CASE("Queries over TCP are length prefixed and may span reads")
+{
+  const auto queries = server->queries();
+  Tcp_client client;
+
+  // two queries in one write
+  std::vector<uint8_t> data;
+  Tcp_client::prefix(data, query(1, "www.example.com"));
+  Tcp_client::prefix(data, query(2, "nope.example.com"));
+  client.write(data);
+  process_events();
+
+  EXPECT(client.answers.size() == 2u);
+  EXPECT(id_of(client.answers.at(0)) == 1);
+  EXPECT(parse(client.answers.at(0)).get_first_ipv4() == ip4::Addr(10,0,0,2));
+  EXPECT(id_of(client.answers.at(1)) == 2);
+  EXPECT(parse(client.answers.at(1)).rcode == Response_code::NAME_ERROR);
+
+  // one query in three writes, splitting the length too
+  data.clear();
+  Tcp_client::prefix(data, query(3, "www.example.com"));
+  client.write({data.begin(), data.begin() + 1});
+  process_events();
+  client.write({data.begin() + 1, data.begin() + 10});
+  process_events();
+  EXPECT(client.answers.size() == 2u);
+  client.write({data.begin() + 10, data.end()});
+  process_events();
+
+  EXPECT(client.answers.size() == 3u);
+  EXPECT(id_of(client.answers.at(2)) == 3);
+  EXPECT(parse(client.answers.at(2)).get_first_ipv4() == ip4::Addr(10,0,0,2));
+  EXPECT(server->queries() == queries + 3);
+}
+
+CASE("Other names are forwarded upstream and answered with the client's ID")
+{
+  server->set_forwarder(client_addr, UPSTREAM_PORT);
+  recursor.queries.clear();
+  const auto forwarded = server->forwarded();
+  Udp_client client;
+
+  client.ask(4321, "www.example.net");
+  client.ask(4322, "www.example.com");
+  process_events();
+
+  // the zones are answered directly, the rest is relayed with a new ID
+  EXPECT(client.answers.size() == 1u);
+  EXPECT(id_of(client.answers.at(0)) == 4322);
+  EXPECT(server->forwarded() == forwarded + 1);
+  EXPECT(recursor.queries.size() == 1u);
+
+  answer_upstream();
+  process_events();
+  EXPECT(client.answers.size() == 2u);
+  EXPECT(id_of(client.answers.at(1)) == 4321);
+  auto res = parse(client.answers.at(1));
+  EXPECT(res.get_first_ipv4() == ip4::Addr(10,1,0,2));
+
+  // over TCP the answer is length prefixed
+  Tcp_client tcp;
+  std::vector<uint8_t> data;
+  Tcp_client::prefix(data, query(99, "www.example.net"));
+  tcp.write(data);
+  process_events();
+  EXPECT(recursor.queries.size() == 1u);
+  EXPECT(tcp.answers.empty());
+
+  answer_upstream();
+  process_events();
+  EXPECT(tcp.answers.size() == 1u);
+  EXPECT(id_of(tcp.answers.at(0)) == 99);
+  EXPECT(parse(tcp.answers.at(0)).get_first_ipv4() == ip4::Addr(10,1,0,2));
+  EXPECT(server->forwarded() == forwarded + 2);
+}
+
+CASE("Forwarded queries without an answer expire")
+{
+  server->set_forwarder(client_addr, UPSTREAM_PORT);
+  recursor.queries.clear();
+  const auto forwarded = server->forwarded();
+  Udp_client client;
+
+  // answered in time
+  client.ask(1, "www.example.net");
+  process_events();
+  advance(Server::FORWARD_TIMEOUT / 2);
+  answer_upstream();
+  process_events();
+  EXPECT(client.answers.size() == 1u);
+
+  // answered too late, the client has retried by now
+  client.ask(2, "www.example.net");
+  process_events();
+  EXPECT(recursor.queries.size() == 1u);
+  advance(Server::FORWARD_TIMEOUT);
+  answer_upstream();
+  process_events();
+  EXPECT(client.answers.size() == 1u);
+
+  // and the retry is forwarded again
+  client.ask(2, "www.example.net");
+  process_events();
+  answer_upstream();
+  process_events();
+  EXPECT(client.answers.size() == 2u);
+  EXPECT(id_of(client.answers.at(1)) == 2);
+  EXPECT(server->forwarded() == forwarded + 3);
+}
@@ -0,0 +1,159 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/dns/zone.hpp>
+#include <net/dns/query.hpp>
+#include <net/dns/response.hpp>
+
+using namespace net;
+using namespace net::dns;
+
+static std::vector<Zone> example_zones()
+{
+  std::vector<Zone> zones;
+  auto& zone = zones.emplace_back("Example.com.");
+  zone.soa("ns1", "hostmaster", 2018010101, 7200, 3600, 1209600, 60)
+      .add_ns("@", "ns1")
+      .add("ns1", ip4::Addr{10,0,0,1})
+      .add("www", ip4::Addr{10,0,0,2})
+      .add("www", ip4::Addr{10,0,0,3}, 30)
+      .add("www", ip6::Addr{0xfe800000, 0, 0, 2})
+      .add_cname("ftp", "www")
+      .add_mx("@", 10, "mail.example.org.")
+      .add("a.b", ip4::Addr{10,0,0,4});
+
+  zones.emplace_back("example.org")
+       .soa("ns1.example.com.", "hostmaster.example.com.", 1)
+       .add("mail", ip4::Addr{10,1,0,1});
+  return zones;
+}
+
+struct Result {
+  size_t len;
+  Response res;
+};
+
+static Result ask(const Zone_table& table, const std::string& name, Record_type rtype,
+                  id_t id = 1234)
+{
+  char query[512];
+  const auto qlen = Query{id, name, rtype}.write(query);
+  char out[512];
+  Result r;
+  r.len = table.respond((uint8_t*) query, qlen, (uint8_t*) out, sizeof(out));
+  if(r.len > 0) {
+    EXPECT(ntohs(((Header*) out)->id) == id);
+    EXPECT(((Header*) out)->qr == 1);
+    EXPECT(((Header*) out)->rd == 1);
+    r.res.parse(out, r.len);
+  }
+  return r;
+}
+
+CASE("Zone_table answers from precomputed responses")
+{
+  Zone_table table{example_zones()};
+  EXPECT(table.zones() == 2u);
+  EXPECT(table.memory_usage() > 0u);
+
+  auto r = ask(table, "www.example.com", Record_type::A, 4321);
+  EXPECT(r.len > 0u);
+  EXPECT(r.res.rcode == Response_code::NO_ERROR);
+  EXPECT(r.res.answers.size() == 2u);
+  EXPECT(r.res.answers.at(0).name == "www.example.com");
+  EXPECT(r.res.answers.at(0).get_ipv4() == ip4::Addr(10,0,0,2));
+  EXPECT(r.res.answers.at(0).ttl == 3600u);
+  EXPECT(r.res.answers.at(1).get_ipv4() == ip4::Addr(10,0,0,3));
+  EXPECT(r.res.answers.at(1).ttl == 30u);
+
+  // names are case insensitive
+  r = ask(table, "WWW.Example.COM", Record_type::AAAA);
+  EXPECT(r.res.answers.size() == 1u);
+  EXPECT(r.res.get_first_ipv6() == ip6::Addr(0xfe800000, 0, 0, 2));
+
+  // an alias answers any type
+  r = ask(table, "ftp.example.com", Record_type::A);
+  EXPECT(r.res.answers.size() == 1u);
+  EXPECT(r.res.answers.at(0).rtype == Record_type::ALIAS);
+
+  r = ask(table, "example.com", Record_type::MX);
+  EXPECT(r.res.answers.size() == 1u);
+  EXPECT(r.res.answers.at(0).rtype == Record_type::MX);
+
+  r = ask(table, "mail.example.org", Record_type::A);
+  EXPECT(r.res.get_first_ipv4() == ip4::Addr(10,1,0,1));
+}
+
+CASE("Zone_table gives negative answers with the zone SOA")
+{
+  Zone_table table{example_zones()};
+
+  auto r = ask(table, "nope.example.com", Record_type::A);
+  EXPECT(r.len > 0u);
+  EXPECT(r.res.rcode == Response_code::NAME_ERROR);
+  EXPECT(r.res.answers.empty());
+  EXPECT(r.res.auth.size() == 1u);
+  EXPECT(r.res.auth.at(0).name == "example.com");
+  EXPECT(r.res.negative_ttl() == 60u);
+
+  // the name exists, not the type
+  r = ask(table, "ns1.example.com", Record_type::AAAA);
+  EXPECT(r.res.rcode == Response_code::NO_ERROR);
+  EXPECT(r.res.answers.empty());
+  EXPECT(r.res.auth.size() == 1u);
+
+  // empty non-terminal
+  r = ask(table, "b.example.com", Record_type::A);
+  EXPECT(r.res.rcode == Response_code::NO_ERROR);
+  EXPECT(r.res.answers.empty());
+
+  // not ours
+  r = ask(table, "www.example.net", Record_type::A);
+  EXPECT(r.len == 0u);
+  r = ask(table, "com", Record_type::A);
+  EXPECT(r.len == 0u);
+}
+
+CASE("Zone_table rejects malformed queries and invalid zones")
+{
+  Zone_table table{example_zones()};
+
+  uint8_t query[512];
+  const auto qlen = Query{1, "www.example.com", Record_type::A}.write((char*) query);
+  uint8_t out[512];
+
+  // cut in the question
+  auto len = table.respond(query, qlen - 3, out, sizeof(out));
+  EXPECT(len == sizeof(Header));
+  EXPECT((out[3] & 0xF) == (int) Response_code::FORMAT_ERROR);
+
+  // not a standard query
+  query[2] |= 0x10;
+  len = table.respond(query, qlen, out, sizeof(out));
+  EXPECT((out[3] & 0xF) == (int) Response_code::NOT_IMPL);
+
+  std::vector<Zone> zones;
+  zones.emplace_back("example.com").add("www", ip4::Addr{10,0,0,1});
+  EXPECT_THROWS_AS(Zone_table{zones}, Zone_error);
+
+  zones.back().soa("ns1", "hostmaster", 1).add_cname("www", "ftp");
+  EXPECT_THROWS_AS(Zone_table{zones}, Zone_error);
+
+  zones.clear();
+  zones.emplace_back("example.com").soa("ns1", "hostmaster", 1).add("www.example.org.", ip4::Addr{});
+  EXPECT_THROWS_AS(Zone_table{zones}, Zone_error);
+}
@@ -0,0 +1,146 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <packet_factory.hpp>
+#include <common.cxx>
+#include <net/ip4/ip4.hpp>
+#include <net/ip6/ip6.hpp>
+#include <net/filter_classifier.hpp>
+
+using namespace net;
+using Classifier  = Filter_classifier<IP4>;
+using Classifier6 = Filter_classifier<IP6>;
+
+static auto udp_packet(ip4::Addr src, uint16_t sport, ip4::Addr dst, uint16_t dport)
+{
+  auto ip4 = create_ip4_packet_init(src, dst);
+  ip4->set_protocol(Protocol::UDP);
+  ip4->increment_data_end(8);
+  auto data = ip4->ip_data();
+  data[0] = sport >> 8; data[1] = sport & 0xFF;
+  data[2] = dport >> 8; data[3] = dport & 0xFF;
+  ip4->set_ip_total_length(ip4->size());
+  return ip4;
+}
+
+CASE("Filter_classifier picks the first matching rule")
+{
+  Classifier cls{Filter_verdict_type::DROP};
+  Classifier::Rule rule;
+
+  // 0: drop everything from 10.0.0.66
+  rule.src = {{10,0,0,66}, 32};
+  rule.verdict = Filter_verdict_type::DROP;
+  cls.add(rule);
+
+  // 1: accept UDP to 10.0.1.0/24 port 53
+  rule = {};
+  rule.dst   = {{10,0,1,0}, 24};
+  rule.proto = Protocol::UDP;
+  rule.dport = {53, 53};
+  cls.add(rule);
+
+  // 2: accept UDP from 10.0.0.0/8 to ports 1000-2000
+  rule = {};
+  rule.src   = {{10,0,0,0}, 8};
+  rule.proto = Protocol::UDP;
+  rule.dport = {1000, 2000};
+  cls.add(rule);
+
+  // 3: same shape as 1, different key
+  rule = {};
+  rule.dst   = {{10,0,2,0}, 24};
+  rule.proto = Protocol::UDP;
+  rule.dport = {53, 53};
+  rule.verdict = Filter_verdict_type::DROP;
+  cls.add(rule);
+
+  EXPECT(cls.size() == 4u);
+
+  auto pkt = udp_packet({10,0,0,5}, 4000, {10,0,1,9}, 53);
+  EXPECT(cls.classify(*pkt, nullptr) == 1u);
+  // rules 1 and 3 share one table
+  EXPECT(cls.tuples() == 2u);
+
+  pkt = udp_packet({10,0,0,66}, 4000, {10,0,1,9}, 53);
+  EXPECT(cls.classify(*pkt, nullptr) == 0u);
+
+  pkt = udp_packet({10,9,0,1}, 4000, {192,168,0,1}, 1500);
+  EXPECT(cls.classify(*pkt, nullptr) == 2u);
+
+  pkt = udp_packet({10,9,0,1}, 4000, {10,0,2,1}, 53);
+  EXPECT(cls.classify(*pkt, nullptr) == 3u);
+
+  pkt = udp_packet({192,168,0,1}, 4000, {10,0,3,1}, 53);
+  EXPECT(cls.classify(*pkt, nullptr) == Classifier::NONE);
+
+  EXPECT(cls.hits(0) == 1u);
+  EXPECT(cls.hits(1) == 1u);
+  EXPECT(cls.hits(2) == 1u);
+  EXPECT(cls.hits(3) == 1u);
+  EXPECT(cls.misses() == 1u);
+
+  Filter_chain<IP4> chain{"Test", {cls.filter()}};
+  EXPECT(chain.chain.size() == 1u);
+}
+
+CASE("Filter_classifier matches conntrack state and gives verdicts")
+{
+  Classifier cls{Filter_verdict_type::DROP};
+  Classifier::Rule rule;
+  rule.ct_state = Conntrack::State::ESTABLISHED;
+  cls.add(rule);
+
+  rule = {};
+  rule.proto = Protocol::ICMPv4;
+  cls.add(rule);
+
+  auto pkt = udp_packet({10,0,0,1}, 1, {10,0,0,2}, 2);
+  EXPECT(cls.classify(*pkt, nullptr) == Classifier::NONE);
+
+  Conntrack::Entry entry{{{{10,0,0,1}, 1}, {{10,0,0,2}, 2}}, Protocol::UDP};
+  entry.state = Conntrack::State::NEW;
+  EXPECT(cls.classify(*pkt, &entry) == Classifier::NONE);
+  entry.state = Conntrack::State::ESTABLISHED;
+  EXPECT(cls.classify(*pkt, &entry) == 0u);
+
+  auto icmp = create_ip4_packet_init({10,0,0,1}, {10,0,0,2});
+  icmp->set_protocol(Protocol::ICMPv4);
+  EXPECT(cls.classify(*icmp, nullptr) == 1u);
+
+  // port rules never match packets without ports
+  rule = {};
+  rule.dport = {0, 0};
+  cls.add(rule);
+  icmp->set_protocol(Protocol::IPv4);
+  EXPECT(cls.classify(*icmp, nullptr) == Classifier::NONE);
+}
+
+CASE("Filter_classifier handles IPv6 prefixes")
+{
+  Classifier6 cls;
+  Classifier6::Rule rule;
+  rule.src = {ip6::Addr{0xfe800000, 0, 0, 0}, 10};
+  rule.verdict = Filter_verdict_type::DROP;
+  cls.add(rule);
+
+  auto pkt = create_ip6_packet_init(ip6::Addr{0xfe800000, 0, 0, 1}, ip6::Addr{0xfe800000, 0, 0, 2});
+  EXPECT(cls.classify(*pkt, nullptr) == 0u);
+
+  pkt = create_ip6_packet_init(ip6::Addr{0xfec00000, 0, 0, 1}, ip6::Addr{0xfe800000, 0, 0, 2});
+  EXPECT(cls.classify(*pkt, nullptr) == Classifier6::NONE);
+  EXPECT(cls.default_verdict() == Filter_verdict_type::ACCEPT);
+}
@@ -0,0 +1,269 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/inet>
+#include <net/interfaces>
+#include <net/http/basic_client.hpp>
+#include <kernel/timers.hpp>
+#include <hw/async_device.hpp>
+
+using namespace net;
+using namespace std::chrono;
+
+static uint64_t my_time = 0;
+
+static uint64_t get_time()
+{ return my_time; }
+
+#include <delegate>
+extern delegate<uint64_t()> systime_override;
+
+static std::unique_ptr<hw::Async_device<UserNet>> dev1 = nullptr;
+static std::unique_ptr<hw::Async_device<UserNet>> dev2 = nullptr;
+
+static const http::Basic_client::Host server_host {ip4::Addr{10,0,0,42}, 80};
+
+static const std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+
+// a server answering each request, or holding the answers back
+static struct {
+  int accepted = 0;
+  int requests = 0;
+  bool hold = false;
+  std::vector<tcp::Connection_ptr> held;
+} server;
+
+static void setup_server()
+{
+  auto& listener = Interfaces::get(0).tcp().listen(80);
+  listener.on_connect([] (tcp::Connection_ptr conn) {
+    server.accepted++;
+    conn->on_read(1024, [conn] (auto buf) {
+      const std::string_view data {(const char*) buf->data(), buf->size()};
+      for (auto pos = data.find("\r\n\r\n"); pos != data.npos;
+           pos = data.find("\r\n\r\n", pos + 4))
+      {
+        server.requests++;
+        if (server.hold)
+          server.held.push_back(conn);
+        else
+          conn->write(reply);
+      }
+    });
+  });
+}
+
+// answer the oldest request held back
+static void answer_held()
+{
+  auto conn = server.held.front();
+  server.held.erase(server.held.begin());
+  conn->write(reply);
+}
+
+static void setup_inet()
+{
+  dev1 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev2 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev1->connect(*dev2);
+  dev2->connect(*dev1);
+
+  Interfaces::get(0).network_config({10,0,0,42}, {255,255,255,0}, {10,0,0,1});
+  Interfaces::get(1).network_config({10,0,0,43}, {255,255,255,0}, {10,0,0,1});
+  setup_server();
+}
+
+static void process_events()
+{
+  for (int i = 0; i < 16; i++)
+    Events::get().process_events();
+}
+
+// let the time pass, firing the timers due
+static void advance(milliseconds ms)
+{
+  my_time += nanoseconds(ms).count();
+  Timers::timers_handler();
+  process_events();
+}
+
+struct Result {
+  int calls = 0;
+  http::Error err;
+  http::Response_ptr res = nullptr;
+};
+
+static void send(http::Basic_client& client, Result& result,
+                 http::Basic_client::Options options = {})
+{
+  auto req = client.create_request();
+  req->set_uri(uri::URI{"/"});
+  client.send(std::move(req), server_host,
+    [&result] (http::Error err, http::Response_ptr res, http::Connection&) {
+      result.calls++;
+      result.err = err;
+      result.res = std::move(res);
+    }, false, std::move(options));
+}
+
+static std::unique_ptr<http::Basic_client> make_client()
+{
+  auto client = std::make_unique<http::Basic_client>(Interfaces::get(1).tcp());
+  client->keep_alive(true);
+  http::Basic_client::Pool_options opts;
+  opts.max_conns_per_host = 1;
+  opts.pipeline_depth = 1;
+  client->set_pool_options(opts);
+  return client;
+}
+
+CASE("Setup networks")
+{
+  systime_override = get_time;
+  my_time = 1'000'000'000;
+  Timers::init([] (Timers::duration_t) {}, [] () {});
+  Timers::ready();
+  setup_inet();
+}
+
+CASE("Keep-alive connections are reused")
+{
+  auto client = make_client();
+  server = {};
+
+  Result a, b;
+  send(*client, a);
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(not a.err);
+  EXPECT(a.res->status_code() == 200);
+  EXPECT(client->connection_count(server_host) == 1u);
+
+  send(*client, b);
+  process_events();
+  EXPECT(b.calls == 1);
+  EXPECT(not b.err);
+  EXPECT(server.accepted == 1);
+  EXPECT(server.requests == 2);
+}
+
+CASE("Requests beyond the per host limit wait for a connection")
+{
+  auto client = make_client();
+  server = {};
+  server.hold = true;
+
+  Result a, b;
+  send(*client, a);
+  send(*client, b);
+  process_events();
+  EXPECT(client->queued_count(server_host) == 1u);
+  EXPECT(server.requests == 1);
+
+  // the connection is handed over to the waiting request
+  answer_held();
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(not a.err);
+  EXPECT(client->queued_count(server_host) == 0u);
+  EXPECT(server.requests == 2);
+
+  answer_held();
+  process_events();
+  EXPECT(b.calls == 1);
+  EXPECT(not b.err);
+  EXPECT(server.accepted == 1);
+}
+
+CASE("A waiting request times out on its own timeout")
+{
+  auto client = make_client();
+  server = {};
+  server.hold = true;
+
+  Result a, b;
+  send(*client, a);
+  http::Basic_client::Options options;
+  options.timeout = 100ms;
+  send(*client, b, options);
+  process_events();
+  EXPECT(client->queued_count(server_host) == 1u);
+
+  advance(50ms);
+  EXPECT(b.calls == 0);
+
+  advance(50ms);
+  EXPECT(b.calls == 1);
+  EXPECT(b.err.timeout());
+  EXPECT(b.res == nullptr);
+  EXPECT(client->queued_count(server_host) == 0u);
+
+  // and is not sent when the connection is released
+  answer_held();
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(not a.err);
+  EXPECT(b.calls == 1);
+  EXPECT(server.requests == 1);
+}
+
+CASE("The time spent waiting counts against the timeout")
+{
+  auto client = make_client();
+  server = {};
+  server.hold = true;
+
+  Result a, b;
+  send(*client, a);
+  http::Basic_client::Options options;
+  options.timeout = 100ms;
+  send(*client, b, options);
+  process_events();
+
+  advance(60ms);
+  answer_held();
+  process_events();
+  EXPECT(a.calls == 1);
+  EXPECT(server.requests == 2);
+
+  // sent with what was left, not a fresh 100ms
+  advance(40ms);
+  EXPECT(b.calls == 1);
+  EXPECT(b.err.timeout());
+  server.held.clear();
+}
+
+CASE("A connection the response handler takes the stream from is let go")
+{
+  auto client = make_client();
+  server = {};
+
+  http::Connection::Stream_ptr stream = nullptr;
+  auto req = client->create_request();
+  req->set_uri(uri::URI{"/"});
+  client->send(std::move(req), server_host,
+    [&stream] (http::Error err, http::Response_ptr, http::Connection& conn) {
+      EXPECT(not err);
+      stream = conn.release();
+    });
+  process_events();
+
+  EXPECT(stream != nullptr);
+  EXPECT(client->connection_count(server_host) == 0u);
+  stream->close();
+  process_events();
+}
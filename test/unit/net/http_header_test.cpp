@@ -113,3 +113,29 @@ CASE("Headers can be streamed")
   ss << header;
   EXPECT(ss.str().size() > 15);
 }
+
+CASE("Header::value() matches field names case-insensitively")
+{
+  http::Header header;
+  header.add_field("Content-Type", "text/html");
+  EXPECT(header.value("content-type") == "text/html");
+  EXPECT(header.value("CONTENT-TYPE") == "text/html");
+  EXPECT(header.value("Content-Typo") == "");
+  EXPECT(header.value("Content-Type-") == "");
+}
+
+CASE("Header::serialize() writes the header block in wire format")
+{
+  http::Header header;
+  std::string empty(header.serialized_size(), '\0');
+  auto end = header.serialize(empty.data());
+  EXPECT(end == empty.data() + empty.size());
+  EXPECT(empty == "\r\n");
+
+  header.add_field("Connection", "close");
+  header.add_field("Content-Length", "5");
+  std::string block(header.serialized_size(), '\0');
+  end = header.serialize(block.data());
+  EXPECT(end == block.data() + block.size());
+  EXPECT(block == "Connection: close\r\nContent-Length: 5\r\n\r\n");
+}
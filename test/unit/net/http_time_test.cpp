@@ -53,3 +53,12 @@ CASE("now() returns current time")
   auto str = http::time::now();
   EXPECT(str.size() > 0ul);
 }
+
+CASE("cached_now() returns the current time in Internet Standard Format")
+{
+  auto cached = http::time::cached_now();
+  EXPECT(cached.size() > 0ul);
+  EXPECT(http::time::to_time_t(std::string{cached}) != std::time_t{});
+  // same view is handed out within the same second
+  EXPECT(http::time::cached_now().data() == cached.data());
+}
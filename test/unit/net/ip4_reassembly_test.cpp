@@ -0,0 +1,142 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <packet_factory.hpp>
+#include <common.cxx>
+#include <net/ip4/reassembly.hpp>
+
+using namespace net;
+using Reassembly = ip4::Reassembly;
+
+static const ip4::Addr SRC {10,0,0,1};
+static const ip4::Addr DST {10,0,0,2};
+
+static uint8_t pattern(int offset) { return offset * 7 + 3; }
+
+static Reassembly::IP_packet_ptr
+fragment(uint16_t id, int offset, int len, bool more, ip4::Addr src = SRC)
+{
+  auto ip4 = create_ip4_packet_init(src, DST);
+  ip4->set_protocol(Protocol::UDP);
+  ip4->set_ip_id(id);
+  ip4->set_ip_frag_off_flags(more ? ip4::Flags::MF : ip4::Flags::NONE, offset / 8);
+  ip4->increment_data_end(len);
+  auto data = ip4->ip_data();
+  for (int i = 0; i < len; i++)
+    data[i] = pattern(offset + i);
+  ip4->set_ip_total_length(ip4->size());
+  ip4->set_ip_checksum();
+  return ip4;
+}
+
+static bool verify(const PacketIP4& pkt, int total)
+{
+  if (pkt.ip_data_length() != total) return false;
+  auto data = pkt.ip_data();
+  for (int i = 0; i < total; i++)
+    if (data[i] != pattern(i)) return false;
+  return true;
+}
+
+CASE("IP4 reassembly of out of order fragments")
+{
+  Reassembly reassembly{"reassembly_test"};
+  const RTC::timestamp_t now = 100;
+
+  EXPECT(reassembly.process(fragment(1, 2960, 1000, false), now) == nullptr);
+  EXPECT(reassembly.process(fragment(1, 0, 1480, true), now) == nullptr);
+  EXPECT(reassembly.pending() == 1u);
+  EXPECT(reassembly.memory() > 0u);
+
+  auto pkt = reassembly.process(fragment(1, 1480, 1480, true), now);
+  EXPECT(pkt != nullptr);
+  EXPECT(reassembly.pending() == 0u);
+  EXPECT(reassembly.memory() == 0u);
+
+  EXPECT(verify(*pkt, 3960));
+  EXPECT(pkt->ip_total_length() == 20 + 3960);
+  EXPECT(pkt->ip_flags() == ip4::Flags::NONE);
+  EXPECT(pkt->ip_frag_offs() == 0);
+  EXPECT(pkt->ip_src() == SRC);
+  EXPECT(pkt->ip_protocol() == Protocol::UDP);
+  EXPECT(pkt->compute_ip_checksum() == 0);
+}
+
+CASE("IP4 reassembly in place when the first buffer is large enough")
+{
+  Reassembly reassembly{"reassembly_test"};
+  auto first = fragment(2, 0, 400, true);
+  const auto* buffer = first->buf();
+
+  EXPECT(reassembly.process(std::move(first), 1) == nullptr);
+  auto pkt = reassembly.process(fragment(2, 400, 100, false), 1);
+  EXPECT(pkt != nullptr);
+  EXPECT(pkt->buf() == buffer);
+  EXPECT(verify(*pkt, 500));
+}
+
+CASE("IP4 reassembly drops overlapping and inconsistent fragments")
+{
+  Reassembly reassembly{"reassembly_test"};
+  EXPECT(reassembly.process(fragment(3, 0, 800, true), 1) == nullptr);
+  // duplicate is ignored
+  EXPECT(reassembly.process(fragment(3, 0, 800, true), 1) == nullptr);
+  EXPECT(reassembly.pending() == 1u);
+  // overlap drops the datagram
+  EXPECT(reassembly.process(fragment(3, 400, 800, true), 1) == nullptr);
+  EXPECT(reassembly.pending() == 0u);
+  EXPECT(reassembly.memory() == 0u);
+
+  // data beyond the last fragment
+  EXPECT(reassembly.process(fragment(4, 800, 100, false), 1) == nullptr);
+  EXPECT(reassembly.process(fragment(4, 1200, 400, true), 1) == nullptr);
+  EXPECT(reassembly.pending() == 0u);
+}
+
+CASE("IP4 reassembly times out and enforces limits")
+{
+  Reassembly::Config config;
+  config.max_datagrams = 2;
+  config.timeout = 10;
+  Reassembly reassembly{"reassembly_test", config};
+
+  EXPECT(reassembly.process(fragment(5, 0, 400, true), 1) == nullptr);
+  EXPECT(reassembly.process(fragment(6, 0, 400, true), 1) == nullptr);
+  // table is full
+  EXPECT(reassembly.process(fragment(7, 0, 400, true), 2) == nullptr);
+  EXPECT(reassembly.pending() == 2u);
+
+  // late fragments don't complete a timed out datagram, they start a new one
+  EXPECT(reassembly.process(fragment(5, 400, 100, false), 11) == nullptr);
+  reassembly.expire(11);
+  EXPECT(reassembly.pending() == 1u);
+  reassembly.expire(21);
+  EXPECT(reassembly.pending() == 0u);
+  EXPECT(reassembly.memory() == 0u);
+
+  // per-source memory cap
+  config.max_memory_per_source = 2 * PACKET_CAPA + 100;
+  reassembly.set_config(config);
+  EXPECT(reassembly.process(fragment(8, 0, 400, true), 20) == nullptr);
+  EXPECT(reassembly.process(fragment(8, 400, 400, true), 20) == nullptr);
+  EXPECT(reassembly.pending() == 1u);
+  EXPECT(reassembly.process(fragment(8, 800, 400, true), 20) == nullptr);
+  EXPECT(reassembly.pending() == 0u);
+  EXPECT(reassembly.memory() == 0u);
+  // another source is unaffected
+  EXPECT(reassembly.process(fragment(9, 0, 400, true, {10,0,0,3}), 20) == nullptr);
+  EXPECT(reassembly.process(fragment(9, 400, 8, false, {10,0,0,3}), 20) != nullptr);
+}
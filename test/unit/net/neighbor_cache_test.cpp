@@ -0,0 +1,107 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/neighbor_cache.hpp>
+#include <net/ip4/addr.hpp>
+
+using namespace net;
+using Cache = Neighbor_cache<ip4::Addr, int>;
+
+CASE("Neighbor_cache insert, find and erase")
+{
+  Cache cache{8};
+  EXPECT(cache.empty());
+  EXPECT(cache.capacity() == 8u);
+
+  cache.insert({10,0,0,1}, 1);
+  cache.insert({10,0,0,2}, 2);
+  EXPECT(cache.size() == 2u);
+  EXPECT(*cache.find({10,0,0,1}) == 1);
+  EXPECT(*cache.lookup({10,0,0,2}) == 2);
+  EXPECT(cache.find({10,0,0,3}) == nullptr);
+
+  // replacing keeps the size
+  cache.insert({10,0,0,1}, 11);
+  EXPECT(cache.size() == 2u);
+  EXPECT(*cache.find({10,0,0,1}) == 11);
+
+  EXPECT(cache.erase({10,0,0,1}));
+  EXPECT(not cache.erase({10,0,0,1}));
+  EXPECT(cache.find({10,0,0,1}) == nullptr);
+  EXPECT(cache.size() == 1u);
+
+  cache.clear();
+  EXPECT(cache.empty());
+  EXPECT(cache.find({10,0,0,2}) == nullptr);
+}
+
+CASE("Neighbor_cache evicts the least recently used entry when full")
+{
+  Cache cache{4};
+  for (int i = 1; i <= 4; i++)
+    cache.insert({10,0,0,(uint8_t)i}, i);
+
+  // 10.0.0.1 is now the most recently used
+  EXPECT(cache.lookup({10,0,0,1}) != nullptr);
+
+  cache.insert({10,0,0,5}, 5);
+  EXPECT(cache.size() == 4u);
+  EXPECT(cache.evictions() == 1u);
+  EXPECT(cache.find({10,0,0,2}) == nullptr);
+  EXPECT(cache.find({10,0,0,1}) != nullptr);
+
+  // find() does not affect LRU order
+  EXPECT(cache.find({10,0,0,3}) != nullptr);
+  cache.insert({10,0,0,6}, 6);
+  EXPECT(cache.find({10,0,0,3}) == nullptr);
+}
+
+CASE("Neighbor_cache stays consistent under churn")
+{
+  const size_t cap = 64;
+  Cache cache{cap};
+  std::vector<int> recent;
+
+  for (int i = 0; i < 5000; i++)
+  {
+    const ip4::Addr addr{(uint32_t) (i * 7919) % 300};
+    if (i % 3 == 0)
+      cache.erase(addr);
+    else
+      cache.insert(addr, i);
+    EXPECT(cache.size() <= cap);
+  }
+
+  // every entry reachable from the LRU list is also found by hashing
+  size_t visited = 0;
+  cache.for_each([&] (const ip4::Addr& addr, int& value) {
+    visited++;
+    auto* entry = cache.find(addr);
+    EXPECT(entry != nullptr);
+    EXPECT(*entry == value);
+  });
+  EXPECT(visited == cache.size());
+
+  auto removed = cache.erase_if([] (const ip4::Addr&, const int& value) {
+    return value % 2 == 0;
+  });
+  EXPECT(cache.size() + removed == visited);
+  cache.for_each([&] (const ip4::Addr& addr, int& value) {
+    EXPECT(value % 2 == 1);
+    EXPECT(cache.find(addr) != nullptr);
+  });
+}
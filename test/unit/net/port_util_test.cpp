@@ -17,6 +17,7 @@
 
 #include <common.cxx>
 #include <net/port_util.hpp>
+#include <set>
 
 CASE("Binding and unbinding")
 {
@@ -87,3 +88,33 @@ CASE("Simulating random connections")
     EXPECT(util.has_free_ephemeral() == false);
   }
 }
+
+CASE("Hashed ephemeral ports per destination")
+{
+  using namespace net;
+  Port_util util;
+  const Socket dest1 {ip4::Addr{10,0,0,1}, 80};
+  const Socket dest2 {ip4::Addr{10,0,0,2}, 80};
+
+  // successive ports for one destination are unique
+  std::set<uint16_t> used;
+  for(int i = 0; i < 100; i++)
+  {
+    const auto port = util.get_next_ephemeral(dest1);
+    EXPECT(port_ranges::is_dynamic(port));
+    EXPECT(not util.is_bound(port));
+    util.bind(port);
+    EXPECT(used.insert(port).second);
+  }
+  const auto port = util.get_next_ephemeral(dest2);
+  EXPECT(not util.is_bound(port));
+
+  // fill up the range, the last ports are found by scanning
+  for(auto i = util.size() - 100; i > 0; --i)
+    util.bind(util.get_next_ephemeral(dest2));
+  EXPECT(util.has_free_ephemeral() == false);
+  EXPECT_THROWS_AS(util.get_next_ephemeral(dest1), net::Port_error);
+
+  util.unbind(port_ranges::DYNAMIC_END);
+  EXPECT(util.get_next_ephemeral(dest1) == port_ranges::DYNAMIC_END);
+}
@@ -0,0 +1,98 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/tcp/connection_table.hpp>
+
+using namespace net;
+using namespace net::tcp;
+using Tuple = Connection_table::Tuple;
+
+// a distinct, never dereferenced connection pointer
+static Connection_ptr fake_conn(uintptr_t id)
+{ return Connection_ptr{std::shared_ptr<void>{}, reinterpret_cast<Connection*>(id)}; }
+
+static Tuple tuple(uint16_t rport, uint8_t host = 1)
+{ return {{ip4::Addr{10,0,0,1}, 80}, {ip4::Addr{10,0,1,host}, rport}}; }
+
+CASE("Connection_table finds, inserts and erases connections")
+{
+  Connection_table table{8};
+  EXPECT(table.empty());
+
+  EXPECT(table.insert(tuple(1000), fake_conn(1)));
+  EXPECT(table.insert(tuple(1001), fake_conn(2)));
+  EXPECT(not table.insert(tuple(1000), fake_conn(3)));
+  EXPECT(table.size() == 2u);
+
+  auto* conn = table.find(tuple(1000));
+  EXPECT(conn != nullptr);
+  EXPECT(conn->get() == reinterpret_cast<Connection*>(1));
+  EXPECT(table.find(tuple(1002)) == nullptr);
+
+  // the hash is not symmetric
+  const Tuple reversed{tuple(1000).second, tuple(1000).first};
+  EXPECT(table.hash(reversed) != table.hash(tuple(1000)));
+  EXPECT(table.find(reversed) == nullptr);
+
+  EXPECT(table.erase(tuple(1000)));
+  EXPECT(not table.erase(tuple(1000)));
+  EXPECT(table.find(tuple(1000)) == nullptr);
+  EXPECT(table.find(tuple(1001))->get() == reinterpret_cast<Connection*>(2));
+  EXPECT(table.size() == 1u);
+}
+
+CASE("Connection_table grows and keeps every connection reachable")
+{
+  Connection_table table{8};
+  const size_t initial = table.capacity();
+  const uint16_t N = 5000;
+
+  for(uint16_t i = 0; i < N; i++)
+    EXPECT(table.insert(tuple(i, i % 7), fake_conn(i + 1)));
+  EXPECT(table.size() == N);
+  EXPECT(table.capacity() > initial);
+
+  // erase every other, which frees slots along the probe sequences
+  for(uint16_t i = 0; i < N; i += 2)
+    EXPECT(table.erase(tuple(i, i % 7)));
+
+  size_t found = 0;
+  for(uint16_t i = 0; i < N; i++)
+  {
+    auto* conn = table.find(tuple(i, i % 7));
+    if(i % 2 == 0) {
+      EXPECT(conn == nullptr);
+    }
+    else {
+      EXPECT(conn != nullptr);
+      EXPECT(conn->get() == reinterpret_cast<Connection*>(i + 1));
+      found++;
+    }
+  }
+  EXPECT(found == N / 2u);
+
+  // freed entries are reused
+  for(uint16_t i = 0; i < N; i += 2)
+    EXPECT(table.insert(tuple(i, i % 7), fake_conn(i + 1)));
+
+  size_t visited = 0;
+  table.for_each([&] (const Tuple& t, const Connection_ptr& conn) {
+    EXPECT(conn.get() == reinterpret_cast<Connection*>(t.second.port() + 1));
+    visited++;
+  });
+  EXPECT(visited == N);
+}
@@ -0,0 +1,153 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/inet>
+#include <net/interfaces>
+#include <hw/async_device.hpp>
+
+using namespace net;
+
+static std::unique_ptr<hw::Async_device<UserNet>> dev1 = nullptr;
+static std::unique_ptr<hw::Async_device<UserNet>> dev2 = nullptr;
+
+static void setup_inet()
+{
+  dev1 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev2 = std::make_unique<hw::Async_device<UserNet>>(UserNet::create(1500));
+  dev1->connect(*dev2);
+  dev2->connect(*dev1);
+
+  auto& inet_server = net::Interfaces::get(0);
+  inet_server.network_config({10,0,0,42}, {255,255,255,0}, {10,0,0,1});
+  auto& inet_client = net::Interfaces::get(1);
+  inet_client.network_config({10,0,0,43}, {255,255,255,0}, {10,0,0,1});
+}
+
+static void process_events(int rounds = 16)
+{
+  for (int i = 0; i < rounds; i++)
+    Events::get().process_events();
+}
+
+static tcp::buffer_t make_data(size_t len, uint8_t seed)
+{
+  auto buf = tcp::construct_buffer(len);
+  for (size_t i = 0; i < len; i++)
+    (*buf)[i] = (uint8_t) (seed + i * 7);
+  return buf;
+}
+
+static std::vector<uint8_t> flatten(const tcp::Payload_chain& chain)
+{
+  std::vector<uint8_t> data;
+  for (const auto& p : chain)
+    data.insert(data.end(), p.begin(), p.end());
+  return data;
+}
+
+static bool same(const std::vector<uint8_t>& data, const tcp::buffer_t& buf)
+{
+  return std::equal(data.begin(), data.end(), buf->begin(), buf->end());
+}
+
+// the client's packets are received (and held) by the server
+static size_t client_buffers()
+{
+  return dev2->nic().transmit_queue_available();
+}
+
+static std::vector<tcp::Payload_chain> chains;
+static tcp::Connection_ptr client_conn = nullptr;
+
+CASE("Setup networks")
+{
+  setup_inet();
+
+  auto& server = Interfaces::get(0).tcp().listen(80);
+  server.on_connect([] (tcp::Connection_ptr conn) {
+    conn->on_read_chain(16384, [] (tcp::Payload_chain chain) {
+      chains.push_back(std::move(chain));
+    });
+  });
+
+  Interfaces::get(1).tcp().connect({ip4::Addr{10,0,0,42}, 80},
+    [] (tcp::Connection_ptr conn) {
+      client_conn = conn;
+    });
+  process_events();
+
+  EXPECT(client_conn != nullptr);
+  EXPECT(client_conn->is_connected());
+}
+
+CASE("In order segments are joined into one chain, delivered on PSH")
+{
+  chains.clear();
+  // two segments, the last one pushed
+  auto data = make_data(2500, 1);
+  client_conn->write(data);
+  process_events();
+
+  EXPECT(chains.size() == 1u);
+  EXPECT(chains.at(0).size() == 2u);
+  EXPECT(tcp::chain_size(chains.at(0)) == data->size());
+  EXPECT(same(flatten(chains.at(0)), data));
+}
+
+CASE("Packets are released back to the pool when the chain is dropped")
+{
+  chains.clear();
+  process_events();
+  const auto before = client_buffers();
+
+  auto data = make_data(2500, 2);
+  client_conn->write(data);
+  process_events();
+
+  EXPECT(chains.size() == 1u);
+  // the payloads keep the received packets alive
+  EXPECT(client_buffers() <= before - chains.at(0).size());
+  EXPECT(same(flatten(chains.at(0)), data));
+
+  chains.clear();
+  process_events();
+  EXPECT(client_buffers() == before);
+}
+
+CASE("Chains are delivered in stream order across writes")
+{
+  chains.clear();
+  auto first  = make_data(1000, 3);
+  auto second = make_data(2000, 4);
+  client_conn->write(first);
+  client_conn->write(second);
+  process_events();
+
+  std::vector<uint8_t> received;
+  for (const auto& chain : chains) {
+    auto part = flatten(chain);
+    received.insert(received.end(), part.begin(), part.end());
+  }
+  std::vector<uint8_t> expected(first->begin(), first->end());
+  expected.insert(expected.end(), second->begin(), second->end());
+  EXPECT(received == expected);
+
+  chains.clear();
+  client_conn->close();
+  process_events();
+  client_conn = nullptr;
+}
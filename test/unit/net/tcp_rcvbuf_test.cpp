@@ -0,0 +1,67 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/tcp/rcvbuf_tuner.hpp>
+
+using namespace net::tcp;
+
+CASE("Receive buffer grows once per RTT while the sender sends more")
+{
+  Rcvbuf_tuner tuner;
+  const uint32_t srtt = 20;
+  // the first data starts the measurement
+  EXPECT(tuner.on_data(1000, 1000, 65535, srtt) == 0u);
+  // less than an RTT later nothing is decided
+  EXPECT(tuner.on_data(1010, 11000, 65535, srtt) == 0u);
+  // 20000 bytes in the first RTT
+  EXPECT(tuner.on_data(1020, 21000, 65535, srtt) == 40000u);
+  // 40000 bytes in the next
+  EXPECT(tuner.on_data(1040, 61000, 65535, srtt) == 80000u);
+  // the sender slowed down, keep the buffer
+  EXPECT(tuner.on_data(1060, 71000, 65535, srtt) == 0u);
+  EXPECT(tuner.on_data(1080, 131000, 65535, srtt) == 120000u);
+}
+
+CASE("Receiver side RTT is measured in ms when there's no sender RTT")
+{
+  Rcvbuf_tuner tuner;
+  EXPECT(tuner.on_data(1000, 0, 5000, 0) == 0u);
+  EXPECT(tuner.rcv_rtt == 0u);
+  // a full window took 15 ms to arrive
+  EXPECT(tuner.on_data(1015, 5000, 5000, 0) == 0u);
+  EXPECT(tuner.rcv_rtt == 15u);
+  // which is used to pace the growth
+  EXPECT(tuner.on_data(1025, 8000, 5000, 0) == 0u);
+  EXPECT(tuner.on_data(1030, 12000, 5000, 0) == 14000u);
+}
+
+CASE("Connections are idle after a period without data, and measure over")
+{
+  Rcvbuf_tuner tuner;
+  tuner.on_data(5000, 0, 5000, 20);
+  tuner.on_data(5020, 10000, 5000, 20);
+  EXPECT(not tuner.idle(5500, 1000));
+  EXPECT(tuner.idle(6020, 1000));
+  // the clock wraps around
+  tuner.on_data(0xffffff00, 20000, 5000, 20);
+  EXPECT(not tuner.idle(0x100, 1000));
+  EXPECT(tuner.idle(0x400, 1000));
+
+  tuner.restart();
+  EXPECT(tuner.on_data(7000, 30000, 5000, 20) == 0u);
+  EXPECT(tuner.on_data(7020, 50000, 5000, 20) == 40000u);
+}
@@ -172,6 +172,30 @@ CASE("Reseting the buffer")
   EXPECT(buf.buffer()->data() != data);
 }
 
+CASE("Shrinking an empty buffer")
+{
+  using namespace net::tcp;
+  seq_t SEQ = 1000;
+  Read_buffer buf{SEQ, MIN_BUFSZ, MAX_BUFSZ};
+  EXPECT(buf.buffer()->capacity() >= MIN_BUFSZ);
+
+  // data is kept
+  const std::string str = "idle";
+  SEQ += buf.insert(SEQ, (uint8_t*)str.data(), str.size());
+  buf.shrink();
+  EXPECT(buf.buffer()->capacity() >= MIN_BUFSZ);
+
+  buf.reset(SEQ);
+  buf.shrink();
+  EXPECT(buf.buffer()->capacity() == 0u);
+  EXPECT(buf.capacity() == MAX_BUFSZ);
+
+  // and allocated again when needed
+  buf.insert(SEQ, (uint8_t*)str.data(), str.size(), true);
+  EXPECT(buf.size() == str.size());
+  EXPECT(buf.is_ready());
+}
+
 #include <limits>
 CASE("fits()")
 {
@@ -0,0 +1,143 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/tcp/scoreboard.hpp>
+
+using namespace net::tcp;
+using Block = sack::Block;
+
+static void send_segments(Scoreboard& sb, seq_t seq, int count, uint32_t now)
+{
+  for (int i = 0; i < count; i++, seq += 1000)
+    sb.on_send(seq, seq + 1000, now);
+}
+
+CASE("Scoreboard marks holes below SACKed data as lost")
+{
+  Scoreboard sb;
+  send_segments(sb, 1000, 5, 0);
+  EXPECT(sb.size() == 5u);
+  EXPECT(sb.pipe() == 5000u);
+
+  // first segment acked, second is missing
+  Block blocks[] { {3000, 6000} };
+  EXPECT(sb.on_ack(2000, blocks, 1, 50) == 3000u);
+  EXPECT(sb.size() == 4u);
+  EXPECT(sb.sacked_bytes() == 3000u);
+  EXPECT(sb.pipe() == 1000u);
+  EXPECT(sb.rack_rtt() == 50u);
+  EXPECT(not sb.has_lost());
+
+  // three segments SACKed above the hole, no reordering window
+  EXPECT(sb.detect_loss(50, false) == 0u);
+  EXPECT(sb.has_lost());
+  EXPECT(sb.pipe() == 0u);
+
+  const auto* lost = sb.next_lost();
+  EXPECT(lost != nullptr);
+  EXPECT(lost->start == 2000u);
+  EXPECT(lost->end == 3000u);
+
+  sb.on_retransmit(2000, 60);
+  EXPECT(not sb.has_lost());
+  EXPECT(sb.next_lost() == nullptr);
+  EXPECT(sb.pipe() == 1000u);
+
+  // sending above SND.MAX is new data
+  sb.on_send(6000, 7000, 60);
+  EXPECT(sb.pipe() == 2000u);
+
+  sb.on_ack(7000, nullptr, 0, 120);
+  EXPECT(sb.empty());
+  EXPECT(sb.pipe() == 0u);
+  EXPECT(sb.sacked_bytes() == 0u);
+}
+
+CASE("Scoreboard waits a reordering window before marking loss")
+{
+  Scoreboard sb;
+  send_segments(sb, 0, 3, 0);
+
+  Block blocks[] { {2000, 3000} };
+  sb.on_ack(0, blocks, 1, 40);
+  // reo_wnd is min_rtt / 4
+  EXPECT(sb.detect_loss(40, false) == 10u);
+  EXPECT(not sb.has_lost());
+
+  EXPECT(sb.detect_loss(50, false) == 0u);
+  EXPECT(sb.has_lost());
+  EXPECT(sb.pipe() == 0u);
+  EXPECT(sb.next_lost()->start == 0u);
+}
+
+CASE("Scoreboard detects reordering and handles timeouts")
+{
+  Scoreboard sb;
+  send_segments(sb, 0, 4, 0);
+
+  // third segment arrives before the first two
+  Block blocks[] { {2000, 3000} };
+  sb.on_ack(0, blocks, 1, 30);
+  EXPECT(not sb.reordering_seen());
+  sb.on_ack(2000, blocks, 1, 31);
+  EXPECT(sb.reordering_seen());
+  EXPECT(sb.size() == 2u);
+
+  // partially acked segment is trimmed
+  sb.on_ack(3500, nullptr, 0, 32);
+  EXPECT(sb.outstanding() == 500u);
+  EXPECT(sb.last_unsacked()->start == 3500u);
+
+  // retransmission timeout
+  sb.mark_all_lost();
+  EXPECT(sb.has_lost());
+  EXPECT(sb.pipe() == 0u);
+  sb.on_retransmit(3500, 1000);
+  EXPECT(sb.pipe() == 500u);
+
+  // lost retransmissions are detected, and need another retransmit
+  sb.on_send(4000, 5000, 1100);
+  Block newer[] { {4000, 5000} };
+  sb.on_ack(3500, newer, 1, 1150);
+  sb.detect_loss(2000, true);
+  EXPECT(sb.has_lost());
+  EXPECT(sb.next_lost()->start == 3500u);
+
+  sb.clear();
+  EXPECT(sb.empty());
+  EXPECT(sb.min_rtt() == 0u);
+}
+
+CASE("Scoreboard doesn't see reordering in the first delivery of a high ISN")
+{
+  Scoreboard sb;
+  // above 2^31, which is "below" the initial highest delivered sequence
+  const seq_t isn = 0x90000000;
+  send_segments(sb, isn, 3, 0);
+
+  sb.on_ack(isn + 1000, nullptr, 0, 40);
+  EXPECT(not sb.reordering_seen());
+  sb.on_ack(isn + 3000, nullptr, 0, 41);
+  EXPECT(not sb.reordering_seen());
+
+  // reordering is still seen above it
+  send_segments(sb, isn + 3000, 2, 50);
+  Block blocks[] { {isn + 4000, isn + 5000} };
+  sb.on_ack(isn + 3000, blocks, 1, 90);
+  sb.on_ack(isn + 5000, nullptr, 0, 91);
+  EXPECT(sb.reordering_seen());
+}
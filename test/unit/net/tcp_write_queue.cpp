@@ -230,3 +230,28 @@ CASE("Creating a WriteQueue and operate it")
     }
   }
 };
+
+CASE("Reading unacknowledged data at an offset from SND.UNA")
+{
+  Write_queue wq;
+  wq.push_back(create_write_request(1000));
+  wq.push_back(create_write_request(500));
+  wq.advance(1000);
+  wq.advance(500);
+
+  auto data = wq.data_at(0);
+  EXPECT( data.first == wq.una()->data() );
+  EXPECT( data.second == 1000u );
+
+  wq.acknowledge(300);
+  data = wq.data_at(200);
+  EXPECT( data.first == wq.una()->data() + 500 );
+  EXPECT( data.second == 500u );
+
+  data = wq.data_at(900);
+  EXPECT( data.second == 300u );
+
+  data = wq.data_at(1200);
+  EXPECT( data.first == nullptr );
+  EXPECT( data.second == 0u );
+}
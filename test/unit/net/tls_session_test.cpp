@@ -0,0 +1,122 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/tls/session_cache.hpp>
+#include <net/tls/ticket_keys.hpp>
+#include <cstring>
+#include <vector>
+
+using namespace net::tls;
+using namespace std::chrono;
+
+CASE("Session cache evicts the least recently used and expires sessions")
+{
+  Session_cache cache(2, seconds(60));
+  cache.store("a", "session a", 1000);
+  cache.store("b", "session b", 1000);
+  EXPECT(cache.size() == 2u);
+
+  // touching "a" makes "b" the next to go
+  EXPECT(cache.find("a", 1010) == "session a");
+  cache.store("c", "session c", 1020);
+  EXPECT(cache.size() == 2u);
+  EXPECT(cache.find("b", 1020).empty());
+  EXPECT(cache.find("c", 1020) == "session c");
+
+  // replacing keeps one entry per ID
+  cache.store("c", "session c2", 1030);
+  EXPECT(cache.size() == 2u);
+  EXPECT(cache.find("c", 1030) == "session c2");
+
+  // "a" was stored at 1000 and has a 60 second lifetime
+  EXPECT(cache.find("a", 1060).empty());
+  EXPECT(cache.size() == 1u);
+
+  cache.remove("c");
+  EXPECT(cache.size() == 0u);
+  EXPECT(cache.hits() == 3u);
+  EXPECT(cache.misses() == 2u);
+
+  // oversized IDs are not stored
+  cache.store(std::string(Session_cache::MAX_ID_LEN + 1, 'x'), "session", 1000);
+  EXPECT(cache.size() == 0u);
+}
+
+CASE("Ticket keys rotate and accept older keys until they expire")
+{
+  Ticket_keys keys(seconds(100));
+  EXPECT(keys.size() == 0u);
+
+  const auto& first = keys.current(1000);
+  uint8_t first_name[Ticket_keys::NAME_LEN];
+  std::memcpy(first_name, first.name, sizeof(first_name));
+  EXPECT(keys.size() == 1u);
+  EXPECT(&keys.current(1099) == &first);
+
+  // past the lifetime a new key is used, the old one is still accepted
+  const auto& second = keys.current(1100);
+  EXPECT(keys.size() == 2u);
+  EXPECT(std::memcmp(second.name, first_name, sizeof(first_name)) != 0);
+  EXPECT(keys.find(first_name, 1150) != nullptr);
+  EXPECT(keys.find(second.name, 1150) == &second);
+  // but not after two lifetimes
+  EXPECT(keys.find(first_name, 1200) == nullptr);
+
+  // the number of keys is bounded
+  for (int i = 0; i < 10; i++) keys.rotate(1100);
+  EXPECT(keys.size() == Ticket_keys::MAX_KEYS);
+}
+
+CASE("Ticket keys survive serialization")
+{
+  Ticket_keys keys(seconds(100));
+  keys.current(1000);
+  keys.rotate(1050);
+  const auto current = keys.current(1050);
+
+  std::vector<char> buffer(keys.serialized_size());
+  EXPECT(keys.serialize_to(buffer.data(), buffer.size()) == buffer.size());
+
+  Ticket_keys restored;
+  restored.deserialize_from(buffer.data(), buffer.size());
+  EXPECT(restored.size() == 2u);
+  EXPECT(restored.lifetime() == seconds(100));
+  const auto& key = restored.current(1050);
+  EXPECT(std::memcmp(&key, &current, sizeof(key)) == 0);
+
+  EXPECT_THROWS(restored.deserialize_from(buffer.data(), buffer.size() - 1));
+  buffer[0] ^= 1;
+  EXPECT_THROWS(restored.deserialize_from(buffer.data(), buffer.size()));
+  EXPECT_THROWS(keys.serialize_to(buffer.data(), 8));
+}
+
+CASE("Ticket keys list the accepted keys, newest first")
+{
+  Ticket_keys keys(seconds(100));
+  keys.current(1000);
+  keys.rotate(1050);
+  keys.rotate(1150);
+
+  std::vector<Ticket_keys::timestamp_t> created;
+  keys.for_each([&] (const auto& key) { created.push_back(key.created); }, 1150);
+  EXPECT(created == (std::vector<Ticket_keys::timestamp_t>{1150, 1050, 1000}));
+
+  // the first key is two lifetimes old
+  created.clear();
+  keys.for_each([&] (const auto& key) { created.push_back(key.created); }, 1200);
+  EXPECT(created == (std::vector<Ticket_keys::timestamp_t>{1150, 1050}));
+}
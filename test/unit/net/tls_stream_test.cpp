@@ -0,0 +1,274 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <net/openssl/tls_stream.hpp>
+#include <openssl/x509.h>
+#include <deque>
+
+using openssl::TLS_stream;
+
+// one end of an in-memory transport, handing what was written
+// to the other end when delivered
+struct Pipe : public net::StreamBuffer
+{
+  Pipe* peer = nullptr;
+  std::deque<buffer_t> outq;
+  // the size of each write, and all that was written
+  std::vector<size_t> writes;
+  std::vector<uint8_t> sent;
+  bool closing = false;
+  bool closed_ = false;
+
+  void write(buffer_t buf) override {
+    writes.push_back(buf->size());
+    sent.insert(sent.end(), buf->begin(), buf->end());
+    outq.push_back(std::move(buf));
+  }
+  void write(const std::string& str) override {
+    write(construct_buffer(str.begin(), str.end()));
+  }
+  void write(const void* data, size_t n) override {
+    const auto* buf = static_cast<const uint8_t*> (data);
+    write(construct_buffer(buf, buf + n));
+  }
+  // like TCP, what was written before closing is still delivered
+  void close() override {
+    closing = true;
+  }
+
+  bool deliver() {
+    if (outq.empty()) {
+      if (not closing or closed_) return false;
+      closed_ = true;
+      peer->closed();
+      return true;
+    }
+    auto bufs = std::move(outq);
+    outq.clear();
+    for (auto& buf : bufs)
+      peer->enqueue_data(std::move(buf));
+    peer->signal_data();
+    return true;
+  }
+
+  void clear() {
+    writes.clear();
+    sent.clear();
+  }
+
+  net::Socket local() const override { return {}; }
+  net::Socket remote() const override { return {}; }
+  std::string to_string() const override { return "pipe"; }
+  bool is_connected() const noexcept override { return not closing; }
+  bool is_writable() const noexcept override { return not closing; }
+  bool is_readable() const noexcept override { return not closed_; }
+  bool is_closing() const noexcept override { return closing and not closed_; }
+  bool is_closed() const noexcept override { return closed_; }
+  int get_cpuid() const noexcept override { return 0; }
+  net::Stream* transport() noexcept override { return nullptr; }
+  void handle_read_congestion() override {}
+  void handle_write_congestion() override {}
+};
+
+// a self-signed certificate, made once
+static SSL_CTX* server_context()
+{
+  static SSL_CTX* ctx = [] {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    auto* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*) "localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    auto* ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx, cert);
+    SSL_CTX_use_PrivateKey(ctx, key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+  }();
+  return ctx;
+}
+
+static SSL_CTX* client_context()
+{
+  static SSL_CTX* ctx = [] {
+    auto* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    return ctx;
+  }();
+  return ctx;
+}
+
+// an end of the connection, and what it received
+struct Peer {
+  Pipe* pipe = nullptr;
+  std::unique_ptr<TLS_stream> tls;
+  std::string received;
+  int connects = 0;
+  int closes = 0;
+  // the data received when closed
+  std::string at_close;
+};
+
+struct Connection {
+  Peer client, server;
+
+  Connection()
+  {
+    auto cpipe = std::make_unique<Pipe>();
+    auto spipe = std::make_unique<Pipe>();
+    client.pipe = cpipe.get();
+    server.pipe = spipe.get();
+    cpipe->peer = spipe.get();
+    spipe->peer = cpipe.get();
+
+    server.tls = std::make_unique<TLS_stream>(server_context(), std::move(spipe));
+    client.tls = std::make_unique<TLS_stream>(client_context(), std::move(cpipe), true);
+    for (auto* peer : {&client, &server})
+    {
+      peer->tls->on_connect([peer] (net::Stream&) { peer->connects++; });
+      peer->tls->on_read(0, [peer] (auto buf) {
+        peer->received.append((const char*) buf->data(), buf->size());
+      });
+      peer->tls->on_close([peer] {
+        peer->closes++;
+        peer->at_close = peer->received;
+      });
+    }
+    pump();
+  }
+
+  // deliver until both ends are quiet
+  void pump()
+  {
+    while (client.pipe->deliver() | server.pipe->deliver());
+  }
+};
+
+// the number of TLS records in what was written
+static size_t count_records(const std::vector<uint8_t>& data)
+{
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos + 5 <= data.size())
+  {
+    pos += 5 + ((data[pos + 3] << 8) | data[pos + 4]);
+    count++;
+  }
+  EXPECT(pos == data.size());
+  return count;
+}
+
+static std::string pattern(size_t len)
+{
+  std::string str(len, 0);
+  for (size_t i = 0; i < len; i++)
+    str[i] = 'a' + (i * 7) % 26;
+  return str;
+}
+
+CASE("TLS streams complete the handshake over an in-memory transport")
+{
+  Connection conn;
+  EXPECT(conn.client.connects == 1);
+  EXPECT(conn.server.connects == 1);
+  EXPECT(conn.client.tls->is_connected());
+  EXPECT(conn.server.tls->is_connected());
+
+  // outside the callbacks writes are sent right away
+  conn.client.pipe->clear();
+  conn.client.tls->write("hello");
+  conn.client.tls->write("world");
+  EXPECT(conn.client.pipe->writes.size() == 2u);
+  conn.pump();
+  EXPECT(conn.server.received == "helloworld");
+}
+
+CASE("Small writes from within on_read are coalesced into one record")
+{
+  Connection conn;
+  std::string expected;
+  for (int i = 0; i < 10; i++)
+    expected += "reply " + std::to_string(i) + "\n";
+
+  auto& server = *conn.server.tls;
+  server.on_read(0, [&server] (auto) {
+    for (int i = 0; i < 10; i++)
+      server.write("reply " + std::to_string(i) + "\n");
+  });
+  conn.server.pipe->clear();
+  conn.client.tls->write("ping");
+  conn.pump();
+
+  EXPECT(conn.client.received == expected);
+  EXPECT(conn.server.pipe->writes.size() == 1u);
+  EXPECT(count_records(conn.server.pipe->sent) == 1u);
+}
+
+CASE("Writes above the record size are split into records, in order")
+{
+  Connection conn;
+  const auto big = pattern(TLS_stream::RECORD_SIZE * 2 + 1000);
+
+  auto& server = *conn.server.tls;
+  server.on_read(0, [&server, &big] (auto) {
+    server.write("head");
+    server.write(big);
+    server.write("tail");
+  });
+  conn.server.pipe->clear();
+  conn.client.tls->write("ping");
+  conn.pump();
+
+  EXPECT(conn.client.received == "head" + big + "tail");
+  EXPECT(count_records(conn.server.pipe->sent) >= 3u);
+
+  // and from outside the callbacks
+  auto& received = conn.server.received;
+  server.on_read(0, [&received] (auto buf) {
+    received.append((const char*) buf->data(), buf->size());
+  });
+  conn.client.tls->write(big);
+  conn.pump();
+  EXPECT(received == big);
+}
+
+CASE("Closing with coalesced data pending sends it before closing")
+{
+  Connection conn;
+
+  auto& server = *conn.server.tls;
+  server.on_read(0, [&server] (auto) {
+    server.write("bye ");
+    server.write("now");
+    server.close();
+  });
+  conn.client.tls->write("ping");
+  conn.pump();
+
+  EXPECT(conn.server.closes == 1);
+  EXPECT(conn.client.closes == 1);
+  EXPECT(conn.client.at_close == "bye now");
+  EXPECT(conn.server.pipe->closing);
+}
@@ -0,0 +1,69 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <nic_mock.hpp>
+#include <net/inet>
+#include <cstring>
+#include <vector>
+
+using namespace net;
+
+CASE("sendmmsg sends each datagram with its own header and next hop")
+{
+  Nic_mock nic;
+  Inet inet{nic};
+  inet.network_config({10,0,0,45}, {255,255,255,0}, {10,0,0,1});
+
+  struct Sent {
+    ip4::Addr dst;
+    ip4::Addr next_hop;
+    uint16_t  total_length;
+    bool      checksum_ok;
+    int       chain_length;
+    std::string payload;
+  };
+  std::vector<Sent> sent;
+  inet.ip_obj().set_linklayer_out(
+    [&sent] (Packet_ptr pkt, ip4::Addr next_hop) {
+      auto ip = static_unique_ptr_cast<PacketIP4>(std::move(pkt));
+      const auto* data = (const char*) ip->ip_data().data() + sizeof(udp::Header);
+      sent.push_back({ip->ip_dst(), next_hop, ip->ip_total_length(),
+                      ip->compute_ip_checksum() == 0, ip->chain_length(),
+                      std::string(data, ip->ip_total_length() - ip->ip_header_length() - sizeof(udp::Header))});
+    });
+
+  auto& sock = inet.udp().bind(5000);
+  const std::string msgs[] { "first", "second datagram", "3" };
+  const udp::Datagram batch[] {
+    { ip4::Addr{10,0,0,50}, 53,  (const uint8_t*) msgs[0].data(), msgs[0].size() },
+    { ip4::Addr{8,8,8,8},   53,  (const uint8_t*) msgs[1].data(), msgs[1].size() },
+    { ip4::Addr{10,0,0,51}, 123, (const uint8_t*) msgs[2].data(), msgs[2].size() },
+  };
+  EXPECT(sock.sendmmsg(batch, 3) == 3u);
+  EXPECT(sent.size() == 3u);
+
+  const ip4::Addr next_hops[] { {10,0,0,50}, {10,0,0,1}, {10,0,0,51} };
+  for (size_t i = 0; i < sent.size(); i++)
+  {
+    EXPECT(sent[i].chain_length == 1);
+    EXPECT(sent[i].dst == batch[i].addr.v4());
+    EXPECT(sent[i].next_hop == next_hops[i]);
+    EXPECT(sent[i].checksum_ok);
+    EXPECT(sent[i].total_length == 20 + sizeof(udp::Header) + msgs[i].size());
+    EXPECT(sent[i].payload == msgs[i]);
+  }
+}
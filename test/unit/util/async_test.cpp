@@ -0,0 +1,200 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <async>
+#include <fs/disk.hpp>
+#include <fs/memdisk.hpp>
+#include <deque>
+#include <unistd.h>
+using namespace fs;
+
+static MemDisk* mdisk = nullptr;
+static Disk_ptr disk = nullptr;
+static std::unique_ptr<Dirent> ent = nullptr;
+static std::string contents;
+
+/**
+ * A stream which queues what is written until the test
+ * lets it go out, like a TCP connection's write queue
+ */
+struct Mock_stream : public net::Stream
+{
+  std::string out;
+  WriteCallback on_write_;
+  std::deque<size_t> pending;
+  size_t queued = 0;
+  size_t max_queued = 0;
+  bool writable = true;
+
+  // hand the oldest write to the network
+  void transmit_one()
+  {
+    const auto n = pending.front();
+    pending.pop_front();
+    queued -= n;
+    if (on_write_) on_write_(n);
+  }
+
+  void write(buffer_t buf) override
+  {
+    out.append((const char*) buf->data(), buf->size());
+    pending.push_back(buf->size());
+    queued += buf->size();
+    max_queued = std::max(max_queued, queued);
+  }
+  void on_write(WriteCallback cb) override { on_write_ = std::move(cb); }
+
+  void on_connect(ConnectCallback) override {}
+  void on_read(size_t, ReadCallback) override {}
+  void on_data(DataCallback) override {}
+  size_t next_size() override { return 0; }
+  buffer_t read_next() override { return nullptr; }
+  void on_close(CloseCallback) override {}
+  void write(const void*, size_t) override {}
+  void write(const std::string&) override {}
+  void close() override {}
+  void reset_callbacks() override {}
+  net::Socket local() const override { return {}; }
+  net::Socket remote() const override { return {}; }
+  std::string to_string() const override { return "Mock_stream"; }
+  bool is_connected() const noexcept override { return writable; }
+  bool is_writable() const noexcept override { return writable; }
+  bool is_readable() const noexcept override { return writable; }
+  bool is_closing() const noexcept override { return false; }
+  bool is_closed() const noexcept override { return not writable; }
+  int get_cpuid() const noexcept override { return 0; }
+  Stream* transport() noexcept override { return nullptr; }
+};
+
+CASE("Prepare memdisk")
+{
+  std::string path = "memdisk.fat";
+  if (access(path.c_str(), F_OK) == -1)
+    path = "../memdisk.fat";
+  auto* fp = fopen(path.c_str(), "rb");
+  EXPECT(fp != nullptr);
+  fseek(fp, 0L, SEEK_END);
+  const long size = ftell(fp);
+  rewind(fp);
+  char* buffer = new char[size];
+  EXPECT(fread(buffer, size, 1, fp) == 1u);
+  fclose(fp);
+
+  mdisk = new MemDisk(buffer, buffer + size);
+  disk = std::make_shared<Disk> (*mdisk);
+  disk->init_fs([&lest_env] (auto err, File_system&) { EXPECT(!err); });
+
+  ent = std::make_unique<Dirent>(disk->fs().stat("/test.pem"));
+  EXPECT(ent->is_file());
+  contents = disk->fs().read(*ent, 0, ent->size()).to_string();
+  EXPECT(contents.size() == ent->size());
+  // enough for a few chunks
+  EXPECT(contents.size() > 1000u);
+}
+
+CASE("disk_transfer hands over chunks one at a time, in order")
+{
+  std::string got;
+  std::vector<Async::next_func> next;
+  int chunks = 0;
+  bool done = false;
+
+  Async::disk_transfer(disk, *ent,
+    [&] (buffer_t buf, Async::next_func n) {
+      chunks++;
+      got.append((const char*) buf->data(), buf->size());
+      next.push_back(n);
+    },
+    [&] (fs::error_t err, bool good) { done = good and not err; },
+    100, 3);
+
+  // the writer gets the next chunk only when it asks for it
+  while (not next.empty())
+  {
+    EXPECT(next.size() == 1u);
+    auto n = next.back();
+    next.clear();
+    n(true);
+  }
+  EXPECT(done);
+  EXPECT(chunks == int((contents.size() + 99) / 100));
+  EXPECT(got == contents);
+}
+
+CASE("disk_transfer stops when a write fails")
+{
+  Async::next_func next;
+  int chunks = 0;
+  bool called = false, good = true;
+
+  Async::disk_transfer(disk, *ent,
+    [&] (buffer_t, Async::next_func n) { chunks++; next = n; },
+    [&] (fs::error_t err, bool g) { called = true; good = g and not err; },
+    100, 3);
+
+  EXPECT(chunks == 1);
+  next(false);
+  EXPECT(called);
+  EXPECT(not good);
+  EXPECT(chunks == 1);
+}
+
+CASE("upload_file pipelines reads and writes, bounded by the write queue")
+{
+  Mock_stream stream;
+  bool done = false;
+
+  Async::upload_file(disk, *ent, &stream,
+    [&] (fs::error_t err, bool good) { done = good and not err; },
+    100, 4, 250);
+
+  // the queue is filled up front, without waiting for the stream
+  EXPECT(stream.pending.size() == 3u);
+  while (not stream.pending.empty())
+  {
+    EXPECT(not done);
+    stream.transmit_one();
+  }
+  EXPECT(done);
+  EXPECT(stream.out == contents);
+  // held back once max_queued is reached, at most a chunk over
+  EXPECT(stream.max_queued < 250u + 100u);
+  // the upload let go of the stream when it finished
+  EXPECT(stream.on_write_ == nullptr);
+}
+
+CASE("upload_file fails and lets go of the stream when it closes")
+{
+  Mock_stream stream;
+  bool called = false, good = true;
+
+  Async::upload_file(disk, *ent, &stream,
+    [&] (fs::error_t err, bool g) { called = true; good = g and not err; },
+    100, 4, 250);
+  EXPECT(stream.on_write_ != nullptr);
+
+  stream.writable = false;
+  stream.transmit_one();
+  EXPECT(called);
+  EXPECT(not good);
+  EXPECT(stream.on_write_ == nullptr);
+  // nothing more is written
+  const auto written = stream.out.size();
+  while (not stream.pending.empty())
+    stream.transmit_one();
+  EXPECT(stream.out.size() == written);
+}
@@ -0,0 +1,131 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2015-2017 Oslo and Akershus University College of Applied Sciences
+// and Alfred Bratterud
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <common.cxx>
+#include <util/path_router.hpp>
+
+using namespace path2regex;
+
+CASE("Router matches static routes")
+{
+  Router router;
+  const auto root  = router.add("/");
+  const auto users = router.add("/users");
+  const auto list  = router.add("/users/list");
+
+  EXPECT(router.fallbacks() == 0u);
+  EXPECT(router.match("/").route == root);
+  EXPECT(router.match("/users").route == users);
+  EXPECT(router.match("/users/").route == users);
+  EXPECT(router.match("/USERS/List").route == list);
+  EXPECT_NOT(router.match("/users/lists"));
+  EXPECT_NOT(router.match("/other"));
+}
+
+CASE("Router captures parameters as views into the path")
+{
+  Router router;
+  const auto user = router.add("/users/:name");
+  const auto post = router.add("/users/:name/posts/:post(\\d+)");
+  EXPECT(router.fallbacks() == 0u);
+
+  const std::string path = "/users/alice/posts/42";
+  auto m = router.match(path);
+  EXPECT(m.route == post);
+  EXPECT(m.count == 2u);
+  EXPECT(m.get("name") == "alice");
+  EXPECT(m.get("name").data() == path.data() + 7);
+  EXPECT(m.get_uint("post").value() == 42u);
+
+  // typed parameter only accepts digits
+  EXPECT_NOT(router.match("/users/alice/posts/latest"));
+
+  m = router.match("/users/bob");
+  EXPECT(m.route == user);
+  EXPECT(m.get("name") == "bob");
+  EXPECT(m.get("post") == "");
+}
+
+CASE("Router prefers static segments and backtracks into parameters")
+{
+  Router router;
+  const auto param = router.add("/files/:id/meta");
+  const auto stat  = router.add("/files/new");
+
+  EXPECT(router.match("/files/new").route == stat);
+  // "new" is also a valid :id
+  auto m = router.match("/files/new/meta");
+  EXPECT(m.route == param);
+  EXPECT(m.get("id") == "new");
+}
+
+CASE("Router handles optional parameters and wildcards")
+{
+  Router router;
+  const auto opt  = router.add("/page/:num?");
+  const auto wild = router.add("/static/*");
+
+  EXPECT(router.match("/page").route == opt);
+  auto m = router.match("/page/3");
+  EXPECT(m.route == opt);
+  EXPECT(m.get("num") == "3");
+
+  m = router.match("/static/css/site.css");
+  EXPECT(m.route == wild);
+  EXPECT(m.count == 1u);
+  EXPECT(m.params[0].value == "css/site.css");
+  EXPECT(router.match("/static/").route == wild);
+}
+
+CASE("Router falls back to regex for custom patterns")
+{
+  Router router;
+  const auto custom = router.add("/users/:role(admin|guest)");
+  const auto any    = router.add("/users/:name");
+  EXPECT(router.fallbacks() == 1u);
+
+  // the fallback was added first and takes precedence
+  auto m = router.match("/users/admin");
+  EXPECT(m.route == custom);
+  EXPECT(m.get("role") == "admin");
+
+  m = router.match("/users/carol");
+  EXPECT(m.route == any);
+  EXPECT(m.get("name") == "carol");
+}
+
+CASE("Router respects the strict, sensitive and end options")
+{
+  Router strict{{{"strict", true}}};
+  const auto a = strict.add("/a/");
+  const auto b = strict.add("/b");
+  EXPECT(strict.match("/a/").route == a);
+  EXPECT_NOT(strict.match("/a"));
+  EXPECT(strict.match("/b").route == b);
+  EXPECT_NOT(strict.match("/b/"));
+
+  Router sensitive{{{"sensitive", true}}};
+  sensitive.add("/Api");
+  EXPECT(sensitive.match("/Api"));
+  EXPECT_NOT(sensitive.match("/api"));
+
+  Router prefix{{{"end", false}}};
+  const auto api = prefix.add("/api");
+  EXPECT(prefix.match("/api/v1/users").route == api);
+  EXPECT_NOT(prefix.match("/apis"));
+}
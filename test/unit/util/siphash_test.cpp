@@ -0,0 +1,31 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <util/siphash.hpp>
+
+CASE("siphash matches the reference vectors")
+{
+  // key 00 01 .. 0f, messages 00 01 .. (len-1)
+  const Siphash_key key {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+  uint8_t msg[64];
+  for(int i = 0; i < 64; i++) msg[i] = i;
+
+  EXPECT(siphash(key, msg, 0)  == 0x726fdb47dd0e0e31ULL);
+  EXPECT(siphash(key, msg, 8)  == 0x93f5f5799a932462ULL);
+  EXPECT(siphash(key, msg, 15) == 0xa129ca6149be45e5ULL);
+  EXPECT(siphash(key, msg, 63) == 0x958a324ceb064572ULL);
+}
@@ -0,0 +1,103 @@
+// This file is a part of the IncludeOS unikernel - www.includeos.org
+//
+// Copyright 2018 IncludeOS AS, Oslo, Norway
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <common.cxx>
+#include <util/syslog_ring.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Logged {
+  int priority;
+  std::string msg;
+};
+static std::vector<Logged> logged;
+
+static void sink(int priority, const char* msg, size_t len)
+{
+  logged.push_back({priority, std::string(msg, len)});
+}
+
+static bool log(Syslog_ring& ring, int priority, const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  const bool ok = ring.record(priority, fmt, args, ENOENT);
+  va_end(args);
+  return ok;
+}
+
+CASE("Syslog_ring formats records when drained")
+{
+  Syslog_ring ring;
+  logged.clear();
+  EXPECT(ring.empty());
+
+  char name[] = "eth0";
+  EXPECT(log(ring, 3, "%s: %d packets, %5.2f%% loss", name, 42, 1.5));
+  // the string is copied when recorded
+  name[0] = 'X';
+  EXPECT(log(ring, 6, "%-4s|%08lx|%c|%m", "ab", 0xbeefUL, 'z'));
+  EXPECT(log(ring, 7, "%*d|%.*s|%llu|%hhu", 4, 7, 3, "abcdef", 1ULL << 40, 300));
+  EXPECT(not ring.empty());
+
+  EXPECT(ring.drain(sink) == 3u);
+  EXPECT(ring.empty());
+  EXPECT(logged.size() == 3u);
+  EXPECT(logged[0].priority == 3);
+  EXPECT(logged[0].msg == "eth0: 42 packets,  1.50% loss");
+  EXPECT(logged[1].priority == 6);
+  EXPECT(logged[1].msg == std::string("ab  |0000beef|z|") + strerror(ENOENT));
+  EXPECT(logged[2].msg == "   7|abc|1099511627776|44");
+}
+
+CASE("Syslog_ring truncates long strings and wraps around")
+{
+  Syslog_ring ring {512};
+  logged.clear();
+
+  std::string longstr(1000, 'x');
+  EXPECT(log(ring, 1, "%s", longstr.c_str()));
+  EXPECT(ring.drain(sink) == 1u);
+  EXPECT(logged.back().msg.size() == Syslog_ring::max_string);
+
+  // fill and drain more than the capacity a few times
+  for (int i = 0; i < 100; i++) {
+    EXPECT(log(ring, 2, "message %d", i));
+    EXPECT(log(ring, 2, "%s %s", "some", "strings"));
+    EXPECT(ring.drain(sink) == 2u);
+    EXPECT(logged[logged.size()-2].msg == "message " + std::to_string(i));
+    EXPECT(logged.back().msg == "some strings");
+  }
+  EXPECT(ring.dropped() == 0u);
+}
+
+CASE("Syslog_ring drops records when full")
+{
+  Syslog_ring ring {256};
+  logged.clear();
+
+  int stored = 0;
+  while (log(ring, 0, "%s", "0123456789abcdef0123456789abcdef"))
+    stored++;
+  EXPECT(stored > 0);
+  EXPECT(ring.dropped() == 1u);
+  EXPECT(not log(ring, 0, "%d", 1));
+  EXPECT(ring.dropped() == 2u);
+
+  EXPECT(ring.drain(sink) == (size_t) stored);
+  EXPECT(log(ring, 0, "%d", 1));
+}